@@ -0,0 +1,322 @@
+/**
+ * @file batch.cpp
+ * @brief Plan every scenario of a batch file (see scenario_io.hpp) and stream the results out as CSV
+ *
+ * Scenarios are read, planned and written one chunk at a time, so memory use depends on the chunk size only,
+ * never on the size of the input. With --threads, the scenarios of a chunk are planned in parallel
+ * and their results are still written in input order.
+ * run with --help for the list of options
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "logging.hpp"
+#include "scenario_io.hpp"
+#include "thread_pool.hpp"
+
+using namespace std;
+
+const size_t DEFAULT_CHUNK_PER_THREAD = 64; ///< scenarios held in memory per worker when --chunk isn't given
+
+/**
+ * command line options of the batch planner
+ */
+struct batch_options
+{
+   string input_path = "-"; ///< scenario file, "-" for STDIN
+   string output_path = "-"; ///< result CSV, "-" for STDOUT
+   size_t threads = 0; ///< plan scenarios on a thread_pool of this many workers, 0 plans serially
+   size_t chunk = 0; ///< scenarios read ahead per round, 0 picks DEFAULT_CHUNK_PER_THREAD per thread
+   pathfind_config config; ///< options for every plan
+   log_level level = log_level::WARNING; ///< runtime log threshold
+};
+
+/**
+ * one scenario of a chunk and its formatted result rows
+ */
+struct batch_item
+{
+   scenario input; ///< scenario as read, reused from chunk to chunk
+   string rows; ///< CSV rows for this scenario
+   bool failed = false; ///< true if plan() threw
+};
+
+/**
+ * @brief print usage to STDERR
+ * @param program argv[0]
+ */
+static void print_usage(const char *program)
+{
+   cerr << "usage: " << program << " [options] [INPUT]\n"
+        << "  INPUT                          binary or text scenario file, - for STDIN (-)\n"
+        << "  --output FILE                  result CSV, - for STDOUT (-)\n"
+        << "  --threads N                    plan scenarios on N workers, 0 for serial (0)\n"
+        << "  --chunk N                      scenarios held in memory at once (" << DEFAULT_CHUNK_PER_THREAD << " per thread)\n"
+        << "  --mode greedy|optimal          assignment mode (greedy)\n"
+        << "  --max-agents N                 reject scenarios with more agents than N (" << NUM_MAX_AGENTS << ")\n"
+        << "  --log-level debug|info|warning|error|none  diagnostics on STDERR (warning)\n";
+}
+
+/**
+ * @brief parse argv into batch_options
+ * Throws std::invalid_argument on an unknown option or a missing value
+ * @param argc from main()
+ * @param argv from main()
+ * @return parsed options
+ */
+static batch_options parse_options(int argc, char **argv)
+{
+   batch_options opts;
+   bool have_input = false;
+   for (int i = 1; i < argc; i++)
+   {
+      string key = argv[i];
+      if (key == "--help")
+      {
+         print_usage(argv[0]);
+         exit(0);
+      }
+      if (key.rfind("--", 0) != 0)
+      {
+         if (have_input)
+         {
+            throw invalid_argument("ERROR: more than one input file given");
+         }
+         opts.input_path = key;
+         have_input = true;
+         continue;
+      }
+      if (i + 1 >= argc)
+      {
+         throw invalid_argument("ERROR: missing value for " + key);
+      }
+      string value = argv[++i];
+
+      if (key == "--output")
+      {
+         opts.output_path = value;
+      }
+      else if (key == "--threads")
+      {
+         opts.threads = stoul(value);
+      }
+      else if (key == "--chunk")
+      {
+         opts.chunk = stoul(value);
+      }
+      else if (key == "--mode")
+      {
+         if (value != "greedy" && value != "optimal")
+         {
+            throw invalid_argument("ERROR: unknown mode " + value);
+         }
+         opts.config.assignment = (value == "optimal") ? assignment_mode::OPTIMAL : assignment_mode::GREEDY;
+      }
+      else if (key == "--max-agents")
+      {
+         opts.config.max_agents = stoul(value);
+      }
+      else if (key == "--log-level")
+      {
+         const vector<pair<string, log_level>> levels = {
+             {"debug", log_level::DEBUG}, {"info", log_level::INFO}, {"warning", log_level::WARNING},
+             {"error", log_level::ERROR}, {"none", log_level::NONE}};
+         bool found = false;
+         for (auto &entry : levels)
+         {
+            if (entry.first == value)
+            {
+               opts.level = entry.second;
+               found = true;
+            }
+         }
+         if (!found)
+         {
+            throw invalid_argument("ERROR: unknown log level " + value);
+         }
+      }
+      else
+      {
+         throw invalid_argument("ERROR: unknown option " + key);
+      }
+   }
+   if (opts.chunk == 0)
+   {
+      opts.chunk = DEFAULT_CHUNK_PER_THREAD * max(opts.threads, static_cast<size_t>(1));
+   }
+   return opts;
+}
+
+/**
+ * @brief quote a CSV field, doubling any quotes inside it
+ * @param field raw text
+ * @return quoted field
+ */
+static string csv_quote(const string &field)
+{
+   string quoted = "\"";
+   for (char c : field)
+   {
+      quoted += c;
+      if (c == '"')
+      {
+         quoted += '"';
+      }
+   }
+   return quoted + "\"";
+}
+
+/**
+ * @brief plan one scenario and format its rows
+ * one row per pathfind_result, or a single "error" row carrying the exception message
+ * @param planner Planner to plan with
+ * @param index position of the scenario in the input
+ * @param item scenario to plan, rows and failed are overwritten
+ */
+static void plan_item(const Planner &planner, size_t index, batch_item &item)
+{
+   const scenario &s = item.input;
+   ostringstream rows;
+   string prefix = to_string(index) + "," + csv_quote(s.name) + ",";
+   try
+   {
+      vector<pathfind_result> results = planner.plan(s.bounds, s.agents, s.targets, s.obstacles);
+      for (auto &result : results)
+      {
+         write_result_row(rows, prefix, result);
+      }
+      item.failed = false;
+   }
+   catch (const exception &e)
+   {
+      rows << prefix << "error,,,,,," << csv_quote(e.what()) << "\n";
+      item.failed = true;
+   }
+   item.rows = rows.str();
+}
+
+int main(int argc, char **argv)
+{
+   batch_options opts;
+   try
+   {
+      opts = parse_options(argc, argv);
+   }
+   catch (const exception &e)
+   {
+      cerr << e.what() << "\n";
+      print_usage(argv[0]);
+      return 1;
+   }
+   set_log_level(opts.level);
+   ios::sync_with_stdio(false);
+
+   ifstream input_file;
+   if (opts.input_path != "-")
+   {
+      input_file.open(opts.input_path, ios::binary);
+      if (!input_file)
+      {
+         cerr << "ERROR: cannot open " << opts.input_path << "\n";
+         return 1;
+      }
+   }
+   istream &in = (opts.input_path == "-") ? cin : input_file;
+
+   ofstream output_file;
+   if (opts.output_path != "-")
+   {
+      output_file.open(opts.output_path);
+      if (!output_file)
+      {
+         cerr << "ERROR: cannot open " << opts.output_path << "\n";
+         return 1;
+      }
+   }
+   ostream &out = (opts.output_path == "-") ? cout : output_file;
+
+   // parallelism is across scenarios, so each plan bids serially and the pool is never re-entered
+   unique_ptr<thread_pool> pool;
+   if (opts.threads > 0)
+   {
+      pool = make_unique<thread_pool>(opts.threads);
+   }
+   opts.config.pool = nullptr;
+   Planner planner(opts.config);
+
+   size_t num_scenarios = 0;
+   size_t num_failures = 0;
+   auto start = chrono::steady_clock::now();
+   vector<batch_item> chunk(opts.chunk);
+   string read_error;
+   try
+   {
+      scenario_reader reader(in);
+      out << "scenario,name,status,id,agent_x,agent_y,target_x,target_y,path\n";
+
+      bool more = true;
+      while (more)
+      {
+         size_t count = 0;
+         try
+         {
+            while (count < chunk.size() && (more = reader.next(chunk[count].input)))
+            {
+               count++;
+            }
+         }
+         catch (const exception &e)
+         {
+            // the input itself is broken, still plan and write the scenarios of this chunk read before it
+            read_error = e.what();
+            more = false;
+         }
+
+         size_t first_index = num_scenarios;
+         auto plan_one = [&](size_t i) { plan_item(planner, first_index + i, chunk[i]); };
+         if (pool)
+         {
+            pool->parallel_for(count, plan_one);
+         }
+         else
+         {
+            for (size_t i = 0; i < count; i++)
+            {
+               plan_one(i);
+            }
+         }
+
+         for (size_t i = 0; i < count; i++)
+         {
+            out << chunk[i].rows;
+            num_failures += chunk[i].failed ? 1 : 0;
+         }
+         num_scenarios += count;
+      }
+   }
+   catch (const exception &e)
+   {
+      read_error = e.what();
+   }
+   out.flush();
+   if (!read_error.empty())
+   {
+      // everything read before the broken input has been written
+      cerr << read_error << " (after " << num_scenarios << " scenarios)\n";
+      return 1;
+   }
+
+   double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+   cerr << "planned " << num_scenarios << " scenarios, " << num_failures << " failed, in " << seconds << " s ("
+        << ((seconds > 0) ? num_scenarios / seconds : 0) << " scenarios/sec)\n";
+   return out ? 0 : 1;
+}
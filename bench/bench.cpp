@@ -0,0 +1,1124 @@
+/**
+ * @file bench.cpp
+ * @brief Benchmark libpathfinding over the fixed TEST_n scenarios and seeded random ones
+ *
+ * Prints one JSON object per line per case, so runs can be diffed or collected to track regressions
+ * run with --help for the list of options
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "logging.hpp"
+#include "obstacle_map.hpp"
+#include "obstacle_soa.hpp"
+#include "path_codec.hpp"
+#include "tiled_map.hpp"
+#include "thread_pool.hpp"
+#include "scenario.hpp"
+
+using namespace std;
+
+static atomic<size_t> heap_allocs{0}; ///< calls to operator new, the library's included
+static atomic<size_t> heap_bytes{0}; ///< bytes asked of operator new
+
+/**
+ * @brief counting replacements of the global allocation functions, so the bench sees every heap call a plan makes
+ * The array and nothrow forms forward to these. The deletes stay out of line, or GCC pairs the inlined free()
+ * with operator new at the call site and warns about a mismatch
+ */
+void *operator new(size_t size)
+{
+   heap_allocs.fetch_add(1, memory_order_relaxed);
+   heap_bytes.fetch_add(size, memory_order_relaxed);
+   void *p = malloc(max(size, static_cast<size_t>(1)));
+   if (p == nullptr)
+   {
+      throw bad_alloc();
+   }
+   return p;
+}
+
+void *operator new(size_t size, align_val_t alignment)
+{
+   heap_allocs.fetch_add(1, memory_order_relaxed);
+   heap_bytes.fetch_add(size, memory_order_relaxed);
+   size_t align = static_cast<size_t>(alignment);
+   void *p = aligned_alloc(align, (max(size, static_cast<size_t>(1)) + align - 1) & ~(align - 1));
+   if (p == nullptr)
+   {
+      throw bad_alloc();
+   }
+   return p;
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept
+{
+   free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept
+{
+   free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, align_val_t) noexcept
+{
+   free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t, align_val_t) noexcept
+{
+   free(p);
+}
+
+/**
+ * which Planner entry point a case calls
+ */
+enum class plan_api
+{
+   VECTOR, ///< Planner::plan(), a new vector of owning results per plan
+   SPAN, ///< Planner::plan_into(), one path_buffer and plan_workspace reused by every plan of the case
+   ANYTIME, ///< Planner::plan() with a deadline of bench_options::deadline_us after the plan starts
+   REPLAN ///< Replanner::replan() after moving bench_options::moves agents, reset() once per scenario untimed
+};
+
+/**
+ * command line options of the benchmark
+ */
+struct bench_options
+{
+   string cases = "all"; ///< "fixed", "random" or "all"
+   size_t iterations = 20; ///< timed plans per scenario
+   size_t num_scenarios = 20; ///< random scenarios to generate, seeds random.seed .. random.seed + num_scenarios - 1
+   size_t threads = 0; ///< bid on a thread_pool of this many workers, 0 bids serially
+   assignment_mode mode = assignment_mode::GREEDY; ///< assignment mode of the Planner
+   bool use_path_cache = true; ///< pathfind_config::use_path_cache of the Planner
+   bool prune_bids = true; ///< pathfind_config::prune_bids of the Planner
+   vector<path_engine> engines = {path_engine::HULL}; ///< run every case once per engine
+   vector<coordinate_mode> coordinates = {coordinate_mode::DOUBLE}; ///< and once per obstacle storage mode
+   vector<plan_api> apis = {plan_api::VECTOR}; ///< and once per entry point
+   double deadline_us = 1000; ///< budget of every plan with plan_api::ANYTIME
+   size_t moves = 1; ///< agents moved before every plan with plan_api::REPLAN
+   double move_step = 0.05; ///< largest distance along each axis an agent moves per plan with plan_api::REPLAN
+   double arc_tolerance = pathfind_config().arc_tolerance; ///< pathfind_config::arc_tolerance of the Planner
+   int points_per_circle = pathfind_config().points_per_circle; ///< pathfind_config::points_per_circle of the Planner
+   double max_chord_error = pathfind_config().max_chord_error; ///< pathfind_config::max_chord_error of the Planner
+   double simplify_tolerance = pathfind_config().simplify_tolerance; ///< pathfind_config::simplify_tolerance of the Planner
+   bool simd = true; ///< use the SIMD obstacle kernels where the CPU has them, see set_simd_kernels()
+   bool map_case = false; ///< also time obstacle_map builds and queries over the random scenarios
+   bool tiled_case = false; ///< also time tiled_map builds and queries over the random scenarios
+   double tile_size = 2.5; ///< tile side of the tiled case
+   bool codec_case = false; ///< also time encode_paths() and decode_paths() over the plan of every scenario
+   int codec_bits = path_frame().bits; ///< path_frame::bits of the codec case
+   scenario_params random; ///< generator knobs for the random case
+   string write_path; ///< if set, write the selected scenarios here instead of benchmarking
+   scenario_format write_format = scenario_format::BINARY; ///< encoding used with write_path
+};
+
+/**
+ * everything measured over one case
+ */
+struct case_result
+{
+   vector<double> latency_seconds; ///< end to end time of every successful plan, output included
+   double validate_seconds = 0; ///< summed over successful plans
+   double bid_seconds = 0; ///< summed over successful plans
+   double uncross_seconds = 0; ///< summed over successful plans
+   double output_seconds = 0; ///< summed over successful plans
+   size_t soa_bytes = 0; ///< obstacle_soa_bytes() of every scenario's obstacle index, summed
+   size_t index_bytes = 0; ///< obstacle_index_bytes() of every scenario's obstacle index, summed
+   double wall_seconds = 0; ///< time spent in the timed loop, failures included
+   size_t num_bids = 0; ///< summed over successful plans
+   size_t bids_pruned = 0; ///< summed over successful plans
+   size_t curves_pruned = 0; ///< summed over successful plans
+   size_t num_swaps = 0; ///< summed over successful plans
+   size_t cache_hits = 0; ///< summed over successful plans
+   size_t cache_misses = 0; ///< summed over successful plans
+   size_t heap_allocs = 0; ///< operator new calls inside plan(), summed over successful plans
+   size_t heap_bytes = 0; ///< bytes of those calls, summed over successful plans
+   size_t scratch_peak_bytes = 0; ///< largest plan_stats::scratch_peak_bytes of any plan
+   size_t scratch_spills = 0; ///< summed over successful plans
+   size_t num_converged = 0; ///< successful plans that finished, with plan_api::ANYTIME those that beat their deadline
+   size_t unrouted_paths = 0; ///< anytime_plan::unrouted_paths summed over successful plans
+   size_t keepout_vertices = 0; ///< plan_stats::keepout_vertices summed over successful plans
+   size_t points_simplified = 0; ///< plan_stats::points_simplified summed over successful plans
+   size_t path_points = 0; ///< points of every result path, summed over successful plans
+   size_t targets_rebid = 0; ///< plan_stats::targets_rebid summed over successful plans
+   size_t paths_invalidated = 0; ///< plan_stats::paths_invalidated summed over successful plans
+   double path_length = 0; ///< length of every result path, summed over successful plans
+   size_t num_plans = 0; ///< plans attempted
+   size_t num_failures = 0; ///< plans that threw
+};
+
+/**
+ * @brief print usage to STDERR
+ * @param program argv[0]
+ */
+static void print_usage(const char *program)
+{
+   cerr << "usage: " << program << " [options]\n"
+        << "  --cases fixed|random|all       which scenarios to run (all)\n"
+        << "  --iterations N                 timed plans per scenario (20)\n"
+        << "  --scenarios N                  random scenarios to generate (20)\n"
+        << "  --threads N                    thread_pool workers for bidding, 0 for serial (0)\n"
+        << "  --mode greedy|optimal          assignment mode (greedy)\n"
+        << "  --path-cache on|off            reuse computed paths within a plan (on)\n"
+        << "  --prune on|off                 greedy mode skips bids whose straight-line distance can't win (on)\n"
+        << "  --engine hull|tangent|both     curved path engine, both runs every case twice (hull)\n"
+        << "  --coords double|float32|both   obstacle index storage, both runs every case twice (double)\n"
+        << "  --api vector|span|anytime|replan|both  plan(), plan_into() with reused buffers, plan() with a deadline,\n"
+        << "                                 or Replanner ticks, both runs every case with vector and span (vector)\n"
+        << "  --deadline-us F                budget of each plan with --api anytime (1000)\n"
+        << "  --moves N                      agents moved before each tick with --api replan (1)\n"
+        << "  --move-step F                  largest move along each axis per tick with --api replan (0.05)\n"
+        << "  --arc-tolerance F              tangent engine arc sampling tolerance (" << pathfind_config().arc_tolerance << ")\n"
+        << "  --points N                     hull engine points per keepout circle (" << pathfind_config().points_per_circle << ")\n"
+        << "  --chord-error F                hull engine picks each circle's points for this error instead of --points, 0 for off (0)\n"
+        << "  --simplify F                   drop curved path points within F of a shortcut that clears every obstacle, 0 for off (0)\n"
+        << "  --map on|off                   also time obstacle_map build and agent x target queries on the random scenarios (off)\n"
+        << "  --tiled on|off                 also time tiled_map build and agent x target queries on the random scenarios (off)\n"
+        << "  --tile-size F                  tile side of --tiled (2.5)\n"
+        << "  --codec on|off                 also time the binary path encoding of every scenario's plan (off)\n"
+        << "  --codec-bits N                 bits per quantized coordinate of the path encoding, 1 to 32 (" << path_frame().bits << ")\n"
+        << "  --simd on|off                  SIMD obstacle kernels if the CPU supports them (on)\n"
+        << "  --seed N                       seed of the first random scenario (1)\n"
+        << "  --agents N                     agents per random scenario (8)\n"
+        << "  --targets N                    targets per random scenario (8)\n"
+        << "  --density F                    fraction of area covered by obstacles (0.05)\n"
+        << "  --width F                      width of random scenarios (10)\n"
+        << "  --height F                     height of random scenarios (10)\n"
+        << "  --radius-min F                 smallest obstacle radius (0.2)\n"
+        << "  --radius-max F                 largest obstacle radius (1.0)\n"
+        << "  --radius-dist uniform|exponential  obstacle radius distribution (uniform)\n"
+        << "  --write FILE                   write the selected scenarios to FILE for pathfinding_batch and exit\n"
+        << "  --write-format binary|text     encoding used with --write (binary)\n";
+}
+
+/**
+ * @brief parse argv into bench_options
+ * Throws std::invalid_argument on an unknown option or a missing value
+ * @param argc from main()
+ * @param argv from main()
+ * @return parsed options
+ */
+static bench_options parse_options(int argc, char **argv)
+{
+   bench_options opts;
+   for (int i = 1; i < argc; i++)
+   {
+      string key = argv[i];
+      if (key == "--help")
+      {
+         print_usage(argv[0]);
+         exit(0);
+      }
+      if (i + 1 >= argc)
+      {
+         throw invalid_argument("ERROR: missing value for " + key);
+      }
+      string value = argv[++i];
+
+      if (key == "--cases")
+      {
+         if (value != "fixed" && value != "random" && value != "all")
+         {
+            throw invalid_argument("ERROR: unknown case set " + value);
+         }
+         opts.cases = value;
+      }
+      else if (key == "--iterations")
+      {
+         opts.iterations = stoul(value);
+      }
+      else if (key == "--scenarios")
+      {
+         opts.num_scenarios = stoul(value);
+      }
+      else if (key == "--threads")
+      {
+         opts.threads = stoul(value);
+      }
+      else if (key == "--mode")
+      {
+         if (value != "greedy" && value != "optimal")
+         {
+            throw invalid_argument("ERROR: unknown mode " + value);
+         }
+         opts.mode = (value == "optimal") ? assignment_mode::OPTIMAL : assignment_mode::GREEDY;
+      }
+      else if (key == "--path-cache")
+      {
+         if (value != "on" && value != "off")
+         {
+            throw invalid_argument("ERROR: --path-cache takes on or off");
+         }
+         opts.use_path_cache = (value == "on");
+      }
+      else if (key == "--prune")
+      {
+         if (value != "on" && value != "off")
+         {
+            throw invalid_argument("ERROR: --prune takes on or off");
+         }
+         opts.prune_bids = (value == "on");
+      }
+      else if (key == "--engine")
+      {
+         if (value == "hull")
+         {
+            opts.engines = {path_engine::HULL};
+         }
+         else if (value == "tangent")
+         {
+            opts.engines = {path_engine::TANGENT};
+         }
+         else if (value == "both")
+         {
+            opts.engines = {path_engine::HULL, path_engine::TANGENT};
+         }
+         else
+         {
+            throw invalid_argument("ERROR: unknown engine " + value);
+         }
+      }
+      else if (key == "--coords")
+      {
+         if (value == "double")
+         {
+            opts.coordinates = {coordinate_mode::DOUBLE};
+         }
+         else if (value == "float32")
+         {
+            opts.coordinates = {coordinate_mode::FLOAT32};
+         }
+         else if (value == "both")
+         {
+            opts.coordinates = {coordinate_mode::DOUBLE, coordinate_mode::FLOAT32};
+         }
+         else
+         {
+            throw invalid_argument("ERROR: unknown coordinate mode " + value);
+         }
+      }
+      else if (key == "--api")
+      {
+         if (value == "vector")
+         {
+            opts.apis = {plan_api::VECTOR};
+         }
+         else if (value == "span")
+         {
+            opts.apis = {plan_api::SPAN};
+         }
+         else if (value == "anytime")
+         {
+            opts.apis = {plan_api::ANYTIME};
+         }
+         else if (value == "replan")
+         {
+            opts.apis = {plan_api::REPLAN};
+         }
+         else if (value == "both")
+         {
+            opts.apis = {plan_api::VECTOR, plan_api::SPAN};
+         }
+         else
+         {
+            throw invalid_argument("ERROR: unknown api " + value);
+         }
+      }
+      else if (key == "--simd")
+      {
+         if (value != "on" && value != "off")
+         {
+            throw invalid_argument("ERROR: --simd takes on or off");
+         }
+         opts.simd = (value == "on");
+      }
+      else if (key == "--width")
+      {
+         opts.random.width = stod(value);
+      }
+      else if (key == "--height")
+      {
+         opts.random.height = stod(value);
+      }
+      else if (key == "--map")
+      {
+         if (value != "on" && value != "off")
+         {
+            throw invalid_argument("ERROR: --map takes on or off");
+         }
+         opts.map_case = (value == "on");
+      }
+      else if (key == "--tiled")
+      {
+         if (value != "on" && value != "off")
+         {
+            throw invalid_argument("ERROR: --tiled takes on or off");
+         }
+         opts.tiled_case = (value == "on");
+      }
+      else if (key == "--tile-size")
+      {
+         opts.tile_size = stod(value);
+         if (!(opts.tile_size > 0))
+         {
+            throw invalid_argument("ERROR: --tile-size must be > 0");
+         }
+      }
+      else if (key == "--codec")
+      {
+         if (value != "on" && value != "off")
+         {
+            throw invalid_argument("ERROR: --codec takes on or off");
+         }
+         opts.codec_case = (value == "on");
+      }
+      else if (key == "--codec-bits")
+      {
+         opts.codec_bits = stoi(value);
+         if (opts.codec_bits < 1 || opts.codec_bits > 32)
+         {
+            throw invalid_argument("ERROR: --codec-bits must be 1 to 32");
+         }
+      }
+      else if (key == "--deadline-us")
+      {
+         opts.deadline_us = stod(value);
+         if (!(opts.deadline_us >= 0))
+         {
+            throw invalid_argument("ERROR: --deadline-us must not be negative");
+         }
+      }
+      else if (key == "--moves")
+      {
+         opts.moves = stoul(value);
+      }
+      else if (key == "--move-step")
+      {
+         opts.move_step = stod(value);
+         if (!(opts.move_step >= 0))
+         {
+            throw invalid_argument("ERROR: --move-step must not be negative");
+         }
+      }
+      else if (key == "--points")
+      {
+         opts.points_per_circle = stoi(value);
+         if (opts.points_per_circle < 3)
+         {
+            throw invalid_argument("ERROR: --points must be at least 3");
+         }
+      }
+      else if (key == "--chord-error")
+      {
+         opts.max_chord_error = stod(value);
+         if (!(opts.max_chord_error >= 0))
+         {
+            throw invalid_argument("ERROR: --chord-error must not be negative");
+         }
+      }
+      else if (key == "--simplify")
+      {
+         opts.simplify_tolerance = stod(value);
+         if (!(opts.simplify_tolerance >= 0))
+         {
+            throw invalid_argument("ERROR: --simplify must not be negative");
+         }
+      }
+      else if (key == "--arc-tolerance")
+      {
+         opts.arc_tolerance = stod(value);
+         if (!(opts.arc_tolerance > 0))
+         {
+            throw invalid_argument("ERROR: --arc-tolerance must be > 0");
+         }
+      }
+      else if (key == "--seed")
+      {
+         opts.random.seed = stoull(value);
+      }
+      else if (key == "--agents")
+      {
+         opts.random.num_agents = stoul(value);
+      }
+      else if (key == "--targets")
+      {
+         opts.random.num_targets = stoul(value);
+      }
+      else if (key == "--density")
+      {
+         opts.random.obstacle_density = stod(value);
+      }
+      else if (key == "--radius-min")
+      {
+         opts.random.radius_min = stod(value);
+      }
+      else if (key == "--radius-max")
+      {
+         opts.random.radius_max = stod(value);
+      }
+      else if (key == "--radius-dist")
+      {
+         if (value != "uniform" && value != "exponential")
+         {
+            throw invalid_argument("ERROR: unknown radius distribution " + value);
+         }
+         opts.random.radius_dist = (value == "exponential") ? radius_distribution::EXPONENTIAL : radius_distribution::UNIFORM;
+      }
+      else if (key == "--write")
+      {
+         opts.write_path = value;
+      }
+      else if (key == "--write-format")
+      {
+         if (value != "binary" && value != "text")
+         {
+            throw invalid_argument("ERROR: unknown scenario format " + value);
+         }
+         opts.write_format = (value == "text") ? scenario_format::TEXT : scenario_format::BINARY;
+      }
+      else
+      {
+         throw invalid_argument("ERROR: unknown option " + key);
+      }
+   }
+   return opts;
+}
+
+/**
+ * @brief nearest-rank percentile
+ * @param sorted samples in ascending order
+ * @param fraction percentile as a fraction, 0.99 for p99
+ * @return the sample at that rank, 0 if there are none
+ */
+static double percentile(const vector<double> &sorted, double fraction)
+{
+   if (sorted.empty())
+   {
+      return 0;
+   }
+   size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+   rank = min(max(rank, static_cast<size_t>(1)), sorted.size());
+   return sorted[rank - 1];
+}
+
+/**
+ * @brief one tick of agent movement for plan_api::REPLAN
+ * Each moved agent is nudged by up to move_step along each axis, a nudge that would leave the boundary
+ * or land in an obstacle is drawn again a few times and then dropped
+ * @param replanner Replanner holding the current agents
+ * @param s scenario being replanned, for its boundary and obstacles
+ * @param opts number of moves and their size
+ * @param rng random source of the case
+ * @return delta moving up to opts.moves agents
+ */
+static replan_delta random_moves(const Replanner &replanner, const scenario &s, const bench_options &opts, mt19937_64 &rng)
+{
+   const int MAX_DRAWS = 8;
+   const vector<Point> &agents = replanner.agents();
+   uniform_real_distribution<double> step(-opts.move_step, opts.move_step);
+   replan_delta delta;
+   for (size_t m = 0; m < opts.moves && !agents.empty(); m++)
+   {
+      size_t a = rng() % agents.size();
+      for (int draw = 0; draw < MAX_DRAWS; draw++)
+      {
+         Point p(agents[a].x() + step(rng), agents[a].y() + step(rng));
+         bool is_clear = bg::covered_by(p, s.bounds) &&
+                         none_of(s.obstacles.begin(), s.obstacles.end(), [&](const obstacle &o) { return bg::distance(p, o.p) <= o.radius; });
+         if (is_clear)
+         {
+            delta.moved_agents.push_back({a, p});
+            break;
+         }
+      }
+   }
+   return delta;
+}
+
+/**
+ * @brief plan each scenario once untimed, then iterations times timed
+ * output is formatted into a reused string stream, so the "output" phase measures CSV formatting and not terminal I/O
+ * with plan_api::SPAN every plan writes into the same path_buffer, so its allocations are only counted until it has grown.
+ * With plan_api::REPLAN the untimed plan is a Replanner::reset() and every timed plan is a replan() after random_moves(),
+ * a replan() that throws is followed by an untimed reset()
+ * @param planner Planner to benchmark
+ * @param api entry point to call
+ * @param scenarios scenarios of this case
+ * @param opts iterations, and the options of the anytime and replan entry points
+ * @return measurements of the case
+ */
+static case_result run_case(const Planner &planner, plan_api api, const vector<scenario> &scenarios, const bench_options &opts)
+{
+   auto budget = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, micro>(opts.deadline_us));
+   case_result result;
+   ostringstream sink;
+   path_buffer buffer;
+   plan_workspace workspace;
+   vector<unique_ptr<Replanner>> replanners;
+   mt19937_64 rng(opts.random.seed);
+
+   for (auto &s : scenarios)
+   {
+      obstacle_index index = build_obstacle_index(s.obstacles, planner.config().coordinates);
+      result.soa_bytes += obstacle_soa_bytes(index.soa);
+      result.index_bytes += obstacle_index_bytes(index);
+      replanners.push_back(make_unique<Replanner>(planner.config()));
+      try
+      {
+         if (api == plan_api::SPAN)
+         {
+            planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, buffer, workspace);
+         }
+         else if (api == plan_api::REPLAN)
+         {
+            replanners.back()->reset(s.bounds, s.agents, s.targets, s.obstacles);
+         }
+         else
+         {
+            planner.plan(s.bounds, s.agents, s.targets, s.obstacles);
+         }
+      }
+      catch (const exception &)
+      {
+         // counted below on the timed runs
+      }
+   }
+
+   auto wall_start = chrono::steady_clock::now();
+   for (size_t n = 0; n < scenarios.size(); n++)
+   {
+      const scenario &s = scenarios[n];
+      Replanner &replanner = *replanners[n];
+      for (size_t i = 0; i < opts.iterations; i++)
+      {
+         result.num_plans++;
+         plan_stats stats;
+         replan_delta delta;
+         if (api == plan_api::REPLAN)
+         {
+            if (!replanner.has_plan())
+            {
+               try
+               {
+                  replanner.reset(s.bounds, s.agents, s.targets, s.obstacles);
+               }
+               catch (const exception &)
+               {
+                  result.num_failures++;
+                  continue;
+               }
+            }
+            delta = random_moves(replanner, s, opts, rng);
+         }
+         auto start = chrono::steady_clock::now();
+         size_t allocs_before = heap_allocs.load(memory_order_relaxed);
+         size_t bytes_before = heap_bytes.load(memory_order_relaxed);
+         vector<pathfind_result> results;
+         const vector<pathfind_result> *planned = &results; // replanned results stay in their Replanner
+         bool converged = true; // only anytime plans can stop short
+         try
+         {
+            if (api == plan_api::SPAN)
+            {
+               planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, buffer, workspace, &stats);
+            }
+            else if (api == plan_api::ANYTIME)
+            {
+               anytime_plan anytime = planner.plan(s.bounds, s.agents, s.targets, s.obstacles, start + budget, &stats);
+               results = move(anytime.results);
+               converged = anytime.converged;
+               result.unrouted_paths += anytime.unrouted_paths;
+            }
+            else if (api == plan_api::REPLAN)
+            {
+               planned = &replanner.replan(delta, &stats);
+            }
+            else
+            {
+               results = planner.plan(s.bounds, s.agents, s.targets, s.obstacles, &stats);
+            }
+         }
+         catch (const exception &)
+         {
+            result.num_failures++;
+            continue;
+         }
+         size_t allocs = heap_allocs.load(memory_order_relaxed) - allocs_before;
+         size_t bytes = heap_bytes.load(memory_order_relaxed) - bytes_before;
+         auto output_start = chrono::steady_clock::now();
+         sink.str("");
+         if (api == plan_api::SPAN)
+         {
+            print_result(sink, s.bounds, s.obstacles, buffer);
+         }
+         else
+         {
+            print_result(sink, s.bounds, (api == plan_api::REPLAN) ? replanner.obstacles() : s.obstacles, *planned);
+         }
+         auto end = chrono::steady_clock::now();
+
+         result.latency_seconds.push_back(chrono::duration<double>(end - start).count());
+         result.validate_seconds += stats.validate_seconds;
+         result.bid_seconds += stats.bid_seconds;
+         result.uncross_seconds += stats.uncross_seconds;
+         result.output_seconds += chrono::duration<double>(end - output_start).count();
+         result.num_bids += stats.num_bids;
+         result.bids_pruned += stats.bids_pruned;
+         result.curves_pruned += stats.curves_pruned;
+         result.num_swaps += stats.num_swaps;
+         result.num_converged += converged ? 1 : 0;
+         result.cache_hits += stats.cache_hits;
+         result.cache_misses += stats.cache_misses;
+         result.heap_allocs += allocs;
+         result.heap_bytes += bytes;
+         result.scratch_peak_bytes = max(result.scratch_peak_bytes, stats.scratch_peak_bytes);
+         result.scratch_spills += stats.scratch_spills;
+         result.keepout_vertices += stats.keepout_vertices;
+         result.points_simplified += stats.points_simplified;
+         result.targets_rebid += stats.targets_rebid;
+         result.paths_invalidated += stats.paths_invalidated;
+         for (auto &r : *planned)
+         {
+            result.path_length += bg::length(r.path);
+            result.path_points += r.path.size();
+         }
+         for (size_t r = 0; r < path_buffer_size(buffer); r++)
+         {
+            span<const Point> path = path_buffer_path(buffer, r);
+            result.path_points += path.size();
+            for (size_t j = 1; j < path.size(); j++)
+            {
+               result.path_length += bg::distance(path[j - 1], path[j]);
+            }
+         }
+      }
+   }
+   result.wall_seconds = chrono::duration<double>(chrono::steady_clock::now() - wall_start).count();
+   return result;
+}
+
+/**
+ * @brief print a case_result as one line of JSON on STDOUT
+ * times are in microseconds, phase times are means per successful plan
+ * @param name case label
+ * @param opts options the case ran with
+ * @param config Planner options the case ran with
+ * @param api entry point the case called
+ * @param num_scenarios number of scenarios in the case
+ * @param result measurements of the case
+ */
+static void report_case(const string &name, const bench_options &opts, const pathfind_config &config, plan_api api, size_t num_scenarios, case_result &result)
+{
+   const double US = 1e6;
+   vector<double> &latency = result.latency_seconds;
+   sort(latency.begin(), latency.end());
+   size_t num_ok = latency.size();
+   double per_plan = (num_ok > 0) ? US / num_ok : 0;
+   double total = 0;
+   for (double l : latency)
+   {
+      total += l;
+   }
+
+   cout << "{\"case\":\"" << name << "\""
+        << ",\"mode\":\"" << (opts.mode == assignment_mode::OPTIMAL ? "optimal" : "greedy") << "\""
+        << ",\"engine\":\"" << (config.engine == path_engine::TANGENT ? "tangent" : "hull") << "\""
+        << ",\"coords\":\"" << (config.coordinates == coordinate_mode::FLOAT32 ? "float32" : "double") << "\""
+        << ",\"api\":\"" << (api == plan_api::SPAN ? "span" : (api == plan_api::ANYTIME) ? "anytime" : (api == plan_api::REPLAN) ? "replan" : "vector") << "\""
+        << ",\"kernels\":\"" << obstacle_kernel_name() << "\""
+        << ",\"threads\":" << opts.threads
+        << ",\"scenarios\":" << num_scenarios
+        << ",\"plans\":" << result.num_plans
+        << ",\"failures\":" << result.num_failures
+        << ",\"plans_per_sec\":" << ((result.wall_seconds > 0) ? num_ok / result.wall_seconds : 0)
+        << ",\"latency_us\":{\"mean\":" << total * per_plan
+        << ",\"p50\":" << percentile(latency, 0.50) * US
+        << ",\"p99\":" << percentile(latency, 0.99) * US
+        << ",\"max\":" << (latency.empty() ? 0 : latency.back() * US) << "}"
+        << ",\"phase_us\":{\"validate\":" << result.validate_seconds * per_plan
+        << ",\"bid\":" << result.bid_seconds * per_plan
+        << ",\"uncross\":" << result.uncross_seconds * per_plan
+        << ",\"output\":" << result.output_seconds * per_plan << "}"
+        << ",\"bids_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.num_bids) / num_ok : 0)
+        << ",\"bids_pruned_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.bids_pruned) / num_ok : 0)
+        << ",\"curves_pruned_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.curves_pruned) / num_ok : 0)
+        << ",\"swaps_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.num_swaps) / num_ok : 0)
+        << ",\"cache_hits_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.cache_hits) / num_ok : 0)
+        << ",\"cache_misses_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.cache_misses) / num_ok : 0)
+        << ",\"heap_allocs_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.heap_allocs) / num_ok : 0)
+        << ",\"heap_bytes_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.heap_bytes) / num_ok : 0)
+        << ",\"scratch_peak_bytes\":" << result.scratch_peak_bytes
+        << ",\"scratch_spills_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.scratch_spills) / num_ok : 0)
+        << ",\"converged_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.num_converged) / num_ok : 0)
+        << ",\"unrouted_paths_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.unrouted_paths) / num_ok : 0)
+        << ",\"keepout_vertices_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.keepout_vertices) / num_ok : 0)
+        << ",\"points_simplified_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.points_simplified) / num_ok : 0)
+        << ",\"path_points_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.path_points) / num_ok : 0)
+        << ",\"targets_rebid_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.targets_rebid) / num_ok : 0)
+        << ",\"paths_invalidated_per_plan\":" << ((num_ok > 0) ? static_cast<double>(result.paths_invalidated) / num_ok : 0)
+        << ",\"length_per_plan\":" << ((num_ok > 0) ? result.path_length / num_ok : 0)
+        << ",\"soa_bytes_per_scenario\":" << result.soa_bytes / max(num_scenarios, static_cast<size_t>(1))
+        << ",\"index_bytes_per_scenario\":" << result.index_bytes / max(num_scenarios, static_cast<size_t>(1))
+        << "}" << endl;
+}
+
+/**
+ * @brief generate the random case
+ * @param opts generator knobs and scenario count
+ * @return opts.num_scenarios scenarios with consecutive seeds
+ */
+static vector<scenario> random_scenarios(const bench_options &opts)
+{
+   vector<scenario> scenarios;
+   for (size_t i = 0; i < opts.num_scenarios; i++)
+   {
+      scenario_params params = opts.random;
+      params.seed = opts.random.seed + i;
+      scenarios.push_back(generate_scenario(params));
+   }
+   return scenarios;
+}
+
+/**
+ * @brief build an obstacle_map per scenario and query every {agent, target} pair against it
+ * prints one line of JSON on STDOUT, times are in microseconds
+ * @param opts options the case runs with
+ * @param scenarios scenarios of the case
+ */
+static void run_map_case(const bench_options &opts, const vector<scenario> &scenarios)
+{
+   const double US = 1e6;
+   vector<double> query_seconds;
+   double build_seconds = 0;
+   size_t num_edges = 0;
+   size_t num_unreachable = 0;
+   double path_length = 0;
+   for (auto &s : scenarios)
+   {
+      auto build_start = chrono::steady_clock::now();
+      obstacle_map map(s.bounds, s.obstacles, pathfind_config().min_keepout_buffer, opts.arc_tolerance);
+      build_seconds += chrono::duration<double>(chrono::steady_clock::now() - build_start).count();
+      num_edges += map.num_edges();
+      for (size_t i = 0; i < opts.iterations; i++)
+      {
+         for (auto &agent : s.agents)
+         {
+            for (auto &target : s.targets)
+            {
+               auto start = chrono::steady_clock::now();
+               Line path = map.find_path(agent, target);
+               query_seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+               num_unreachable += path.empty() ? 1 : 0;
+               path_length += bg::length(path);
+            }
+         }
+      }
+   }
+   sort(query_seconds.begin(), query_seconds.end());
+   double total = 0;
+   for (double q : query_seconds)
+   {
+      total += q;
+   }
+   size_t n = max(query_seconds.size(), static_cast<size_t>(1));
+   cout << "{\"case\":\"map\""
+        << ",\"scenarios\":" << scenarios.size()
+        << ",\"queries\":" << query_seconds.size()
+        << ",\"unreachable\":" << num_unreachable
+        << ",\"build_us\":" << ((scenarios.empty()) ? 0 : build_seconds * US / scenarios.size())
+        << ",\"edges_per_map\":" << ((scenarios.empty()) ? 0 : static_cast<double>(num_edges) / scenarios.size())
+        << ",\"query_us\":{\"mean\":" << total * US / n
+        << ",\"p50\":" << percentile(query_seconds, 0.50) * US
+        << ",\"p99\":" << percentile(query_seconds, 0.99) * US << "}"
+        << ",\"length_per_query\":" << path_length / n
+        << "}" << endl;
+}
+
+/**
+ * @brief build a tiled_map per scenario and query every {agent, target} pair against it
+ * prints one line of JSON on STDOUT, times are in microseconds, loads are per query
+ * @param opts options the case runs with
+ * @param scenarios scenarios of the case
+ */
+static void run_tiled_case(const bench_options &opts, const vector<scenario> &scenarios)
+{
+   const double US = 1e6;
+   vector<double> query_seconds;
+   double build_seconds = 0;
+   size_t num_unreachable = 0;
+   double path_length = 0;
+   size_t num_obstacles = 0;
+   tiled_path_stats totals;
+   for (auto &s : scenarios)
+   {
+      auto build_start = chrono::steady_clock::now();
+      tiled_map map(s.bounds, s.obstacles, opts.tile_size, pathfind_config().min_keepout_buffer, opts.arc_tolerance);
+      build_seconds += chrono::duration<double>(chrono::steady_clock::now() - build_start).count();
+      num_obstacles += map.num_obstacles();
+      for (size_t i = 0; i < opts.iterations; i++)
+      {
+         for (auto &agent : s.agents)
+         {
+            for (auto &target : s.targets)
+            {
+               tiled_path_stats stats;
+               auto start = chrono::steady_clock::now();
+               Line path = map.find_path(agent, target, &stats);
+               query_seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+               num_unreachable += path.empty() ? 1 : 0;
+               path_length += bg::length(path);
+               totals.route_tiles += stats.route_tiles;
+               totals.coarse_expanded += stats.coarse_expanded;
+               totals.legs += stats.legs;
+               totals.tiles_loaded += stats.tiles_loaded;
+               totals.obstacles_loaded += stats.obstacles_loaded;
+            }
+         }
+      }
+   }
+   sort(query_seconds.begin(), query_seconds.end());
+   double total = 0;
+   for (double q : query_seconds)
+   {
+      total += q;
+   }
+   size_t n = max(query_seconds.size(), static_cast<size_t>(1));
+   cout << "{\"case\":\"tiled\""
+        << ",\"tile_size\":" << opts.tile_size
+        << ",\"scenarios\":" << scenarios.size()
+        << ",\"obstacles_per_map\":" << ((scenarios.empty()) ? 0 : static_cast<double>(num_obstacles) / scenarios.size())
+        << ",\"queries\":" << query_seconds.size()
+        << ",\"unreachable\":" << num_unreachable
+        << ",\"build_us\":" << ((scenarios.empty()) ? 0 : build_seconds * US / scenarios.size())
+        << ",\"query_us\":{\"mean\":" << total * US / n
+        << ",\"p50\":" << percentile(query_seconds, 0.50) * US
+        << ",\"p99\":" << percentile(query_seconds, 0.99) * US << "}"
+        << ",\"route_tiles_per_query\":" << static_cast<double>(totals.route_tiles) / n
+        << ",\"coarse_expanded_per_query\":" << static_cast<double>(totals.coarse_expanded) / n
+        << ",\"legs_per_query\":" << static_cast<double>(totals.legs) / n
+        << ",\"tiles_loaded_per_query\":" << static_cast<double>(totals.tiles_loaded) / n
+        << ",\"obstacles_loaded_per_query\":" << static_cast<double>(totals.obstacles_loaded) / n
+        << ",\"length_per_query\":" << path_length / n
+        << "}" << endl;
+}
+
+/**
+ * @brief plan every scenario once, then encode and decode its paths opts.iterations times
+ * prints one line of JSON on STDOUT with throughput, bytes per path against the DSV text of print_result(),
+ * and the largest coordinate error decoding introduced
+ * @param opts options the case runs with
+ * @param planner Planner to plan the scenarios with
+ * @param scenarios scenarios of the case
+ */
+static void run_codec_case(const bench_options &opts, const Planner &planner, const vector<scenario> &scenarios)
+{
+   path_buffer planned;
+   path_buffer decoded;
+   vector<char> message;
+   double encode_seconds = 0;
+   double decode_seconds = 0;
+   size_t num_paths = 0;
+   size_t num_points = 0;
+   size_t message_bytes = 0;
+   size_t dsv_bytes = 0;
+   double max_error = 0;
+   double bound = 0;
+   for (auto &s : scenarios)
+   {
+      try
+      {
+         planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, planned);
+      }
+      catch (const exception &)
+      {
+         continue;
+      }
+      path_frame frame = {s.bounds, opts.codec_bits};
+      bound = max(bound, path_frame_max_error(frame));
+      for (size_t r = 0; r < path_buffer_size(planned); r++)
+      {
+         Line path(path_buffer_path(planned, r).begin(), path_buffer_path(planned, r).end());
+         ostringstream dsv;
+         dsv << LP_PRINT_GEOM(path);
+         dsv_bytes += dsv.str().size();
+      }
+      for (size_t i = 0; i < opts.iterations; i++)
+      {
+         auto start = chrono::steady_clock::now();
+         encode_paths(frame, planned, message);
+         auto mid = chrono::steady_clock::now();
+         decode_paths(frame, message, decoded);
+         auto end = chrono::steady_clock::now();
+         encode_seconds += chrono::duration<double>(mid - start).count();
+         decode_seconds += chrono::duration<double>(end - mid).count();
+      }
+      num_paths += path_buffer_size(planned);
+      num_points += planned.points.size();
+      message_bytes += message.size();
+      for (size_t k = 0; k < planned.points.size(); k++)
+      {
+         max_error = max(max_error, abs(planned.points[k].x() - decoded.points[k].x()));
+         max_error = max(max_error, abs(planned.points[k].y() - decoded.points[k].y()));
+      }
+   }
+   size_t n = max(num_paths, static_cast<size_t>(1));
+   size_t coded = num_paths * opts.iterations;
+   cout << "{\"case\":\"codec\""
+        << ",\"bits\":" << opts.codec_bits
+        << ",\"scenarios\":" << scenarios.size()
+        << ",\"paths\":" << num_paths
+        << ",\"points_per_path\":" << static_cast<double>(num_points) / n
+        << ",\"bytes_per_path\":" << static_cast<double>(message_bytes) / n
+        << ",\"bytes_per_point\":" << ((num_points > 0) ? static_cast<double>(message_bytes) / num_points : 0)
+        << ",\"dsv_bytes_per_path\":" << static_cast<double>(dsv_bytes) / n
+        << ",\"f64_bytes_per_path\":" << static_cast<double>(num_points * 2 * sizeof(double)) / n
+        << ",\"encode_paths_per_sec\":" << ((encode_seconds > 0) ? coded / encode_seconds : 0)
+        << ",\"decode_paths_per_sec\":" << ((decode_seconds > 0) ? coded / decode_seconds : 0)
+        << ",\"encode_mb_per_sec\":" << ((encode_seconds > 0) ? message_bytes * opts.iterations / encode_seconds / 1e6 : 0)
+        << ",\"decode_mb_per_sec\":" << ((decode_seconds > 0) ? message_bytes * opts.iterations / decode_seconds / 1e6 : 0)
+        << ",\"max_error\":" << max_error
+        << ",\"max_error_bound\":" << bound
+        << "}" << endl;
+}
+
+/**
+ * @brief write the selected cases to opts.write_path
+ * @param opts case selection and output file
+ * @return exit status for main()
+ */
+static int write_scenarios(const bench_options &opts)
+{
+   ofstream out(opts.write_path, ios::binary);
+   if (!out)
+   {
+      cerr << "ERROR: cannot open " << opts.write_path << "\n";
+      return 1;
+   }
+   scenario_writer writer(out, opts.write_format);
+   size_t count = 0;
+   if (opts.cases != "random")
+   {
+      for (auto &s : fixed_scenarios())
+      {
+         writer.write(s);
+         count++;
+      }
+   }
+   if (opts.cases != "fixed")
+   {
+      // one at a time, so huge batches don't have to fit in memory
+      for (size_t i = 0; i < opts.num_scenarios; i++)
+      {
+         scenario_params params = opts.random;
+         params.seed = opts.random.seed + i;
+         writer.write(generate_scenario(params));
+         count++;
+      }
+   }
+   cerr << "wrote " << count << " scenarios to " << opts.write_path << "\n";
+   return out ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+   bench_options opts;
+   try
+   {
+      opts = parse_options(argc, argv);
+   }
+   catch (const exception &e)
+   {
+      cerr << e.what() << "\n";
+      print_usage(argv[0]);
+      return 1;
+   }
+
+   if (!opts.write_path.empty())
+   {
+      return write_scenarios(opts);
+   }
+
+   // measure the planner, not the terminal
+   set_log_sink(nullptr);
+   set_simd_kernels(opts.simd);
+
+   unique_ptr<thread_pool> pool;
+   pathfind_config config;
+   config.assignment = opts.mode;
+   config.use_path_cache = opts.use_path_cache;
+   config.prune_bids = opts.prune_bids;
+   config.arc_tolerance = opts.arc_tolerance;
+   config.points_per_circle = opts.points_per_circle;
+   config.max_chord_error = opts.max_chord_error;
+   config.simplify_tolerance = opts.simplify_tolerance;
+   if (opts.threads > 0)
+   {
+      pool = make_unique<thread_pool>(opts.threads);
+      config.pool = pool.get();
+   }
+
+   vector<scenario> scenarios;
+   if (opts.cases != "fixed")
+   {
+      config.max_agents = max(config.max_agents, opts.random.num_agents);
+      scenarios = random_scenarios(opts);
+   }
+
+   for (path_engine engine : opts.engines)
+   {
+      for (coordinate_mode coordinates : opts.coordinates)
+      {
+         config.engine = engine;
+         config.coordinates = coordinates;
+         Planner planner(config);
+         for (plan_api api : opts.apis)
+         {
+            if (opts.cases != "random")
+            {
+               for (auto &s : fixed_scenarios())
+               {
+                  case_result result = run_case(planner, api, {s}, opts);
+                  report_case(s.name, opts, config, api, 1, result);
+               }
+            }
+            if (opts.cases != "fixed")
+            {
+               case_result result = run_case(planner, api, scenarios, opts);
+               report_case("random", opts, config, api, scenarios.size(), result);
+            }
+         }
+      }
+   }
+   if (opts.map_case && opts.cases != "fixed")
+   {
+      run_map_case(opts, scenarios);
+   }
+   if (opts.tiled_case && opts.cases != "fixed")
+   {
+      run_tiled_case(opts, scenarios);
+   }
+   if (opts.codec_case)
+   {
+      vector<scenario> coded = (opts.cases != "random") ? fixed_scenarios() : vector<scenario>();
+      coded.insert(coded.end(), scenarios.begin(), scenarios.end());
+      run_codec_case(opts, Planner(config), coded);
+   }
+   return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file scenario.cpp
+ * @brief Fixed and seeded-random pathfinding scenarios for benchmarks and tools
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "scenario.hpp"
+
+using namespace std;
+
+const double BOUNDARY_MARGIN = 0.3; ///< gap kept between an obstacle and the boundary
+const double OBSTACLE_GAP = 0.2; ///< gap kept between two obstacles
+const double POINT_CLEARANCE = 0.3; ///< gap kept between an agent or target and any obstacle
+const size_t MAX_PLACEMENT_ATTEMPTS = 100; ///< rejection sampling tries per placed item
+
+
+/**
+ * @brief draw one obstacle radius
+ * @param params radius range and distribution
+ * @param rng random engine
+ * @return radius within [radius_min, radius_max]
+ */
+static double draw_radius(const scenario_params &params, mt19937_64 &rng)
+{
+   double span = params.radius_max - params.radius_min;
+   if (span <= 0)
+   {
+      return params.radius_min;
+   }
+   switch (params.radius_dist)
+   {
+   case radius_distribution::EXPONENTIAL:
+   {
+      exponential_distribution<double> dist(4.0 / span);
+      return params.radius_min + min(dist(rng), span);
+   }
+   case radius_distribution::UNIFORM:
+   default:
+   {
+      uniform_real_distribution<double> dist(params.radius_min, params.radius_max);
+      return dist(rng);
+   }
+   }
+}
+
+/**
+ * @brief test whether a point keeps clear of every obstacle
+ * @param p point under test
+ * @param obstacles obstacles placed so far
+ * @return true if p is at least POINT_CLEARANCE outside all obstacles
+ */
+static bool is_clear_of_obstacles(const Point &p, const vector<obstacle> &obstacles)
+{
+   for (auto &obs : obstacles)
+   {
+      if (bg::distance(p, obs.p) < obs.radius + POINT_CLEARANCE)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief place count points uniformly inside the boundary, away from obstacles
+ * @param params boundary size
+ * @param obstacles obstacles to keep clear of
+ * @param count number of points wanted
+ * @param rng random engine
+ * @return placed points, fewer than count only if the free space is tiny
+ */
+static vector<Point> place_points(const scenario_params &params, const vector<obstacle> &obstacles, size_t count, mt19937_64 &rng)
+{
+   uniform_real_distribution<double> x_dist(0.0, params.width);
+   uniform_real_distribution<double> y_dist(0.0, params.height);
+   vector<Point> points;
+   for (size_t i = 0; i < count; i++)
+   {
+      for (size_t attempt = 0; attempt < MAX_PLACEMENT_ATTEMPTS; attempt++)
+      {
+         Point p(x_dist(rng), y_dist(rng));
+         if (is_clear_of_obstacles(p, obstacles))
+         {
+            points.push_back(p);
+            break;
+         }
+      }
+   }
+   return points;
+}
+
+scenario generate_scenario(const scenario_params &params)
+{
+   mt19937_64 rng(params.seed);
+   scenario result;
+   result.name = "random_" + to_string(params.seed);
+   result.bounds = Boundary(Point(0.0, 0.0), Point(params.width, params.height));
+
+   // obstacles first, until the requested fraction of the area is covered
+   double target_area = params.obstacle_density * params.width * params.height;
+   double covered_area = 0;
+   size_t misses = 0;
+   while (covered_area < target_area && misses < MAX_PLACEMENT_ATTEMPTS)
+   {
+      double radius = draw_radius(params, rng);
+      double lo = radius + BOUNDARY_MARGIN;
+      if (2 * lo >= min(params.width, params.height))
+      {
+         misses++;
+         continue;
+      }
+      uniform_real_distribution<double> x_dist(lo, params.width - lo);
+      uniform_real_distribution<double> y_dist(lo, params.height - lo);
+      obstacle candidate = {Point(x_dist(rng), y_dist(rng)), radius};
+
+      bool fits = all_of(result.obstacles.begin(), result.obstacles.end(), [&](const obstacle &o)
+                         { return bg::distance(o.p, candidate.p) >= o.radius + candidate.radius + OBSTACLE_GAP; });
+      if (!fits)
+      {
+         misses++;
+         continue;
+      }
+      misses = 0;
+      result.obstacles.push_back(candidate);
+      covered_area += M_PI * radius * radius;
+   }
+
+   result.agents = place_points(params, result.obstacles, params.num_agents, rng);
+   result.targets = place_points(params, result.obstacles, params.num_targets, rng);
+   return result;
+}
+
+vector<scenario> fixed_scenarios()
+{
+   Boundary bounds{Point(0.0, 0.0), Point(10.0, 10.0)};
+   vector<scenario> fixed;
+
+   // simple test with shortest path sanity checking
+   // and a single simple convex hull case
+   fixed.push_back({"TEST_1", bounds,
+                    {Point(4.0, 7.0), Point(2.0, 9.0), Point(2.0, 3.0), Point(8.0, 2.0)},
+                    {Point(8.0, 9.0), Point(7.0, 9.0), Point(2.0, 1.0), Point(5.0, 2.0)},
+                    {{Point(5.0, 5.0), 2.0}, {Point(2.0, 2.0), 0.5}}});
+
+   // the "peapod" test, convex hull around
+   // two obstacles in both directions
+   fixed.push_back({"TEST_2", bounds,
+                    {Point(1.2, 1.0), Point(0.1, 0.1)},
+                    {Point(9.5, 9.5), Point(9.8, 9.8)},
+                    {{Point(3.0, 3.0), 1.0}, {Point(6.5, 6.5), 1.0}}});
+
+   // force one cross then another
+   // and undo them both sequentially
+   fixed.push_back({"TEST_3", bounds,
+                    {Point(1.2, 1.0), Point(9.7, 0.1), Point(0.2, 9.9), Point(4.0, 6.0)},
+                    {Point(6.0, 4.0), Point(0.1, 9.5), Point(9.8, 9.8), Point(9.9, 0.1)},
+                    {{Point(5, 5), 1.0}}});
+
+   // undo an X wrapped around a convex hull
+   fixed.push_back({"TEST_4", bounds,
+                    {Point(0.2, 1.0), Point(2.5, 0.5), Point(1.0, 4.0)},
+                    {Point(9.9, 9.9), Point(9.8, 9.7), Point(5.5, 9.5)},
+                    {{Point(3, 7), 2.99}}});
+
+   return fixed;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file scenario.hpp
+ * @brief Fixed and seeded-random pathfinding scenarios for benchmarks and tools
+ */
+#ifndef __SCENARIO_HPP_
+#define __SCENARIO_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "scenario_io.hpp"
+
+/**
+ * how obstacle radii are drawn between radius_min and radius_max
+ */
+enum class radius_distribution
+{
+   UNIFORM,     ///< every radius in range equally likely
+   EXPONENTIAL, ///< mostly small obstacles with a tail of large ones, mean a quarter of the range above radius_min
+};
+
+/**
+ * knobs for generate_scenario()
+ */
+struct scenario_params
+{
+   uint64_t seed = 1; ///< same seed and params always give the same scenario
+   size_t num_agents = 8; ///< agents to place
+   size_t num_targets = 8; ///< targets to place
+   double obstacle_density = 0.05; ///< fraction of the boundary area to cover with obstacles
+   double radius_min = 0.2; ///< smallest obstacle radius
+   double radius_max = 1.0; ///< largest obstacle radius
+   radius_distribution radius_dist = radius_distribution::UNIFORM; ///< how radii are drawn
+   double width = 10.0; ///< boundary extends from 0 to width in x
+   double height = 10.0; ///< boundary extends from 0 to height in y
+};
+
+/**
+ * @brief build a random scenario that passes is_valid_input_params()
+ * Obstacles are kept off the boundary and apart from each other, agents and targets keep clear of every obstacle.
+ * Placement is by rejection sampling, so a density that can't be reached is silently capped
+ * @param params sizes, density and radius distribution
+ * @return generated scenario named "random_<seed>"
+ */
+scenario generate_scenario(const scenario_params &params);
+
+/**
+ * @brief the four hand-built scenarios TEST_1..TEST_4 from main.cpp
+ * @return scenarios named "TEST_1".."TEST_4"
+ */
+std::vector<scenario> fixed_scenarios();
+
+#endif  // __SCENARIO_HPP_
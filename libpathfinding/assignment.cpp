@@ -0,0 +1,131 @@
+/**
+ * @file assignment.cpp
+ * @brief Linear assignment solver used by pathfind() when selecting agents for targets
+ */
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "assignment.hpp"
+
+using namespace std;
+
+
+vector<size_t> solve_assignment(const cost_matrix &matrix)
+{
+   assignment_scratch scratch;
+   vector<size_t> result;
+   solve_assignment(matrix, scratch, result);
+   return result;
+}
+
+/**
+ * @brief see assignment.hpp for details
+ * Rows are inserted one at a time. For each new row we grow a Dijkstra-like tree of
+ * reduced costs over the columns until we reach a free column, then flip the assignments
+ * along that path. The potentials u (rows) and v (cols) keep all reduced costs non-negative,
+ * so each augmentation is a single O(rows * cols) sweep with no inner matrix copies.
+ * Indices below are 1-based so that column 0 can stand in for "the row being inserted".
+ */
+void solve_assignment(const cost_matrix &matrix, assignment_scratch &scratch, vector<size_t> &result)
+{
+   const size_t n = matrix.rows;
+   const size_t m = matrix.cols;
+   const double inf = numeric_limits<double>::infinity();
+
+   if (n > m)
+   {
+      throw invalid_argument("ERROR: Assignment needs at least as many columns as rows");
+   }
+   if (matrix.costs.size() != n * m)
+   {
+      throw invalid_argument("ERROR: Cost matrix size does not match rows * cols");
+   }
+
+   vector<double> &u = scratch.u;
+   vector<double> &v = scratch.v;
+   vector<size_t> &row_of = scratch.row_of;
+   vector<size_t> &way = scratch.way;
+   vector<double> &min_v = scratch.min_v;
+   vector<char> &used = scratch.used;
+   u.assign(n + 1, 0.0);
+   v.assign(m + 1, 0.0);
+   row_of.assign(m + 1, 0);
+   way.assign(m + 1, 0);
+   min_v.resize(m + 1);
+   used.resize(m + 1);
+
+   for (size_t i = 1; i <= n; i++)
+   {
+      row_of[0] = i;
+      size_t j0 = 0;
+      fill(min_v.begin(), min_v.end(), inf);
+      fill(used.begin(), used.end(), 0);
+
+      do
+      {
+         used[j0] = 1;
+         const size_t i0 = row_of[j0];
+         const double *row = &matrix.costs[(i0 - 1) * m];
+         double delta = inf;
+         size_t j1 = 0;
+
+         for (size_t j = 1; j <= m; j++)
+         {
+            if (used[j])
+            {
+               continue;
+            }
+            double cur = row[j - 1] - u[i0] - v[j];
+            if (cur < min_v[j])
+            {
+               min_v[j] = cur;
+               way[j] = j0;
+            }
+            if (min_v[j] < delta)
+            {
+               delta = min_v[j];
+               j1 = j;
+            }
+         }
+
+         if (j1 == 0 || delta == inf)
+         {
+            throw runtime_error("ERROR: Assignment has no finite-cost solution");
+         }
+
+         for (size_t j = 0; j <= m; j++)
+         {
+            if (used[j])
+            {
+               u[row_of[j]] += delta;
+               v[j] -= delta;
+            }
+            else
+            {
+               min_v[j] -= delta;
+            }
+         }
+         j0 = j1;
+      } while (row_of[j0] != 0);
+
+      // flip assignments back along the augmenting path
+      do
+      {
+         size_t j1 = way[j0];
+         row_of[j0] = row_of[j1];
+         j0 = j1;
+      } while (j0 != 0);
+   }
+
+   result.assign(n, 0);
+   for (size_t j = 1; j <= m; j++)
+   {
+      if (row_of[j] != 0)
+      {
+         result[row_of[j] - 1] = j - 1;
+      }
+   }
+}
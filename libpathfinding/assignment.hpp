@@ -0,0 +1,72 @@
+/**
+ * @file assignment.hpp
+ * @brief Linear assignment solver used by pathfind() when selecting agents for targets
+ */
+#ifndef __ASSIGNMENT_HPP_
+#define __ASSIGNMENT_HPP_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Dense row-major cost matrix where rows are targets and columns are agents
+ * entry (row, col) is the length of the path agent col would fly to target row
+ */
+struct cost_matrix
+{
+   size_t rows; ///< number of rows (targets)
+   size_t cols; ///< number of columns (agents)
+   std::vector<double> costs; ///< rows * cols costs in row-major order
+
+   /**
+    * @brief mutable access to a single cost
+    * @param row row (target) index
+    * @param col column (agent) index
+    * @return reference to the cost at {row, col}
+    */
+   double &at(size_t row, size_t col) { return costs[row * cols + col]; }
+
+   /**
+    * @brief read-only access to a single cost
+    * @param row row (target) index
+    * @param col column (agent) index
+    * @return the cost at {row, col}
+    */
+   double at(size_t row, size_t col) const { return costs[row * cols + col]; }
+};
+
+/**
+ * @brief Solve the rectangular linear assignment problem for minimum total cost
+ * This is the shortest augmenting path (Jonker-Volgenant style) form of the Hungarian method,
+ * it runs in O(rows^2 * cols) time and O(rows * cols) memory (the matrix itself)
+ * Throws std::invalid_argument if matrix.rows > matrix.cols or the matrix is malformed
+ * Throws std::runtime_error if some row can only be assigned at infinite cost
+ * @param matrix cost matrix with rows <= cols
+ * @return vector of size matrix.rows, entry i holds the column assigned to row i
+ */
+std::vector<size_t> solve_assignment(const cost_matrix &matrix);
+
+/**
+ * working vectors of solve_assignment(), kept by callers that solve many problems so each solve reuses them
+ */
+struct assignment_scratch
+{
+   std::vector<double> u; ///< row potentials
+   std::vector<double> v; ///< column potentials
+   std::vector<size_t> row_of; ///< row currently holding each column, 0 if free
+   std::vector<size_t> way; ///< previous column on the augmenting path
+   std::vector<double> min_v; ///< best reduced cost seen per column this round
+   std::vector<char> used; ///< columns already in the tree this round
+};
+
+/**
+ * @brief solve_assignment() above, in reused storage
+ * Makes no heap allocations once scratch and result have grown to the size of the matrix
+ * Throws the same as solve_assignment() above
+ * @param matrix cost matrix with rows <= cols
+ * @param scratch working vectors, overwritten
+ * @param result overwritten with matrix.rows entries, entry i holds the column assigned to row i
+ */
+void solve_assignment(const cost_matrix &matrix, assignment_scratch &scratch, std::vector<size_t> &result);
+
+#endif  // __ASSIGNMENT_HPP_
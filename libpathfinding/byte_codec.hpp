@@ -0,0 +1,248 @@
+/**
+ * @file byte_codec.hpp
+ * @brief Little-endian encoding of integers, varints, floats, doubles and points, shared by every binary format of the library
+ *
+ * Writers append to a std::vector<char>, readers go through a bounds-checked record_cursor over one record,
+ * so a truncated or lying record throws instead of reading past its end. Byte order never depends on the host.
+ */
+#ifndef __BYTE_CODEC_HPP_
+#define __BYTE_CODEC_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+/**
+ * @brief append a little-endian uint16
+ * @param buf buffer to append to
+ * @param v value to store
+ */
+inline void put_u16(std::vector<char> &buf, uint16_t v)
+{
+   buf.push_back(static_cast<char>(v & 0xff));
+   buf.push_back(static_cast<char>(v >> 8));
+}
+
+/**
+ * @brief append a little-endian uint32
+ * @param buf buffer to append to
+ * @param v value to store
+ */
+inline void put_u32(std::vector<char> &buf, uint32_t v)
+{
+   for (int shift = 0; shift < 32; shift += 8)
+   {
+      buf.push_back(static_cast<char>((v >> shift) & 0xff));
+   }
+}
+
+/**
+ * @brief append a double as its IEEE 754 bits, little-endian
+ * @param buf buffer to append to
+ * @param v value to store, read back bit for bit by record_cursor::get_f64()
+ */
+inline void put_f64(std::vector<char> &buf, double v)
+{
+   uint64_t bits;
+   std::memcpy(&bits, &v, sizeof(bits));
+   for (int shift = 0; shift < 64; shift += 8)
+   {
+      buf.push_back(static_cast<char>((bits >> shift) & 0xff));
+   }
+}
+
+/**
+ * @brief append a float as its IEEE 754 bits, little-endian
+ * @param buf buffer to append to
+ * @param v value to store, read back bit for bit by record_cursor::get_f32()
+ */
+inline void put_f32(std::vector<char> &buf, float v)
+{
+   uint32_t bits;
+   std::memcpy(&bits, &v, sizeof(bits));
+   put_u32(buf, bits);
+}
+
+/**
+ * @brief append a point as two doubles, x then y
+ * @param buf buffer to append to
+ * @param p point to store
+ */
+inline void put_point(std::vector<char> &buf, const Point &p)
+{
+   put_f64(buf, p.x());
+   put_f64(buf, p.y());
+}
+
+/**
+ * @brief append an unsigned LEB128 varint, 7 bits per byte with the high bit set on all but the last
+ * @param buf buffer to append to
+ * @param v value to store, 1 byte below 128 and at most 10 bytes
+ */
+inline void put_varint(std::vector<char> &buf, uint64_t v)
+{
+   while (v >= 0x80)
+   {
+      buf.push_back(static_cast<char>((v & 0x7f) | 0x80));
+      v >>= 7;
+   }
+   buf.push_back(static_cast<char>(v));
+}
+
+/**
+ * @brief map a signed value to an unsigned one so small magnitudes of either sign make short varints
+ * 0, -1, 1, -2, 2 ... become 0, 1, 2, 3, 4 ...
+ * @param v signed value
+ * @return zig-zag encoded value
+ */
+inline uint64_t zigzag_encode(int64_t v)
+{
+   return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+/**
+ * @brief inverse of zigzag_encode()
+ * @param v zig-zag encoded value
+ * @return signed value
+ */
+inline int64_t zigzag_decode(uint64_t v)
+{
+   return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+/**
+ * @brief overwrite 4 bytes already in a buffer, for length prefixes known only once the payload is written
+ * @param buf buffer holding the placeholder
+ * @param at offset of the placeholder
+ * @param v value to store
+ */
+inline void patch_u32(std::vector<char> &buf, size_t at, uint32_t v)
+{
+   for (int i = 0; i < 4; i++)
+   {
+      buf[at + i] = static_cast<char>((v >> (8 * i)) & 0xff);
+   }
+}
+
+/**
+ * bounds-checked cursor over one binary record
+ * Throws std::runtime_error naming the record kind when a read would run past end
+ */
+struct record_cursor
+{
+   const char *pos; ///< next byte to read
+   const char *end; ///< one past the last byte of the record
+   const char *kind = "scenario"; ///< record kind for error messages
+
+   /**
+    * @brief step over the next bytes of the record
+    * Throws std::runtime_error if fewer than n bytes are left
+    * @param n bytes to take
+    * @return first of the n bytes taken
+    */
+   const char *take(size_t n)
+   {
+      if (static_cast<size_t>(end - pos) < n)
+      {
+         throw std::runtime_error(std::string("ERROR: ") + kind + " record is truncated");
+      }
+      const char *at = pos;
+      pos += n;
+      return at;
+   }
+
+   /**
+    * @brief read a little-endian unsigned integer from put_u16() or put_u32()
+    * Throws std::runtime_error if fewer than n bytes are left
+    * @param n bytes of the integer, at most 8
+    * @return value
+    */
+   uint64_t get_uint(size_t n)
+   {
+      const unsigned char *bytes = reinterpret_cast<const unsigned char *>(take(n));
+      uint64_t v = 0;
+      for (size_t i = 0; i < n; i++)
+      {
+         v |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+      }
+      return v;
+   }
+
+   /**
+    * @brief read a varint from put_varint()
+    * @return value, throws std::runtime_error if it runs past 10 bytes
+    */
+   uint64_t get_varint()
+   {
+      uint64_t v = 0;
+      for (int shift = 0; shift < 70; shift += 7)
+      {
+         uint8_t byte = static_cast<uint8_t>(*take(1));
+         v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+         if ((byte & 0x80) == 0)
+         {
+            return v;
+         }
+      }
+      throw std::runtime_error(std::string("ERROR: ") + kind + " record has a malformed varint");
+   }
+
+   /**
+    * @brief read a double from put_f64()
+    * Throws std::runtime_error if fewer than 8 bytes are left
+    * @return value, bit for bit as written
+    */
+   double get_f64()
+   {
+      uint64_t bits = get_uint(8);
+      double v;
+      std::memcpy(&v, &bits, sizeof(v));
+      return v;
+   }
+
+   /**
+    * @brief read a float from put_f32()
+    * Throws std::runtime_error if fewer than 4 bytes are left
+    * @return value, bit for bit as written
+    */
+   float get_f32()
+   {
+      uint32_t bits = get_uint(4);
+      float v;
+      std::memcpy(&v, &bits, sizeof(v));
+      return v;
+   }
+
+   /**
+    * @brief read a point from put_point()
+    * Throws std::runtime_error if fewer than 16 bytes are left
+    * @return point, x then y as written
+    */
+   Point get_point()
+   {
+      double x = get_f64();
+      double y = get_f64();
+      return Point(x, y);
+   }
+
+   /**
+    * @brief read an element count, rejecting counts the rest of the record can't hold
+    * @param element_size bytes per element
+    * @return element count
+    */
+   size_t get_count(size_t element_size)
+   {
+      size_t count = get_uint(4);
+      if (count > static_cast<size_t>(end - pos) / element_size)
+      {
+         throw std::runtime_error(std::string("ERROR: ") + kind + " record count exceeds record size");
+      }
+      return count;
+   }
+};
+
+#endif  // __BYTE_CODEC_HPP_
@@ -0,0 +1,108 @@
+/**
+ * @file compact_coords.cpp
+ * @brief Compact encodings of planner coordinates- float32 offsets in a local frame, and the quantized int32 positions of DroneStatus.msg
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "compact_coords.hpp"
+
+using namespace std;
+
+int32_t quantize_degrees(double degrees)
+{
+   double turns = fmod((degrees + 180.0) / 360.0, 1.0);
+   if (turns < 0)
+   {
+      turns += 1.0;
+   }
+   // llround can give exactly 2^32, which wraps back to -180 like it should
+   return static_cast<int32_t>(static_cast<uint32_t>(llround(turns * WGS84_STEPS_PER_TURN)));
+}
+
+double dequantize_degrees(int32_t quantized)
+{
+   return -180.0 + 360.0 * (static_cast<uint32_t>(quantized) / WGS84_STEPS_PER_TURN);
+}
+
+/**
+ * @brief signed number of steps from one quantized angle to another, the short way around
+ * @param from start angle
+ * @param to end angle
+ * @return to - from, modulo 2^32
+ */
+static int32_t step_difference(int32_t from, int32_t to)
+{
+   return static_cast<int32_t>(static_cast<uint32_t>(to) - static_cast<uint32_t>(from));
+}
+
+wgs84_frame make_wgs84_frame(const quantized_position &origin)
+{
+   double meters_per_step = WGS84_QUANTUM_DEGREES * METERS_PER_DEGREE;
+   double latitude = dequantize_degrees(origin.latitude) * M_PI / 180.0;
+   return {origin, meters_per_step * cos(latitude), meters_per_step};
+}
+
+Point from_quantized(const wgs84_frame &frame, const quantized_position &position)
+{
+   return Point(step_difference(frame.origin.longitude, position.longitude) * frame.meters_per_step_x,
+                step_difference(frame.origin.latitude, position.latitude) * frame.meters_per_step_y);
+}
+
+quantized_position to_quantized(const wgs84_frame &frame, const Point &p)
+{
+   int64_t east = llround(p.x() / frame.meters_per_step_x);
+   int64_t north = llround(p.y() / frame.meters_per_step_y);
+   return {static_cast<int32_t>(static_cast<uint32_t>(frame.origin.latitude) + static_cast<uint32_t>(north)),
+           static_cast<int32_t>(static_cast<uint32_t>(frame.origin.longitude) + static_cast<uint32_t>(east))};
+}
+
+local_frame make_local_frame(const Boundary &bounds)
+{
+   local_frame frame;
+   bg::centroid(bounds, frame.origin);
+   return frame;
+}
+
+double compact_resolution(const local_frame &frame, const Boundary &bounds)
+{
+   double x = fmax(fabs(bounds.min_corner().x() - frame.origin.x()), fabs(bounds.max_corner().x() - frame.origin.x()));
+   double y = fmax(fabs(bounds.min_corner().y() - frame.origin.y()), fabs(bounds.max_corner().y() - frame.origin.y()));
+   double half_step_x = (nextafterf(static_cast<float>(x), HUGE_VALF) - static_cast<float>(x)) / 2.0;
+   double half_step_y = (nextafterf(static_cast<float>(y), HUGE_VALF) - static_cast<float>(y)) / 2.0;
+   return hypot(half_step_x, half_step_y);
+}
+
+compact_point to_compact_point(const local_frame &frame, const Point &p)
+{
+   return {static_cast<float>(p.x() - frame.origin.x()), static_cast<float>(p.y() - frame.origin.y())};
+}
+
+Point from_compact_point(const local_frame &frame, const compact_point &p)
+{
+   return Point(frame.origin.x() + p.x, frame.origin.y() + p.y);
+}
+
+compact_line to_compact_line(const local_frame &frame, const Line &path)
+{
+   compact_line compact;
+   compact.reserve(path.size());
+   for (auto &p : path)
+   {
+      compact.push_back(to_compact_point(frame, p));
+   }
+   return compact;
+}
+
+Line from_compact_line(const local_frame &frame, const compact_line &path)
+{
+   Line line;
+   line.reserve(path.size());
+   for (auto &p : path)
+   {
+      line.push_back(from_compact_point(frame, p));
+   }
+   return line;
+}
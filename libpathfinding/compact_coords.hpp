@@ -0,0 +1,147 @@
+/**
+ * @file compact_coords.hpp
+ * @brief Compact encodings of planner coordinates- float32 offsets in a local frame, and the quantized int32 positions of DroneStatus.msg
+ *
+ * Planner coordinates are doubles on a flat map. A local_frame pins an origin near the map, so points on it fit
+ * in float32 offsets and a stored path takes half the memory. A wgs84_frame turns the quantized latitude and
+ * longitude of extra/DroneStatus.msg straight into planner coordinates, in meters east and north of an origin,
+ * with an integer subtraction and a multiply per axis and no trigonometry per message.
+ */
+#ifndef __COMPACT_COORDS_HPP_
+#define __COMPACT_COORDS_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+const double WGS84_STEPS_PER_TURN = 4294967296.0; ///< 2^32, quantization steps of the DroneStatus.msg encoding around a full circle
+const double WGS84_QUANTUM_DEGREES = 360.0 / WGS84_STEPS_PER_TURN; ///< one step of the DroneStatus.msg encoding, degrees = -180 + 360 * (u / 2^32)
+const double METERS_PER_DEGREE = 111319.49079327357; ///< length of one degree of latitude, or of longitude on the equator, WGS84 equatorial radius
+
+/**
+ * @brief encode degrees the way DroneStatus.msg does
+ * u is the unsigned value of the returned bits, so -180 encodes as 0 and 0 as INT32_MIN
+ * @param degrees angle, wrapped into [-180, 180)
+ * @return nearest quantized value
+ */
+int32_t quantize_degrees(double degrees);
+
+/**
+ * @brief decode a DroneStatus.msg angle
+ * @param quantized value as sent
+ * @return degrees in [-180, 180)
+ */
+double dequantize_degrees(int32_t quantized);
+
+/**
+ * latitude and longitude as carried by DroneStatus.msg
+ */
+struct quantized_position
+{
+   int32_t latitude; ///< quantized with quantize_degrees()
+   int32_t longitude; ///< quantized with quantize_degrees()
+};
+
+/**
+ * flat frame around a quantized origin, x east and y north in meters
+ * Equirectangular- distances are good to a fraction of a percent within tens of kilometers of the origin
+ */
+struct wgs84_frame
+{
+   quantized_position origin; ///< planner point (0, 0)
+   double meters_per_step_x; ///< east meters per step of longitude at the origin latitude
+   double meters_per_step_y; ///< north meters per step of latitude
+};
+
+/**
+ * @brief frame for planning around a position
+ * @param origin position that becomes planner point (0, 0)
+ * @return wgs84_frame, the only trigonometry is done here
+ */
+wgs84_frame make_wgs84_frame(const quantized_position &origin);
+
+/**
+ * @brief planner coordinates of a quantized position
+ * differences wrap modulo 2^32, so frames straddling the antimeridian work
+ * @param frame frame from make_wgs84_frame()
+ * @param position quantized position
+ * @return meters east and north of the frame origin
+ */
+Point from_quantized(const wgs84_frame &frame, const quantized_position &position);
+
+/**
+ * @brief quantized position of planner coordinates, the inverse of from_quantized() to within one step
+ * @param frame frame from make_wgs84_frame()
+ * @param p meters east and north of the frame origin
+ * @return nearest quantized position
+ */
+quantized_position to_quantized(const wgs84_frame &frame, const Point &p);
+
+/**
+ * float32 frame for storing planner points compactly
+ */
+struct local_frame
+{
+   Point origin; ///< compact points are offsets from here
+};
+
+/**
+ * a planner point as a float32 offset from a local_frame origin
+ */
+struct compact_point
+{
+   float x; ///< x - origin.x()
+   float y; ///< y - origin.y()
+};
+
+using compact_line = std::vector<compact_point>; ///< a Line in half the memory
+
+/**
+ * @brief frame centered on a map, so the largest offset is half the map size
+ * @param bounds outer boundary of the map
+ * @return local_frame at the center of bounds
+ */
+local_frame make_local_frame(const Boundary &bounds);
+
+/**
+ * @brief largest error of a point of the map after a round trip through a compact_point
+ * @param frame frame from make_local_frame()
+ * @param bounds outer boundary of the map
+ * @return distance bound, half a float32 step at the farthest corner in each axis
+ */
+double compact_resolution(const local_frame &frame, const Boundary &bounds);
+
+/**
+ * @brief store one point as a float32 offset
+ * @param frame frame to store in
+ * @param p point in planner coordinates
+ * @return offset of p from the frame origin
+ */
+compact_point to_compact_point(const local_frame &frame, const Point &p);
+
+/**
+ * @brief planner coordinates of a stored point
+ * @param frame frame the point was stored in
+ * @param p compact_point from to_compact_point()
+ * @return point within compact_resolution() of the original
+ */
+Point from_compact_point(const local_frame &frame, const compact_point &p);
+
+/**
+ * @brief store a path as float32 offsets
+ * @param frame frame to store in
+ * @param path path in planner coordinates
+ * @return compact_line with one entry per point
+ */
+compact_line to_compact_line(const local_frame &frame, const Line &path);
+
+/**
+ * @brief planner coordinates of a stored path
+ * @param frame frame the path was stored in
+ * @param path compact_line from to_compact_line()
+ * @return Line within compact_resolution() of the original, point by point
+ */
+Line from_compact_line(const local_frame &frame, const compact_line &path);
+
+#endif  // __COMPACT_COORDS_HPP_
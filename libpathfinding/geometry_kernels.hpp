@@ -0,0 +1,220 @@
+/**
+ * @file geometry_kernels.hpp
+ * @brief Closed-form circle predicates that never tessellate or allocate polygons
+ *
+ * Circles here are exact- {center, radius} rather than the points_per_circle polygon
+ * that circle_from_obstacle() builds. Tessellated circles are only needed where a polygon
+ * feeds bg::union_ / bg::convex_hull during curved path construction.
+ */
+#ifndef __GEOMETRY_KERNELS_HPP_
+#define __GEOMETRY_KERNELS_HPP_
+
+#include <algorithm>
+#include <cmath>
+
+#include "pathfinding.hpp"
+
+/**
+ * @brief squared distance from point p to the segment {a, b}
+ * @param p point under test
+ * @param a first segment endpoint
+ * @param b second segment endpoint
+ * @return squared euclidean distance
+ */
+inline double point_segment_distance_sq(const Point &p, const Point &a, const Point &b)
+{
+   const double dx = b.x() - a.x();
+   const double dy = b.y() - a.y();
+   const double len_sq = dx * dx + dy * dy;
+   double t = 0.0;
+   if (len_sq > 0.0)
+   {
+      t = std::clamp(((p.x() - a.x()) * dx + (p.y() - a.y()) * dy) / len_sq, 0.0, 1.0);
+   }
+   const double ex = a.x() + t * dx - p.x();
+   const double ey = a.y() + t * dy - p.y();
+   return ex * ex + ey * ey;
+}
+
+/**
+ * @brief distance from point p to the closest point of a polyline
+ * @param path Line of one or more points
+ * @param p point under test
+ * @return euclidean distance, infinity for an empty path
+ */
+inline double path_point_distance(const Line &path, const Point &p)
+{
+   if (path.empty())
+   {
+      return HUGE_VAL;
+   }
+   double best = (path[0].x() - p.x()) * (path[0].x() - p.x()) + (path[0].y() - p.y()) * (path[0].y() - p.y());
+   for (size_t i = 1; i < path.size(); i++)
+   {
+      best = std::min(best, point_segment_distance_sq(p, path[i - 1], path[i]));
+   }
+   return std::sqrt(best);
+}
+
+/**
+ * @brief test whether a point lies inside or on a circle, same as bg::covered_by against a disc
+ * @param p point under test
+ * @param o circle
+ * @return true if |p - o.p| <= o.radius
+ */
+inline bool point_in_circle(const Point &p, const obstacle &o)
+{
+   const double dx = p.x() - o.p.x();
+   const double dy = p.y() - o.p.y();
+   return (dx * dx + dy * dy) <= (o.radius * o.radius);
+}
+
+/**
+ * @brief test whether the segment {a, b} touches a circle
+ * @param a first segment endpoint
+ * @param b second segment endpoint
+ * @param o circle
+ * @return true if any point of the segment is inside or on the circle
+ */
+inline bool segment_intersects_circle(const Point &a, const Point &b, const obstacle &o)
+{
+   return point_segment_distance_sq(o.p, a, b) <= (o.radius * o.radius);
+}
+
+/**
+ * @brief test whether any segment of a polyline touches a circle
+ * @param path Line of one or more points
+ * @param o circle
+ * @return true if the path enters or touches the circle
+ */
+inline bool path_intersects_circle(const Line &path, const obstacle &o)
+{
+   if (path.size() == 1)
+   {
+      return point_in_circle(path[0], o);
+   }
+   for (size_t i = 1; i < path.size(); i++)
+   {
+      if (segment_intersects_circle(path[i - 1], path[i], o))
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * @brief test whether a box and a circle share any point
+ * @param box box under test
+ * @param o circle
+ * @return true if the closest point of the box to the circle center is within the radius
+ */
+inline bool box_intersects_circle(const Boundary &box, const obstacle &o)
+{
+   const double cx = std::clamp(o.p.x(), box.min_corner().x(), box.max_corner().x());
+   const double cy = std::clamp(o.p.y(), box.min_corner().y(), box.max_corner().y());
+   return point_in_circle(Point(cx, cy), o);
+}
+
+/**
+ * @brief test whether a circle can reach the outline of a box
+ * a circle strictly inside the box can neither contain nor split it, the rest are those whose bounding box meets the box
+ * @param box box under test
+ * @param o circle
+ * @return true if the circle's bounding box meets the box without lying strictly inside it
+ */
+inline bool circle_reaches_outline(const Boundary &box, const obstacle &o)
+{
+   const Point &lo = box.min_corner();
+   const Point &hi = box.max_corner();
+   const double x = o.p.x();
+   const double y = o.p.y();
+   const double r = o.radius;
+   bool touches = (x - r <= hi.x()) && (x + r >= lo.x()) && (y - r <= hi.y()) && (y + r >= lo.y());
+   bool inside = (x - r > lo.x()) && (x + r < hi.x()) && (y - r > lo.y()) && (y + r < hi.y());
+   return touches && !inside;
+}
+
+/**
+ * @brief test whether a box lies entirely inside or on a circle
+ * a disc is convex, so this holds exactly when all four corners are inside
+ * @param box box under test
+ * @param o circle
+ * @return true if the whole box is covered by the circle
+ */
+inline bool box_in_circle(const Boundary &box, const obstacle &o)
+{
+   const Point &lo = box.min_corner();
+   const Point &hi = box.max_corner();
+   return point_in_circle(lo, o) && point_in_circle(hi, o) &&
+          point_in_circle(Point(lo.x(), hi.y()), o) && point_in_circle(Point(hi.x(), lo.y()), o);
+}
+
+/**
+ * @brief test whether removing a circle from a box leaves more than one piece
+ * Every piece of box minus a (convex) disc touches the box outline, so the pieces
+ * are in one-to-one correspondence with the runs of outline that the disc covers.
+ * We walk the outline edge by edge, clip each edge against the disc, and count runs.
+ * Tangent contact (zero-length runs) does not split the box.
+ * @param box box under test
+ * @param o circle
+ * @return true if the circle splits the box into two or more regions
+ */
+inline bool circle_splits_box(const Boundary &box, const obstacle &o)
+{
+   const Point &lo = box.min_corner();
+   const Point &hi = box.max_corner();
+   const Point corners[5] = {lo, Point(hi.x(), lo.y()), hi, Point(lo.x(), hi.y()), lo};
+   const double eps = 1e-12;
+
+   double perimeter = 0.0;
+   double run_start[4];
+   double run_end[4];
+   int num_runs = 0;
+
+   for (int e = 0; e < 4; e++)
+   {
+      const Point &a = corners[e];
+      const Point &b = corners[e + 1];
+      const double len = std::hypot(b.x() - a.x(), b.y() - a.y());
+      if (len > 0.0)
+      {
+         // project the circle center onto the edge, then open up by the half-chord
+         const double ux = (b.x() - a.x()) / len;
+         const double uy = (b.y() - a.y()) / len;
+         const double along = (o.p.x() - a.x()) * ux + (o.p.y() - a.y()) * uy;
+         const double across = (o.p.x() - a.x()) * uy - (o.p.y() - a.y()) * ux;
+         const double half_chord_sq = o.radius * o.radius - across * across;
+         if (half_chord_sq > 0.0)
+         {
+            const double half_chord = std::sqrt(half_chord_sq);
+            const double t0 = std::max(0.0, along - half_chord);
+            const double t1 = std::min(len, along + half_chord);
+            if (t1 - t0 > eps)
+            {
+               // runs that meet at a shared corner are one run
+               if (num_runs > 0 && (perimeter + t0) - run_end[num_runs - 1] <= eps)
+               {
+                  run_end[num_runs - 1] = perimeter + t1;
+               }
+               else
+               {
+                  run_start[num_runs] = perimeter + t0;
+                  run_end[num_runs] = perimeter + t1;
+                  num_runs++;
+               }
+            }
+         }
+      }
+      perimeter += len;
+   }
+
+   // the outline is a loop, so a run ending at the last corner joins one starting at the first
+   if (num_runs > 1 && run_start[0] <= eps && perimeter - run_end[num_runs - 1] <= eps)
+   {
+      num_runs--;
+   }
+   return num_runs > 1;
+}
+
+#endif  // __GEOMETRY_KERNELS_HPP_
@@ -0,0 +1,197 @@
+/**
+ * @file logging.cpp
+ * @brief Leveled diagnostic logging for libpathfinding with pluggable sinks
+ */
+
+#include <chrono>
+#include <cstring>
+
+#include "logging.hpp"
+
+using namespace std;
+
+const auto DRAIN_POLL_INTERVAL = chrono::milliseconds(1); ///< how long the drain thread sleeps on an empty ring
+
+/**
+ * @brief sink in use before anyone calls set_log_sink()
+ * @return stream_log_sink on std::cerr, constructed on first use
+ */
+static log_sink *default_log_sink()
+{
+   static stream_log_sink stderr_sink(cerr);
+   return &stderr_sink;
+}
+
+static atomic<log_sink *> installed_sink{default_log_sink()}; ///< sink every LP_LOG_* macro writes to
+static atomic<int> runtime_level{LP_LOG_LEVEL}; ///< set_log_level() threshold
+
+
+/**
+ * @brief short tag printed in front of each message
+ * @param level severity of the message
+ * @return tag text
+ */
+static const char *level_tag(log_level level)
+{
+   switch (level)
+   {
+   case log_level::DEBUG:
+      return "DEBUG";
+   case log_level::INFO:
+      return "INFO";
+   case log_level::WARNING:
+      return "WARNING";
+   case log_level::ERROR:
+      return "ERROR";
+   default:
+      return "NONE";
+   }
+}
+
+void set_log_sink(log_sink *sink)
+{
+   installed_sink.store(sink, memory_order_release);
+}
+
+void set_log_level(log_level level)
+{
+   runtime_level.store(static_cast<int>(level), memory_order_relaxed);
+}
+
+bool is_log_enabled(log_level level)
+{
+   return static_cast<int>(level) >= runtime_level.load(memory_order_relaxed)
+      && installed_sink.load(memory_order_relaxed) != nullptr;
+}
+
+void log_write(log_level level, const string &message)
+{
+   log_sink *sink = installed_sink.load(memory_order_acquire);
+   if (sink != nullptr)
+   {
+      sink->write(level, message);
+   }
+}
+
+void stream_log_sink::write(log_level level, const string &message)
+{
+   // one write per line and no flush, flushing is up to the stream
+   string line = string("[") + level_tag(level) + "] " + message + "\n";
+   lock_guard<mutex> lock(out_mutex);
+   out << line;
+}
+
+async_log_sink::async_log_sink(log_sink &downstream, size_t capacity)
+   : downstream(downstream)
+{
+   size_t rounded = 2;
+   while (rounded < capacity)
+   {
+      rounded <<= 1;
+   }
+   mask = rounded - 1;
+   ring = new slot[rounded];
+   for (size_t i = 0; i < rounded; i++)
+   {
+      ring[i].sequence.store(i, memory_order_relaxed);
+   }
+   drainer = thread(&async_log_sink::drain_loop, this);
+}
+
+async_log_sink::~async_log_sink()
+{
+   stopping.store(true, memory_order_release);
+   drainer.join();
+   delete[] ring;
+}
+
+void async_log_sink::write(log_level level, const string &message)
+{
+   size_t pos = enqueue_pos.load(memory_order_relaxed);
+   slot *cell;
+   while (true)
+   {
+      cell = &ring[pos & mask];
+      size_t seq = cell->sequence.load(memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0)
+      {
+         if (enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+         {
+            break;
+         }
+      }
+      else if (diff < 0)
+      {
+         // ring is full, never block the planner for a log line
+         num_dropped.fetch_add(1, memory_order_relaxed);
+         return;
+      }
+      else
+      {
+         pos = enqueue_pos.load(memory_order_relaxed);
+      }
+   }
+
+   size_t len = min(message.size(), MAX_MESSAGE_SIZE - 1);
+   memcpy(cell->text, message.data(), len);
+   cell->text[len] = '\0';
+   cell->level = level;
+   cell->sequence.store(pos + 1, memory_order_release);
+}
+
+/**
+ * @brief take the oldest message off the ring, only ever called from the drain thread
+ * @param level output, level of the message
+ * @param message output, text of the message
+ * @return false if the ring was empty
+ */
+bool async_log_sink::try_pop(log_level &level, string &message)
+{
+   size_t pos = dequeue_pos.load(memory_order_relaxed);
+   slot *cell = &ring[pos & mask];
+   size_t seq = cell->sequence.load(memory_order_acquire);
+   if (seq != pos + 1)
+   {
+      return false;
+   }
+   level = cell->level;
+   message.assign(cell->text);
+   cell->sequence.store(pos + mask + 1, memory_order_release);
+   dequeue_pos.store(pos + 1, memory_order_relaxed);
+   return true;
+}
+
+void async_log_sink::drain_loop()
+{
+   log_level level;
+   string message;
+   while (true)
+   {
+      bool drained_any = false;
+      while (try_pop(level, message))
+      {
+         downstream.write(level, message);
+         num_drained.fetch_add(1, memory_order_release);
+         drained_any = true;
+      }
+      if (!drained_any)
+      {
+         if (stopping.load(memory_order_acquire))
+         {
+            return;
+         }
+         this_thread::sleep_for(DRAIN_POLL_INTERVAL);
+      }
+   }
+}
+
+void async_log_sink::flush()
+{
+   // every claimed slot is either drained or still in flight, wait for the drainer to catch up
+   size_t target = enqueue_pos.load(memory_order_acquire);
+   while (num_drained.load(memory_order_acquire) < target)
+   {
+      this_thread::sleep_for(DRAIN_POLL_INTERVAL);
+   }
+}
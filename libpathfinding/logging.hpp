@@ -0,0 +1,210 @@
+/**
+ * @file logging.hpp
+ * @brief Leveled diagnostic logging for libpathfinding with pluggable sinks
+ *
+ * Diagnostics go through the LP_LOG_* macros below to whatever log_sink is installed,
+ * by default a stream_log_sink on std::cerr. STDOUT is left to print_result() for CSV.
+ * Levels below LP_LOG_LEVEL are removed by the preprocessor, so their arguments are never evaluated.
+ */
+#ifndef __LOGGING_HPP_
+#define __LOGGING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#define LP_LOG_LEVEL_DEBUG 0   ///< per-bid and per-path detail, including serialized paths
+#define LP_LOG_LEVEL_INFO 1    ///< one line per planning decision
+#define LP_LOG_LEVEL_WARNING 2 ///< recoverable surprises
+#define LP_LOG_LEVEL_ERROR 3   ///< rejected inputs and failed plans
+#define LP_LOG_LEVEL_NONE 4    ///< compile out all logging
+
+/**
+ * lowest level compiled into the library, override with -DLP_LOG_LEVEL=LP_LOG_LEVEL_xxx
+ */
+#ifndef LP_LOG_LEVEL
+#define LP_LOG_LEVEL LP_LOG_LEVEL_INFO
+#endif
+
+/**
+ * severity of a log message, same order as the LP_LOG_LEVEL_xxx macros
+ */
+enum class log_level : int
+{
+   DEBUG = LP_LOG_LEVEL_DEBUG,
+   INFO = LP_LOG_LEVEL_INFO,
+   WARNING = LP_LOG_LEVEL_WARNING,
+   ERROR = LP_LOG_LEVEL_ERROR,
+   NONE = LP_LOG_LEVEL_NONE,
+};
+
+/**
+ * Destination for log messages. write() may be called from several threads at once
+ */
+class log_sink
+{
+public:
+   virtual ~log_sink() = default;
+
+   /**
+    * @brief consume one message
+    * @param level severity of the message
+    * @param message text without trailing newline
+    */
+   virtual void write(log_level level, const std::string &message) = 0;
+};
+
+/**
+ * Synchronous sink writing one line per message to an ostream, serialized by a mutex
+ */
+class stream_log_sink : public log_sink
+{
+public:
+   /**
+    * @brief create a sink on an ostream that outlives it
+    * @param out stream to write to, std::cerr by default
+    */
+   explicit stream_log_sink(std::ostream &out = std::cerr) : out(out) {}
+
+   void write(log_level level, const std::string &message) override;
+
+private:
+   std::ostream &out; ///< destination stream
+   std::mutex out_mutex; ///< keeps lines from interleaving
+};
+
+/**
+ * Asynchronous sink: callers copy the message into a fixed-size lock-free ring buffer and return,
+ * a background thread drains the ring into a downstream sink.
+ * Producers never block or allocate- if the ring is full the message is dropped and counted.
+ * Messages longer than MAX_MESSAGE_SIZE - 1 bytes are truncated.
+ */
+class async_log_sink : public log_sink
+{
+public:
+   static constexpr size_t MAX_MESSAGE_SIZE = 256; ///< bytes per ring slot, including terminator
+
+   /**
+    * @brief start the drain thread
+    * @param downstream sink that receives drained messages, must outlive this object
+    * @param capacity number of ring slots, rounded up to a power of two
+    */
+   explicit async_log_sink(log_sink &downstream, size_t capacity = 4096);
+
+   /**
+    * @brief drain whatever is left and stop the drain thread
+    */
+   ~async_log_sink() override;
+
+   async_log_sink(const async_log_sink &) = delete;
+   async_log_sink &operator=(const async_log_sink &) = delete;
+
+   void write(log_level level, const std::string &message) override;
+
+   /**
+    * @brief block until every message written so far has reached the downstream sink
+    */
+   void flush();
+
+   /**
+    * @brief number of messages dropped because the ring was full
+    * @return drop count since construction
+    */
+   uint64_t dropped() const { return num_dropped.load(std::memory_order_relaxed); }
+
+private:
+   /**
+    * one ring slot, sequence numbers follow the bounded MPMC queue design by D. Vyukov
+    */
+   struct slot
+   {
+      std::atomic<size_t> sequence; ///< tells producers and the consumer whose turn the slot is
+      log_level level; ///< message level
+      char text[MAX_MESSAGE_SIZE]; ///< nul-terminated message
+   };
+
+   bool try_pop(log_level &level, std::string &message);
+   void drain_loop();
+
+   log_sink &downstream; ///< receives drained messages
+   size_t mask; ///< capacity - 1
+   slot *ring; ///< capacity slots
+   std::atomic<size_t> enqueue_pos{0}; ///< next slot a producer claims
+   std::atomic<size_t> dequeue_pos{0}; ///< next slot the consumer reads
+   std::atomic<size_t> num_drained{0}; ///< messages handed downstream so far
+   std::atomic<uint64_t> num_dropped{0}; ///< messages lost to a full ring
+   std::atomic<bool> stopping{false}; ///< set by the destructor
+   std::thread drainer; ///< background consumer
+};
+
+/**
+ * @brief install the sink every LP_LOG_* macro writes to
+ * @param sink sink that outlives its installation, nullptr to discard all messages
+ */
+void set_log_sink(log_sink *sink);
+
+/**
+ * @brief set the runtime threshold, messages below it are skipped before formatting
+ * levels below LP_LOG_LEVEL are already compiled out and can't be turned back on here
+ * @param level lowest level to emit
+ */
+void set_log_level(log_level level);
+
+/**
+ * @brief test whether a message at level would reach the sink
+ * @param level severity under test
+ * @return true if a sink is installed and level passes the runtime threshold
+ */
+bool is_log_enabled(log_level level);
+
+/**
+ * @brief hand a formatted message to the installed sink
+ * @param level severity of the message
+ * @param message text without trailing newline
+ */
+void log_write(log_level level, const std::string &message);
+
+/**
+ * format with operator<< and write, only if the level is enabled at runtime
+ */
+#define LP_LOG(level, expr)                         \
+   do                                               \
+   {                                                \
+      if (is_log_enabled(level))                    \
+      {                                             \
+         std::ostringstream lp_log_stream;          \
+         lp_log_stream << expr;                     \
+         log_write(level, lp_log_stream.str());     \
+      }                                             \
+   } while (0)
+
+#if LP_LOG_LEVEL <= LP_LOG_LEVEL_DEBUG
+#define LP_LOG_DEBUG(expr) LP_LOG(log_level::DEBUG, expr)
+#else
+#define LP_LOG_DEBUG(expr) do {} while (0)
+#endif
+
+#if LP_LOG_LEVEL <= LP_LOG_LEVEL_INFO
+#define LP_LOG_INFO(expr) LP_LOG(log_level::INFO, expr)
+#else
+#define LP_LOG_INFO(expr) do {} while (0)
+#endif
+
+#if LP_LOG_LEVEL <= LP_LOG_LEVEL_WARNING
+#define LP_LOG_WARNING(expr) LP_LOG(log_level::WARNING, expr)
+#else
+#define LP_LOG_WARNING(expr) do {} while (0)
+#endif
+
+#if LP_LOG_LEVEL <= LP_LOG_LEVEL_ERROR
+#define LP_LOG_ERROR(expr) LP_LOG(log_level::ERROR, expr)
+#else
+#define LP_LOG_ERROR(expr) do {} while (0)
+#endif
+
+#endif  // __LOGGING_HPP_
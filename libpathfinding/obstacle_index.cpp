@@ -0,0 +1,181 @@
+/**
+ * @file obstacle_index.cpp
+ * @brief Spatial index over blocks of obstacles, built once per obstacle map
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "obstacle_index.hpp"
+#include "geometry_kernels.hpp"
+
+using namespace std;
+
+
+/**
+ * @brief sort-tile-recursive order of the obstacles, so each run of OBSTACLE_LANES is spatially compact
+ * sorted into vertical slabs by x, then each slab by y
+ * @param obstacles obstacles to order
+ * @return permutation of obstacle indices
+ */
+static vector<size_t> tile_order(span<const obstacle> obstacles)
+{
+   vector<size_t> order(obstacles.size());
+   iota(order.begin(), order.end(), 0);
+   size_t num_blocks = (order.size() + OBSTACLE_LANES - 1) / OBSTACLE_LANES;
+   size_t slab_size = static_cast<size_t>(ceil(sqrt(static_cast<double>(num_blocks)))) * OBSTACLE_LANES;
+
+   stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return obstacles[a].p.x() < obstacles[b].p.x(); });
+   for (size_t start = 0; start < order.size(); start += slab_size)
+   {
+      auto end = order.begin() + min(order.size(), start + slab_size);
+      stable_sort(order.begin() + start, end, [&](size_t a, size_t b) { return obstacles[a].p.y() < obstacles[b].p.y(); });
+   }
+   return order;
+}
+
+obstacle_index build_obstacle_index(span<const obstacle> obstacles, coordinate_mode mode)
+{
+   obstacle_soa soa = build_obstacle_soa(obstacles, tile_order(obstacles), mode);
+
+   vector<ObstacleEntry> entries;
+   entries.reserve(num_blocks(soa));
+   for (size_t block = 0; block < num_blocks(soa); block++)
+   {
+      Boundary box = obstacle_bounding_box(obstacles[soa.ids[block * OBSTACLE_LANES]]);
+      for (size_t k = 1; k < OBSTACLE_LANES && soa.ids[block * OBSTACLE_LANES + k] != NO_OBSTACLE; k++)
+      {
+         bg::expand(box, obstacle_bounding_box(obstacles[soa.ids[block * OBSTACLE_LANES + k]]));
+      }
+      entries.push_back({box, block});
+   }
+
+   // the range constructor uses the packing algorithm, much better than inserting one by one
+   return obstacle_index{vector<obstacle>(obstacles.begin(), obstacles.end()), move(soa), ObstacleTree(entries.begin(), entries.end())};
+}
+
+size_t obstacle_index_bytes(const obstacle_index &index)
+{
+   return index.obstacles.size() * sizeof(obstacle) + obstacle_soa_bytes(index.soa) + index.tree.size() * sizeof(ObstacleEntry);
+}
+
+Boundary obstacle_bounding_box(const obstacle &o)
+{
+   return Boundary(Point(o.p.x() - o.radius, o.p.y() - o.radius),
+                   Point(o.p.x() + o.radius, o.p.y() + o.radius));
+}
+
+/**
+ * @brief append the obstacle indices of a block's hits, settling its uncertain lanes in double
+ * @param index obstacle_index the block belongs to
+ * @param block block the masks belong to
+ * @param mask hit mask from one of the obstacle_soa kernels
+ * @param uncertain uncertain mask from the same call
+ * @param is_hit exact test of one obstacle, the predicate the kernel computes
+ * @param result indices are appended here
+ */
+template <typename Predicate>
+static void append_hits(const obstacle_index &index, size_t block, uint32_t mask, uint32_t uncertain, Predicate is_hit, scratch_vector<size_t> &result)
+{
+   while (uncertain != 0)
+   {
+      int k = countr_zero(uncertain);
+      if (is_hit(index.obstacles[index.soa.ids[block * OBSTACLE_LANES + k]]))
+      {
+         mask |= 1u << k;
+      }
+      uncertain &= uncertain - 1;
+   }
+   while (mask != 0)
+   {
+      result.push_back(index.soa.ids[block * OBSTACLE_LANES + countr_zero(mask)]);
+      mask &= mask - 1;
+   }
+}
+
+/**
+ * @brief sort hit indices, so callers see obstacles in the order they were provided
+ * and results do not depend on block layout
+ * @param hits indices, possibly repeated
+ * @return sorted, de-duplicated indices
+ */
+static scratch_vector<size_t> sorted_indices(scratch_vector<size_t> hits)
+{
+   sort(hits.begin(), hits.end());
+   hits.erase(unique(hits.begin(), hits.end()), hits.end());
+   return hits;
+}
+
+scratch_vector<size_t> query_path_hits(const obstacle_index &index, span<const Point> path)
+{
+   if (path.size() == 1)
+   {
+      return query_point_hits(index, path[0]);
+   }
+   scratch_vector<size_t> hits;
+   scratch_vector<ObstacleEntry> blocks;
+   uint32_t uncertain = 0;
+   for (size_t i = 1; i < path.size(); i++)
+   {
+      blocks.clear();
+      index.tree.query(bgi::intersects(Segment(path[i - 1], path[i])), back_inserter(blocks));
+      for (auto &block : blocks)
+      {
+         uint32_t mask = segment_hit_mask(index.soa, block.second, path[i - 1], path[i], uncertain);
+         append_hits(index, block.second, mask, uncertain, [&](const obstacle &o) { return segment_intersects_circle(path[i - 1], path[i], o); }, hits);
+      }
+   }
+   return sorted_indices(move(hits));
+}
+
+scratch_vector<size_t> query_point_hits(const obstacle_index &index, const Point &p)
+{
+   scratch_vector<size_t> hits;
+   scratch_vector<ObstacleEntry> blocks;
+   uint32_t uncertain = 0;
+   index.tree.query(bgi::intersects(p), back_inserter(blocks));
+   for (auto &block : blocks)
+   {
+      uint32_t mask = point_hit_mask(index.soa, block.second, p, uncertain);
+      append_hits(index, block.second, mask, uncertain, [&](const obstacle &o) { return point_in_circle(p, o); }, hits);
+   }
+   return sorted_indices(move(hits));
+}
+
+scratch_vector<size_t> query_outline_hits(const obstacle_index &index, const Boundary &box)
+{
+   scratch_vector<size_t> hits;
+   scratch_vector<ObstacleEntry> blocks;
+   uint32_t uncertain = 0;
+   index.tree.query(bgi::intersects(box), back_inserter(blocks));
+   for (auto &block : blocks)
+   {
+      uint32_t mask = outline_hit_mask(index.soa, block.second, box, uncertain);
+      append_hits(index, block.second, mask, uncertain, [&](const obstacle &o) { return circle_reaches_outline(box, o); }, hits);
+   }
+   return sorted_indices(move(hits));
+}
+
+scratch_vector<size_t> query_box_hits(const obstacle_index &index, const Boundary &box)
+{
+   scratch_vector<size_t> hits;
+   scratch_vector<ObstacleEntry> blocks;
+   index.tree.query(bgi::intersects(box), back_inserter(blocks));
+   for (auto &block : blocks)
+   {
+      // no batched kernel for this one, every filled lane is settled in double
+      uint32_t uncertain = 0;
+      for (size_t k = 0; k < OBSTACLE_LANES && index.soa.ids[block.second * OBSTACLE_LANES + k] != NO_OBSTACLE; k++)
+      {
+         uncertain |= 1u << k;
+      }
+      append_hits(index, block.second, 0, uncertain, [&](const obstacle &o) { return box_intersects_circle(box, o); }, hits);
+   }
+   return sorted_indices(move(hits));
+}
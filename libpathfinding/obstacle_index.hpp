@@ -0,0 +1,96 @@
+/**
+ * @file obstacle_index.hpp
+ * @brief Spatial index over blocks of obstacles, built once per obstacle map
+ *
+ * Obstacles are tiled into spatially compact blocks of OBSTACLE_LANES (see obstacle_soa.hpp). The R-tree holds one
+ * bounding box per block, and each block it returns is tested with one batched kernel call. In FLOAT32 mode the
+ * kernels may report near misses, which are dropped by testing those few obstacles again in double.
+ */
+#ifndef __OBSTACLE_INDEX_HPP_
+#define __OBSTACLE_INDEX_HPP_
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+#include "pathfinding.hpp"
+#include "obstacle_soa.hpp"
+#include "scratch_arena.hpp"
+
+namespace bgi = boost::geometry::index;
+
+using Segment = bg::model::segment<Point>; ///< alias for boost.geometry segment<Point>
+using ObstacleEntry = std::pair<Boundary, size_t>; ///< bounding box and the index of the obstacle (or block) it bounds
+using ObstacleTree = bgi::rtree<ObstacleEntry, bgi::quadratic<16>>; ///< alias for the boost.geometry R-tree holding ObstacleEntry
+
+/**
+ * Obstacles of a single map, the same obstacles in blocks, and an R-tree over the blocks
+ * queries return exact hits as indices into obstacles
+ */
+struct obstacle_index
+{
+   std::vector<obstacle> obstacles; ///< obstacles in the order they were provided, in double in every mode for exact retests and path building
+   obstacle_soa soa; ///< obstacles tiled into spatially compact blocks
+   ObstacleTree tree; ///< R-tree of {bounding box of a block, block number}
+};
+
+/**
+ * @brief bulk-load an obstacle_index from a vector of obstacles
+ * @param obstacles all circular obstacles on the map, copied into the index
+ * @param mode how the blocks store obstacles, queries return the same hits either way
+ * @return populated obstacle_index
+ */
+obstacle_index build_obstacle_index(std::span<const obstacle> obstacles, coordinate_mode mode = coordinate_mode::DOUBLE);
+
+/**
+ * @brief bytes held by an obstacle_index, its double obstacles, block lanes and R-tree entries
+ * The R-tree's node overhead is left out, so this is a lower bound
+ * @param index obstacle_index to measure
+ * @return size of its arrays
+ */
+size_t obstacle_index_bytes(const obstacle_index &index);
+
+/**
+ * @brief axis-aligned bounding box of a circular obstacle
+ * @param o obstacle to bound
+ * @return Boundary enclosing the full circle
+ */
+Boundary obstacle_bounding_box(const obstacle &o);
+
+/**
+ * @brief find obstacles that any segment of a path touches, same predicate as path_intersects_circle()
+ * @param index obstacle_index for the map
+ * @param path points of a path, one or more
+ * @return sorted, de-duplicated indices into index.obstacles, on the scratch arena
+ */
+scratch_vector<size_t> query_path_hits(const obstacle_index &index, std::span<const Point> path);
+
+/**
+ * @brief find obstacles that contain a point, same predicate as point_in_circle()
+ * @param index obstacle_index for the map
+ * @param p point under test
+ * @return sorted indices into index.obstacles, on the scratch arena
+ */
+scratch_vector<size_t> query_point_hits(const obstacle_index &index, const Point &p);
+
+/**
+ * @brief find obstacles that reach the outline of a box, see outline_hit_mask()
+ * only these can contain or split the box
+ * @param index obstacle_index for the map
+ * @param box box under test
+ * @return sorted indices into index.obstacles, on the scratch arena
+ */
+scratch_vector<size_t> query_outline_hits(const obstacle_index &index, const Boundary &box);
+
+/**
+ * @brief find obstacles that share any point with a box, same predicate as box_intersects_circle()
+ * @param index obstacle_index for the map
+ * @param box box under test
+ * @return sorted indices into index.obstacles, on the scratch arena
+ */
+scratch_vector<size_t> query_box_hits(const obstacle_index &index, const Boundary &box);
+
+#endif  // __OBSTACLE_INDEX_HPP_
@@ -0,0 +1,672 @@
+/**
+ * @file obstacle_map.cpp
+ * @brief Persistent obstacle map with a precomputed tangent visibility graph, queried with A*
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "obstacle_map.hpp"
+#include "geometry_kernels.hpp"
+#include "tangent_path.hpp"
+
+using namespace std;
+
+const double MAP_TWO_PI = 2.0 * M_PI;
+const double MAP_EPSILON = 1e-9; ///< slack for touching, a path may graze a circle but not cut into it
+const size_t NO_CIRCLE = SIZE_MAX; ///< query_edge::circle of a straight segment
+
+/**
+ * a tangent point from a query endpoint, only lives for one find_path()
+ */
+struct query_node
+{
+   size_t circle; ///< circle the point lies on
+   Point p; ///< position on the circle
+   double angle; ///< angle of p around the circle center
+};
+
+/**
+ * a step of the query graph, either a segment or an arc around one circle
+ */
+struct query_edge
+{
+   size_t to; ///< node the step arrives at
+   double cost; ///< length of the step
+   size_t circle; ///< circle of an arc, NO_CIRCLE for a segment
+   bool is_clockwise; ///< direction of an arc
+};
+
+/**
+ * @brief fold an angle into [0, 2pi)
+ * @param a angle in radians
+ * @return equivalent angle in [0, 2pi)
+ */
+static double wrap_angle(double a)
+{
+   a = fmod(a, MAP_TWO_PI);
+   return (a < 0) ? a + MAP_TWO_PI : a;
+}
+
+/**
+ * @brief test whether a segment cuts into a circle, grazing it does not count
+ * @param a first segment endpoint
+ * @param b second segment endpoint
+ * @param o circle
+ * @return true if part of the segment is strictly inside o
+ */
+static bool is_blocking(const Point &a, const Point &b, const obstacle &o)
+{
+   double inner = o.radius - MAP_EPSILON * (1.0 + o.radius);
+   return inner > 0 && point_segment_distance_sq(o.p, a, b) < inner * inner;
+}
+
+obstacle_map::obstacle_map(const Boundary &bounds, const vector<obstacle> &obstacles, double clearance, double arc_tolerance)
+    : bounds(bounds), clearance(clearance), arc_tolerance(arc_tolerance)
+{
+   if (!(arc_tolerance > 0))
+   {
+      throw invalid_argument("ERROR: obstacle_map arc_tolerance must be > 0");
+   }
+   for (auto &o : obstacles)
+   {
+      add_circle(o);
+   }
+   for (size_t c = 0; c < circles.size(); c++)
+   {
+      rebuild_ring(c);
+   }
+}
+
+size_t obstacle_map::insert(const obstacle &o)
+{
+   for (size_t c : add_circle(o))
+   {
+      rebuild_ring(c);
+   }
+   return circles.size() - 1;
+}
+
+void obstacle_map::remove(size_t id)
+{
+   if (id >= circles.size() || !circles[id].active)
+   {
+      throw invalid_argument("ERROR: obstacle_map has no obstacle " + to_string(id));
+   }
+   map_circle &circle = circles[id];
+   Boundary box = obstacle_bounding_box(circle.shape);
+   circle.active = false;
+   circle_tree.remove(ObstacleEntry(box, id));
+
+   /* bitangents of the removed circle go with it, along with their nodes on the other circles */
+   vector<size_t> touched;
+   for (size_t n : circle.members)
+   {
+      map_edge &edge = edges[nodes[n].edge];
+      if (!edge.alive)
+      {
+         continue;
+      }
+      edge.alive = false;
+      dead_edges++;
+      nodes[edge.a].alive = false;
+      nodes[edge.b].alive = false;
+      edge_tree.remove(SegmentEntry(Segment(nodes[edge.a].p, nodes[edge.b].p), nodes[n].edge));
+      touched.push_back(nodes[(edge.a == n) ? edge.b : edge.a].circle);
+   }
+
+   /* bitangents that passed through it have one blocker less */
+   vector<SegmentEntry> hits;
+   edge_tree.query(bgi::intersects(box), back_inserter(hits));
+   for (auto &hit : hits)
+   {
+      map_edge &edge = edges[hit.second];
+      if (is_blocking(nodes[edge.a].p, nodes[edge.b].p, circle.shape))
+      {
+         edge.blockers--;
+      }
+   }
+
+   /* circles it overlapped get their arcs back */
+   vector<size_t> overlapping = query_circles(box);
+   touched.insert(touched.end(), overlapping.begin(), overlapping.end());
+   touched.push_back(id);
+   sort(touched.begin(), touched.end());
+   touched.erase(unique(touched.begin(), touched.end()), touched.end());
+   for (size_t c : touched)
+   {
+      rebuild_ring(c);
+   }
+   if (2 * dead_edges > edges.size())
+   {
+      compact();
+   }
+}
+
+size_t obstacle_map::num_obstacles() const
+{
+   return count_if(circles.begin(), circles.end(), [](const map_circle &c) { return c.active; });
+}
+
+size_t obstacle_map::num_edges() const
+{
+   return count_if(edges.begin(), edges.end(), [](const map_edge &e) { return e.alive && e.blockers == 0; });
+}
+
+/**
+ * @brief add a circle, its bitangents to every live circle, and its blocker counts
+ * rings are left for the caller to rebuild
+ * @param o obstacle to add, before clearance
+ * @return circles whose ring needs rebuilding, sorted
+ */
+vector<size_t> obstacle_map::add_circle(const obstacle &o)
+{
+   size_t id = circles.size();
+   map_circle circle;
+   circle.shape = {o.p, o.radius + clearance};
+   Boundary box = obstacle_bounding_box(circle.shape);
+
+   /* bitangents that pass through the new circle get one more blocker */
+   vector<SegmentEntry> hits;
+   edge_tree.query(bgi::intersects(box), back_inserter(hits));
+   for (auto &hit : hits)
+   {
+      map_edge &edge = edges[hit.second];
+      if (is_blocking(nodes[edge.a].p, nodes[edge.b].p, circle.shape))
+      {
+         edge.blockers++;
+      }
+   }
+   circles.push_back(circle);
+
+   vector<size_t> touched = query_circles(box);
+   touched.push_back(id);
+   for (size_t j = 0; j < id; j++)
+   {
+      if (circles[j].active && add_bitangents(j, id))
+      {
+         touched.push_back(j);
+      }
+   }
+   circle_tree.insert(ObstacleEntry(box, id));
+
+   sort(touched.begin(), touched.end());
+   touched.erase(unique(touched.begin(), touched.end()), touched.end());
+   return touched;
+}
+
+/**
+ * @brief add the (up to) four bitangents between circles i and j
+ * outer bitangents exist unless one circle contains the other, inner ones only if the circles are apart.
+ * Bitangents that leave the bounds can never be used and are not added
+ * @param i first circle
+ * @param j second circle
+ * @return true if any bitangent was added
+ */
+bool obstacle_map::add_bitangents(size_t i, size_t j)
+{
+   const obstacle &ci = circles[i].shape;
+   const obstacle &cj = circles[j].shape;
+   double dx = cj.p.x() - ci.p.x();
+   double dy = cj.p.y() - ci.p.y();
+   double d = hypot(dx, dy);
+   if (d == 0)
+   {
+      return false;
+   }
+   dx /= d;
+   dy /= d;
+
+   bool added = false;
+   for (double side : {1.0, -1.0})
+   {
+      // normal n of the tangent line satisfies n . (cj - ci) = ri - side * rj
+      double k = (ci.radius - side * cj.radius) / d;
+      if (fabs(k) >= 1.0)
+      {
+         continue;
+      }
+      double h = sqrt(1.0 - k * k);
+      for (double turn : {1.0, -1.0})
+      {
+         double nx = k * dx - turn * h * dy;
+         double ny = k * dy + turn * h * dx;
+         Point pi(ci.p.x() + ci.radius * nx, ci.p.y() + ci.radius * ny);
+         Point pj(cj.p.x() + side * cj.radius * nx, cj.p.y() + side * cj.radius * ny);
+         if (!bg::covered_by(pi, bounds) || !bg::covered_by(pj, bounds))
+         {
+            continue;
+         }
+
+         size_t e = edges.size();
+         size_t a = nodes.size();
+         nodes.push_back({i, pi, wrap_angle(atan2(ny, nx)), e});
+         nodes.push_back({j, pj, wrap_angle(atan2(side * ny, side * nx)), e});
+         circles[i].members.push_back(a);
+         circles[j].members.push_back(a + 1);
+
+         map_edge edge = {a, a + 1, bg::distance(pi, pj)};
+         edge.blockers = count_blockers(pi, pj, i, j);
+         edges.push_back(edge);
+         edge_tree.insert(SegmentEntry(Segment(pi, pj), e));
+         added = true;
+      }
+   }
+   return added;
+}
+
+/**
+ * @brief sort the live nodes of a circle into its ring and work out which arcs between them are free
+ * @param c circle to rebuild
+ */
+void obstacle_map::rebuild_ring(size_t c)
+{
+   map_circle &circle = circles[c];
+   circle.ring.clear();
+   circle.ring_angles.clear();
+   circle.arc_open.clear();
+   circle.blocked.clear();
+   if (!circle.active)
+   {
+      circle.members.clear();
+      return;
+   }
+
+   auto dead = [&](size_t n) { return !nodes[n].alive; };
+   circle.members.erase(remove_if(circle.members.begin(), circle.members.end(), dead), circle.members.end());
+   circle.ring = circle.members;
+   sort(circle.ring.begin(), circle.ring.end(), [&](size_t a, size_t b) { return nodes[a].angle < nodes[b].angle; });
+   for (size_t k = 0; k < circle.ring.size(); k++)
+   {
+      nodes[circle.ring[k]].ring_pos = k;
+      circle.ring_angles.push_back(nodes[circle.ring[k]].angle);
+   }
+
+   /* stretches of the circle inside another obstacle */
+   const obstacle &o = circle.shape;
+   for (size_t k : query_circles(obstacle_bounding_box(o)))
+   {
+      const obstacle &other = circles[k].shape;
+      double d = bg::distance(o.p, other.p);
+      if (k == c || d >= o.radius + other.radius || d + other.radius <= o.radius)
+      {
+         continue;
+      }
+      if (d + o.radius <= other.radius)
+      {
+         circle.blocked.push_back({0.0, M_PI});
+         continue;
+      }
+      double cos_half = (o.radius * o.radius + d * d - other.radius * other.radius) / (2.0 * o.radius * d);
+      circle.blocked.push_back({atan2(other.p.y() - o.p.y(), other.p.x() - o.p.x()), acos(clamp(cos_half, -1.0, 1.0))});
+   }
+
+   /* stretches of the circle outside the bounds */
+   const Point &lo = bounds.min_corner();
+   const Point &hi = bounds.max_corner();
+   const pair<double, double> sides[4] = {{0.0, hi.x() - o.p.x()}, {M_PI / 2, hi.y() - o.p.y()},
+                                          {M_PI, o.p.x() - lo.x()}, {3 * M_PI / 2, o.p.y() - lo.y()}};
+   for (auto &side : sides)
+   {
+      if (side.second < o.radius)
+      {
+         circle.blocked.push_back({side.first, acos(clamp(side.second / o.radius, -1.0, 1.0))});
+      }
+   }
+
+   size_t m = circle.ring.size();
+   if (m < 2)
+   {
+      return;
+   }
+   for (size_t k = 0; k < m; k++)
+   {
+      double sweep = wrap_angle(circle.ring_angles[(k + 1) % m] - circle.ring_angles[k]);
+      circle.arc_open.push_back(is_arc_clear(circle, circle.ring_angles[k], sweep) ? 1 : 0);
+   }
+}
+
+/**
+ * @brief number of live circles a segment cuts into
+ * @param a first segment endpoint
+ * @param b second segment endpoint
+ * @param skip_1 circle to ignore, NO_CIRCLE for none
+ * @param skip_2 another circle to ignore, NO_CIRCLE for none
+ * @return number of blocking circles
+ */
+size_t obstacle_map::count_blockers(const Point &a, const Point &b, size_t skip_1, size_t skip_2) const
+{
+   vector<ObstacleEntry> hits;
+   circle_tree.query(bgi::intersects(Segment(a, b)), back_inserter(hits));
+   size_t count = 0;
+   for (auto &hit : hits)
+   {
+      if (hit.second != skip_1 && hit.second != skip_2 && is_blocking(a, b, circles[hit.second].shape))
+      {
+         count++;
+      }
+   }
+   return count;
+}
+
+/**
+ * @brief test whether a counterclockwise arc stays clear of other obstacles and inside the bounds
+ * @param circle circle of the arc, its blocked stretches must be current
+ * @param start_angle angle the arc starts at
+ * @param sweep counterclockwise extent of the arc, in [0, 2pi)
+ * @return true if the arc overlaps none of circle.blocked
+ */
+bool obstacle_map::is_arc_clear(const map_circle &circle, double start_angle, double sweep) const
+{
+   for (auto &stretch : circle.blocked)
+   {
+      if (stretch.second >= M_PI)
+      {
+         return false;
+      }
+      // offset of the blocked stretch's start from the arc's start, going counterclockwise
+      double offset = wrap_angle(stretch.first - stretch.second - start_angle);
+      if (offset < sweep - MAP_EPSILON || offset + 2.0 * stretch.second > MAP_TWO_PI + MAP_EPSILON)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief live circles whose bounding box touches a box
+ * @param box box under test
+ * @return circle ids, sorted
+ */
+vector<size_t> obstacle_map::query_circles(const Boundary &box) const
+{
+   vector<ObstacleEntry> hits;
+   circle_tree.query(bgi::intersects(box), back_inserter(hits));
+   vector<size_t> ids;
+   for (auto &hit : hits)
+   {
+      ids.push_back(hit.second);
+   }
+   sort(ids.begin(), ids.end());
+   return ids;
+}
+
+/**
+ * @brief drop dead nodes and edges, renumbering the live ones in their current order
+ * rings only ever hold live nodes, so they are remapped in place and keep their order
+ */
+void obstacle_map::compact()
+{
+   vector<size_t> new_id(nodes.size(), SIZE_MAX);
+   vector<map_node> live_nodes;
+   vector<map_edge> live_edges;
+   vector<SegmentEntry> entries;
+   live_nodes.reserve(2 * (edges.size() - dead_edges));
+   live_edges.reserve(edges.size() - dead_edges);
+   entries.reserve(edges.size() - dead_edges);
+   for (auto &edge : edges)
+   {
+      if (!edge.alive)
+      {
+         continue;
+      }
+      size_t e = live_edges.size();
+      for (size_t n : {edge.a, edge.b})
+      {
+         new_id[n] = live_nodes.size();
+         live_nodes.push_back(nodes[n]);
+         live_nodes.back().edge = e;
+      }
+      live_edges.push_back(edge);
+      live_edges.back().a = new_id[edge.a];
+      live_edges.back().b = new_id[edge.b];
+      entries.push_back(SegmentEntry(Segment(nodes[edge.a].p, nodes[edge.b].p), e));
+   }
+   for (auto &circle : circles)
+   {
+      circle.members.erase(remove_if(circle.members.begin(), circle.members.end(), [&](size_t n) { return new_id[n] == SIZE_MAX; }),
+                           circle.members.end());
+      for (size_t &n : circle.members)
+      {
+         n = new_id[n];
+      }
+      for (size_t &n : circle.ring)
+      {
+         n = new_id[n];
+      }
+   }
+   nodes = move(live_nodes);
+   edges = move(live_edges);
+   edge_tree = SegmentTree(entries);
+   dead_edges = 0;
+}
+
+Line obstacle_map::find_path(const Point &agent, const Point &target) const
+{
+   const Point ends[2] = {agent, target};
+   for (auto &p : ends)
+   {
+      if (!bg::covered_by(p, bounds))
+      {
+         throw invalid_argument("ERROR: obstacle_map query point is out of bounds");
+      }
+      for (size_t c : query_circles(Boundary(p, p)))
+      {
+         const obstacle &o = circles[c].shape;
+         if (bg::distance(p, o.p) < o.radius - MAP_EPSILON * (1.0 + o.radius))
+         {
+            throw invalid_argument("ERROR: obstacle_map query point is inside an obstacle");
+         }
+      }
+   }
+   if (count_blockers(agent, target, NO_CIRCLE, NO_CIRCLE) == 0)
+   {
+      return Line{agent, target};
+   }
+
+   /**
+    * query graph: nodes [0, N) are the map's, then the tangent points from agent and target,
+    * then agent and target themselves. Steps touching a query node are kept aside
+    */
+   const size_t N = nodes.size();
+   vector<query_node> temps;
+   vector<pair<size_t, size_t>> links; // {end, temp}
+   for (size_t e = 0; e < 2; e++)
+   {
+      const Point &p = ends[e];
+      for (size_t c = 0; c < circles.size(); c++)
+      {
+         if (!circles[c].active)
+         {
+            continue;
+         }
+         const obstacle &o = circles[c].shape;
+         double d = bg::distance(p, o.p);
+         if (d <= o.radius * (1.0 + MAP_EPSILON))
+         {
+            continue;
+         }
+         double base = atan2(p.y() - o.p.y(), p.x() - o.p.x());
+         double half = acos(o.radius / d);
+         for (double a : {base + half, base - half})
+         {
+            Point t(o.p.x() + o.radius * cos(a), o.p.y() + o.radius * sin(a));
+            if (bg::covered_by(t, bounds) && count_blockers(p, t, c, NO_CIRCLE) == 0)
+            {
+               links.push_back({e, temps.size()});
+               temps.push_back({c, t, wrap_angle(a)});
+            }
+         }
+      }
+   }
+   const size_t T = temps.size();
+   const size_t AGENT = N + T;
+   const size_t TARGET = N + T + 1;
+
+   vector<vector<query_edge>> query_adj(T + 2);
+   unordered_map<size_t, vector<query_edge>> map_adj;
+   auto adj_of = [&](size_t n) -> vector<query_edge> & { return (n < N) ? map_adj[n] : query_adj[n - N]; };
+   auto link = [&](size_t u, size_t v, double cost, size_t circle, bool is_clockwise)
+   {
+      adj_of(u).push_back({v, cost, circle, is_clockwise});
+      adj_of(v).push_back({u, cost, circle, !is_clockwise});
+   };
+   auto point_of = [&](size_t n) -> const Point & { return (n < N) ? nodes[n].p : (n < AGENT) ? temps[n - N].p : ends[n - AGENT]; };
+
+   for (auto &l : links)
+   {
+      link(AGENT + l.first, N + l.second, bg::distance(ends[l.first], temps[l.second].p), NO_CIRCLE, false);
+   }
+   for (size_t t = 0; t < T; t++)
+   {
+      const query_node &q = temps[t];
+      const map_circle &circle = circles[q.circle];
+      const double r = circle.shape.radius;
+
+      /* around the circle to the nearest map nodes either way */
+      size_t m = circle.ring.size();
+      if (m > 0)
+      {
+         size_t next = upper_bound(circle.ring_angles.begin(), circle.ring_angles.end(), q.angle) - circle.ring_angles.begin();
+         next %= m;
+         size_t prev = (next + m - 1) % m;
+         double sweep = wrap_angle(circle.ring_angles[next] - q.angle);
+         if (is_arc_clear(circle, q.angle, sweep))
+         {
+            link(N + t, circle.ring[next], r * sweep, q.circle, false);
+         }
+         sweep = wrap_angle(q.angle - circle.ring_angles[prev]);
+         if (is_arc_clear(circle, circle.ring_angles[prev], sweep))
+         {
+            link(N + t, circle.ring[prev], r * sweep, q.circle, true);
+         }
+      }
+
+      /* and to the other query nodes on the same circle */
+      for (size_t u = t + 1; u < T; u++)
+      {
+         if (temps[u].circle != q.circle)
+         {
+            continue;
+         }
+         double sweep = wrap_angle(temps[u].angle - q.angle);
+         if (is_arc_clear(circle, q.angle, sweep))
+         {
+            link(N + t, N + u, r * sweep, q.circle, false);
+         }
+         if (is_arc_clear(circle, temps[u].angle, MAP_TWO_PI - sweep))
+         {
+            link(N + u, N + t, r * (MAP_TWO_PI - sweep), q.circle, false);
+         }
+      }
+   }
+
+   /* A*, straight-line distance to the target never overestimates */
+   vector<double> cost(T + N + 2, HUGE_VAL);
+   vector<query_edge> arrived_by(T + N + 2, {NO_CIRCLE, 0.0, NO_CIRCLE, false}); // .to is the node each one was reached from
+   using frontier_entry = pair<double, size_t>;
+   priority_queue<frontier_entry, vector<frontier_entry>, greater<frontier_entry>> frontier;
+   cost[AGENT] = 0;
+   frontier.push({bg::distance(agent, target), AGENT});
+
+   vector<query_edge> steps;
+   while (!frontier.empty())
+   {
+      auto [estimate, n] = frontier.top();
+      frontier.pop();
+      if (n == TARGET)
+      {
+         break;
+      }
+      if (estimate > cost[n] + bg::distance(point_of(n), target) + MAP_EPSILON)
+      {
+         continue;
+      }
+
+      steps.clear();
+      if (n < N)
+      {
+         const map_node &node = nodes[n];
+         const map_edge &edge = edges[node.edge];
+         if (edge.alive && edge.blockers == 0)
+         {
+            steps.push_back({(edge.a == n) ? edge.b : edge.a, edge.length, NO_CIRCLE, false});
+         }
+         const map_circle &circle = circles[node.circle];
+         size_t m = circle.ring.size();
+         if (m >= 2)
+         {
+            size_t k = node.ring_pos;
+            size_t next = (k + 1) % m;
+            size_t prev = (k + m - 1) % m;
+            if (circle.arc_open[k])
+            {
+               double sweep = wrap_angle(circle.ring_angles[next] - circle.ring_angles[k]);
+               steps.push_back({circle.ring[next], circle.shape.radius * sweep, node.circle, false});
+            }
+            if (circle.arc_open[prev])
+            {
+               double sweep = wrap_angle(circle.ring_angles[k] - circle.ring_angles[prev]);
+               steps.push_back({circle.ring[prev], circle.shape.radius * sweep, node.circle, true});
+            }
+         }
+         auto extra = map_adj.find(n);
+         if (extra != map_adj.end())
+         {
+            steps.insert(steps.end(), extra->second.begin(), extra->second.end());
+         }
+      }
+      else
+      {
+         steps = query_adj[n - N];
+      }
+      for (auto &step : steps)
+      {
+         double next_cost = cost[n] + step.cost;
+         if (next_cost < cost[step.to])
+         {
+            cost[step.to] = next_cost;
+            arrived_by[step.to] = {n, step.cost, step.circle, step.is_clockwise};
+            frontier.push({next_cost + bg::distance(point_of(step.to), target), step.to});
+         }
+      }
+   }
+   if (cost[TARGET] == HUGE_VAL)
+   {
+      return Line();
+   }
+
+   /* walk back from the target, then emit segments and sampled arcs in order */
+   vector<size_t> chain = {TARGET};
+   while (chain.back() != AGENT)
+   {
+      chain.push_back(arrived_by[chain.back()].to);
+   }
+   reverse(chain.begin(), chain.end());
+
+   Line path = {agent};
+   for (size_t i = 1; i < chain.size(); i++)
+   {
+      const query_edge &step = arrived_by[chain[i]];
+      const Point &p = point_of(chain[i]);
+      if (step.circle != NO_CIRCLE)
+      {
+         append_circle_arc(path, circles[step.circle].shape, point_of(chain[i - 1]), p, step.is_clockwise, arc_tolerance);
+      }
+      if (i + 1 == chain.size() || bg::distance(path.back(), p) > MAP_EPSILON)
+      {
+         path.push_back(p);
+      }
+   }
+   return path;
+}
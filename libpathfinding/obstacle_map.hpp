@@ -0,0 +1,141 @@
+/**
+ * @file obstacle_map.hpp
+ * @brief Persistent obstacle map with a precomputed tangent visibility graph, queried with A*
+ *
+ * The shortest path around circles is made of bitangent segments between circles and arcs along them.
+ * An obstacle_map finds every bitangent between its (inflated) obstacles once, and keeps, per bitangent,
+ * a count of the obstacles blocking it. A query only has to add the tangents from its two endpoints
+ * before running A*. Inserting or removing an obstacle only touches the bitangents of that obstacle
+ * and the blocker counts of bitangents crossing it.
+ *
+ * Removed bitangents stay in the graph as dead entries until they make up half of it, then the nodes and edges
+ * are compacted, so memory and per-query work follow the live obstacles under insert/remove churn. Obstacle ids
+ * are never reused, a removed obstacle keeps an empty map_circle slot that queries step over.
+ */
+#ifndef __OBSTACLE_MAP_HPP_
+#define __OBSTACLE_MAP_HPP_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+#include "pathfinding.hpp"
+#include "obstacle_index.hpp"
+
+using SegmentEntry = std::pair<Segment, size_t>; ///< bitangent segment and its position in obstacle_map::edges
+using SegmentTree = bgi::rtree<SegmentEntry, bgi::quadratic<16>>; ///< alias for the boost.geometry R-tree holding SegmentEntry
+
+/**
+ * an obstacle of the map and the tangent points on it
+ */
+struct map_circle
+{
+   obstacle shape; ///< obstacle grown by the map clearance
+   bool active = true; ///< false once removed, ids are never reused
+   std::vector<size_t> members; ///< nodes added on this circle, dead ones are dropped by rebuild_ring()
+   std::vector<size_t> ring; ///< live nodes on this circle, sorted by angle
+   std::vector<double> ring_angles; ///< angle of each node in ring
+   std::vector<char> arc_open; ///< arc_open[k] is true if the counterclockwise arc ring[k] -> ring[k + 1] is free
+   std::vector<std::pair<double, double>> blocked; ///< {center angle, half width} of each arc of the circle inside another obstacle or out of bounds
+};
+
+/**
+ * an end point of a bitangent
+ */
+struct map_node
+{
+   size_t circle; ///< circle this node lies on
+   Point p; ///< position on the circle
+   double angle; ///< angle of p around the circle center
+   size_t edge; ///< bitangent this node belongs to, each bitangent has its own two nodes
+   size_t ring_pos = 0; ///< position in map_circle::ring
+   bool alive = true; ///< false once its circle or the other circle of its bitangent is removed
+};
+
+/**
+ * a bitangent between two circles, usable while nothing blocks it
+ */
+struct map_edge
+{
+   size_t a; ///< node on the first circle
+   size_t b; ///< node on the second circle
+   double length; ///< length of the segment
+   size_t blockers = 0; ///< number of live obstacles the segment passes through
+   bool alive = true; ///< false once one of its circles is removed
+};
+
+/**
+ * An obstacle map to plan many agent -> target paths against
+ * Build it once per map, then call find_path() as often as needed. find_path() is const and keeps
+ * its state on the stack, so any number of threads may query one map as long as none of them modifies it
+ */
+class obstacle_map
+{
+public:
+   /**
+    * @brief build the tangent visibility graph of a map
+    * @param bounds outer boundary, no path leaves it
+    * @param obstacles circular obstacles of the map
+    * @param clearance distance every path keeps from every obstacle, added to each radius
+    * @param arc_tolerance largest gap between a sampled arc of a path and its circle, must be > 0
+    */
+   obstacle_map(const Boundary &bounds, const std::vector<obstacle> &obstacles, double clearance = 0.0, double arc_tolerance = 0.01);
+
+   /**
+    * @brief add an obstacle without rebuilding the graph
+    * @param o obstacle to add, grown by the map clearance
+    * @return id of the obstacle, for remove()
+    */
+   size_t insert(const obstacle &o);
+
+   /**
+    * @brief remove an obstacle without rebuilding the graph
+    * Throws std::invalid_argument if id isn't a live obstacle of this map
+    * @param id returned by insert(), or the position of the obstacle in the constructor's vector
+    */
+   void remove(size_t id);
+
+   /**
+    * @brief shortest path from agent to target
+    * Throws std::invalid_argument if agent or target is out of bounds or inside an obstacle
+    * @param agent first point of the path
+    * @param target last point of the path
+    * @return path from agent to target, or an empty Line if target can't be reached
+    */
+   Line find_path(const Point &agent, const Point &target) const;
+
+   /**
+    * @brief number of live obstacles
+    * @return obstacles inserted and not removed
+    */
+   size_t num_obstacles() const;
+
+   /**
+    * @brief number of usable bitangents
+    * @return bitangents that are alive and not blocked
+    */
+   size_t num_edges() const;
+
+private:
+   std::vector<size_t> add_circle(const obstacle &o);
+   bool add_bitangents(size_t i, size_t j);
+   void rebuild_ring(size_t c);
+   size_t count_blockers(const Point &a, const Point &b, size_t skip_1, size_t skip_2) const;
+   bool is_arc_clear(const map_circle &circle, double start_angle, double sweep) const;
+   std::vector<size_t> query_circles(const Boundary &box) const;
+   void compact();
+
+   Boundary bounds; ///< outer boundary of the map
+   double clearance; ///< added to every obstacle radius
+   double arc_tolerance; ///< see append_circle_arc()
+   std::vector<map_circle> circles; ///< every obstacle ever added, indexed by id
+   std::vector<map_node> nodes; ///< tangent points, dead ones included until the next compact()
+   std::vector<map_edge> edges; ///< bitangents, dead ones included until the next compact()
+   size_t dead_edges = 0; ///< edges no longer alive, see compact()
+   ObstacleTree circle_tree; ///< bounding boxes of live circles
+   SegmentTree edge_tree; ///< live bitangents, blocked or not
+};
+
+#endif  // __OBSTACLE_MAP_HPP_
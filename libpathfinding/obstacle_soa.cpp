@@ -0,0 +1,543 @@
+/**
+ * @file obstacle_soa.cpp
+ * @brief Structure-of-arrays obstacle store and batched circle tests that return a hit mask per block
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "obstacle_soa.hpp"
+#include "geometry_kernels.hpp"
+
+#if defined(__x86_64__) && !defined(LP_DISABLE_SIMD)
+#define LP_HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+const double FLOAT_SLACK = 64.0 * FLT_EPSILON; ///< float rounding error bound, relative to the largest coordinate involved
+
+
+/**
+ * @brief whether this build and this CPU can run the AVX2 kernels
+ * @return true if the AVX2 kernels are available
+ */
+static bool cpu_has_avx2()
+{
+#ifdef LP_HAVE_AVX2_KERNELS
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2");
+#else
+   return false;
+#endif
+}
+
+static const bool avx2_available = cpu_has_avx2(); ///< checked once at load
+static atomic<bool> use_avx2{avx2_available}; ///< see set_simd_kernels()
+
+obstacle_soa build_obstacle_soa(span<const obstacle> obstacles, const vector<size_t> &order, coordinate_mode mode)
+{
+   size_t padded = ((order.size() + OBSTACLE_LANES - 1) / OBSTACLE_LANES) * OBSTACLE_LANES;
+   if (obstacles.size() >= NO_OBSTACLE)
+   {
+      throw invalid_argument("ERROR: too many obstacles for one obstacle_soa");
+   }
+   obstacle_soa soa;
+   soa.mode = mode;
+   soa.ids.assign(padded, NO_OBSTACLE);
+   for (size_t k = 0; k < order.size(); k++)
+   {
+      soa.ids[k] = static_cast<uint32_t>(order[k]);
+   }
+
+   if (mode == coordinate_mode::DOUBLE)
+   {
+      soa.x.assign(padded, 0.0);
+      soa.y.assign(padded, 0.0);
+      soa.r.assign(padded, numeric_limits<double>::quiet_NaN());
+      for (size_t k = 0; k < order.size(); k++)
+      {
+         const obstacle &o = obstacles[order[k]];
+         soa.x[k] = o.p.x();
+         soa.y[k] = o.p.y();
+         soa.r[k] = o.radius;
+      }
+      return soa;
+   }
+
+   /* center the frame on the obstacles, so offsets and their rounding error stay small */
+   if (!obstacles.empty())
+   {
+      Boundary box(obstacles[0].p, obstacles[0].p);
+      for (auto &o : obstacles)
+      {
+         bg::expand(box, o.p);
+      }
+      bg::centroid(box, soa.origin);
+   }
+   soa.fx.assign(padded, 0.0f);
+   soa.fy.assign(padded, 0.0f);
+   soa.fr.assign(padded, numeric_limits<float>::quiet_NaN());
+   for (size_t k = 0; k < order.size(); k++)
+   {
+      const obstacle &o = obstacles[order[k]];
+      const double dx = o.p.x() - soa.origin.x();
+      const double dy = o.p.y() - soa.origin.y();
+      soa.fx[k] = static_cast<float>(dx);
+      soa.fy[k] = static_cast<float>(dy);
+      soa.fr[k] = nextafter(static_cast<float>(o.radius), HUGE_VALF);
+      soa.extent = max(soa.extent, max(fabs(dx), fabs(dy)) + o.radius);
+   }
+   return soa;
+}
+
+size_t obstacle_soa_bytes(const obstacle_soa &soa)
+{
+   return (soa.x.size() + soa.y.size() + soa.r.size()) * sizeof(double) +
+          (soa.fx.size() + soa.fy.size() + soa.fr.size()) * sizeof(float) + soa.ids.size() * sizeof(uint32_t);
+}
+
+/**
+ * a query moved into the float frame of an obstacle_soa
+ * every radius it is tested against grows by slack, which bounds the rounding error of the test
+ */
+struct float_query
+{
+   float ax; ///< first point x, or box min x
+   float ay; ///< first point y, or box min y
+   float bx; ///< second point x, or box max x
+   float by; ///< second point y, or box max y
+   float slack; ///< added to every radius
+};
+
+/**
+ * @brief move two points (a segment, a point twice, or the corners of a box) into the float frame
+ * @param soa obstacle store in FLOAT32 mode
+ * @param a first point
+ * @param b second point
+ * @return float_query with a slack that covers the extent of the obstacles and of both points
+ */
+static float_query to_float_query(const obstacle_soa &soa, const Point &a, const Point &b)
+{
+   const double ax = a.x() - soa.origin.x();
+   const double ay = a.y() - soa.origin.y();
+   const double bx = b.x() - soa.origin.x();
+   const double by = b.y() - soa.origin.y();
+   const double scale = max({soa.extent, fabs(ax), fabs(ay), fabs(bx), fabs(by)});
+   return {static_cast<float>(ax), static_cast<float>(ay), static_cast<float>(bx), static_cast<float>(by),
+           static_cast<float>(FLOAT_SLACK * scale)};
+}
+
+/* Scalar kernels, the reference every SIMD kernel must match bit for bit */
+
+/**
+ * @brief fold a lane's float test, run at radius - slack and at radius + slack, into the two masks
+ * @param sure the test passed even with the smaller radius
+ * @param maybe the test passed with the larger radius
+ * @param k lane number
+ * @param mask lanes that certainly hit
+ * @param uncertain lanes within rounding error of the predicate
+ */
+static void fold_lane(bool sure, bool maybe, size_t k, uint32_t &mask, uint32_t &uncertain)
+{
+   if (sure)
+   {
+      mask |= 1u << k;
+   }
+   else if (maybe)
+   {
+      uncertain |= 1u << k;
+   }
+}
+
+static uint32_t segment_hit_mask_float(const obstacle_soa &soa, size_t block, const float_query &q, uint32_t &uncertain)
+{
+   const float dx = q.bx - q.ax;
+   const float dy = q.by - q.ay;
+   const float len_sq = dx * dx + dy * dy;
+   uint32_t mask = 0;
+   uncertain = 0;
+   for (size_t k = 0; k < OBSTACLE_LANES; k++)
+   {
+      size_t i = block * OBSTACLE_LANES + k;
+      const float x = soa.fx[i];
+      const float y = soa.fy[i];
+      const float near = soa.fr[i] - q.slack;
+      const float far = soa.fr[i] + q.slack;
+      float t = 0.0f;
+      if (len_sq > 0.0f)
+      {
+         t = max(min(((x - q.ax) * dx + (y - q.ay) * dy) / len_sq, 1.0f), 0.0f);
+      }
+      const float ex = q.ax + t * dx - x;
+      const float ey = q.ay + t * dy - y;
+      const float dist_sq = ex * ex + ey * ey;
+      fold_lane(near > 0.0f && dist_sq <= near * near, dist_sq <= far * far, k, mask, uncertain);
+   }
+   return mask;
+}
+
+static uint32_t point_hit_mask_float(const obstacle_soa &soa, size_t block, const float_query &q, uint32_t &uncertain)
+{
+   uint32_t mask = 0;
+   uncertain = 0;
+   for (size_t k = 0; k < OBSTACLE_LANES; k++)
+   {
+      size_t i = block * OBSTACLE_LANES + k;
+      const float dx = q.ax - soa.fx[i];
+      const float dy = q.ay - soa.fy[i];
+      const float near = soa.fr[i] - q.slack;
+      const float far = soa.fr[i] + q.slack;
+      const float dist_sq = dx * dx + dy * dy;
+      fold_lane(near > 0.0f && dist_sq <= near * near, dist_sq <= far * far, k, mask, uncertain);
+   }
+   return mask;
+}
+
+/**
+ * @brief circle_reaches_outline() of one float lane
+ * @param q box in the float frame
+ * @param x center x of the lane
+ * @param y center y of the lane
+ * @param r radius of the lane
+ * @return true if the lane's bounding box meets the box without lying strictly inside it
+ */
+static bool float_reaches_outline(const float_query &q, float x, float y, float r)
+{
+   bool touches = (x - r <= q.bx) && (x + r >= q.ax) && (y - r <= q.by) && (y + r >= q.ay);
+   bool inside = (x - r > q.ax) && (x + r < q.bx) && (y - r > q.ay) && (y + r < q.by);
+   return touches && !inside;
+}
+
+static uint32_t outline_hit_mask_float(const obstacle_soa &soa, size_t block, const float_query &q, uint32_t &uncertain)
+{
+   uint32_t mask = 0;
+   uncertain = 0;
+   for (size_t k = 0; k < OBSTACLE_LANES; k++)
+   {
+      size_t i = block * OBSTACLE_LANES + k;
+      const float x = soa.fx[i];
+      const float y = soa.fy[i];
+      // a larger radius only makes touching easier and lying strictly inside harder, so the smaller radius gives the sure hits
+      const float near = soa.fr[i] - q.slack;
+      const float far = soa.fr[i] + q.slack;
+      fold_lane(near > 0.0f && float_reaches_outline(q, x, y, near), float_reaches_outline(q, x, y, far), k, mask, uncertain);
+   }
+   return mask;
+}
+
+static uint32_t segment_hit_mask_scalar(const obstacle_soa &soa, size_t block, const Point &a, const Point &b)
+{
+   uint32_t mask = 0;
+   for (size_t k = 0; k < OBSTACLE_LANES; k++)
+   {
+      size_t i = block * OBSTACLE_LANES + k;
+      const double r = soa.r[i];
+      if (point_segment_distance_sq(Point(soa.x[i], soa.y[i]), a, b) <= r * r)
+      {
+         mask |= 1u << k;
+      }
+   }
+   return mask;
+}
+
+static uint32_t point_hit_mask_scalar(const obstacle_soa &soa, size_t block, const Point &p)
+{
+   uint32_t mask = 0;
+   for (size_t k = 0; k < OBSTACLE_LANES; k++)
+   {
+      size_t i = block * OBSTACLE_LANES + k;
+      if (point_in_circle(p, {Point(soa.x[i], soa.y[i]), soa.r[i]}))
+      {
+         mask |= 1u << k;
+      }
+   }
+   return mask;
+}
+
+static uint32_t outline_hit_mask_scalar(const obstacle_soa &soa, size_t block, const Boundary &box)
+{
+   uint32_t mask = 0;
+   for (size_t k = 0; k < OBSTACLE_LANES; k++)
+   {
+      size_t i = block * OBSTACLE_LANES + k;
+      if (circle_reaches_outline(box, {Point(soa.x[i], soa.y[i]), soa.r[i]}))
+      {
+         mask |= 1u << k;
+      }
+   }
+   return mask;
+}
+
+#ifdef LP_HAVE_AVX2_KERNELS
+
+/* AVX2 kernels, the same operations in the same order as the scalar ones, four lanes at a time and without FMA */
+
+__attribute__((target("avx2"))) static uint32_t segment_hit_mask_avx2(const obstacle_soa &soa, size_t block, const Point &a, const Point &b)
+{
+   const double dx_s = b.x() - a.x();
+   const double dy_s = b.y() - a.y();
+   const double len_sq_s = dx_s * dx_s + dy_s * dy_s;
+   const __m256d ax = _mm256_set1_pd(a.x());
+   const __m256d ay = _mm256_set1_pd(a.y());
+   const __m256d dx = _mm256_set1_pd(dx_s);
+   const __m256d dy = _mm256_set1_pd(dy_s);
+   const __m256d len_sq = _mm256_set1_pd(len_sq_s);
+   const __m256d zero = _mm256_setzero_pd();
+   const __m256d one = _mm256_set1_pd(1.0);
+
+   uint32_t mask = 0;
+   for (size_t half = 0; half < OBSTACLE_LANES; half += 4)
+   {
+      size_t i = block * OBSTACLE_LANES + half;
+      const __m256d x = _mm256_load_pd(&soa.x[i]);
+      const __m256d y = _mm256_load_pd(&soa.y[i]);
+      const __m256d r = _mm256_load_pd(&soa.r[i]);
+      __m256d t = zero;
+      if (len_sq_s > 0.0)
+      {
+         __m256d along = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(x, ax), dx), _mm256_mul_pd(_mm256_sub_pd(y, ay), dy));
+         t = _mm256_max_pd(_mm256_min_pd(_mm256_div_pd(along, len_sq), one), zero);
+      }
+      const __m256d ex = _mm256_sub_pd(_mm256_add_pd(ax, _mm256_mul_pd(t, dx)), x);
+      const __m256d ey = _mm256_sub_pd(_mm256_add_pd(ay, _mm256_mul_pd(t, dy)), y);
+      const __m256d dist_sq = _mm256_add_pd(_mm256_mul_pd(ex, ex), _mm256_mul_pd(ey, ey));
+      const __m256d hit = _mm256_cmp_pd(dist_sq, _mm256_mul_pd(r, r), _CMP_LE_OQ);
+      mask |= static_cast<uint32_t>(_mm256_movemask_pd(hit)) << half;
+   }
+   return mask;
+}
+
+__attribute__((target("avx2"))) static uint32_t point_hit_mask_avx2(const obstacle_soa &soa, size_t block, const Point &p)
+{
+   const __m256d px = _mm256_set1_pd(p.x());
+   const __m256d py = _mm256_set1_pd(p.y());
+
+   uint32_t mask = 0;
+   for (size_t half = 0; half < OBSTACLE_LANES; half += 4)
+   {
+      size_t i = block * OBSTACLE_LANES + half;
+      const __m256d dx = _mm256_sub_pd(px, _mm256_load_pd(&soa.x[i]));
+      const __m256d dy = _mm256_sub_pd(py, _mm256_load_pd(&soa.y[i]));
+      const __m256d r = _mm256_load_pd(&soa.r[i]);
+      const __m256d dist_sq = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+      const __m256d hit = _mm256_cmp_pd(dist_sq, _mm256_mul_pd(r, r), _CMP_LE_OQ);
+      mask |= static_cast<uint32_t>(_mm256_movemask_pd(hit)) << half;
+   }
+   return mask;
+}
+
+__attribute__((target("avx2"))) static uint32_t outline_hit_mask_avx2(const obstacle_soa &soa, size_t block, const Boundary &box)
+{
+   const __m256d lo_x = _mm256_set1_pd(box.min_corner().x());
+   const __m256d lo_y = _mm256_set1_pd(box.min_corner().y());
+   const __m256d hi_x = _mm256_set1_pd(box.max_corner().x());
+   const __m256d hi_y = _mm256_set1_pd(box.max_corner().y());
+
+   uint32_t mask = 0;
+   for (size_t half = 0; half < OBSTACLE_LANES; half += 4)
+   {
+      size_t i = block * OBSTACLE_LANES + half;
+      const __m256d x = _mm256_load_pd(&soa.x[i]);
+      const __m256d y = _mm256_load_pd(&soa.y[i]);
+      const __m256d r = _mm256_load_pd(&soa.r[i]);
+      const __m256d x_lo = _mm256_sub_pd(x, r);
+      const __m256d x_hi = _mm256_add_pd(x, r);
+      const __m256d y_lo = _mm256_sub_pd(y, r);
+      const __m256d y_hi = _mm256_add_pd(y, r);
+      __m256d touches = _mm256_and_pd(_mm256_cmp_pd(x_lo, hi_x, _CMP_LE_OQ), _mm256_cmp_pd(x_hi, lo_x, _CMP_GE_OQ));
+      touches = _mm256_and_pd(touches, _mm256_and_pd(_mm256_cmp_pd(y_lo, hi_y, _CMP_LE_OQ), _mm256_cmp_pd(y_hi, lo_y, _CMP_GE_OQ)));
+      __m256d inside = _mm256_and_pd(_mm256_cmp_pd(x_lo, lo_x, _CMP_GT_OQ), _mm256_cmp_pd(x_hi, hi_x, _CMP_LT_OQ));
+      inside = _mm256_and_pd(inside, _mm256_and_pd(_mm256_cmp_pd(y_lo, lo_y, _CMP_GT_OQ), _mm256_cmp_pd(y_hi, hi_y, _CMP_LT_OQ)));
+      mask |= static_cast<uint32_t>(_mm256_movemask_pd(_mm256_andnot_pd(inside, touches))) << half;
+   }
+   return mask;
+}
+
+/**
+ * @brief split the two AVX2 float comparison results the way fold_lane() does
+ * @param sure lanes that passed with radius - slack
+ * @param maybe lanes that passed with radius + slack
+ * @param uncertain output, maybe and not sure
+ * @return sure lanes
+ */
+__attribute__((target("avx2"))) static uint32_t fold_lanes_avx2(__m256 sure, __m256 maybe, uint32_t &uncertain)
+{
+   uncertain = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_andnot_ps(sure, maybe)));
+   return static_cast<uint32_t>(_mm256_movemask_ps(sure));
+}
+
+__attribute__((target("avx2"))) static uint32_t segment_hit_mask_float_avx2(const obstacle_soa &soa, size_t block, const float_query &q, uint32_t &uncertain)
+{
+   const float dx_s = q.bx - q.ax;
+   const float dy_s = q.by - q.ay;
+   const float len_sq_s = dx_s * dx_s + dy_s * dy_s;
+   const __m256 ax = _mm256_set1_ps(q.ax);
+   const __m256 ay = _mm256_set1_ps(q.ay);
+   const __m256 dx = _mm256_set1_ps(dx_s);
+   const __m256 dy = _mm256_set1_ps(dy_s);
+   const __m256 slack = _mm256_set1_ps(q.slack);
+   const __m256 zero = _mm256_setzero_ps();
+
+   size_t i = block * OBSTACLE_LANES;
+   const __m256 x = _mm256_load_ps(&soa.fx[i]);
+   const __m256 y = _mm256_load_ps(&soa.fy[i]);
+   const __m256 r = _mm256_load_ps(&soa.fr[i]);
+   const __m256 near = _mm256_sub_ps(r, slack);
+   const __m256 far = _mm256_add_ps(r, slack);
+   __m256 t = zero;
+   if (len_sq_s > 0.0f)
+   {
+      __m256 along = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(x, ax), dx), _mm256_mul_ps(_mm256_sub_ps(y, ay), dy));
+      t = _mm256_max_ps(_mm256_min_ps(_mm256_div_ps(along, _mm256_set1_ps(len_sq_s)), _mm256_set1_ps(1.0f)), zero);
+   }
+   const __m256 ex = _mm256_sub_ps(_mm256_add_ps(ax, _mm256_mul_ps(t, dx)), x);
+   const __m256 ey = _mm256_sub_ps(_mm256_add_ps(ay, _mm256_mul_ps(t, dy)), y);
+   const __m256 dist_sq = _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey));
+   const __m256 sure = _mm256_and_ps(_mm256_cmp_ps(near, zero, _CMP_GT_OQ), _mm256_cmp_ps(dist_sq, _mm256_mul_ps(near, near), _CMP_LE_OQ));
+   return fold_lanes_avx2(sure, _mm256_cmp_ps(dist_sq, _mm256_mul_ps(far, far), _CMP_LE_OQ), uncertain);
+}
+
+__attribute__((target("avx2"))) static uint32_t point_hit_mask_float_avx2(const obstacle_soa &soa, size_t block, const float_query &q, uint32_t &uncertain)
+{
+   const __m256 slack = _mm256_set1_ps(q.slack);
+   const __m256 zero = _mm256_setzero_ps();
+
+   size_t i = block * OBSTACLE_LANES;
+   const __m256 dx = _mm256_sub_ps(_mm256_set1_ps(q.ax), _mm256_load_ps(&soa.fx[i]));
+   const __m256 dy = _mm256_sub_ps(_mm256_set1_ps(q.ay), _mm256_load_ps(&soa.fy[i]));
+   const __m256 r = _mm256_load_ps(&soa.fr[i]);
+   const __m256 near = _mm256_sub_ps(r, slack);
+   const __m256 far = _mm256_add_ps(r, slack);
+   const __m256 dist_sq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+   const __m256 sure = _mm256_and_ps(_mm256_cmp_ps(near, zero, _CMP_GT_OQ), _mm256_cmp_ps(dist_sq, _mm256_mul_ps(near, near), _CMP_LE_OQ));
+   return fold_lanes_avx2(sure, _mm256_cmp_ps(dist_sq, _mm256_mul_ps(far, far), _CMP_LE_OQ), uncertain);
+}
+
+/**
+ * @brief float_reaches_outline() of eight lanes
+ * @param q box in the float frame
+ * @param x center x of the lanes
+ * @param y center y of the lanes
+ * @param r radius of the lanes
+ * @return all ones in lanes that reach the outline
+ */
+__attribute__((target("avx2"))) static __m256 float_reaches_outline_avx2(const float_query &q, __m256 x, __m256 y, __m256 r)
+{
+   const __m256 lo_x = _mm256_set1_ps(q.ax);
+   const __m256 lo_y = _mm256_set1_ps(q.ay);
+   const __m256 hi_x = _mm256_set1_ps(q.bx);
+   const __m256 hi_y = _mm256_set1_ps(q.by);
+   const __m256 x_lo = _mm256_sub_ps(x, r);
+   const __m256 x_hi = _mm256_add_ps(x, r);
+   const __m256 y_lo = _mm256_sub_ps(y, r);
+   const __m256 y_hi = _mm256_add_ps(y, r);
+   __m256 touches = _mm256_and_ps(_mm256_cmp_ps(x_lo, hi_x, _CMP_LE_OQ), _mm256_cmp_ps(x_hi, lo_x, _CMP_GE_OQ));
+   touches = _mm256_and_ps(touches, _mm256_and_ps(_mm256_cmp_ps(y_lo, hi_y, _CMP_LE_OQ), _mm256_cmp_ps(y_hi, lo_y, _CMP_GE_OQ)));
+   __m256 inside = _mm256_and_ps(_mm256_cmp_ps(x_lo, lo_x, _CMP_GT_OQ), _mm256_cmp_ps(x_hi, hi_x, _CMP_LT_OQ));
+   inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(y_lo, lo_y, _CMP_GT_OQ), _mm256_cmp_ps(y_hi, hi_y, _CMP_LT_OQ)));
+   return _mm256_andnot_ps(inside, touches);
+}
+
+__attribute__((target("avx2"))) static uint32_t outline_hit_mask_float_avx2(const obstacle_soa &soa, size_t block, const float_query &q, uint32_t &uncertain)
+{
+   const __m256 slack = _mm256_set1_ps(q.slack);
+
+   size_t i = block * OBSTACLE_LANES;
+   const __m256 x = _mm256_load_ps(&soa.fx[i]);
+   const __m256 y = _mm256_load_ps(&soa.fy[i]);
+   const __m256 r = _mm256_load_ps(&soa.fr[i]);
+   const __m256 near = _mm256_sub_ps(r, slack);
+   const __m256 far = _mm256_add_ps(r, slack);
+   const __m256 sure = _mm256_and_ps(_mm256_cmp_ps(near, _mm256_setzero_ps(), _CMP_GT_OQ), float_reaches_outline_avx2(q, x, y, near));
+   return fold_lanes_avx2(sure, float_reaches_outline_avx2(q, x, y, far), uncertain);
+}
+
+#endif  // LP_HAVE_AVX2_KERNELS
+
+uint32_t segment_hit_mask(const obstacle_soa &soa, size_t block, const Point &a, const Point &b, uint32_t &uncertain)
+{
+   if (soa.mode == coordinate_mode::FLOAT32)
+   {
+      const float_query q = to_float_query(soa, a, b);
+#ifdef LP_HAVE_AVX2_KERNELS
+      if (use_avx2.load(memory_order_relaxed))
+      {
+         return segment_hit_mask_float_avx2(soa, block, q, uncertain);
+      }
+#endif
+      return segment_hit_mask_float(soa, block, q, uncertain);
+   }
+   uncertain = 0;
+#ifdef LP_HAVE_AVX2_KERNELS
+   if (use_avx2.load(memory_order_relaxed))
+   {
+      return segment_hit_mask_avx2(soa, block, a, b);
+   }
+#endif
+   return segment_hit_mask_scalar(soa, block, a, b);
+}
+
+uint32_t point_hit_mask(const obstacle_soa &soa, size_t block, const Point &p, uint32_t &uncertain)
+{
+   if (soa.mode == coordinate_mode::FLOAT32)
+   {
+      const float_query q = to_float_query(soa, p, p);
+#ifdef LP_HAVE_AVX2_KERNELS
+      if (use_avx2.load(memory_order_relaxed))
+      {
+         return point_hit_mask_float_avx2(soa, block, q, uncertain);
+      }
+#endif
+      return point_hit_mask_float(soa, block, q, uncertain);
+   }
+   uncertain = 0;
+#ifdef LP_HAVE_AVX2_KERNELS
+   if (use_avx2.load(memory_order_relaxed))
+   {
+      return point_hit_mask_avx2(soa, block, p);
+   }
+#endif
+   return point_hit_mask_scalar(soa, block, p);
+}
+
+uint32_t outline_hit_mask(const obstacle_soa &soa, size_t block, const Boundary &box, uint32_t &uncertain)
+{
+   if (soa.mode == coordinate_mode::FLOAT32)
+   {
+      const float_query q = to_float_query(soa, box.min_corner(), box.max_corner());
+#ifdef LP_HAVE_AVX2_KERNELS
+      if (use_avx2.load(memory_order_relaxed))
+      {
+         return outline_hit_mask_float_avx2(soa, block, q, uncertain);
+      }
+#endif
+      return outline_hit_mask_float(soa, block, q, uncertain);
+   }
+   uncertain = 0;
+#ifdef LP_HAVE_AVX2_KERNELS
+   if (use_avx2.load(memory_order_relaxed))
+   {
+      return outline_hit_mask_avx2(soa, block, box);
+   }
+#endif
+   return outline_hit_mask_scalar(soa, block, box);
+}
+
+void set_simd_kernels(bool enabled)
+{
+   use_avx2.store(enabled && avx2_available);
+}
+
+const char *obstacle_kernel_name()
+{
+   return use_avx2.load() ? "avx2" : "scalar";
+}
@@ -0,0 +1,142 @@
+/**
+ * @file obstacle_soa.hpp
+ * @brief Structure-of-arrays obstacle store and batched circle tests that return a hit mask per block
+ *
+ * Obstacles are grouped into blocks of OBSTACLE_LANES, with their center x, center y and radius each in
+ * their own aligned array. One call tests a whole block against a segment, a point or a box and returns
+ * one bit per obstacle. The AVX2 kernels do four obstacles per instruction. The scalar kernels give bit-for-bit
+ * the same masks, and are used when the CPU lacks AVX2, when built with -DLP_DISABLE_SIMD, or after set_simd_kernels(false).
+ *
+ * In coordinate_mode::FLOAT32 the lanes hold float32 offsets from an origin near the obstacles instead, so the
+ * coordinate lanes of a block take half the bytes and fit one AVX2 register each. Only the lanes shrink, the caller
+ * keeps the obstacles in double to settle close calls. Float tests can't be exact, so each lane is tested with its
+ * radius shrunk and grown by a bound on the rounding error. Lanes that pass both are hits, lanes that pass only the
+ * grown test are returned as uncertain, for the caller to settle in double. On real maps very few lanes are that close.
+ */
+#ifndef __OBSTACLE_SOA_HPP_
+#define __OBSTACLE_SOA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+const size_t OBSTACLE_LANES = 8; ///< obstacles per block, two AVX2 registers of doubles
+const size_t OBSTACLE_ALIGN = 32; ///< byte alignment of every block, one AVX2 register
+const uint32_t NO_OBSTACLE = UINT32_MAX; ///< id of a padding lane
+
+/**
+ * minimal allocator handing out OBSTACLE_ALIGN-aligned storage, so blocks can be loaded with aligned loads
+ */
+template <typename T>
+struct aligned_allocator
+{
+   using value_type = T;
+
+   aligned_allocator() = default;
+   template <typename U>
+   aligned_allocator(const aligned_allocator<U> &) {}
+
+   T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(OBSTACLE_ALIGN))); }
+   void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(OBSTACLE_ALIGN)); }
+
+   template <typename U>
+   bool operator==(const aligned_allocator<U> &) const { return true; }
+};
+
+using aligned_doubles = std::vector<double, aligned_allocator<double>>; ///< OBSTACLE_ALIGN-aligned array of doubles
+using aligned_floats = std::vector<float, aligned_allocator<float>>; ///< OBSTACLE_ALIGN-aligned array of floats
+
+/**
+ * Obstacles in blocks of OBSTACLE_LANES
+ * Only the arrays of the chosen mode are filled. The last block is padded with NaN radii, which never hit anything
+ */
+struct obstacle_soa
+{
+   coordinate_mode mode = coordinate_mode::DOUBLE; ///< which arrays below hold the obstacles
+   aligned_doubles x; ///< DOUBLE only, center x of every lane
+   aligned_doubles y; ///< DOUBLE only, center y of every lane
+   aligned_doubles r; ///< DOUBLE only, radius of every lane
+   Point origin; ///< FLOAT32 only, the float lanes are offsets from this point
+   double extent = 0.0; ///< FLOAT32 only, largest |offset| + radius of any lane, scales the rounding error bound
+   aligned_floats fx; ///< FLOAT32 only, center x - origin.x() of every lane
+   aligned_floats fy; ///< FLOAT32 only, center y - origin.y() of every lane
+   aligned_floats fr; ///< FLOAT32 only, radius of every lane, rounded up
+   std::vector<uint32_t> ids; ///< caller's index of the obstacle in every lane, NO_OBSTACLE for padding
+};
+
+/**
+ * @brief lay obstacles out in blocks, in the given order
+ * @param obstacles obstacles to store
+ * @param order indices into obstacles, consecutive runs of OBSTACLE_LANES become one block
+ * Throws std::invalid_argument if there are NO_OBSTACLE obstacles or more
+ * @param mode DOUBLE for exact tests, FLOAT32 for coordinate lanes of half the size
+ * @return populated obstacle_soa, ids hold the values of order
+ */
+obstacle_soa build_obstacle_soa(std::span<const obstacle> obstacles, const std::vector<size_t> &order,
+                                coordinate_mode mode = coordinate_mode::DOUBLE);
+
+/**
+ * @brief bytes held by the lanes of an obstacle_soa, ids included
+ * @param soa obstacle store
+ * @return size of all its arrays
+ */
+size_t obstacle_soa_bytes(const obstacle_soa &soa);
+
+/**
+ * @brief number of blocks in an obstacle_soa
+ * @param soa obstacle store
+ * @return number of blocks
+ */
+inline size_t num_blocks(const obstacle_soa &soa) { return soa.ids.size() / OBSTACLE_LANES; }
+
+/**
+ * @brief test one block against a segment, same predicate as segment_intersects_circle()
+ * @param soa obstacle store
+ * @param block block to test
+ * @param a first segment endpoint
+ * @param b second segment endpoint
+ * @param uncertain output, bit k set if lane k is too close to call in FLOAT32 mode, always 0 in DOUBLE mode
+ * @return bit k set if lane k touches the segment
+ */
+uint32_t segment_hit_mask(const obstacle_soa &soa, size_t block, const Point &a, const Point &b, uint32_t &uncertain);
+
+/**
+ * @brief test one block against a point, same predicate as point_in_circle()
+ * @param soa obstacle store
+ * @param block block to test
+ * @param p point under test
+ * @param uncertain output, bit k set if lane k is too close to call in FLOAT32 mode, always 0 in DOUBLE mode
+ * @return bit k set if the point is inside or on lane k
+ */
+uint32_t point_hit_mask(const obstacle_soa &soa, size_t block, const Point &p, uint32_t &uncertain);
+
+/**
+ * @brief find the circles of one block that reach the outline of a box
+ * a circle strictly inside the box can neither contain nor split it, every other circle whose bounding box meets the box is a hit
+ * (see circle_reaches_outline())
+ * @param soa obstacle store
+ * @param block block to test
+ * @param box box under test
+ * @param uncertain output, bit k set if lane k is too close to call in FLOAT32 mode, always 0 in DOUBLE mode
+ * @return bit k set if lane k is not strictly inside box but its bounding box intersects box
+ */
+uint32_t outline_hit_mask(const obstacle_soa &soa, size_t block, const Boundary &box, uint32_t &uncertain);
+
+/**
+ * @brief choose between the SIMD and scalar kernels at runtime, for benchmarking
+ * Enabling has no effect if the CPU lacks AVX2 or SIMD was disabled at build time
+ * @param enabled false to force the scalar kernels
+ */
+void set_simd_kernels(bool enabled);
+
+/**
+ * @brief name of the kernels in use
+ * @return "avx2" or "scalar"
+ */
+const char *obstacle_kernel_name();
+
+#endif  // __OBSTACLE_SOA_HPP_
@@ -0,0 +1,72 @@
+/**
+ * @file path_cache.cpp
+ * @brief Per-plan memo of calculate_path() results keyed by {agent, target}
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "path_cache.hpp"
+
+using namespace std;
+
+
+/**
+ * @brief fold one coordinate into a running hash
+ * @param seed running hash
+ * @param v coordinate, -0.0 hashes like 0.0
+ * @return updated hash
+ */
+static size_t hash_combine(size_t seed, double v)
+{
+   v += 0.0;
+   uint64_t bits;
+   memcpy(&bits, &v, sizeof(bits));
+   return seed ^ (hash<uint64_t>()(bits) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+size_t path_key_hash::operator()(const path_key &key) const
+{
+   size_t seed = 0;
+   seed = hash_combine(seed, key.agent_x);
+   seed = hash_combine(seed, key.agent_y);
+   seed = hash_combine(seed, key.target_x);
+   seed = hash_combine(seed, key.target_y);
+   return seed;
+}
+
+cached_path *path_cache_find(path_cache &cache, const Point &agent, const Point &target)
+{
+   auto it = cache.entries.find({agent.x(), agent.y(), target.x(), target.y()});
+   if (it == cache.entries.end())
+   {
+      return nullptr;
+   }
+   if (it->second.is_built)
+   {
+      cache.hits++;
+   }
+   return &it->second;
+}
+
+cached_path &path_cache_insert(path_cache &cache, const Point &agent, const Point &target)
+{
+   cache.misses++;
+   return cache.entries[{agent.x(), agent.y(), target.x(), target.y()}];
+}
+
+cached_path &path_cache_reserve(path_cache &cache, const Point &agent, const Point &target, int keepout_step, int num_keepout_steps)
+{
+   cached_path &entry = cache.entries[{agent.x(), agent.y(), target.x(), target.y()}];
+   entry.keepout_step = keepout_step;
+   entry.num_keepout_steps = num_keepout_steps;
+   entry.is_built = false;
+   return entry;
+}
+
+void path_cache_clear(path_cache &cache)
+{
+   cache.entries.clear();
+   cache.hits = 0;
+   cache.misses = 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file path_cache.hpp
+ * @brief Per-plan memo of calculate_path() results keyed by {agent, target}
+ */
+#ifndef __PATH_CACHE_HPP_
+#define __PATH_CACHE_HPP_
+
+#include <cstddef>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+/**
+ * exact coordinates of an {agent, target} pair, agents and targets are identified by position
+ */
+struct path_key
+{
+   double agent_x; ///< x of the agent
+   double agent_y; ///< y of the agent
+   double target_x; ///< x of the target
+   double target_y; ///< y of the target
+
+   bool operator==(const path_key &other) const = default;
+};
+
+/**
+ * hash over the bit patterns of a path_key, with -0.0 folded into 0.0 so equal keys hash equal
+ */
+struct path_key_hash
+{
+   size_t operator()(const path_key &key) const;
+};
+
+/**
+ * a computed path and its length
+ * The points live in the pool of the path_cache holding the entry, see path_cache
+ */
+struct cached_path
+{
+   using allocator_type = std::pmr::polymorphic_allocator<Point>; ///< lets the entries map hand its pool to the points
+
+   std::pmr::vector<Point> path; ///< points of the path from agent to target
+   double length = 0; ///< bg::length(path)
+   int keepout_step = 0; ///< first keepout step the path is built with, see path_cache_reserve()
+   int num_keepout_steps = 0; ///< steps held in the keepout_pool from keepout_step on, one per obstacle wrapped, 0 unless a result selected the path
+   bool is_built = true; ///< false while the path is reserved but not built yet
+
+   cached_path() = default;
+   explicit cached_path(const allocator_type &alloc) : path(alloc) {}
+   cached_path(const cached_path &other, const allocator_type &alloc)
+       : path(other.path, alloc), length(other.length), keepout_step(other.keepout_step), num_keepout_steps(other.num_keepout_steps),
+         is_built(other.is_built)
+   {
+   }
+};
+
+/**
+ * Every path computed during one plan, bids and uncrossing both read from here
+ * entries are never erased during a plan, so pointers to them stay valid. A Replanner keeps its cache from one plan
+ * to the next and erases the entries a change invalidates only between plans.
+ * Entries and their points come from pool, which keeps the memory when they are erased, so a cache cleared with
+ * path_cache_clear() and refilled with paths of the same sizes makes no heap allocations
+ */
+struct path_cache
+{
+   std::pmr::unsynchronized_pool_resource pool; ///< memory of entries, reused once they are erased
+   std::pmr::unordered_map<path_key, cached_path, path_key_hash> entries{&pool}; ///< computed paths
+   size_t hits = 0; ///< lookups answered without computing a path
+   size_t misses = 0; ///< paths computed and stored
+};
+
+/**
+ * @brief forget every entry and zero the counters, keeping the memory for the next plan
+ * @param cache path_cache to clear
+ */
+void path_cache_clear(path_cache &cache);
+
+/**
+ * @brief look up the path of {agent, target}
+ * counts a hit if a built path is found, a miss is only counted once the caller stores the path with path_cache_insert().
+ * A reserved entry is returned too, check cached_path::is_built
+ * @param cache path_cache to search
+ * @param agent position of the agent
+ * @param target position of the target
+ * @return the entry, or nullptr if the pair has not been stored
+ */
+cached_path *path_cache_find(path_cache &cache, const Point &agent, const Point &target);
+
+/**
+ * @brief get the entry of {agent, target} to store a newly computed path in, counts a miss
+ * an existing entry is returned as is, for the caller to overwrite
+ * @param cache path_cache to update
+ * @param agent position of the agent
+ * @param target position of the target
+ * @return the entry, valid for the life of the cache
+ */
+cached_path &path_cache_insert(path_cache &cache, const Point &agent, const Point &target);
+
+/**
+ * @brief store a placeholder for a path that may be built later, counts neither a hit nor a miss
+ * Pruned bids keep the keepout step they were given this way, so building one later gives the same path
+ * it would have had if it was built while bidding
+ * @param cache path_cache to update
+ * @param agent position of the agent
+ * @param target position of the target
+ * @param keepout_step first keepout step to build the path with
+ * @param num_keepout_steps number of steps the path holds in the keepout_pool
+ * @return the entry, valid for the life of the cache
+ */
+cached_path &path_cache_reserve(path_cache &cache, const Point &agent, const Point &target, int keepout_step, int num_keepout_steps);
+
+#endif  // __PATH_CACHE_HPP_
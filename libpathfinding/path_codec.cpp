@@ -0,0 +1,238 @@
+/**
+ * @file path_codec.cpp
+ * @brief Compact binary encoding of planned paths, for sending them to vehicles over a low-bandwidth link
+ */
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "path_codec.hpp"
+#include "byte_codec.hpp"
+
+using namespace std;
+
+/**
+ * @brief byte-at-a-time table of CRC-16/CCITT-FALSE, polynomial 0x1021
+ * @return remainder of every byte value
+ */
+static constexpr array<uint16_t, 256> crc16_table()
+{
+   array<uint16_t, 256> table = {};
+   for (int byte = 0; byte < 256; byte++)
+   {
+      uint16_t crc = static_cast<uint16_t>(byte << 8);
+      for (int bit = 0; bit < 8; bit++)
+      {
+         crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+      }
+      table[byte] = crc;
+   }
+   return table;
+}
+
+static constexpr array<uint16_t, 256> CRC16_TABLE = crc16_table(); ///< see crc16_table()
+
+/**
+ * @brief CRC-16/CCITT-FALSE, the 16-bit CRC most serial links already use
+ * @param bytes bytes to check
+ * @return CRC, initial value 0xFFFF and no final xor
+ */
+static uint16_t crc16(span<const char> bytes)
+{
+   uint16_t crc = 0xFFFF;
+   for (char c : bytes)
+   {
+      crc = static_cast<uint16_t>((crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ static_cast<uint8_t>(c)) & 0xff]);
+   }
+   return crc;
+}
+
+/**
+ * @brief number of quantization steps across a frame
+ * Throws std::invalid_argument if the frame has an empty box or bits outside 1 to 32
+ * @param frame frame to check
+ * @return 2^bits, quantized values run from 0 to 2^bits - 1
+ */
+static int64_t frame_steps(const path_frame &frame)
+{
+   if (frame.bits < 1 || frame.bits > 32 ||
+       !(frame.bounds.max_corner().x() > frame.bounds.min_corner().x()) ||
+       !(frame.bounds.max_corner().y() > frame.bounds.min_corner().y()))
+   {
+      throw invalid_argument("ERROR: path_frame needs a box with positive width and height and 1 to 32 bits");
+   }
+   return int64_t(1) << frame.bits;
+}
+
+/**
+ * @brief quantize one coordinate
+ * Throws std::invalid_argument if v lies outside {lo, hi}
+ * @param v coordinate
+ * @param lo frame minimum along the axis
+ * @param hi frame maximum along the axis
+ * @param steps number of steps across the frame
+ * @return nearest step to v, the last step for points within half a step of hi
+ */
+static int64_t quantize(double v, double lo, double hi, int64_t steps)
+{
+   double q = round((v - lo) / (hi - lo) * steps);
+   if (!(q >= 0 && q <= steps))
+   {
+      throw invalid_argument("ERROR: path point lies outside the path_frame bounds");
+   }
+   return min(static_cast<int64_t>(q), steps - 1);
+}
+
+/**
+ * @brief read the difference of one coordinate from the point before
+ * Throws std::runtime_error if it is larger than any two points of the frame can differ by
+ * @param cursor cursor over the message
+ * @param steps number of steps across the frame
+ * @return signed difference
+ */
+static int64_t get_delta(record_cursor &cursor, int64_t steps)
+{
+   // checked before decoding, so a corrupt value can't overflow the running coordinate
+   uint64_t encoded = cursor.get_varint();
+   if (encoded > 2 * static_cast<uint64_t>(steps - 1))
+   {
+      throw runtime_error("ERROR: path message point lies outside its frame");
+   }
+   return zigzag_decode(encoded);
+}
+
+double path_frame_max_error(const path_frame &frame)
+{
+   int64_t steps = frame_steps(frame);
+   double width = frame.bounds.max_corner().x() - frame.bounds.min_corner().x();
+   double height = frame.bounds.max_corner().y() - frame.bounds.min_corner().y();
+   return max(width, height) / steps;
+}
+
+path_frame wgs84_path_frame(const wgs84_frame &frame)
+{
+   // u / 2^32 of the whole turn, shifted so the origin's own u lands on the origin
+   const double turn_x = WGS84_STEPS_PER_TURN * frame.meters_per_step_x;
+   const double turn_y = WGS84_STEPS_PER_TURN * frame.meters_per_step_y;
+   const double lo_x = -static_cast<double>(static_cast<uint32_t>(frame.origin.longitude)) * frame.meters_per_step_x;
+   const double lo_y = -static_cast<double>(static_cast<uint32_t>(frame.origin.latitude)) * frame.meters_per_step_y;
+   return {Boundary(Point(lo_x, lo_y), Point(lo_x + turn_x, lo_y + turn_y)), 32};
+}
+
+void encode_paths(const path_frame &frame, const path_buffer &paths, vector<char> &message)
+{
+   const int64_t steps = frame_steps(frame);
+   const Point &lo = frame.bounds.min_corner();
+   const Point &hi = frame.bounds.max_corner();
+
+   message.clear();
+   message.push_back(static_cast<char>(PATH_CODEC_VERSION));
+   message.push_back(static_cast<char>(frame.bits));
+   put_varint(message, path_buffer_size(paths));
+   for (size_t i = 0; i < path_buffer_size(paths); i++)
+   {
+      span<const Point> path = path_buffer_path(paths, i);
+      if (path.empty())
+      {
+         throw invalid_argument("ERROR: path_buffer holds an empty path");
+      }
+      put_varint(message, zigzag_encode(paths.ids[i]));
+      put_varint(message, path.size());
+      int64_t prev_x = quantize(path[0].x(), lo.x(), hi.x(), steps);
+      int64_t prev_y = quantize(path[0].y(), lo.y(), hi.y(), steps);
+      put_varint(message, prev_x);
+      put_varint(message, prev_y);
+      for (size_t k = 1; k < path.size(); k++)
+      {
+         int64_t x = quantize(path[k].x(), lo.x(), hi.x(), steps);
+         int64_t y = quantize(path[k].y(), lo.y(), hi.y(), steps);
+         put_varint(message, zigzag_encode(x - prev_x));
+         put_varint(message, zigzag_encode(y - prev_y));
+         prev_x = x;
+         prev_y = y;
+      }
+   }
+   put_u16(message, crc16(message));
+}
+
+void decode_paths(const path_frame &frame, span<const char> message, path_buffer &paths)
+{
+   const int64_t steps = frame_steps(frame);
+   const Point &lo = frame.bounds.min_corner();
+   const Point &hi = frame.bounds.max_corner();
+   const double scale_x = (hi.x() - lo.x()) / steps;
+   const double scale_y = (hi.y() - lo.y()) / steps;
+
+   /* nothing is parsed out of a message the link damaged */
+   if (message.size() < 4)
+   {
+      throw runtime_error("ERROR: path message is truncated");
+   }
+   span<const char> body = message.first(message.size() - 2);
+   record_cursor crc_cursor = {body.data() + body.size(), message.data() + message.size(), "path message"};
+   if (crc_cursor.get_uint(2) != crc16(body))
+   {
+      throw runtime_error("ERROR: path message fails its CRC");
+   }
+
+   record_cursor cursor = {body.data(), body.data() + body.size(), "path message"};
+   uint64_t version = cursor.get_uint(1);
+   if (version != PATH_CODEC_VERSION)
+   {
+      throw runtime_error("ERROR: path message has unknown version " + to_string(version));
+   }
+   uint64_t bits = cursor.get_uint(1);
+   if (bits != static_cast<uint64_t>(frame.bits))
+   {
+      throw runtime_error("ERROR: path message has " + to_string(bits) + " bit coordinates, the frame has " + to_string(frame.bits));
+   }
+
+   path_buffer_clear(paths);
+   // smallest path is an id, a point count and one point, a byte each coordinate
+   uint64_t count = cursor.get_varint();
+   if (count > static_cast<uint64_t>(cursor.end - cursor.pos) / 4)
+   {
+      throw runtime_error("ERROR: path message count exceeds message size");
+   }
+   for (uint64_t i = 0; i < count; i++)
+   {
+      paths.ids.push_back(static_cast<int>(zigzag_decode(cursor.get_varint())));
+      uint64_t num_points = cursor.get_varint();
+      if (num_points == 0 || num_points > static_cast<uint64_t>(cursor.end - cursor.pos) / 2)
+      {
+         throw runtime_error("ERROR: path message point count exceeds message size");
+      }
+      int64_t x = 0;
+      int64_t y = 0;
+      for (uint64_t k = 0; k < num_points; k++)
+      {
+         if (k == 0)
+         {
+            x = static_cast<int64_t>(cursor.get_varint());
+            y = static_cast<int64_t>(cursor.get_varint());
+         }
+         else
+         {
+            x += get_delta(cursor, steps);
+            y += get_delta(cursor, steps);
+         }
+         if (x < 0 || x >= steps || y < 0 || y >= steps)
+         {
+            throw runtime_error("ERROR: path message point lies outside its frame");
+         }
+         paths.points.push_back(Point(lo.x() + x * scale_x, lo.y() + y * scale_y));
+      }
+      paths.agents.push_back(paths.points[paths.offsets.back()]);
+      paths.targets.push_back(paths.points.back());
+      paths.offsets.push_back(paths.points.size());
+   }
+   if (cursor.pos != cursor.end)
+   {
+      throw runtime_error("ERROR: path message has trailing bytes");
+   }
+}
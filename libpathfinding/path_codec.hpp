@@ -0,0 +1,76 @@
+/**
+ * @file path_codec.hpp
+ * @brief Compact binary encoding of planned paths, for sending them to vehicles over a low-bandwidth link
+ *
+ * Coordinates are quantized the way extra/DroneStatus.msg packs latitude into an int32: a coordinate is
+ * min + (max - min) * (u / 2^bits) for an unsigned u of the given bits, over a path_frame both ends agree on.
+ * DroneStatus.msg is the 32-bit case over a whole turn, -180 + 360 * (u / 2^32), and a frame from wgs84_path_frame()
+ * sends exactly its u values. u stops at 2^bits - 1, so points within half a step of the max corner go to the last step.
+ * Neighbouring waypoints are close, so every point after the first is sent as its difference from the one before.
+ *
+ * Message, varints are LEB128 and signed values are zig-zag encoded first (see byte_codec.hpp):
+ *   uint8 version (1), uint8 coordinate bits, varint path count, then per path:
+ *     zig-zag varint result id, varint point count,
+ *     varint x and y of the first point, zig-zag varint x and y difference of each later point
+ *   uint16 CRC-16/CCITT-FALSE of every byte before it, little-endian
+ *
+ * The agent and target of a result are the first and last points of its path, so they are not sent again.
+ */
+#ifndef __PATH_CODEC_HPP_
+#define __PATH_CODEC_HPP_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "compact_coords.hpp"
+
+const uint8_t PATH_CODEC_VERSION = 1; ///< version written into every message
+
+/**
+ * the box quantized coordinates are fractions of, known to sender and receiver like the WGS84 frame of DroneStatus.msg
+ */
+struct path_frame
+{
+   Boundary bounds; ///< every encoded point must lie in this box, usually the planning boundary
+   int bits = 32; ///< bits per quantized coordinate, 1 to 32, a step is (max - min) / 2^bits
+};
+
+/**
+ * @brief largest distance between a point and its decoded copy along either axis
+ * Throws std::invalid_argument if the frame has an empty box or bits outside 1 to 32
+ * @param frame frame of the message
+ * @return a quantization step of the wider axis, reached only near the max corner, elsewhere the error is at most half a step
+ */
+double path_frame_max_error(const path_frame &frame);
+
+/**
+ * @brief frame whose quantized values are the int32 latitude and longitude of DroneStatus.msg
+ * Coordinates are the meters east and north of a wgs84_frame, and encode_paths() quantizes a point to the same
+ * values to_quantized() does. A path can't cross the antimeridian, where the int32 longitude wraps
+ * @param frame planning frame from make_wgs84_frame()
+ * @return 32-bit path_frame spanning one turn of longitude and of latitude, in meters
+ */
+path_frame wgs84_path_frame(const wgs84_frame &frame);
+
+/**
+ * @brief encode every path of a plan as one message
+ * Throws std::invalid_argument if the frame is invalid, a path is empty, or a point lies outside the frame
+ * @param frame quantization frame, the receiver must decode with the same one
+ * @param paths results from Planner::plan_into()
+ * @param message overwritten with the message, keeps its capacity
+ */
+void encode_paths(const path_frame &frame, const path_buffer &paths, std::vector<char> &message);
+
+/**
+ * @brief decode a message from encode_paths(), straight from its bytes into the buffer
+ * Throws std::runtime_error if the CRC does not match, the message is truncated or malformed,
+ * or it was encoded with a different version or number of bits; paths is unspecified after a throw
+ * @param frame quantization frame the message was encoded with
+ * @param message exactly one message
+ * @param paths overwritten with the decoded paths, agents and targets taken from their ends, keeps its capacity
+ */
+void decode_paths(const path_frame &frame, std::span<const char> message, path_buffer &paths);
+
+#endif  // __PATH_CODEC_HPP_
@@ -0,0 +1,79 @@
+/**
+ * @file path_index.cpp
+ * @brief Spatial index over path segment bounding boxes, used to find crossing candidates
+ */
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <boost/iterator/function_output_iterator.hpp>
+
+#include "path_index.hpp"
+
+using namespace std;
+
+
+void path_index_insert(path_index &index, size_t id, const Line &path)
+{
+   if (id >= index.entries.size())
+   {
+      index.entries.resize(id + 1);
+   }
+   path_index_remove(index, id);
+
+   vector<PathSegmentEntry> &entries = index.entries[id];
+   for (size_t i = 1; i < path.size(); i++)
+   {
+      Boundary box;
+      bg::envelope(bg::model::segment<Point>(path[i - 1], path[i]), box);
+      entries.push_back({box, id});
+   }
+   if (path.size() == 1)
+   {
+      entries.push_back({Boundary(path[0], path[0]), id});
+   }
+   index.tree.insert(entries.begin(), entries.end());
+}
+
+void path_index_remove(path_index &index, size_t id)
+{
+   if (id >= index.entries.size())
+   {
+      return;
+   }
+   index.tree.remove(index.entries[id].begin(), index.entries[id].end());
+   index.entries[id].clear();
+}
+
+void path_index_clear(path_index &index)
+{
+   index.tree.clear();
+   for (auto &entries : index.entries)
+   {
+      entries.clear();
+   }
+}
+
+void query_crossing_candidates(const path_index &index, size_t id, vector<size_t> &candidates)
+{
+   candidates.clear();
+   if (id >= index.entries.size())
+   {
+      return;
+   }
+
+   // hits go straight into candidates, nothing is buffered in between
+   auto keep_other = boost::make_function_output_iterator([&](const PathSegmentEntry &hit)
+   {
+      if (hit.second != id)
+      {
+         candidates.push_back(hit.second);
+      }
+   });
+   for (auto &entry : index.entries[id])
+   {
+      index.tree.query(bgi::intersects(entry.first), keep_other);
+   }
+   sort(candidates.begin(), candidates.end(), greater<size_t>());
+   candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+}
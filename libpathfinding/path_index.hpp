@@ -0,0 +1,65 @@
+/**
+ * @file path_index.hpp
+ * @brief Spatial index over path segment bounding boxes, used to find crossing candidates
+ */
+#ifndef __PATH_INDEX_HPP_
+#define __PATH_INDEX_HPP_
+
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+#include "pathfinding.hpp"
+
+namespace bgi = boost::geometry::index;
+
+using PathSegmentEntry = std::pair<Boundary, size_t>; ///< segment bounding box and the id of the path that owns it
+using PathTree = bgi::rtree<PathSegmentEntry, bgi::quadratic<16>, bgi::indexable<PathSegmentEntry>, bgi::equal_to<PathSegmentEntry>,
+                            std::pmr::polymorphic_allocator<PathSegmentEntry>>; ///< alias for the boost.geometry R-tree holding PathSegmentEntry
+
+/**
+ * Segment boxes of a set of paths, ids are positions in the caller's result vector
+ * paths can be replaced one at a time as they are recalculated.
+ * Tree nodes come from pool, so an index emptied with path_index_clear() is refilled without heap allocations
+ */
+struct path_index
+{
+   std::pmr::unsynchronized_pool_resource pool; ///< memory of tree nodes, reused once they are freed
+   PathTree tree{bgi::quadratic<16>(), bgi::indexable<PathSegmentEntry>(), bgi::equal_to<PathSegmentEntry>(), PathTree::allocator_type(&pool)}; ///< R-tree over every segment box of every indexed path
+   std::vector<std::vector<PathSegmentEntry>> entries; ///< entries[id] holds the values inserted for path id
+};
+
+/**
+ * @brief remove every path, keeping the memory for the next set
+ * @param index path_index to clear
+ */
+void path_index_clear(path_index &index);
+
+/**
+ * @brief index (or re-index) the segments of a single path
+ * any segments previously indexed for id are removed first
+ * @param index path_index to update
+ * @param id id of the path, grows the index if needed
+ * @param path Line to index
+ */
+void path_index_insert(path_index &index, size_t id, const Line &path);
+
+/**
+ * @brief remove every segment of a path from the index
+ * @param index path_index to update
+ * @param id id of the path
+ */
+void path_index_remove(path_index &index, size_t id);
+
+/**
+ * @brief find other paths with a segment box touching a segment box of path id
+ * @param index path_index holding path id
+ * @param id id of the path under test
+ * @param candidates overwritten with the ids of candidate paths in descending order, never includes id
+ */
+void query_crossing_candidates(const path_index &index, size_t id, std::vector<size_t> &candidates);
+
+#endif  // __PATH_INDEX_HPP_
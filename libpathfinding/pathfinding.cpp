@@ -9,165 +9,1612 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <span>
+// GCC 12 flags a false -Wmaybe-uninitialized in the envelope code of Boost 1.74 once bg::union_ is inlined at -O2
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/point_xy.hpp>
 #include <boost/geometry/io/dsv/write.hpp>
+#pragma GCC diagnostic pop
 
 #include "pathfinding.hpp"
+#include "pathfinding_core.hpp"
+#include "assignment.hpp"
+#include "obstacle_index.hpp"
+#include "path_index.hpp"
+#include "path_cache.hpp"
+#include "tangent_path.hpp"
+#include "plan_context.hpp"
+#include "scratch_arena.hpp"
+#include "geometry_kernels.hpp"
+#include "thread_pool.hpp"
+#include "logging.hpp"
 
 using namespace std;
 namespace bg = boost::geometry;
 
+const double TANGENT_MIN_CLEARANCE = 1e-6; ///< gap kept between a tangent-engine keepout circle and its agent or target
 
-// tunables
-const int points_per_circle = 16; ///< configurable number of points around circles
-const double line_buffer_distance = 0.1; ///< configurable relatively small "stroke-width" to turn lines to polygons
-const float min_keepout_buffer = 0.05; ///< scalar for get_obstacle_buffer_size()
+
+const size_t NO_BUILDER = SIZE_MAX; ///< bid_batch::builder of a pair whose path was already in the path cache
+const size_t NO_AGENT = SIZE_MAX; ///< no agent selected, or no agent to bid first
+const int BID_KEEPOUT_STEP = 1; ///< first keepout step of every bid, selected paths then reserve their own, see reserve_result_steps()
+
+/**
+ * Every {target, agent} bid of one batch. Every bid is built at BID_KEEPOUT_STEP and laid out up front in row-major order,
+ * then evaluate_bids() builds whichever paths are needed, in any order and on any thread, each one exactly as it
+ * would have been built if the whole batch was
+ */
+struct bid_batch
+{
+   cost_matrix costs; ///< one row per target and one column per agent, valid where is_evaluated
+   vector<Line> paths; ///< paths in row-major order, valid where is_evaluated, never shrinks so each Line keeps its capacity
+   vector<cached_path *> entries; ///< path cache entry of each pair, nullptr without pathfind_config::use_path_cache
+   vector<size_t> builder; ///< pair whose build fills in this pair, itself unless the pair repeats or was cached
+   vector<bool> needs_curve; ///< the straight path of the pair hits an obstacle
+   vector<bool> is_evaluated; ///< path and cost are filled in
+
+   /* working storage of the bidding stages, kept here so a reused batch reuses it too */
+   vector<pair<const cached_path *, size_t>> unbuilt; ///< {cache entry, pair} of every pair whose cached path is not built, see reserve_bids()
+   vector<size_t> to_build; ///< pairs evaluate_bids() builds
+   vector<size_t> pairs; ///< pairs evaluate_all_bids() evaluates at once
+   vector<pair<double, size_t>> candidates; ///< {lower bound, agent} of the agents select_greedy_bid() considers
+   vector<size_t> wave; ///< pairs select_greedy_bid() evaluates together
+   vector<bool> is_assigned; ///< one flag per agent, true once it has a target
+   vector<size_t> selected; ///< agent of each target, see assign_targets_optimal()
+   vector<size_t> taken; ///< pair each selected path was moved out of, in result order, see recycle_paths()
+   assignment_scratch assignment; ///< working vectors of solve_assignment()
+};
+
+/**
+ * working storage of resolve_crossings()
+ */
+struct crossing_scratch
+{
+   path_index paths; ///< segment boxes of every result path
+   vector<size_t> dirty; ///< max-heap of the results still to check
+   vector<bool> is_dirty; ///< one flag per result, true while it is in dirty
+   vector<size_t> candidates; ///< crossing candidates of the result being checked
+};
 
 /**
- *  static variable, ensures n-many wraps around obstacles don't take same path
- *  each subsequent call to get_obstacle_avoid_path will have additional keepout
+ * Everything a plan_workspace carries from one plan to the next, see plan_results()
  */
-static int buffer_offset = 1; ///< incrementing value to increase subsequent keepout around obstacles
+struct plan_scratch
+{
+   obstacle_index index; ///< obstacles of the latest plan given as a span, indexed again only when they change
+   bool has_index = false; ///< index holds the obstacles of an earlier plan
+   coordinate_mode index_mode = coordinate_mode::DOUBLE; ///< coordinate_mode index was built with
+   path_cache cache; ///< cleared at the start of every plan
+   keepout_pool steps; ///< cleared at the start of every plan
+   bid_batch bids; ///< refilled by reserve_bids()
+   crossing_scratch crossings; ///< refilled by resolve_crossings()
+   vector<Point> remaining_agents; ///< agents not assigned yet
+   vector<pathfind_result> results; ///< results of the latest plan, their paths go back to bids once copied out
+};
+
+/* Planning */
+static void plan_results(plan_scratch &scratch, const pathfind_config &settings, const Boundary &bounds, span<const Point> agents,
+                         span<const Point> targets, span<const obstacle> obstacles, const obstacle_index *prebuilt, plan_stats *stats,
+                         path_buffer *into = nullptr, chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max(),
+                         anytime_plan *anytime = nullptr);
+static const obstacle_index &index_obstacles(plan_scratch &scratch, span<const obstacle> obstacles, coordinate_mode mode);
+static void recycle_paths(vector<pathfind_result> &results, bid_batch &bids);
+static bool has_deadline(const plan_context &ctx);
+static bool is_past_deadline(plan_context &ctx);
+
+/* Replanning */
+static bool is_delta_in_range(const replan_state &state, const replan_delta &delta);
+static void apply_delta(replan_state &state, const replan_delta &delta, obstacle_index &next_index, unordered_map<size_t, size_t> &warm_starts,
+                        plan_stats &timings);
+static void repair_plan(replan_state &state, const unordered_map<size_t, size_t> &warm_starts, plan_stats &timings);
+static void begin_tick(plan_context &ctx);
+static void end_tick(plan_context &ctx, plan_stats &timings);
+
+/* Assigning agents to targets */
+static void assign_targets_greedy(plan_context &ctx, vector<Point> &agents, span<const Point> targets, bid_batch &bids,
+                                  vector<pathfind_result> &final_results);
+static void assign_targets_optimal(plan_context &ctx, vector<Point> &agents, span<const Point> targets, bid_batch &bids,
+                                   vector<pathfind_result> &final_results);
+static vector<pathfind_result> assign_targets_nearest(plan_context &ctx, span<const Point> agents, span<const Point> targets, bid_batch &bids,
+                                                      size_t &num_unrouted);
+static size_t select_greedy_bid(plan_context &ctx, span<const Point> agents, span<const Point> targets, size_t t, const vector<bool> &is_assigned,
+                                size_t warm_start, bid_batch &bids);
+static void reserve_bids(plan_context &ctx, span<const Point> agents, span<const Point> targets, size_t num_targets, bid_batch &batch);
+static void evaluate_bids(plan_context &ctx, span<const Point> agents, span<const Point> targets, bid_batch &batch, span<const size_t> pairs);
+static bool evaluate_all_bids(plan_context &ctx, span<const Point> agents, span<const Point> targets, bid_batch &batch);
+static void erase_assigned_agents(vector<Point> &agents, const vector<bool> &is_assigned);
 
 /* Resolving paths */
 static void swap_agents(vector<pathfind_result> &pr, int idx_1, int idx_2);
-static Line get_obstacle_avoid_path(Line straight_path, vector<obstacle> &obstacles, bool is_clockwise);
-static Line find_convex_hull_subset(Point agent, Point target, Line convex_hull, bool is_clockwise);
-static Line calculate_path(Boundary &bounds, Point agent, Point target, vector<obstacle> &obstacles);
+static void reserve_result_steps(plan_context &ctx, vector<pathfind_result> &results, const vector<bool> *is_changed = nullptr);
+static size_t resolve_crossings(plan_context &ctx, vector<pathfind_result> &results, crossing_scratch &scratch,
+                                const vector<bool> *is_changed = nullptr, vector<size_t> *agent_ids = nullptr);
+static Line get_obstacle_avoid_path(const plan_context &ctx, const ScratchLine &straight_path, bool is_clockwise, int keepout_step);
+static ScratchLine find_convex_hull_subset(Point agent, Point target, ScratchLine convex_hull, bool is_clockwise);
+static Line get_tangent_avoid_path(const plan_context &ctx, const ScratchLine &straight_path, bool is_clockwise, int keepout_step);
+static Line get_shorter_tangent_path(const plan_context &ctx, const ScratchLine &straight_path, int keepout_step);
+static void calculate_path(const plan_context &ctx, Point agent, Point target, int keepout_step, Line &path);
+static Line simplify_path(const plan_context &ctx, const Line &path);
+static void recalculate_path(plan_context &ctx, Point agent, Point target, bool use_cached, Line &path);
+static void unselect_path(plan_context &ctx, const pathfind_result &result);
 
 /* boundary checking */
-static vector<obstacle> get_intersecting_obstacles(Line straight_path, vector<obstacle> obstacles);
-static bool is_path_crossing(pathfind_result p1, pathfind_result p2);
-static bool is_path_in_bounds(Line path, Boundary bounds);
-static bool is_point_in_bounds(Point p, Boundary bounds);
+static bool validate_inputs(const plan_context &ctx, span<const Point> agents, span<const Point> targets);
+static scratch_vector<obstacle> get_intersecting_obstacles(span<const Point> path, const obstacle_index &index);
+static bool is_path_crossing(const pathfind_result &p1, const pathfind_result &p2);
 
 /* Miscellaneous functions */
-static MultiPolygon circle_from_obstacle(obstacle o, double extra_buffer);
-static double get_obstacle_buffer_size(void);
+static ScratchPolygon circle_from_obstacle(const obstacle &o, int points_per_circle, double extra_buffer);
+static ScratchPolygon keepout_polygon(const plan_context &ctx, const obstacle &o, double extra_buffer);
+static double get_obstacle_buffer_size(const plan_context &ctx, int keepout_step);
+static int count_keepout_steps(const plan_context &ctx, Point agent, Point target);
+static int reserve_keepout_steps(plan_context &ctx, Point agent, Point target);
+static void release_keepout_steps(plan_context &ctx, Point agent, Point target, const cached_path &entry);
+static void clear_keepout_steps(keepout_pool &pool);
+static void restore_keepout_steps(plan_context &ctx);
+
+/* Output */
+static void print_result_header(ostream &out, const Boundary &bounds);
+static void print_result_obstacles(ostream &out, span<const obstacle> obstacles);
 
 
 /**
  * @brief the pathfind() function is the core offering of this libpathfinding library
  * see pathfinding.h and the README.md for details
+ * kept as a thin wrapper over Planner::plan() that also pops assigned agents from agents
+ */
+vector<pathfind_result> pathfind(Boundary &bounds, vector<Point> &agents, vector<Point> &targets, vector<obstacle> &obstacles, const pathfind_config &config)
+{
+   vector<pathfind_result> final_results = Planner(config).plan(bounds, agents, targets, obstacles);
+
+   // pop assigned agents, callers of pathfind() see only the agents left over
+   for (auto &result : final_results)
+   {
+      auto it = find_if(agents.begin(), agents.end(), [&](const Point &p) { return bg::equals(p, result.agent); });
+      if (it != agents.end())
+      {
+         agents.erase(it);
+      }
+   }
+   return final_results;
+}
+
+Planner::Planner(const pathfind_config &config) : settings(config)
+{
+}
+
+vector<pathfind_result> Planner::plan(const Boundary &bounds, const vector<Point> &agents, const vector<Point> &targets, const vector<obstacle> &obstacles,
+                                      plan_stats *stats) const
+{
+   plan_scratch scratch;
+   plan_results(scratch, settings, bounds, agents, targets, obstacles, nullptr, stats);
+   return move(scratch.results);
+}
+
+anytime_plan Planner::plan(const Boundary &bounds, const vector<Point> &agents, const vector<Point> &targets, const vector<obstacle> &obstacles,
+                           chrono::steady_clock::time_point deadline, plan_stats *stats) const
+{
+   anytime_plan out;
+   plan_scratch scratch;
+   plan_results(scratch, settings, bounds, agents, targets, obstacles, nullptr, stats, nullptr, deadline, &out);
+   out.results = move(scratch.results);
+   return out;
+}
+
+void Planner::plan_into(const Boundary &bounds, span<const Point> agents, span<const Point> targets, span<const obstacle> obstacles,
+                        path_buffer &results, plan_workspace &workspace, plan_stats *stats) const
+{
+   plan_results(*workspace.scratch, settings, bounds, agents, targets, obstacles, nullptr, stats, &results);
+}
+
+void Planner::plan_into(const Boundary &bounds, span<const Point> agents, span<const Point> targets, const obstacle_index &obstacles,
+                        path_buffer &results, plan_workspace &workspace, plan_stats *stats) const
+{
+   plan_results(*workspace.scratch, settings, bounds, agents, targets, obstacles.obstacles, &obstacles, stats, &results);
+}
+
+void Planner::plan_into(const Boundary &bounds, span<const Point> agents, span<const Point> targets, span<const obstacle> obstacles,
+                        path_buffer &results, plan_stats *stats) const
+{
+   plan_workspace workspace;
+   plan_into(bounds, agents, targets, obstacles, results, workspace, stats);
+}
+
+void Planner::plan_into(const Boundary &bounds, span<const Point> agents, span<const Point> targets, const obstacle_index &obstacles,
+                        path_buffer &results, plan_stats *stats) const
+{
+   plan_workspace workspace;
+   plan_into(bounds, agents, targets, obstacles, results, workspace, stats);
+}
+
+plan_workspace::plan_workspace() : scratch(make_unique<plan_scratch>())
+{
+}
+
+plan_workspace::~plan_workspace() = default;
+
+/**
+ * World and plan of a Replanner as of its latest tick
+ */
+struct replan_state
+{
+   pathfind_config config; ///< tunables of the owning Replanner, ctx refers to them
+   obstacle_index index; ///< obstacles of the latest tick, ctx refers to it
+   keepout_pool steps; ///< keepout steps held by the paths in cache
+   path_cache cache; ///< every path built so far, ctx refers to it
+   plan_context ctx; ///< carried from tick to tick for its path cache and keepout steps
+   vector<Point> agents; ///< every agent
+   vector<Point> targets; ///< every target
+   vector<pathfind_result> results; ///< one per served target, sorted by id, the index of the target
+   vector<size_t> result_agents; ///< index into agents of the agent of each result
+   vector<bool> is_agent_busy; ///< one flag per agent, true if a result holds it
+
+   /**
+    * @brief state with the given world and nothing planned
+    * @param settings tunables of the owning Replanner
+    * @param bounds boundary Box struct
+    * @param agent_list every agent
+    * @param target_list every target
+    * @param obstacles every obstacle, indexed here
+    */
+   replan_state(const pathfind_config &settings, const Boundary &bounds, span<const Point> agent_list, span<const Point> target_list,
+                span<const obstacle> obstacles)
+       : config(settings), index(build_obstacle_index(obstacles, settings.coordinates)), ctx{config, bounds, index, cache},
+         agents(agent_list.begin(), agent_list.end()), targets(target_list.begin(), target_list.end()), is_agent_busy(agents.size(), false)
+   {
+      ctx.steps = &steps;
+   }
+};
+
+Replanner::Replanner(const pathfind_config &config) : settings(config)
+{
+   // every tick builds on the paths of the ticks before it
+   settings.use_path_cache = true;
+}
+
+Replanner::~Replanner() = default;
+
+const vector<pathfind_result> &Replanner::reset(const Boundary &bounds, const vector<Point> &agents, const vector<Point> &targets,
+                                                const vector<obstacle> &obstacles, plan_stats *stats)
+{
+   plan_stats local_stats;
+   plan_stats &timings = (stats != nullptr) ? *stats : local_stats;
+   timings = plan_stats();
+   auto start = chrono::steady_clock::now();
+
+   state.reset();
+   auto next = make_unique<replan_state>(settings, bounds, agents, targets, obstacles);
+   if (!validate_inputs(next->ctx, agents, targets))
+   {
+      throw std::invalid_argument("Invalid input parameters");
+   }
+   timings.validate_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+   // nothing is served yet, so every target bids among every agent, exactly like plan()
+   repair_plan(*next, {}, timings);
+   end_tick(next->ctx, timings);
+   state = move(next);
+   return state->results;
+}
+
+const vector<pathfind_result> &Replanner::replan(const replan_delta &delta, plan_stats *stats)
+{
+   if (state == nullptr)
+   {
+      throw runtime_error("ERROR: Replanner has no plan to repair, call reset() first");
+   }
+   plan_stats local_stats;
+   plan_stats &timings = (stats != nullptr) ? *stats : local_stats;
+   timings = plan_stats();
+   auto start = chrono::steady_clock::now();
+
+   replan_state &s = *state;
+   begin_tick(s.ctx);
+   if (!is_delta_in_range(s, delta))
+   {
+      throw std::invalid_argument("Invalid input parameters");
+   }
+
+   // the changed world is checked in full before any of it is applied
+   obstacle_index next_index;
+   bool is_map_changed = !delta.removed_obstacles.empty() || !delta.added_obstacles.empty();
+   if (is_map_changed)
+   {
+      vector<bool> is_removed(s.index.obstacles.size(), false);
+      for (size_t o : delta.removed_obstacles)
+      {
+         is_removed[o] = true;
+      }
+      vector<obstacle> next_obstacles;
+      for (size_t o = 0; o < s.index.obstacles.size(); o++)
+      {
+         if (!is_removed[o])
+         {
+            next_obstacles.push_back(s.index.obstacles[o]);
+         }
+      }
+      next_obstacles.insert(next_obstacles.end(), delta.added_obstacles.begin(), delta.added_obstacles.end());
+      next_index = build_obstacle_index(next_obstacles, s.config.coordinates);
+   }
+   plan_context check_ctx = {s.config, s.ctx.bounds, is_map_changed ? next_index : s.index, s.cache};
+   vector<Point> check_agents;
+   vector<Point> check_targets;
+   if (is_map_changed)
+   {
+      // a new obstacle may cover any agent or target, so the whole changed world is checked
+      check_agents = s.agents;
+      for (auto &[a, p] : delta.moved_agents)
+      {
+         check_agents[a] = p;
+      }
+      vector<bool> is_removed(s.targets.size(), false);
+      for (size_t t : delta.removed_targets)
+      {
+         is_removed[t] = true;
+      }
+      for (size_t t = 0; t < s.targets.size(); t++)
+      {
+         if (!is_removed[t])
+         {
+            check_targets.push_back(s.targets[t]);
+         }
+      }
+   }
+   else
+   {
+      // otherwise only the points the delta moves or adds
+      for (auto &[a, p] : delta.moved_agents)
+      {
+         check_agents.push_back(p);
+      }
+   }
+   check_targets.insert(check_targets.end(), delta.added_targets.begin(), delta.added_targets.end());
+   if (!validate_inputs(check_ctx, check_agents, check_targets))
+   {
+      throw std::invalid_argument("Invalid input parameters");
+   }
+
+   try
+   {
+      unordered_map<size_t, size_t> warm_starts; // target -> agent it held before this tick
+      apply_delta(s, delta, next_index, warm_starts, timings);
+      timings.validate_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      repair_plan(s, warm_starts, timings);
+      end_tick(s.ctx, timings);
+   }
+   catch (...)
+   {
+      // the plan is half repaired, start over from reset()
+      state.reset();
+      throw;
+   }
+   return s.results;
+}
+
+const vector<pathfind_result> &Replanner::results() const
+{
+   static const vector<pathfind_result> none;
+   return (state != nullptr) ? state->results : none;
+}
+
+const vector<Point> &Replanner::agents() const
+{
+   static const vector<Point> none;
+   return (state != nullptr) ? state->agents : none;
+}
+
+const vector<Point> &Replanner::targets() const
+{
+   static const vector<Point> none;
+   return (state != nullptr) ? state->targets : none;
+}
+
+const vector<obstacle> &Replanner::obstacles() const
+{
+   static const vector<obstacle> none;
+   return (state != nullptr) ? state->index.obstacles : none;
+}
+
+/**
+ * @brief check that every index in a replan_delta refers to something that exists
+ * @param state state of the replanner before the delta
+ * @param delta change to check
+ * @return true if every index is in range, else false
  */
-vector<pathfind_result> pathfind(Boundary &bounds, vector<Point> &agents, vector<Point> &targets, vector<obstacle> &obstacles)
+static bool is_delta_in_range(const replan_state &state, const replan_delta &delta)
 {
-   vector<pathfind_result> final_results; // results vector
+   for (auto &[a, p] : delta.moved_agents)
+   {
+      if (a >= state.agents.size())
+      {
+         LP_LOG_ERROR("Moved agent " << a << " does not exist");
+         return false;
+      }
+   }
+   for (size_t t : delta.removed_targets)
+   {
+      if (t >= state.targets.size())
+      {
+         LP_LOG_ERROR("Removed target " << t << " does not exist");
+         return false;
+      }
+   }
+   for (size_t o : delta.removed_obstacles)
+   {
+      if (o >= state.index.obstacles.size())
+      {
+         LP_LOG_ERROR("Removed obstacle " << o << " does not exist");
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief apply a checked delta, dropping every result and cached path it touches
+ * A result is dropped if its target was removed, and reopened for bidding if its agent moved, a removed obstacle touches
+ * its straight line or an added obstacle touches its straight line or its path. A cached path is dropped if its agent moved
+ * away, its target was removed, a removed obstacle touches its straight line or an added obstacle touches either, every other
+ * cached path is exactly what calculate_path() would build
+ * @param state state of the replanner, updated in place
+ * @param delta change from is_delta_in_range() and validate_inputs()
+ * @param next_index obstacles after the delta, moved from if the delta changes obstacles
+ * @param warm_starts output, agent each reopened target held, by target index after the delta
+ * @param timings paths_invalidated is counted
+ */
+static void apply_delta(replan_state &state, const replan_delta &delta, obstacle_index &next_index, unordered_map<size_t, size_t> &warm_starts,
+                        plan_stats &timings)
+{
+   plan_context &ctx = state.ctx;
+
+   vector<obstacle> removed_obstacles; // a path whose straight line touches one of these may now be shorter
+   for (size_t o : delta.removed_obstacles)
+   {
+      removed_obstacles.push_back(state.index.obstacles[o]);
+   }
+   // an added obstacle on the straight line changes the path calculate_path() builds, and a kept detour can run
+   // through one its straight line misses, so added obstacles are tested against both
+   obstacle_index added_index = build_obstacle_index(delta.added_obstacles);
+   bool is_obstacle_change = !removed_obstacles.empty() || !delta.added_obstacles.empty();
+   auto is_near_change = [&](const Point &agent, const Point &target, span<const Point> path)
+   {
+      Point straight_path[] = {agent, target};
+      return any_of(removed_obstacles.begin(), removed_obstacles.end(), [&](const obstacle &o) { return segment_intersects_circle(agent, target, o); }) ||
+             (!delta.added_obstacles.empty() &&
+              (!query_path_hits(added_index, straight_path).empty() || !query_path_hits(added_index, path).empty()));
+   };
+
+   vector<Point> moved_from; // positions agents left, no longer anybody's
+   vector<bool> is_moved(state.agents.size(), false);
+   for (auto &[a, p] : delta.moved_agents)
+   {
+      if (!bg::equals(state.agents[a], p))
+      {
+         moved_from.push_back(state.agents[a]);
+         state.agents[a] = p;
+         is_moved[a] = true;
+      }
+   }
+
+   vector<bool> is_removed(state.targets.size(), false);
+   vector<Point> removed_at; // positions of removed targets
+   for (size_t t : delta.removed_targets)
+   {
+      if (!is_removed[t])
+      {
+         is_removed[t] = true;
+         removed_at.push_back(state.targets[t]);
+      }
+   }
+   vector<size_t> new_index(state.targets.size()); // target index after removals
+   size_t num_kept = 0;
+   for (size_t t = 0; t < state.targets.size(); t++)
+   {
+      new_index[t] = num_kept;
+      if (!is_removed[t])
+      {
+         state.targets[num_kept++] = state.targets[t];
+      }
+   }
+   state.targets.resize(num_kept);
+   state.targets.insert(state.targets.end(), delta.added_targets.begin(), delta.added_targets.end());
+
+   /* keep the results the delta doesn't touch, in order, renumbered past removed targets */
+   size_t kept = 0;
+   for (size_t i = 0; i < state.results.size(); i++)
+   {
+      pathfind_result &result = state.results[i];
+      size_t t = result.id;
+      size_t a = state.result_agents[i];
+      if (is_removed[t] || is_moved[a] || is_near_change(result.agent, result.target, result.path))
+      {
+         // its cached path may outlive it, but no longer holds keepout steps
+         unselect_path(ctx, result);
+         if (!is_removed[t])
+         {
+            warm_starts[new_index[t]] = a;
+         }
+         state.is_agent_busy[a] = false;
+         continue;
+      }
+      result.id = static_cast<int>(new_index[t]);
+      state.result_agents[kept] = a;
+      if (kept != i)
+      {
+         state.results[kept] = move(result);
+      }
+      kept++;
+   }
+   state.results.resize(kept);
+   state.result_agents.resize(kept);
+
+   if (is_obstacle_change)
+   {
+      state.index = move(next_index);
+   }
+
+   // a position another agent or target still occupies keeps its paths, the results of that one may hold them
+   erase_if(moved_from, [&](const Point &p) { return any_of(state.agents.begin(), state.agents.end(), [&](const Point &q) { return bg::equals(p, q); }); });
+   erase_if(removed_at, [&](const Point &p) { return any_of(state.targets.begin(), state.targets.end(), [&](const Point &q) { return bg::equals(p, q); }); });
+
+   /* drop the cached paths that no longer exist or no longer hold */
+   if (!moved_from.empty() || !removed_at.empty() || is_obstacle_change)
+   {
+      auto is_stale = [&](const auto &item)
+      {
+         Point agent(item.first.agent_x, item.first.agent_y);
+         Point target(item.first.target_x, item.first.target_y);
+         return any_of(moved_from.begin(), moved_from.end(), [&](const Point &p) { return bg::equals(p, agent); }) ||
+                any_of(removed_at.begin(), removed_at.end(), [&](const Point &p) { return bg::equals(p, target); }) ||
+                is_near_change(agent, target, item.second.path);
+      };
+      erase_if(ctx.cache.entries, [&](const auto &item)
+      {
+         if (!is_stale(item))
+         {
+            return false;
+         }
+         if (!is_obstacle_change)
+         {
+            Point agent(item.first.agent_x, item.first.agent_y);
+            Point target(item.first.target_x, item.first.target_y);
+            release_keepout_steps(ctx, agent, target, item.second);
+         }
+         timings.paths_invalidated++;
+         return true;
+      });
+      if (is_obstacle_change)
+      {
+         // the obstacles were renumbered, so the steps the kept paths hold are marked again under the new numbers
+         restore_keepout_steps(ctx);
+      }
+   }
+}
+
+/**
+ * @brief give agents to the targets that have none, then resolve the crossings the new paths make
+ * Targets without a result bid in index order among the agents without one, exactly like plan() with just those,
+ * greedy bidding starts each target from the agent it held before the tick. Only the new paths start out dirty
+ * in resolve_crossings(), every other pair of paths was checked last tick
+ * @param state state of the replanner, results are updated in place
+ * @param warm_starts agent each reopened target held before this tick, by target index
+ * @param timings bid and uncross phases are timed and counted
+ */
+static void repair_plan(replan_state &state, const unordered_map<size_t, size_t> &warm_starts, plan_stats &timings)
+{
+   plan_context &ctx = state.ctx;
+   auto phase_start = chrono::steady_clock::now();
+
+   vector<bool> is_served(state.targets.size(), false);
+   for (auto &result : state.results)
+   {
+      is_served[result.id] = true;
+   }
+   vector<size_t> open_targets;
+   vector<Point> open_points;
+   for (size_t t = 0; t < state.targets.size(); t++)
+   {
+      if (!is_served[t])
+      {
+         open_targets.push_back(t);
+         open_points.push_back(state.targets[t]);
+      }
+   }
+   vector<size_t> free_agents;
+   vector<Point> free_points;
+   for (size_t a = 0; a < state.agents.size(); a++)
+   {
+      if (!state.is_agent_busy[a])
+      {
+         free_agents.push_back(a);
+         free_points.push_back(state.agents[a]);
+      }
+   }
+
+   /* bid, the open targets against the free agents */
+   const size_t num_served = min(open_targets.size(), free_agents.size());
+   bid_batch bids;
+   reserve_bids(ctx, free_points, open_points, num_served, bids);
+   vector<size_t> selected(num_served); // column of free_agents each open target takes
+   if (state.config.assignment == assignment_mode::OPTIMAL)
+   {
+      if (num_served > 0)
+      {
+         evaluate_all_bids(ctx, free_points, open_points, bids);
+         solve_assignment(bids.costs, bids.assignment, selected);
+      }
+   }
+   else
+   {
+      if (!state.config.prune_bids)
+      {
+         evaluate_all_bids(ctx, free_points, open_points, bids);
+      }
+      vector<bool> is_assigned(free_agents.size(), false);
+      for (size_t t = 0; t < num_served; t++)
+      {
+         auto warm = warm_starts.find(open_targets[t]);
+         size_t warm_start = NO_AGENT;
+         if (warm != warm_starts.end())
+         {
+            auto it = lower_bound(free_agents.begin(), free_agents.end(), warm->second);
+            warm_start = it - free_agents.begin();
+         }
+         selected[t] = select_greedy_bid(ctx, free_points, open_points, t, is_assigned, warm_start, bids);
+         is_assigned[selected[t]] = true;
+      }
+   }
+
+   /* merge the new results in among the kept ones, by target */
+   vector<pathfind_result> merged;
+   vector<size_t> merged_agents;
+   vector<bool> is_changed;
+   size_t kept = 0;
+   auto keep_until = [&](size_t id)
+   {
+      for (; kept < state.results.size() && static_cast<size_t>(state.results[kept].id) < id; kept++)
+      {
+         merged.push_back(move(state.results[kept]));
+         merged_agents.push_back(state.result_agents[kept]);
+         is_changed.push_back(false);
+      }
+   };
+   for (size_t t = 0; t < num_served; t++)
+   {
+      size_t a = selected[t];
+      LP_LOG_INFO("Target_" << open_targets[t] << " selects: bid_" << free_agents[a]);
+      keep_until(open_targets[t]);
+      merged.push_back({
+          .id = static_cast<int>(open_targets[t]),
+          .agent = free_points[a],
+          .target = open_points[t],
+          .path = move(bids.paths[t * free_agents.size() + a]),
+      });
+      merged_agents.push_back(free_agents[a]);
+      is_changed.push_back(true);
+      state.is_agent_busy[free_agents[a]] = true;
+   }
+   keep_until(SIZE_MAX);
+   state.results = move(merged);
+   state.result_agents = move(merged_agents);
+
+   timings.targets_rebid = num_served;
+   timings.num_bids = ctx.num_bids;
+   timings.bids_pruned = ctx.bids_pruned;
+   timings.curves_pruned = ctx.curves_pruned;
+   auto now = chrono::steady_clock::now();
+   timings.bid_seconds = chrono::duration<double>(now - phase_start).count();
+   phase_start = now;
+
+   crossing_scratch crossings;
+   reserve_result_steps(ctx, state.results, &is_changed);
+   timings.num_swaps = resolve_crossings(ctx, state.results, crossings, &is_changed, &state.result_agents);
+   timings.uncross_seconds = chrono::duration<double>(chrono::steady_clock::now() - phase_start).count();
+}
+
+/**
+ * @brief zero the per-tick counters of a Replanner's plan_context
+ * @param ctx plan_context carried from tick to tick
+ */
+static void begin_tick(plan_context &ctx)
+{
+   ctx.num_bids = 0;
+   ctx.bids_pruned = 0;
+   ctx.curves_pruned = 0;
+   ctx.cache.hits = 0;
+   ctx.cache.misses = 0;
+   ctx.scratch.peak_bytes = 0;
+   ctx.scratch.spills = 0;
+   ctx.keepout_vertices = 0;
+   ctx.points_simplified = 0;
+}
+
+/**
+ * @brief drop the placeholders of pruned bids and report the counters
+ * A placeholder is never selected, so it holds no keepout steps
+ * @param ctx plan_context carried from tick to tick
+ * @param timings counters of this tick
+ */
+static void end_tick(plan_context &ctx, plan_stats &timings)
+{
+   if (ctx.bids_pruned > 0)
+   {
+      erase_if(ctx.cache.entries, [&](const auto &item)
+      {
+         return !item.second.is_built;
+      });
+   }
+   timings.cache_hits = ctx.cache.hits;
+   timings.cache_misses = ctx.cache.misses;
+   timings.scratch_peak_bytes = ctx.scratch.peak_bytes;
+   timings.scratch_spills = ctx.scratch.spills;
+   timings.keepout_vertices = ctx.keepout_vertices;
+   timings.points_simplified = ctx.points_simplified;
+}
+
+/**
+ * @brief body of Planner::plan() and Planner::plan_into()
+ * Anytime plans first route a nearest-agent assignment, every bid built for it is shared with the full bidding that follows.
+ * Whichever stage the deadline interrupts, the latest plan with every selected path routed is in scratch.results.
+ * Every container of the plan lives in scratch, so a scratch reused for plans of the same size only allocates
+ * for curved paths, see plan_workspace
+ * @param scratch storage of this plan, results are left in scratch.results unless into is given
+ * @param settings tunables of the calling Planner
+ * @param bounds boundary Box struct
+ * @param agents all agents to bid upon targets
+ * @param targets all targets to be bid upon
+ * @param obstacles all circular obstacles
+ * @param prebuilt index of obstacles built by the caller, or nullptr to build one for this plan
+ * @param stats optional output, per-phase timings and counters of this plan
+ * @param into optional output, the results are written here and their paths go back to scratch for the next plan
+ * @param deadline anytime plans only, when to stop improving the plan
+ * @param anytime output of an anytime plan, nullptr plans to completion with no deadline
+ */
+static void plan_results(plan_scratch &scratch, const pathfind_config &settings, const Boundary &bounds, span<const Point> agents,
+                         span<const Point> targets, span<const obstacle> obstacles, const obstacle_index *prebuilt, plan_stats *stats,
+                         path_buffer *into, chrono::steady_clock::time_point deadline, anytime_plan *anytime)
+{
+   vector<pathfind_result> &final_results = scratch.results;
+   final_results.clear();
+   if (into != nullptr)
+   {
+      path_buffer_clear(*into);
+   }
+   plan_stats local_stats;
+   plan_stats &timings = (stats != nullptr) ? *stats : local_stats;
+   timings = plan_stats();
+   auto phase_start = chrono::steady_clock::now();
+   auto end_phase = [&phase_start](double &seconds)
+   {
+      auto now = chrono::steady_clock::now();
+      seconds = chrono::duration<double>(now - phase_start).count();
+      phase_start = now;
+   };
+
+   // all scratch state lives in scratch or here, so concurrent plans with their own scratch share nothing
+   // the obstacle map is indexed once, every bid and validation check queries it
+   const obstacle_index &index = (prebuilt != nullptr) ? *prebuilt : index_obstacles(scratch, obstacles, settings.coordinates);
+   path_cache_clear(scratch.cache);
+   clear_keepout_steps(scratch.steps);
+   plan_context ctx = {settings, bounds, index, scratch.cache};
+   ctx.steps = &scratch.steps;
+   vector<Point> &remaining_agents = scratch.remaining_agents;
+   remaining_agents.assign(agents.begin(), agents.end());
 
    // just print error and exit if inputs not valid
-   if (!is_valid_input_params(bounds, agents, targets, obstacles))
+   if (!validate_inputs(ctx, agents, targets))
    {
       throw std::invalid_argument("Invalid input parameters");
    }
+   end_phase(timings.validate_seconds);
+
+   // every bid is laid out now, so the stages below can build any of them in any order
+   bid_batch &bids = scratch.bids;
+   reserve_bids(ctx, agents, targets, min(targets.size(), agents.size()), bids);
+   vector<pathfind_result> first_results; // anytime fallback while the full bidding is unfinished
+   size_t num_unrouted = 0;
+   if (anytime != nullptr)
+   {
+      ctx.deadline = deadline;
+      first_results = assign_targets_nearest(ctx, agents, targets, bids, num_unrouted);
+   }
+
+   bool is_bid = false;
+   if (!ctx.is_cut_short)
+   {
+      try
+      {
+         switch (settings.assignment)
+         {
+         case assignment_mode::OPTIMAL:
+            assign_targets_optimal(ctx, remaining_agents, targets, bids, final_results);
+            break;
+         case assignment_mode::GREEDY:
+         default:
+            assign_targets_greedy(ctx, remaining_agents, targets, bids, final_results);
+            break;
+         }
+         is_bid = !ctx.is_cut_short;
+      }
+      catch (const runtime_error &e)
+      {
+         // a bid the first assignment didn't need has no way around an obstacle, an anytime plan keeps what it has
+         if (anytime == nullptr || num_unrouted > 0)
+         {
+            throw;
+         }
+         LP_LOG_WARNING("Anytime plan keeps its first assignment: " << e.what());
+         ctx.is_cut_short = true;
+      }
+   }
+   if (!is_bid)
+   {
+      final_results = move(first_results);
+   }
+
+   // now all agents have been assigned, check for crossed paths
+   timings.num_bids = ctx.num_bids;
+   timings.bids_pruned = ctx.bids_pruned;
+   timings.curves_pruned = ctx.curves_pruned;
+   end_phase(timings.bid_seconds);
+
+   if (is_bid)
+   {
+      LP_LOG_INFO("Path plan is in, conducting final checks");
+      try
+      {
+         reserve_result_steps(ctx, final_results);
+         timings.num_swaps = resolve_crossings(ctx, final_results, scratch.crossings);
+      }
+      catch (const runtime_error &e)
+      {
+         // every swap leaves a whole plan behind, an anytime plan returns it as is
+         if (anytime == nullptr)
+         {
+            throw;
+         }
+         LP_LOG_WARNING("Anytime plan keeps its crossings: " << e.what());
+         ctx.is_cut_short = true;
+      }
+   }
+   end_phase(timings.uncross_seconds);
+   timings.cache_hits = ctx.cache.hits;
+   timings.cache_misses = ctx.cache.misses;
+   timings.scratch_peak_bytes = ctx.scratch.peak_bytes;
+   timings.scratch_spills = ctx.scratch.spills;
+   timings.keepout_vertices = ctx.keepout_vertices;
+   timings.points_simplified = ctx.points_simplified;
+   if (anytime != nullptr)
+   {
+      anytime->converged = !ctx.is_cut_short;
+      anytime->unrouted_paths = is_bid ? 0 : num_unrouted;
+   }
+   if (into != nullptr)
+   {
+      for (auto &result : final_results)
+      {
+         path_buffer_append(*into, result);
+      }
+      recycle_paths(final_results, bids);
+   }
+}
+
+/**
+ * @brief index the obstacles of a plan, reusing the index of the plan before when its obstacles are the same
+ * @param scratch plan_scratch holding the index of the plan before
+ * @param obstacles all circular obstacles of this plan
+ * @param mode coordinate_mode of pathfind_config::coordinates
+ * @return index of obstacles, owned by scratch
+ */
+static const obstacle_index &index_obstacles(plan_scratch &scratch, span<const obstacle> obstacles, coordinate_mode mode)
+{
+   auto is_same = [](const obstacle &a, const obstacle &b) { return a.p.x() == b.p.x() && a.p.y() == b.p.y() && a.radius == b.radius; };
+   if (!scratch.has_index || scratch.index_mode != mode ||
+       !equal(obstacles.begin(), obstacles.end(), scratch.index.obstacles.begin(), scratch.index.obstacles.end(), is_same))
+   {
+      scratch.index = build_obstacle_index(obstacles, mode);
+      scratch.index_mode = mode;
+      scratch.has_index = true;
+   }
+   return scratch.index;
+}
+
+/**
+ * @brief hand the paths of copied-out results back to the bid batch, so the next plan builds into their storage
+ * A selected bid path was moved out of its pair, which leaves the pair with no storage of its own. The same inputs
+ * select the same pairs again, so each path goes back to the pair it came from
+ * @param results results whose paths are no longer needed, emptied
+ * @param bids bid_batch of the plan, takes the paths
+ */
+static void recycle_paths(vector<pathfind_result> &results, bid_batch &bids)
+{
+   for (size_t i = 0; i < min(results.size(), bids.taken.size()); i++)
+   {
+      swap(bids.paths[bids.taken[i]], results[i].path);
+   }
+   results.clear();
+}
+
+/**
+ * @brief whether this plan has a deadline, i.e. is an anytime plan
+ * @param ctx plan_context of this plan
+ * @return true if ctx.deadline was set
+ */
+static bool has_deadline(const plan_context &ctx)
+{
+   return ctx.deadline != chrono::steady_clock::time_point::max();
+}
+
+/**
+ * @brief check the deadline of an anytime plan, once it has passed ctx.is_cut_short stays set
+ * @param ctx plan_context of this plan
+ * @return true if the deadline has passed, always false without one
+ */
+static bool is_past_deadline(plan_context &ctx)
+{
+   if (!ctx.is_cut_short && has_deadline(ctx) && chrono::steady_clock::now() >= ctx.deadline)
+   {
+      LP_LOG_INFO("Deadline passed, planning stops");
+      ctx.is_cut_short = true;
+   }
+   return ctx.is_cut_short;
+}
+
+/**
+ * @brief give each selected path keepout steps of its own, counted per obstacle it wraps
+ * Every bid was built at BID_KEEPOUT_STEP, so selected paths around the same obstacle would lie on top of each other.
+ * In result order, each curved result reserves the lowest steps free around the obstacles it wraps, see
+ * reserve_keepout_steps(), and is rebuilt if its path was built with other steps. Rebuilds run on config.pool
+ * if one was provided, each one exactly as it would be built serially. Results whose pair already holds steps keep them.
+ * An anytime plan stops reserving at its deadline, the remaining results keep their bid paths
+ * @param ctx plan_context of this plan
+ * @param results selected results, paths are rebuilt in place
+ * @param is_changed one flag per result, true if it was selected by this plan, nullptr for every result
+ */
+static void reserve_result_steps(plan_context &ctx, vector<pathfind_result> &results, const vector<bool> *is_changed)
+{
+   vector<pair<size_t, int>> rebuilds; // {result, first step} of every path whose steps differ from the ones it was built with
+   for (size_t i = 0; i < results.size() && !is_past_deadline(ctx); i++)
+   {
+      pathfind_result &result = results[i];
+      int num_steps = (is_changed == nullptr || (*is_changed)[i]) ? count_keepout_steps(ctx, result.agent, result.target) : 0;
+      if (num_steps == 0)
+      {
+         continue;
+      }
+      cached_path *entry = ctx.config.use_path_cache ? path_cache_find(ctx.cache, result.agent, result.target) : nullptr;
+      if (entry != nullptr && entry->num_keepout_steps > 0)
+      {
+         continue;
+      }
+      int keepout_step = reserve_keepout_steps(ctx, result.agent, result.target);
+      int built_step = (entry != nullptr) ? entry->keepout_step : BID_KEEPOUT_STEP;
+      if (entry != nullptr)
+      {
+         entry->keepout_step = keepout_step;
+         entry->num_keepout_steps = num_steps;
+      }
+      if (keepout_step != built_step)
+      {
+         rebuilds.push_back({i, keepout_step});
+      }
+   }
+
+   const plan_context &shared_ctx = ctx;
+   auto build = [&](size_t k)
+   {
+      pathfind_result &result = results[rebuilds[k].first];
+      calculate_path(shared_ctx, result.agent, result.target, rebuilds[k].second, result.path);
+   };
+   if (ctx.config.pool != nullptr && rebuilds.size() > 1)
+   {
+      ctx.config.pool->parallel_for(rebuilds.size(), build);
+   }
+   else
+   {
+      for (size_t k = 0; k < rebuilds.size(); k++)
+      {
+         build(k);
+      }
+   }
+
+   if (ctx.config.use_path_cache)
+   {
+      for (auto [i, keepout_step] : rebuilds)
+      {
+         cached_path &entry = path_cache_insert(ctx.cache, results[i].agent, results[i].target);
+         entry.path.assign(results[i].path.begin(), results[i].path.end());
+         entry.length = bg::length(results[i].path);
+      }
+   }
+}
+
+/**
+ * @brief swap agents between crossing paths until no two paths cross
+ * Every path's segment boxes live in a path_index. A path is "dirty" until it has been
+ * checked against all candidate paths the index returns for it. Two clean paths were already
+ * checked against each other, so after a swap only the two recalculated paths go back on the worklist.
+ * Dirty paths are taken highest index first, same as the original reverse-order scan,
+ * since allocating in the forward order is what allowed the cross.
+ * A Replanner passes is_changed, so only the paths of this tick start out dirty.
+ * An anytime plan stops at its deadline, leaving the remaining crossings.
+ * Throws std::runtime_error if crossings remain after config.max_uncross_swaps swaps
+ * @param ctx plan_context of this plan
+ * @param results accepted pathfind_results, agents and paths are updated in place
+ * @param scratch working storage, overwritten
+ * @param is_changed one flag per result, true if it must be checked, nullptr checks every result
+ * @param agent_ids optional caller ids of the result agents, swapped along with them
+ * @return number of swaps made
+ */
+static size_t resolve_crossings(plan_context &ctx, vector<pathfind_result> &results, crossing_scratch &scratch, const vector<bool> *is_changed,
+                                vector<size_t> *agent_ids)
+{
+   if (results.size() < 2)
+   {
+      return 0;
+   }
+
+   path_index &paths = scratch.paths;
+   vector<size_t> &dirty = scratch.dirty; // max-heap, so the highest index comes out first
+   vector<bool> &is_dirty = scratch.is_dirty;
+   auto mark_dirty = [&](size_t i)
+   {
+      if (!is_dirty[i])
+      {
+         is_dirty[i] = true;
+         dirty.push_back(i);
+         push_heap(dirty.begin(), dirty.end());
+      }
+   };
+   path_index_clear(paths);
+   dirty.clear();
+   is_dirty.assign(results.size(), false);
+   for (size_t i = 0; i < results.size(); i++)
+   {
+      path_index_insert(paths, i, results[i].path);
+      if (is_changed == nullptr || (*is_changed)[i])
+      {
+         mark_dirty(i);
+      }
+   }
+
+   size_t num_swaps = 0;
+   while (!dirty.empty() && !is_past_deadline(ctx))
+   {
+      pop_heap(dirty.begin(), dirty.end());
+      size_t i = dirty.back();
+      dirty.pop_back();
+      is_dirty[i] = false;
+
+      query_crossing_candidates(paths, i, scratch.candidates);
+      for (size_t j : scratch.candidates)
+      {
+         if (!is_path_crossing(results[i], results[j]))
+         {
+            continue;
+         }
+         if (num_swaps >= ctx.config.max_uncross_swaps)
+         {
+            throw runtime_error("ERROR: Crossing paths still unresolved after max_uncross_swaps swaps");
+         }
+         num_swaps++;
+
+         LP_LOG_WARNING("Paths [" << i << "," << j << "] are crossing - resolving");
+         unselect_path(ctx, results[i]);
+         unselect_path(ctx, results[j]);
+         swap_agents(results, i, j);
+         if (agent_ids != nullptr)
+         {
+            swap((*agent_ids)[i], (*agent_ids)[j]);
+         }
+         recalculate_path(ctx, results[i].agent, results[i].target, true, results[i].path);
+         recalculate_path(ctx, results[j].agent, results[j].target, true, results[j].path);
+         if (is_path_crossing(results[i], results[j]))
+         {
+            // i took the inner steps around an obstacle both wrap, j may need them instead
+            unselect_path(ctx, results[i]);
+            unselect_path(ctx, results[j]);
+            recalculate_path(ctx, results[j].agent, results[j].target, true, results[j].path);
+            recalculate_path(ctx, results[i].agent, results[i].target, true, results[i].path);
+         }
+         if (is_path_crossing(results[i], results[j]))
+         {
+            // the paths of the swapped pairs cross either way round, rebuild both with fresh keepout steps
+            recalculate_path(ctx, results[i].agent, results[i].target, false, results[i].path);
+            recalculate_path(ctx, results[j].agent, results[j].target, false, results[j].path);
+         }
+         path_index_insert(paths, i, results[i].path);
+         path_index_insert(paths, j, results[j].path);
+
+         // both paths changed, recheck each of them against everything
+         mark_dirty(i);
+         mark_dirty(j);
+         break;
+      }
+   }
+   return num_swaps;
+}
+
+/**
+ * @brief reserve every {target, agent} bid for the first num_targets targets, building no paths yet
+ * Every bid is built at BID_KEEPOUT_STEP, so bids are independent of each other and of evaluation order.
+ * Building any subset of the batch, serially or on a pool, therefore gives bit-for-bit the same paths as building
+ * all of it serially. Only the paths a plan selects take keepout steps of their own, see reserve_result_steps().
+ * With config.use_path_cache, a pair already in ctx.cache (or repeated within the batch) is built once,
+ * and every pair not cached yet gets a placeholder entry so a bid pruned now is rebuilt identically if uncrossing needs it
+ * @param ctx plan_context of this plan
+ * @param agents vector of all agents
+ * @param targets vector of all targets
+ * @param num_targets number of leading targets to bid on
+ * @param batch overwritten with nothing evaluated yet, its storage is reused
+ */
+static void reserve_bids(plan_context &ctx, span<const Point> agents, span<const Point> targets, size_t num_targets, bid_batch &batch)
+{
+   const size_t num_agents = agents.size();
+   const size_t num_pairs = num_targets * num_agents;
+   batch.costs.rows = num_targets;
+   batch.costs.cols = num_agents;
+   batch.costs.costs.assign(num_pairs, DBL_MAX);
+   if (batch.paths.size() < num_pairs)
+   {
+      batch.paths.resize(num_pairs);
+   }
+   for (auto &path : batch.paths)
+   {
+      path.clear();
+   }
+   batch.entries.assign(num_pairs, nullptr);
+   batch.builder.resize(num_pairs);
+   batch.needs_curve.assign(num_pairs, false);
+   batch.is_evaluated.assign(num_pairs, false);
+   batch.unbuilt.clear();
+   batch.taken.clear();
+
+   for (size_t t = 0; t < num_targets; t++)
+   {
+      for (size_t a = 0; a < num_agents; a++)
+      {
+         size_t k = t * num_agents + a;
+         int num_hits = count_keepout_steps(ctx, agents[a], targets[t]);
+         batch.needs_curve[k] = (num_hits > 0);
+         batch.builder[k] = k;
+         if (!ctx.config.use_path_cache)
+         {
+            continue;
+         }
+
+         cached_path *entry = path_cache_find(ctx.cache, agents[a], targets[t]);
+         if (entry == nullptr)
+         {
+            entry = &path_cache_reserve(ctx.cache, agents[a], targets[t], BID_KEEPOUT_STEP, 0);
+         }
+         batch.entries[k] = entry;
+         if (entry->is_built)
+         {
+            batch.builder[k] = NO_BUILDER;
+            continue;
+         }
+         batch.unbuilt.push_back({entry, k});
+      }
+   }
+
+   // repeats of a pair later in the batch wait on the first one
+   sort(batch.unbuilt.begin(), batch.unbuilt.end());
+   for (size_t i = 0; i < batch.unbuilt.size(); i++)
+   {
+      bool is_first = (i == 0) || (batch.unbuilt[i].first != batch.unbuilt[i - 1].first);
+      batch.builder[batch.unbuilt[i].second] = is_first ? batch.unbuilt[i].second : batch.builder[batch.unbuilt[i - 1].second];
+   }
+}
+
+/**
+ * @brief build the paths of the given pairs, skipping any already evaluated
+ * Paths are built on config.pool if one was provided, else on the calling thread.
+ * With config.use_path_cache every new path is stored for the uncrossing stage
+ * @param ctx plan_context of this plan
+ * @param agents vector of all agents
+ * @param targets vector of all targets
+ * @param batch from reserve_bids(), the pairs are evaluated in place
+ * @param pairs row-major indices of the pairs to evaluate
+ */
+static void evaluate_bids(plan_context &ctx, span<const Point> agents, span<const Point> targets, bid_batch &batch, span<const size_t> pairs)
+{
+   const size_t num_agents = batch.costs.cols;
+
+   /* serial pass, claim each path that still has to be built once */
+   vector<size_t> &to_build = batch.to_build;
+   to_build.clear();
+   for (size_t k : pairs)
+   {
+      size_t b = batch.builder[k];
+      if (b != NO_BUILDER && !batch.is_evaluated[b])
+      {
+         batch.is_evaluated[b] = true;
+         to_build.push_back(b);
+      }
+   }
+
+   /* parallel pass, the expensive curve construction */
+   const plan_context &shared_ctx = ctx;
+   auto build = [&](size_t i)
+   {
+      size_t k = to_build[i];
+      calculate_path(shared_ctx, agents[k % num_agents], targets[k / num_agents], BID_KEEPOUT_STEP, batch.paths[k]);
+      batch.costs.costs[k] = bg::length(batch.paths[k]);
+   };
+   if (ctx.config.pool != nullptr && to_build.size() > 1)
+   {
+      ctx.config.pool->parallel_for(to_build.size(), build);
+   }
+   else
+   {
+      for (size_t i = 0; i < to_build.size(); i++)
+      {
+         build(i);
+      }
+   }
+   ctx.num_bids += to_build.size();
+
+   /* serial pass, store new paths then fill in the pairs that share one */
+   if (ctx.config.use_path_cache)
+   {
+      for (size_t k : to_build)
+      {
+         cached_path &entry = path_cache_insert(ctx.cache, agents[k % num_agents], targets[k / num_agents]);
+         entry.path.assign(batch.paths[k].begin(), batch.paths[k].end());
+         entry.length = batch.costs.costs[k];
+         entry.keepout_step = BID_KEEPOUT_STEP;
+         entry.is_built = true;
+      }
+   }
+   for (size_t k : pairs)
+   {
+      if (!batch.is_evaluated[k])
+      {
+         batch.paths[k].assign(batch.entries[k]->path.begin(), batch.entries[k]->path.end());
+         batch.costs.costs[k] = batch.entries[k]->length;
+         batch.is_evaluated[k] = true;
+         ctx.num_bids++;
+      }
+   }
+}
+
+/**
+ * @brief build every bid of a batch
+ * Without a deadline the whole batch goes to evaluate_bids() at once, so a pool gets all of it.
+ * An anytime plan goes one target row at a time and stops at its deadline
+ * @param ctx plan_context of this plan
+ * @param agents vector of all agents
+ * @param targets vector of all targets
+ * @param batch from reserve_bids(), evaluated in place
+ * @return false if the deadline cut it short
+ */
+static bool evaluate_all_bids(plan_context &ctx, span<const Point> agents, span<const Point> targets, bid_batch &batch)
+{
+   const size_t num_pairs = batch.costs.rows * batch.costs.cols;
+   const size_t step = has_deadline(ctx) ? batch.costs.cols : num_pairs;
+   vector<size_t> &pairs = batch.pairs;
+   pairs.resize(step);
+   for (size_t first = 0; first < num_pairs; first += step)
+   {
+      if (is_past_deadline(ctx))
+      {
+         return false;
+      }
+      iota(pairs.begin(), pairs.end(), first);
+      evaluate_bids(ctx, agents, targets, batch, pairs);
+   }
+   return true;
+}
+
+/**
+ * @brief first assignment of an anytime plan, each target in order takes its nearest remaining agent by straight-line distance
+ * Costs nothing to choose, then the chosen pairs are routed through the shared bid batch, so the full bidding reuses them.
+ * Routing stops at the deadline, results not routed by then keep the straight line from agent to target
+ * @param ctx plan_context of this plan
+ * @param agents vector of all agents
+ * @param targets vector of all targets
+ * @param bids from reserve_bids(), the chosen pairs are evaluated in place
+ * @param num_unrouted output, number of results left as straight lines
+ * @return one pathfind_result per target that received an agent
+ */
+static vector<pathfind_result> assign_targets_nearest(plan_context &ctx, span<const Point> agents, span<const Point> targets, bid_batch &bids,
+                                                      size_t &num_unrouted)
+{
+   const size_t num_agents = bids.costs.cols;
+   const size_t num_served = bids.costs.rows;
+   vector<bool> is_assigned(num_agents, false);
+   vector<size_t> pairs;
+   for (size_t t = 0; t < num_served; t++)
+   {
+      double nearest = DBL_MAX;
+      size_t selected_agent_idx = 0;
+      for (size_t a = 0; a < num_agents; a++)
+      {
+         double distance = bg::comparable_distance(agents[a], targets[t]);
+         if (!is_assigned[a] && distance < nearest)
+         {
+            nearest = distance;
+            selected_agent_idx = a;
+         }
+      }
+      is_assigned[selected_agent_idx] = true;
+      pairs.push_back(t * num_agents + selected_agent_idx);
+   }
+
+   const size_t wave_size = (ctx.config.pool != nullptr) ? ctx.config.pool->size() + 1 : 1;
+   span<const size_t> remaining = pairs;
+   while (!remaining.empty() && !is_past_deadline(ctx))
+   {
+      size_t count = min(wave_size, remaining.size());
+      evaluate_bids(ctx, agents, targets, bids, remaining.first(count));
+      remaining = remaining.subspan(count);
+   }
+
+   vector<pathfind_result> results;
+   num_unrouted = 0;
+   for (size_t t = 0; t < num_served; t++)
+   {
+      size_t k = pairs[t];
+      pathfind_result result = {
+          .id = static_cast<int>(t),
+          .agent = agents[k % num_agents],
+          .target = targets[t],
+      };
+      if (bids.is_evaluated[k])
+      {
+         // copied, the full bidding may select this bid too
+         result.path = bids.paths[k];
+      }
+      else
+      {
+         result.path = {result.agent, result.target};
+         num_unrouted++;
+      }
+      results.push_back(move(result));
+   }
+   LP_LOG_INFO("First assignment ready, " << num_unrouted << " of " << num_served << " paths unrouted");
+   return results;
+}
+
+/**
+ * @brief remove the agents flagged in is_assigned, keeping the rest in order
+ * @param agents vector of all agents, modified in place
+ * @param is_assigned one flag per agent, true to remove it
+ */
+static void erase_assigned_agents(vector<Point> &agents, const vector<bool> &is_assigned)
+{
+   size_t kept = 0;
+   for (size_t a = 0; a < agents.size(); a++)
+   {
+      if (!is_assigned[a])
+      {
+         agents[kept++] = agents[a];
+      }
+   }
+   agents.resize(kept);
+}
+
+/**
+ * @brief assign targets in insertion order, each target accepts the shortest bid among remaining agents
+ * Every bid is laid out up front by reserve_bids(), selection then walks targets in order,
+ * see select_greedy_bid(). An anytime plan returns early, unassigned, once its deadline has passed
+ * Assigned agents are erased from agents
+ * @param ctx plan_context of this plan
+ * @param agents vector of all agents to bid upon targets
+ * @param targets vector of all targets to be bid upon
+ * @param bids from reserve_bids() for the first min(targets.size(), agents.size()) targets
+ * @param final_results output, one pathfind_result per target that received an agent is appended
+ */
+static void assign_targets_greedy(plan_context &ctx, vector<Point> &agents, span<const Point> targets, bid_batch &bids,
+                                  vector<pathfind_result> &final_results)
+{
+   const size_t num_served = bids.costs.rows;
+
+   if (!ctx.config.prune_bids && !has_deadline(ctx))
+   {
+      evaluate_all_bids(ctx, agents, targets, bids);
+   }
+   vector<bool> &is_assigned = bids.is_assigned;
+   is_assigned.assign(agents.size(), false);
 
    // iterate over each target, find the closest agent to assign to each target
    //
    // in my solution there is an implied hierarchy of targets-
    // by this method, we ensure target1 gets its closest agent, then target2 gets
    // its (next) closest agent, and so on.
-   int id = 0; // unique ID for pathfinding result
-   for (auto target : targets)
+   for (size_t t = 0; t < num_served; t++)
    {
-      // generate agent bids for each agent
-      vector<agent_bids> bids = {};
+      size_t selected_agent_idx = select_greedy_bid(ctx, agents, targets, t, is_assigned, NO_AGENT, bids);
+      if (selected_agent_idx == NO_AGENT)
+      {
+         return;
+      }
+
+      // now lock in the choice and pop the agent
+      LP_LOG_INFO("Target_" << t << " selects: bid_" << selected_agent_idx);
+      pathfind_result iter_result = {
+          .id = static_cast<int>(t),
+          .agent = agents[selected_agent_idx],
+          .target = targets[t],
+          // every bid is selected at most once, so the path can be moved out
+          .path = move(bids.paths[t * agents.size() + selected_agent_idx]),
+      };
+      final_results.push_back(move(iter_result));
+      bids.taken.push_back(t * agents.size() + selected_agent_idx);
+      is_assigned[selected_agent_idx] = true;
+   }
+
+   if (num_served < targets.size())
+   {
+      LP_LOG_WARNING("No agents left, remaining targets will not get paths");
+   }
+
+   erase_assigned_agents(agents, is_assigned);
+}
+
+/**
+ * @brief choose the agent of one target, the shortest bid among agents not assigned yet
+ * With config.prune_bids a target evaluates the remaining agents in order of straight-line distance, a lower bound
+ * on any path, and stops building paths once that bound can't beat its best bid. A warm start agent is bid before
+ * the rest, so a good guess bounds every other bid from the start. Selection is the same as building every bid
+ * in any order, ties still go to the lowest agent index. With a pool, bids are built a pool-sized wave at a time.
+ * An anytime plan checks its deadline before each wave
+ * @param ctx plan_context of this plan
+ * @param agents agents of the batch
+ * @param targets targets of the batch
+ * @param t row of the target in bids
+ * @param is_assigned one flag per agent, true if the agent is taken
+ * @param warm_start agent to bid first, or NO_AGENT
+ * @param bids from reserve_bids(), evaluated in place
+ * @return selected agent, or NO_AGENT if the deadline passed first
+ */
+static size_t select_greedy_bid(plan_context &ctx, span<const Point> agents, span<const Point> targets, size_t t, const vector<bool> &is_assigned,
+                                size_t warm_start, bid_batch &bids)
+{
+   const size_t num_agents = bids.costs.cols;
+   const bool is_pruning = ctx.config.prune_bids;
+   const size_t wave_size = !is_pruning ? SIZE_MAX : (ctx.config.pool != nullptr) ? ctx.config.pool->size() + 1 : 1;
+   vector<pair<double, size_t>> &candidates = bids.candidates; // {lower bound, agent} of every remaining agent
+   vector<size_t> &wave = bids.wave;
+   candidates.clear();
 
-      cout << "\tTarget_" << id << " bidding opens" << endl;
-      if (agents.empty())
+   for (size_t a = 0; a < num_agents; a++)
+   {
+      if (!is_assigned[a])
       {
-         cout << "\t\tWARNING: No agents left, remaining targets will not get paths" << endl;
-         break;
+         candidates.push_back({is_pruning ? bg::distance(agents[a], targets[t]) : 0.0, a});
       }
+   }
+   if (is_pruning)
+   {
+      sort(candidates.begin(), candidates.end());
+      auto warm = find_if(candidates.begin(), candidates.end(), [&](const pair<double, size_t> &c) { return c.second == warm_start; });
+      rotate(candidates.begin(), warm, (warm != candidates.end()) ? warm + 1 : warm);
+   }
 
-      for (vector<Point>::iterator it = agents.begin(); it != agents.end(); ++it)
+   // now choose best bid for target among agents still in the pool
+   double iter_distance = DBL_MAX; // instantiate to worst case value
+   size_t selected_agent_idx = 0;
+   for (size_t next = 0; next < candidates.size();)
+   {
+      if (is_past_deadline(ctx))
       {
-         size_t agent_id = std::distance(agents.begin(), it);
-
-         // construct a bid for this agent and append to vector of bids
-         Line chosen_path = calculate_path(bounds, *it, target, obstacles);
-         agent_bids bid = {agent_id, *it, chosen_path, bg::length(chosen_path)};
-         bids.push_back(bid);
+         return NO_AGENT;
       }
-
-      // setup pathfinding result
-      pathfind_result iter_result = {
-          .id = id,
-          .target = target,
-      };
-
-      // now choose best bid for target, then remove
-      // selected agent from pool
-      double iter_distance = DBL_MAX; // instantiate to worst case value
-      size_t selected_agent_idx;
-      cout << "\tTarget_" << id << " has received all bids" << endl;
-      for (auto bid : bids)
+      wave.clear();
+      for (; next < candidates.size() && wave.size() < wave_size; next++)
       {
-         cout << "\t\tBid_" << bid.agent_vect_idx << " dist=" << bid.distance << ", path=" << LP_PRINT_GEOM(bid.path) << endl;
-         if (bid.distance < iter_distance)
+         auto [bound, a] = candidates[next];
+         size_t k = t * num_agents + a;
+         bool cannot_win = (bound > iter_distance) || (bound == iter_distance && a > selected_agent_idx);
+         if (is_pruning && cannot_win && !bids.is_evaluated[k])
          {
-            iter_distance = bid.distance;
-            iter_result.agent = bid.agent;
-            iter_result.path = bid.path;
-            selected_agent_idx = bid.agent_vect_idx;
+            ctx.bids_pruned++;
+            ctx.curves_pruned += bids.needs_curve[k] ? 1 : 0;
+            continue;
          }
+         wave.push_back(k);
       }
-      // now lock in the choice and pope the agent
-      cout << "\t\tTarget_" << id << " selects: bid_" << selected_agent_idx << endl;
-      final_results.push_back(iter_result);
+      evaluate_bids(ctx, agents, targets, bids, wave);
 
-      if (agents.size() > 1)
-      {
-         agents.erase(agents.begin() + selected_agent_idx); // pop assigned agent
-      }
-      else
+      for (size_t k : wave)
       {
-         agents.clear();
+         size_t a = k % num_agents;
+         double cost = bids.costs.costs[k];
+         LP_LOG_DEBUG("Bid_" << a << " dist=" << cost << ", path=" << LP_PRINT_GEOM(bids.paths[k]));
+         if (cost < iter_distance || (cost == iter_distance && a < selected_agent_idx))
+         {
+            iter_distance = cost;
+            selected_agent_idx = a;
+         }
       }
-      id++;
    }
+   LP_LOG_DEBUG("Target_" << t << " has received all bids");
+   return selected_agent_idx;
+}
 
-   // now all agents have been assigned, check for crossed paths
-   cout << "\tPath plan is in, conducting final checks" << endl;
-   bool is_crossing = true;
+/**
+ * @brief assign agents to targets for minimum total path length
+ * Builds the full target x agent cost matrix once with evaluate_all_bids()
+ * and hands it to solve_assignment(). The implied hierarchy of targets is kept-
+ * if there are fewer agents than targets, only the first agents.size() targets are served.
+ * An anytime plan whose deadline passes before the matrix is complete returns early with nothing assigned
+ * Assigned agents are erased from agents
+ * @param ctx plan_context of this plan
+ * @param agents vector of all agents to bid upon targets
+ * @param targets vector of all targets to be bid upon
+ * @param bids from reserve_bids() for the first min(targets.size(), agents.size()) targets
+ * @param final_results output, one pathfind_result per target that received an agent is appended
+ */
+static void assign_targets_optimal(plan_context &ctx, vector<Point> &agents, span<const Point> targets, bid_batch &bids,
+                                   vector<pathfind_result> &final_results)
+{
+   size_t num_served = bids.costs.rows;
 
-   size_t num_results = final_results.size();
-   if (num_results > 1)
+   if (num_served < targets.size())
    {
-      while (is_crossing)
-      {
-         is_crossing = false;
+      LP_LOG_WARNING("Fewer agents than targets, only the first " << num_served << " targets will get paths");
+   }
+   if (num_served == 0)
+   {
+      return;
+   }
 
-         // go through agent/ target assignments in reverse order that they were assigned 
-         // reason for reverse order is that allocating in the forward order allowed for the cross
-         for (int i=num_results-1; i >= 0; i--)
-         {
-            for (int j= num_results-1; j >= 0; j--)
-            {
-               if ((i != j) && (is_path_crossing(final_results.at(i), final_results.at(j))))
-               {
-                  is_crossing = true;
-                  cout << "\t\tERROR: Paths [" << i << "," << j << "] are crossing - resolving" << endl;
-                  swap_agents(final_results, i, j);
-                  final_results.at(i).path = calculate_path(bounds, final_results.at(i).agent, final_results.at(i).target, obstacles);
-                  final_results.at(j).path = calculate_path(bounds, final_results.at(j).agent, final_results.at(j).target, obstacles);
-               }
-            }
-         }
-      }
+   // every {target, agent} pair bids exactly once, the assignment needs all of them
+   if (!evaluate_all_bids(ctx, agents, targets, bids))
+   {
+      return;
    }
-   return final_results;
+   LP_LOG_INFO("Cost matrix " << bids.costs.rows << "x" << bids.costs.cols << " complete, solving assignment");
+
+   vector<size_t> &selected = bids.selected;
+   solve_assignment(bids.costs, bids.assignment, selected);
+   vector<bool> &is_assigned = bids.is_assigned;
+   is_assigned.assign(agents.size(), false);
+   for (size_t t = 0; t < num_served; t++)
+   {
+      pathfind_result result = {
+          .id = static_cast<int>(t),
+          .agent = agents[selected[t]],
+          .target = targets[t],
+          .path = move(bids.paths[t * agents.size() + selected[t]]),
+      };
+      LP_LOG_INFO("Target_" << t << " selects: bid_" << selected[t]);
+      final_results.push_back(move(result));
+      bids.taken.push_back(t * agents.size() + selected[t]);
+      is_assigned[selected[t]] = true;
+   }
+
+   // pop assigned agents, same as greedy bidding does
+   erase_assigned_agents(agents, is_assigned);
 }
 
 /**
  * @brief Create the curved line path that avoids obstacles for a single agent
  * Steps are: create union of straight_path and obstacles, get convex hull of union,
  * create resulting path from a subset of convex_hull points and start/end
+ * @param ctx plan_context of this plan, for obstacles and tunables
  * @param straight_path a two-point line with {agent, target}
- * @param obstacles vector of all obstacles
  * @param is_clockwise true to reverse the convex_hull output before iterating
+ * @param keepout_step first keepout multiple to use, one more is used per intersecting obstacle
  */
-static Line get_obstacle_avoid_path(Line straight_path, vector<obstacle> &obstacles, bool is_clockwise)
+static Line get_obstacle_avoid_path(const plan_context &ctx, const ScratchLine &straight_path, bool is_clockwise, int keepout_step)
 {
+   const double line_buffer_distance = ctx.config.line_buffer_distance;
+   // the round ends of the stroked line are circles of line_buffer_distance, tessellated like any other
+   const int points_per_circle = (ctx.config.max_chord_error > 0) ? chord_error_points(line_buffer_distance, ctx.config.max_chord_error)
+                                                                  : ctx.config.points_per_circle;
+
    boost::geometry::strategy::buffer::distance_symmetric<double> distance_strategy(line_buffer_distance);
    boost::geometry::strategy::buffer::join_round join_strategy(points_per_circle);
    boost::geometry::strategy::buffer::end_round end_strategy(points_per_circle);
@@ -175,28 +1622,28 @@ static Line get_obstacle_avoid_path(Line straight_path, vector<obstacle> &obstac
    boost::geometry::strategy::buffer::side_straight side_strategy;
 
    Line retval;
-   MultiPolygon all_obstacles;
+   ScratchMultiPolygon all_obstacles;
 
    /* stroke Line (series of points) into thin polygon */
-   MultiPolygon line_buf;
+   ScratchMultiPolygon line_buf;
    bg::buffer(straight_path, line_buf, distance_strategy, side_strategy, join_strategy, end_strategy, circle_strategy);
 
    /**
     * iteratively create a polygon union of all obstacles intersecting with the straight line path
     * we expect to have at least one, or else we would have used pathfinding()'s straight_path
     */
-   vector<obstacle> intersecting = get_intersecting_obstacles(straight_path, obstacles);
-   for (auto shape : intersecting)
+   scratch_vector<obstacle> intersecting = get_intersecting_obstacles(straight_path, ctx.index);
+   for (auto &shape : intersecting)
    {
       /**
        * create an ever-slightly-wider circle (see get_obstacle_buffer_size)
        * and stick it to our thin line_buf polygon
        */
-      MultiPolygon circle = circle_from_obstacle(shape, get_obstacle_buffer_size());
-      bg::union_(line_buf, circle[0], all_obstacles);
+      ScratchPolygon circle = keepout_polygon(ctx, shape, get_obstacle_buffer_size(ctx, keepout_step++));
+      bg::union_(line_buf, circle, all_obstacles);
    }
    /* our most crucial trick, generate a convex hull line around the compound polygon */
-   Line hull;
+   ScratchLine hull;
    bg::convex_hull(all_obstacles, hull);
 
    /**
@@ -205,7 +1652,7 @@ static Line get_obstacle_avoid_path(Line straight_path, vector<obstacle> &obstac
     */
 
    /* load the proper subset of the convex hull into the final path */
-   Line convex_hull_subset = find_convex_hull_subset(straight_path[0], straight_path[1], hull, is_clockwise);
+   ScratchLine convex_hull_subset = find_convex_hull_subset(straight_path[0], straight_path[1], hull, is_clockwise);
 
    /**
     * with infinite time I'd like to figure out why I have so much trouble with order of these points- but this works
@@ -226,14 +1673,16 @@ static Line get_obstacle_avoid_path(Line straight_path, vector<obstacle> &obstac
     */
    for (auto point : convex_hull_subset)
    {
-      // we want points that are just a little bit beyond the "stroke width" value we used to turn the line into a polygon
-      // which basically turned
-      //  0----------0
-      // into
-      //   ___________________
-      //  /                   \
-      //  \___________________/
-      // so we ignore points around those ends
+      /**
+       * we want points that are just a little bit beyond the "stroke width" value we used to turn the line into a polygon
+       * which basically turned
+       *  0----------0
+       * into
+       *   ___________________
+       *  /                   \
+       *  \___________________/
+       * so we ignore points around those ends
+       */
       if (!(bg::distance(point, straight_path[0]) < (line_buffer_distance + 0.01)) && !(bg::distance(point, straight_path[1]) < (line_buffer_distance + 0.01)))
       {
          retval.push_back(point);
@@ -245,6 +1694,59 @@ static Line get_obstacle_avoid_path(Line straight_path, vector<obstacle> &obstac
    return retval;
 }
 
+/**
+ * @brief Create the curved path that avoids obstacles for a single agent, path_engine::TANGENT version
+ * Same keepouts as get_obstacle_avoid_path(), but the hull of the grown circles is walked exactly (see tangent_path.hpp)
+ * A keepout never grows past the agent or target, so both always stay on the hull
+ * @param ctx plan_context of this plan, for obstacles and tunables
+ * @param straight_path a two-point line with {agent, target}
+ * @param is_clockwise true for the clockwise side of the hull
+ * @param keepout_step first keepout multiple to use, one more is used per intersecting obstacle
+ * @return path from agent to target, or an empty Line if no detour could be built
+ */
+static Line get_tangent_avoid_path(const plan_context &ctx, const ScratchLine &straight_path, bool is_clockwise, int keepout_step)
+{
+   scratch_vector<obstacle> circles = get_intersecting_obstacles(straight_path, ctx.index);
+   for (auto &circle : circles)
+   {
+      double clearance = min(bg::distance(circle.p, straight_path[0]), bg::distance(circle.p, straight_path[1])) - TANGENT_MIN_CLEARANCE;
+      circle.radius = min(circle.radius + get_obstacle_buffer_size(ctx, keepout_step++), clearance);
+   }
+   return tangent_hull_path(straight_path[0], straight_path[1], circles, is_clockwise, ctx.config.arc_tolerance);
+}
+
+/**
+ * @brief shorter in-bounds side of the tangent hull
+ * Throws std::runtime_error if neither side is in bounds
+ * @param ctx plan_context of this plan
+ * @param straight_path a two-point line with {agent, target}
+ * @param keepout_step first of the keepout steps reserved for this path, both sides share them
+ * @return path from agent to target, or an empty Line if no detour could be built
+ */
+static Line get_shorter_tangent_path(const plan_context &ctx, const ScratchLine &straight_path, int keepout_step)
+{
+   Line best;
+   bool any_built = false;
+   for (bool is_clockwise : {true, false})
+   {
+      Line candidate = get_tangent_avoid_path(ctx, straight_path, is_clockwise, keepout_step);
+      if (candidate.empty())
+      {
+         continue;
+      }
+      any_built = true;
+      if (is_path_in_bounds(candidate, ctx.bounds) && (best.empty() || bg::length(candidate) < bg::length(best)))
+      {
+         best = move(candidate);
+      }
+   }
+   if (any_built && best.empty())
+   {
+      throw runtime_error("ERROR: Agent reports no way around obstacle");
+   }
+   return best;
+}
+
 /**
  * @brief given a convex hull, agent, and target, find subset of points from agent to target
  * this involves finding closest point in convex hull to agent and target, and taking a subvector
@@ -252,17 +1754,17 @@ static Line get_obstacle_avoid_path(Line straight_path, vector<obstacle> &obstac
  * @param target the Point of the final target, second and final point in straight_path
  * @param convex_hull a closed-shape convex hull that goes around but doesn't touch agent/target
  * @param is_clockwise true to reverse convex_hull before iterating
- * @return Line with the relevant portion of provided convex_hull for pathfinding
+ * @return the relevant portion of provided convex_hull for pathfinding
  */
-static Line find_convex_hull_subset(Point agent, Point target, Line convex_hull, bool is_clockwise)
+static ScratchLine find_convex_hull_subset(Point agent, Point target, ScratchLine convex_hull, bool is_clockwise)
 {
    double start_distance;
    double end_distance;
    double min_start_distance = DBL_MAX;
    double min_end_distance = DBL_MAX;
-   size_t start_idx;
-   size_t end_idx;
-   Line result;
+   size_t start_idx = 0;
+   size_t end_idx = 0;
+   ScratchLine result;
 
    /* handle clockwise/counterclockwise by optionally reversing vector of points */
    if (!is_clockwise)
@@ -298,43 +1800,200 @@ static Line find_convex_hull_subset(Point agent, Point target, Line convex_hull,
 }
 
 /**
- * @brief return an ever-growing amount of keepout as extra buffer around shapes
+ * @brief return the amount of keepout to use as extra buffer around shapes
  * Necessary when multiple agents want to circumvent the same obstacle(s) to reach their targets
  * This is fed into circle_from_obstacle's optional arg for get_obstacle_avoid_path()
- * @return configurable min_buffer value * incrementing buffer_offset var
+ * @param ctx plan_context of this plan, for the min_keepout_buffer tunable
+ * @param keepout_step BID_KEEPOUT_STEP or a step handed out by reserve_keepout_steps()
+ * @return configurable min_keepout_buffer value * keepout_step
  */
-static double get_obstacle_buffer_size(void)
+static double get_obstacle_buffer_size(const plan_context &ctx, int keepout_step)
 {
-   return (min_keepout_buffer * buffer_offset++);
+   return (ctx.config.min_keepout_buffer * keepout_step);
 }
 
 /**
- * @brief Turn an obstacle into a circular MultiPolygon
- * @param o obstacle to become a circle
- * @param extra_buffer optionally increase buffer around obstacle. See get_obstacle_buffer_size()
- * @return MultiPolygon circular polygon made of 16 evenly spaced points around o.p
+ * @brief number of keepout steps calculate_path() will use for {agent, target}
+ * @param ctx plan_context of this plan
+ * @param agent agent that must route to target
+ * @param target target to be routed to
+ * @return number of obstacles intersecting the straight path
  */
-static MultiPolygon circle_from_obstacle(obstacle o, double extra_buffer = 0)
+static int count_keepout_steps(const plan_context &ctx, Point agent, Point target)
 {
-   const int points_per_circle = 16; // configurable num points around circle
+   scratch_scope scratch(&ctx.scratch);
+   Point straight_path[] = {agent, target};
+   return get_intersecting_obstacles(straight_path, ctx.index).size();
+}
 
-   /**
-    * We use the concept of a buffer around a point to create our circle
-    * boost::geometry strategies are effectively options about how we will generate our circle
-    */
-   bg::strategy::buffer::join_round join_strategy(points_per_circle); // unused for obstacles
-   bg::strategy::buffer::end_round end_strategy(points_per_circle); // unused for obstacles
-   bg::strategy::buffer::side_straight side_strategy; // unused for obstacles
+/**
+ * @brief reserve keepout steps for a selected path, the lowest free around each obstacle its straight line hits
+ * ensures n-many wraps around an obstacle don't take same path- each path selected around it gets additional keepout.
+ * Steps are counted per obstacle, so a path only goes wider than the selected paths that wrap the same obstacles,
+ * not every path of the plan. The i-th obstacle of the path, in index order, gets step first + i like calculate_path() uses them
+ * @param ctx plan_context of this plan, owns the keepout_pool
+ * @param agent agent that must route to target
+ * @param target target to be routed to
+ * @return first step of the path, BID_KEEPOUT_STEP if its straight line hits nothing
+ */
+static int reserve_keepout_steps(plan_context &ctx, Point agent, Point target)
+{
+   scratch_scope scratch(&ctx.scratch);
+   Point straight_path[] = {agent, target};
+   scratch_vector<size_t> hits = query_path_hits(ctx.index, straight_path);
+   if (hits.empty())
+   {
+      return BID_KEEPOUT_STEP;
+   }
+
+   keepout_pool &pool = *ctx.steps;
+   if (pool.is_used.size() < ctx.index.obstacles.size())
+   {
+      pool.is_used.resize(ctx.index.obstacles.size());
+   }
+   auto is_free = [&](size_t first)
+   {
+      for (size_t i = 0; i < hits.size(); i++)
+      {
+         const vector<bool> &used = pool.is_used[hits[i]];
+         if (first + i < used.size() && used[first + i])
+         {
+            return false;
+         }
+      }
+      return true;
+   };
+   size_t first = BID_KEEPOUT_STEP;
+   while (!is_free(first))
+   {
+      first++;
+   }
+   for (size_t i = 0; i < hits.size(); i++)
+   {
+      vector<bool> &used = pool.is_used[hits[i]];
+      if (used.size() <= first + i)
+      {
+         used.resize(first + i + 1, false);
+      }
+      used[first + i] = true;
+   }
+   return static_cast<int>(first);
+}
+
+/**
+ * @brief give back the keepout steps of a cached path that is dropped, replaced or no longer selected
+ * Only selected paths hold steps, so they are free to hand out again right away
+ * @param ctx plan_context of this plan
+ * @param agent agent of the path
+ * @param target target of the path
+ * @param entry cached path whose steps are released, nothing happens if it holds none
+ */
+static void release_keepout_steps(plan_context &ctx, Point agent, Point target, const cached_path &entry)
+{
+   if (entry.num_keepout_steps == 0)
+   {
+      return;
+   }
+   scratch_scope scratch(&ctx.scratch);
+   Point straight_path[] = {agent, target};
+   scratch_vector<size_t> hits = query_path_hits(ctx.index, straight_path);
+   for (size_t i = 0; i < min(hits.size(), static_cast<size_t>(entry.num_keepout_steps)); i++)
+   {
+      ctx.steps->is_used[hits[i]][entry.keepout_step + i] = false;
+   }
+}
+
+/**
+ * @brief free every keepout step, keeping the storage for the next plan
+ * @param pool keepout_pool of a plan_scratch
+ */
+static void clear_keepout_steps(keepout_pool &pool)
+{
+   for (auto &used : pool.is_used)
+   {
+      used.clear();
+   }
+}
 
-   /* make a circle with 16 points around a single point */
-   bg::strategy::buffer::point_circle circle_strategy(points_per_circle);
+/**
+ * @brief mark the keepout steps of every cached path that holds some again, after the obstacles were renumbered
+ * Every cached path kept across an obstacle change wraps the same obstacles as before, only their indices moved
+ * @param ctx plan_context of a Replanner, its index already holds the changed obstacles
+ */
+static void restore_keepout_steps(plan_context &ctx)
+{
+   keepout_pool &pool = *ctx.steps;
+   pool.is_used.assign(ctx.index.obstacles.size(), vector<bool>());
+   for (const auto &[key, entry] : ctx.cache.entries)
+   {
+      if (entry.num_keepout_steps == 0)
+      {
+         continue;
+      }
+      scratch_scope scratch(&ctx.scratch);
+      Point straight_path[] = {Point(key.agent_x, key.agent_y), Point(key.target_x, key.target_y)};
+      scratch_vector<size_t> hits = query_path_hits(ctx.index, straight_path);
+      for (size_t i = 0; i < hits.size(); i++)
+      {
+         vector<bool> &used = pool.is_used[hits[i]];
+         size_t step = entry.keepout_step + i;
+         if (used.size() <= step)
+         {
+            used.resize(step + 1, false);
+         }
+         used[step] = true;
+      }
+   }
+}
 
-   /* set buffer distance (obstacle radius + extra buffer) */
-   bg::strategy::buffer::distance_symmetric<double> distance_strategy(o.radius + extra_buffer);
+/**
+ * @brief Turn an obstacle into a circular Polygon
+ * The common tessellation counts use the compile-time instantiations of circle_polygon() shipped in this library,
+ * any other count is tessellated at runtime. Both give the same polygon bg::buffer would around o.p
+ * @param o obstacle to become a circle
+ * @param points_per_circle number of points around the circle, see pathfind_config
+ * @param extra_buffer optionally increase buffer around obstacle. See get_obstacle_buffer_size()
+ * @return Polygon made of points_per_circle evenly spaced points around o.p
+ */
+static ScratchPolygon circle_from_obstacle(const obstacle &o, int points_per_circle, double extra_buffer = 0)
+{
+   const double radius = o.radius + extra_buffer;
+   switch (points_per_circle)
+   {
+   case 8:
+      return circle_polygon<double, 8, ScratchPolygon>(o.p, radius);
+   case 16:
+      return circle_polygon<double, 16, ScratchPolygon>(o.p, radius);
+   case 32:
+      return circle_polygon<double, 32, ScratchPolygon>(o.p, radius);
+   case 64:
+      return circle_polygon<double, 64, ScratchPolygon>(o.p, radius);
+   default:
+      return circle_polygon<double, DYNAMIC_POINTS_PER_CIRCLE, ScratchPolygon>(o.p, radius, points_per_circle);
+   }
+}
 
-   MultiPolygon result;
-   bg::buffer(o.p, result, distance_strategy, side_strategy, join_strategy, end_strategy, circle_strategy);
-   return result;
+/**
+ * @brief tessellate the keepout circle of an obstacle for get_obstacle_avoid_path()
+ * With config.max_chord_error set, each circle gets the points chord_error_points() picks for its own radius, and
+ * the polygon is circumscribed so the detour never cuts into the keepout. Otherwise every circle gets
+ * config.points_per_circle points on the circle, as before
+ * @param ctx plan_context of this plan, for tunables, counts the points in ctx.keepout_vertices
+ * @param o obstacle to become a circle
+ * @param extra_buffer keepout around the obstacle, see get_obstacle_buffer_size()
+ * @return closed polygon around the keepout circle
+ */
+static ScratchPolygon keepout_polygon(const plan_context &ctx, const obstacle &o, double extra_buffer)
+{
+   if (!(ctx.config.max_chord_error > 0))
+   {
+      ctx.keepout_vertices += ctx.config.points_per_circle;
+      return circle_from_obstacle(o, ctx.config.points_per_circle, extra_buffer);
+   }
+   const double radius = o.radius + extra_buffer;
+   const int count = chord_error_points(radius, ctx.config.max_chord_error);
+   ctx.keepout_vertices += count;
+   return circle_from_obstacle({o.p, circumscribed_radius(radius, count)}, count);
 }
 
 /**
@@ -343,14 +2002,39 @@ static MultiPolygon circle_from_obstacle(obstacle o, double extra_buffer = 0)
  * @param agents vector of all agents
  * @param targets vector of all targets
  * @param obstacles vector of all obstacles
+ * @param max_agents largest number of agents to accept
+ * @return true if input params are valid, else false
+ */
+bool is_valid_input_params(Boundary &bounds, vector<Point> &agents, vector<Point> &targets, vector<obstacle> &obstacles, size_t max_agents)
+{
+   pathfind_config config;
+   config.max_agents = max_agents;
+   obstacle_index index = build_obstacle_index(obstacles);
+   path_cache cache;
+   plan_context ctx = {config, bounds, index, cache};
+   return validate_inputs(ctx, agents, targets);
+}
+
+/**
+ * @brief validate the input agents and targets against an already indexed obstacle map
+ * Only blocks of obstacles near the point or boundary outline under test are checked, a block at a time
+ * @param ctx plan_context holding the boundary, obstacle_index and max_agents
+ * @param agents vector of all agents
+ * @param targets vector of all targets
  * @return true if input params are valid, else false
  */
-bool is_valid_input_params(Boundary &bounds, vector<Point> &agents, vector<Point> &targets, vector<obstacle> &obstacles)
+static bool validate_inputs(const plan_context &ctx, span<const Point> agents, span<const Point> targets)
 {
+   // the hit lists below live in this thread's scratch arena
+   scratch_scope scratch;
+   const Boundary &bounds = ctx.bounds;
+   const obstacle_index &index = ctx.index;
+   const size_t max_agents = ctx.config.max_agents;
+
    /* ensure we don't exceed max number of agents */
-   if (agents.size() > NUM_MAX_AGENTS)
+   if (agents.size() > max_agents)
    {
-      cerr << "ERROR: Provided number of agents exceeds max value:" << NUM_MAX_AGENTS << endl;
+      LP_LOG_ERROR("Provided number of agents exceeds max value:" << max_agents);
       return false;
    }
 
@@ -360,18 +2044,14 @@ bool is_valid_input_params(Boundary &bounds, vector<Point> &agents, vector<Point
       // ensure all agents are inbounds
       if (!is_point_in_bounds(agent, bounds))
       {
-         cerr << "ERROR: Agent located outside boundary" << endl;
+         LP_LOG_ERROR("Agent located outside boundary");
          return false;
       }
       // ensure no agents are within obstacles
-      for (auto obs : obstacles)
+      if (!query_point_hits(index, agent).empty())
       {
-         MultiPolygon circle = circle_from_obstacle(obs);
-         if (bg::covered_by(agent, circle))
-         {
-            cerr << "ERROR: Agent located within obstacle" << endl;
-            return false;
-         }
+         LP_LOG_ERROR("Agent located within obstacle");
+         return false;
       }
    }
 
@@ -381,42 +2061,36 @@ bool is_valid_input_params(Boundary &bounds, vector<Point> &agents, vector<Point
       // ensure all targets are inbounds
       if (!is_point_in_bounds(target, bounds))
       {
-         cerr << "ERROR: Target located outside boundary" << endl;
+         LP_LOG_ERROR("Target located outside boundary");
          return false;
       }
       // ensure no targets are within obstacles
-      for (auto obs : obstacles)
+      if (!query_point_hits(index, target).empty())
       {
-         MultiPolygon circle = circle_from_obstacle(obs);
-         if (bg::covered_by(target, circle))
-         {
-            cerr << "ERROR: Target located within obstacle" << endl;
-            return false;
-         }
+         LP_LOG_ERROR("Target located within obstacle");
+         return false;
       }
    }
 
+   /* obstacles that don't reach the outline of the boundary can neither contain nor bifurcate it */
+   scratch_vector<size_t> touching_bounds = query_outline_hits(index, bounds);
+
    /* ensure no obstacles contain the box */
-   for (auto obs : obstacles)
+   for (size_t idx : touching_bounds)
    {
-      MultiPolygon circle = circle_from_obstacle(obs);
-      if (bg::covered_by(bounds, circle))
+      if (box_in_circle(bounds, index.obstacles[idx]))
       {
-         cerr << "ERROR: Whole boundary within obstacle" << endl;
+         LP_LOG_ERROR("Whole boundary within obstacle");
          return false;
       }
    }
 
    /* ensure no obstacles bifurcate or intersect the box */
-   for (auto obs : obstacles)
+   for (size_t idx : touching_bounds)
    {
-      MultiPolygon mp;
-      MultiPolygon circle = circle_from_obstacle(obs);
-      bg::difference(bounds, circle, mp);
-
-      if (bg::num_geometries(mp) > 1)
+      if (circle_splits_box(bounds, index.obstacles[idx]))
       {
-         cerr << "ERROR: Obstacle bifurcates or intersects the boundary" << endl;
+         LP_LOG_ERROR("Obstacle bifurcates or intersects the boundary");
          return false;
       }
    }
@@ -440,28 +2114,31 @@ static void swap_agents(vector<pathfind_result> &pr, int idx_1, int idx_2)
 /**
  * @brief Calculate a path from agent to target, this is sort of a state machine
  * that selects straight or curved path, and then orchestrates curved path design if necessary
- * @param bounds outer bounding Box
+ * @param ctx plan_context of this plan, read-only so bids can share it across threads
  * @param agent agent that must route to target
  * @param target target to be routed to
- * @param obstacles vector of circular obstacles to avoid
- * @return a new straight or curved path from agent to target
+ * @param keepout_step first of the keepout steps reserved for this path, both directions share them
+ * @param path overwritten with a new straight or curved path from agent to target, a straight one reuses its storage
  */
-static Line calculate_path(Boundary &bounds, Point agent, Point target, vector<obstacle> &obstacles)
+static void calculate_path(const plan_context &ctx, Point agent, Point target, int keepout_step, Line &path)
 {
+   /* every temporary from here on lives in this thread's scratch arena, only the final path is copied out */
+   scratch_scope scratch(&ctx.scratch);
+
    /* check how many obstacles are intersecting */
-   Line straight_path = {Point(agent.x(), agent.y()), Point(target.x(), target.y())};
-   vector<obstacle> intersecting = get_intersecting_obstacles(straight_path, obstacles);
+   ScratchLine straight_path = {Point(agent.x(), agent.y()), Point(target.x(), target.y())};
+   scratch_vector<obstacle> intersecting = get_intersecting_obstacles(straight_path, ctx.index);
 
    /**
     * Easy case: a straight line to the target will always be the
     * best bid for a particular agent if it is avaialable
     */
    if (intersecting.empty() &&
-       is_path_in_bounds(straight_path, bounds))
+       is_path_in_bounds(straight_path, ctx.bounds))
    {
-      cout << "\t\t\tpath will be straight line" << endl;
+      LP_LOG_DEBUG("path will be straight line");
       // return the straight path
-      return straight_path;
+      path.assign(straight_path.begin(), straight_path.end());
    }
    /**
     * Hard case: if even one obstacle intersects the path, 
@@ -469,22 +2146,33 @@ static Line calculate_path(Boundary &bounds, Point agent, Point target, vector<o
     */
    else if (!intersecting.empty())
    {
-      cout << "\t\t\tpath will be convex hull" << endl;
+      if (ctx.config.engine == path_engine::TANGENT)
+      {
+         LP_LOG_DEBUG("path will be tangent hull");
+         Line curved_path = get_shorter_tangent_path(ctx, straight_path, keepout_step);
+         if (!curved_path.empty())
+         {
+            path = simplify_path(ctx, curved_path);
+            return;
+         }
+         LP_LOG_DEBUG("no tangent hull - falling back to convex hull");
+      }
+      LP_LOG_DEBUG("path will be convex hull");
       /* Attempt clockwise object-avoiding path */
-      Line curved_path = get_obstacle_avoid_path(straight_path, obstacles, true);
+      Line curved_path = get_obstacle_avoid_path(ctx, straight_path, true, keepout_step);
       // confession- after messing with this, I am not certain clockwise_arg is truly clockwise
-      if (!is_path_in_bounds(curved_path, bounds))
+      if (!is_path_in_bounds(curved_path, ctx.bounds))
       {
-         cout << "\t\t\t\tWARNING: clockwise path is OOB - trying counterclockwise" << endl;
+         LP_LOG_WARNING("clockwise path is OOB - trying counterclockwise");
          /* first try was out of bounds, reverse path and try again  */
-         curved_path = get_obstacle_avoid_path(straight_path, obstacles, false);
-         if (!is_path_in_bounds(curved_path, bounds))
+         curved_path = get_obstacle_avoid_path(ctx, straight_path, false, keepout_step);
+         if (!is_path_in_bounds(curved_path, ctx.bounds))
          {
             throw runtime_error("ERROR: Agent reports no way around obstacle");
          }
       }
-      // return the curved path
-      return curved_path;
+      // return the curved path, with the points it can do without dropped
+      path = simplify_path(ctx, curved_path);
    }
    else
    {
@@ -494,111 +2182,300 @@ static Line calculate_path(Boundary &bounds, Point agent, Point target, vector<o
 }
 
 /**
- * @brief test whether two paths intersect
- * @param p1 one pathfinding_result, from which path will be obtained
- * @param p2 another pathfinding_result, from which path will be obtained
- * @return true if p1.path and p2.path intersect, else false
+ * @brief drop the points of a curved path that it can do without, Douglas-Peucker bounded by clearance
+ * A run of points is replaced by the straight shortcut between its ends when every point lies within
+ * simplify_tolerance of the shortcut and the shortcut stays min_keepout_buffer clear of every obstacle,
+ * otherwise the run is split at its farthest point and each half is tried on its own.
+ * A shortcut lies inside the hull of the points it replaces, so a path in bounds stays in bounds
+ * @param ctx plan_context of this plan, for obstacles and tunables, counts the dropped points in ctx.points_simplified
+ * @param path curved path from agent to target
+ * @return path with the same first and last points, path itself if simplify_tolerance is 0
  */
-static bool is_path_crossing(pathfind_result p1, pathfind_result p2)
+static Line simplify_path(const plan_context &ctx, const Line &path)
 {
-   return bg::intersects(p1.path, p2.path);
+   const double tolerance = ctx.config.simplify_tolerance;
+   const double clearance = ctx.config.min_keepout_buffer;
+   if (!(tolerance > 0) || path.size() < 3)
+   {
+      return path;
+   }
+
+   /* a shortcut never leaves the envelope of the path, so only obstacles that reach within clearance of it matter */
+   double min_x = DBL_MAX, min_y = DBL_MAX, max_x = -DBL_MAX, max_y = -DBL_MAX;
+   for (auto &p : path)
+   {
+      min_x = min(min_x, p.x());
+      min_y = min(min_y, p.y());
+      max_x = max(max_x, p.x());
+      max_y = max(max_y, p.y());
+   }
+   Boundary envelope(Point(min_x - clearance, min_y - clearance), Point(max_x + clearance, max_y + clearance));
+   scratch_vector<size_t> nearby = query_box_hits(ctx.index, envelope);
+   auto is_clear = [&](const Point &a, const Point &b)
+   {
+      for (size_t idx : nearby)
+      {
+         const obstacle &o = ctx.index.obstacles[idx];
+         double reach = o.radius + clearance;
+         if (point_segment_distance_sq(o.p, a, b) < reach * reach)
+         {
+            return false;
+         }
+      }
+      return true;
+   };
+
+   scratch_vector<char> is_kept(path.size(), 0);
+   is_kept.front() = 1;
+   is_kept.back() = 1;
+   scratch_vector<pair<size_t, size_t>> runs = {{0, path.size() - 1}};
+   while (!runs.empty())
+   {
+      auto [first, last] = runs.back();
+      runs.pop_back();
+      if (last - first < 2)
+      {
+         continue;
+      }
+      size_t farthest = first + 1;
+      double farthest_distance_sq = 0;
+      for (size_t k = first + 1; k < last; k++)
+      {
+         double distance_sq = point_segment_distance_sq(path[k], path[first], path[last]);
+         if (distance_sq > farthest_distance_sq)
+         {
+            farthest_distance_sq = distance_sq;
+            farthest = k;
+         }
+      }
+      if (farthest_distance_sq <= tolerance * tolerance && is_clear(path[first], path[last]))
+      {
+         continue;
+      }
+      is_kept[farthest] = 1;
+      runs.push_back({first, farthest});
+      runs.push_back({farthest, last});
+   }
+
+   Line simplified;
+   for (size_t k = 0; k < path.size(); k++)
+   {
+      if (is_kept[k])
+      {
+         simplified.push_back(path[k]);
+      }
+   }
+   ctx.points_simplified += path.size() - simplified.size();
+   return simplified;
+}
+
+/**
+ * @brief path of a selected pair for a single serial caller
+ * Returns the path in ctx.cache if use_cached and the pair already holds its keepout steps, or needs none.
+ * Otherwise the pair reserves keepout steps of its own and the path is built with them, unless the cached one
+ * was built with those same steps. A bid pruned while bidding is built here for the first time
+ * @param ctx plan_context of this plan
+ * @param agent agent that must route to target
+ * @param target target to be routed to
+ * @param use_cached false to release the steps the pair holds and build it with fresh ones, even if a path is cached
+ * @param path overwritten with a straight or curved path from agent to target
+ */
+static void recalculate_path(plan_context &ctx, Point agent, Point target, bool use_cached, Line &path)
+{
+   int num_steps = count_keepout_steps(ctx, agent, target);
+   if (!ctx.config.use_path_cache)
+   {
+      calculate_path(ctx, agent, target, reserve_keepout_steps(ctx, agent, target), path);
+      return;
+   }
+
+   cached_path *hit = use_cached ? path_cache_find(ctx.cache, agent, target) : nullptr;
+   if (hit != nullptr && hit->is_built && (num_steps == 0 || hit->num_keepout_steps > 0))
+   {
+      path.assign(hit->path.begin(), hit->path.end());
+      return;
+   }
+   cached_path &entry = (hit != nullptr) ? *hit : path_cache_insert(ctx.cache, agent, target);
+   // the new steps are reserved while the pair still holds its old ones, so a forced rebuild never gets them back
+   int keepout_step = reserve_keepout_steps(ctx, agent, target);
+   release_keepout_steps(ctx, agent, target, entry);
+   if (hit != nullptr && hit->is_built && hit->keepout_step == keepout_step)
+   {
+      path.assign(hit->path.begin(), hit->path.end());
+   }
+   else
+   {
+      calculate_path(ctx, agent, target, keepout_step, path);
+      entry.path.assign(path.begin(), path.end());
+      entry.length = bg::length(path);
+   }
+   entry.keepout_step = keepout_step;
+   entry.num_keepout_steps = num_steps;
+   entry.is_built = true;
 }
 
 /**
- * @brief Test whether any point in a path ever leaves the boundary
- * @param path path under test
- * @param bounds outer boundary Box, all points along p should be inside this
- * @return true if path between {target,agent} never leaves the boundary, else false
+ * @brief release the keepout steps of a result's pair before an uncrossing swap or a replan gives its agent away
+ * The cached path stays, built with the steps it had, so selecting the pair again only rebuilds it if those steps were taken.
+ * Without config.use_path_cache the steps stay held until the plan ends
+ * @param ctx plan_context of this plan
+ * @param result result about to lose its agent
  */
-static bool is_path_in_bounds(Line path, Boundary bounds)
+static void unselect_path(plan_context &ctx, const pathfind_result &result)
 {
-   bool retval = true;
-   for (auto point : path)
+   if (!ctx.config.use_path_cache)
    {
-      if (!is_point_in_bounds(point, bounds))
-      {
-         retval = false;
-      }
+      return;
+   }
+   cached_path *entry = path_cache_find(ctx.cache, result.agent, result.target);
+   if (entry != nullptr)
+   {
+      release_keepout_steps(ctx, result.agent, result.target, *entry);
+      entry->num_keepout_steps = 0;
    }
-   return retval;
 }
 
 /**
- * @brief test whether a point is in bounds
- * @param p point under test
- * @param bounds outer boundary Box point p should be inside this
- * @return true if path never leaves the boundary, else false
+ * @brief test whether two paths intersect
+ * Two straight paths are tested as segments, which gives the same answer without the linestring machinery's allocations
+ * @param p1 one pathfinding_result, from which path will be obtained
+ * @param p2 another pathfinding_result, from which path will be obtained
+ * @return true if p1.path and p2.path intersect, else false
  */
-static bool is_point_in_bounds(Point p, Boundary bounds)
+static bool is_path_crossing(const pathfind_result &p1, const pathfind_result &p2)
 {
-   return bg::covered_by(p, bounds);
+   if (p1.path.size() == 2 && p2.path.size() == 2)
+   {
+      return bg::intersects(Segment(p1.path[0], p1.path[1]), Segment(p2.path[0], p2.path[1]));
+   }
+   return bg::intersects(p1.path, p2.path);
 }
 
 /**
  * @brief Test whether a provided path crosses one or more obstacles
- * @param path Line from target to agent to check for obstacles
- * @param obstacles A vector of circular obstacles
- * @return vector of intersecting obstacles, empty if no intersection
+ * The R-tree narrows the search to blocks of obstacles whose bounding box touches a segment of the path
+ * @param path points of the path from agent to target to check for obstacles
+ * @param index obstacle_index of circular obstacles
+ * @return intersecting obstacles in their original order on the scratch arena, empty if no intersection
  */
-static vector<obstacle> get_intersecting_obstacles(Line path, vector<obstacle> obstacles)
+static scratch_vector<obstacle> get_intersecting_obstacles(span<const Point> path, const obstacle_index &index)
 {
-   vector<obstacle> intersecting = {};
+   scratch_vector<obstacle> intersecting;
 
-   // Check whether any obstacle intersects with this segment
-   for (auto obs : obstacles)
+   /**
+    * rather than tessellating the circle and running a polygon predicate,
+    * each block of obstacles near a segment compares every closest approach to the center against the radius at once
+    */
+   for (size_t idx : query_path_hits(index, path))
    {
-      MultiPolygon result = circle_from_obstacle(obs);
-      /**
-       * rather than check whether every point or n-many points along the line
-       * is within a particular radius, we instead create a circle as a keepout buffer around a point
-       * and then use the boost::geometry intersection checker
-       */
-      if (bg::intersects(path, result))
-      {
-         intersecting.push_back(obs);
-      }
+      intersecting.push_back(index.obstacles[idx]);
    }
    return intersecting;
 }
 
 void print_result(Boundary &bounds, vector<obstacle> &obstacles, vector<pathfind_result> &results)
 {
-   /**
-    * The associated python rendering script render_result.py is designed to ignore blank lines 
-    * and lines that begin with tab so that output from this library can be read 
-    * for diagnostic information or simply piped to a .csv to render with the python script
-    */
+   print_result(cout, bounds, obstacles, results);
+}
+
+void path_buffer_clear(path_buffer &buffer)
+{
+   buffer.ids.clear();
+   buffer.agents.clear();
+   buffer.targets.clear();
+   buffer.offsets.assign(1, 0);
+   buffer.points.clear();
+}
+
+void path_buffer_append(path_buffer &buffer, const pathfind_result &result)
+{
+   buffer.ids.push_back(result.id);
+   buffer.agents.push_back(result.agent);
+   buffer.targets.push_back(result.target);
+   buffer.points.insert(buffer.points.end(), result.path.begin(), result.path.end());
+   buffer.offsets.push_back(buffer.points.size());
+}
 
+/**
+ * @brief CSV header and outer boundary rows of print_result()
+ * The associated python rendering script render_result.py is designed to ignore blank lines
+ * and lines that begin with tab so that output from this library can be read
+ * for diagnostic information or simply piped to a .csv to render with the python script
+ * @param out stream to write to
+ * @param bounds Outer boundary Box
+ */
+static void print_result_header(ostream &out, const Boundary &bounds)
+{
    // print CSV Header
-   cout << endl;
-   cout << "type,node_idx,agent_x,agent_y,target_x,target_y,";
-   cout << "path,";
-   cout << "obstacle_x,obstacle_y,obstacle_rad,";
-   cout << "boundary_x0,boundary_x1,boundary_y0,boundary_y1";
-   cout << endl;
+   out << "\n";
+   out << "type,node_idx,agent_x,agent_y,target_x,target_y,";
+   out << "path,";
+   out << "obstacle_x,obstacle_y,obstacle_rad,";
+   out << "boundary_x0,boundary_x1,boundary_y0,boundary_y1";
+   out << "\n";
 
    // print outer boundary
    double x_0 = bg::get<bg::min_corner, 0>(bounds);
    double x_1 = bg::get<bg::max_corner, 0>(bounds);
    double y_0 = bg::get<bg::min_corner, 1>(bounds);
    double y_1 = bg::get<bg::max_corner, 1>(bounds);
-   cout << "2," << ",,,,,,,,," << x_0 << "," << x_1 << "," << y_0 << "," << y_1 << endl;
+   out << "2," << ",,,,,,,,," << x_0 << "," << x_1 << "," << y_0 << "," << y_1 << "\n";
+}
+
+/**
+ * @brief obstacle rows of print_result(), then flush
+ * @param out stream to write to
+ * @param obstacles all obstacles
+ */
+static void print_result_obstacles(ostream &out, span<const obstacle> obstacles)
+{
+   // print obstacles
+   for (auto &obs : obstacles)
+   {
+      out << "3," << ",,,,,,";
+      out << obs.p.x() << "," << obs.p.y() << "," << obs.radius;
+      out << ",,,," << "\n";
+   }
+   out.flush();
+}
+
+void print_result(ostream &out, const Boundary &bounds, const vector<obstacle> &obstacles, const vector<pathfind_result> &results)
+{
+   print_result_header(out, bounds);
 
    // print pathfinding vectors
-   for (auto result : results)
+   for (auto &result : results)
    {
-      cout << "1," << result.id << ",";
-      cout << result.agent.x() << "," << result.agent.y() << ",";
-      cout << result.target.x() << "," << result.target.y() << ",";
-      cout << "\"" << LP_PRINT_GEOM(result.path) << "\",";
-      cout << ",,,," << endl;
+      out << "1," << result.id << ",";
+      out << result.agent.x() << "," << result.agent.y() << ",";
+      out << result.target.x() << "," << result.target.y() << ",";
+      out << "\"" << LP_PRINT_GEOM(result.path) << "\",";
+      out << ",,,," << "\n";
    }
 
-   // print obstacles
-   for (auto obs : obstacles)
+   print_result_obstacles(out, obstacles);
+}
+
+void print_result(ostream &out, const Boundary &bounds, span<const obstacle> obstacles, const path_buffer &results)
+{
+   print_result_header(out, bounds);
+
+   // print pathfinding vectors, paths written the way LP_PRINT_GEOM writes a Line
+   for (size_t i = 0; i < path_buffer_size(results); i++)
    {
-      cout << "3," << ",,,,,,";
-      cout << obs.p.x() << "," << obs.p.y() << "," << obs.radius;
-      cout << ",,,," << endl;
+      out << "1," << results.ids[i] << ",";
+      out << results.agents[i].x() << "," << results.agents[i].y() << ",";
+      out << results.targets[i].x() << "," << results.targets[i].y() << ",";
+      out << "\"[";
+      const char *separator = "";
+      for (auto &p : path_buffer_path(results, i))
+      {
+         out << separator << "(" << p.x() << "," << p.y() << ")";
+         separator = ",";
+      }
+      out << "]\",";
+      out << ",,,," << "\n";
    }
+
+   print_result_obstacles(out, obstacles);
 }
@@ -8,6 +8,11 @@
 #define __PATHFINDING_HPP_
 
 #include <vector>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <utility>
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/point_xy.hpp>
 
@@ -32,7 +37,58 @@ using MultiPolygon = bg::model::multi_polygon<Polygon>; ///< alias for boost.geo
  */
 #define LP_PRINT_GEOM(x) bg::dsv(x, ",","(",")",",","[","]",",")
 
-const int NUM_MAX_AGENTS = 4; ///< max number of agents allowed per the prompt
+const int NUM_MAX_AGENTS = 4; ///< default max number of agents, see pathfind_config::max_agents
+const size_t DEFAULT_MAX_UNCROSS_SWAPS = 10000; ///< default cap on swaps while resolving crossed paths
+
+class thread_pool;
+
+/**
+ * strategy pathfind() uses to pair agents with targets
+ */
+enum class assignment_mode
+{
+   GREEDY,  ///< each target in insertion order takes the shortest bid among remaining agents
+   OPTIMAL, ///< build the full target x agent cost matrix once, solve for minimum total path length
+};
+
+/**
+ * geometry calculate_path() uses to route around obstacles on the straight path
+ */
+enum class path_engine
+{
+   HULL,    ///< tessellate and buffer the obstacles, union them with the stroked path and walk the convex hull
+   TANGENT, ///< walk the exact hull of the circles, tangent segments plus arcs sampled to arc_tolerance (see tangent_path.hpp)
+};
+
+/**
+ * how the obstacle index stores obstacles for its batched intersection tests (see obstacle_soa.hpp)
+ */
+enum class coordinate_mode
+{
+   DOUBLE,  ///< float64 centers and radii, tested exactly
+   FLOAT32, ///< kernel lanes hold float32 offsets from a local origin, lanes too close to call are retested in double
+};
+
+/**
+ * runtime options for pathfind()
+ */
+struct pathfind_config
+{
+   assignment_mode assignment = assignment_mode::GREEDY; ///< how agents are assigned to targets
+   size_t max_agents = NUM_MAX_AGENTS; ///< reject inputs with more agents than this
+   int points_per_circle = 16; ///< number of points around tessellated circles and round buffer joins
+   double max_chord_error = 0; ///< path_engine::HULL only, > 0 picks the points of each circle from its radius instead, see chord_error_points()
+   double line_buffer_distance = 0.1; ///< relatively small "stroke-width" to turn lines to polygons
+   double simplify_tolerance = 0; ///< > 0 drops curved path points that lie within this distance of a shortcut, see simplify_path()
+   double min_keepout_buffer = 0.05; ///< extra keepout per step, each subsequent wrap around an obstacle goes one step wider
+   size_t max_uncross_swaps = DEFAULT_MAX_UNCROSS_SWAPS; ///< give up with std::runtime_error after this many crossing swaps
+   thread_pool *pool = nullptr; ///< optional persistent pool to compute bids on (see thread_pool.hpp), nullptr bids serially
+   bool use_path_cache = true; ///< compute each {agent, target} path once per plan and reuse it while uncrossing
+   bool prune_bids = true; ///< assignment_mode::GREEDY only, skip building bids whose straight-line distance can't beat the best bid so far
+   path_engine engine = path_engine::HULL; ///< how curved paths are built
+   double arc_tolerance = 0.01; ///< path_engine::TANGENT only, largest gap between a sampled arc and its keepout circle
+   coordinate_mode coordinates = coordinate_mode::DOUBLE; ///< obstacle storage, results are the same either way
+};
 
 /**
  *  a circular "obstacle" with center and radius
@@ -67,6 +123,86 @@ struct pathfind_result
    Line path; ///< path that accepted agent bid
 };
 
+/**
+ * Flat, reusable output of Planner::plan_into()
+ * The path of result i is points[offsets[i]] up to points[offsets[i + 1]], every path is stored back to back.
+ * Clearing keeps capacity, so a buffer reused across plans of a similar size stops allocating after the first
+ */
+struct path_buffer
+{
+   std::vector<int> ids; ///< pathfind_result::id of each result
+   std::vector<Point> agents; ///< selected agent of each result
+   std::vector<Point> targets; ///< target of each result
+   std::vector<size_t> offsets = {0}; ///< start of each result's path in points, then the end of the last one
+   std::vector<Point> points; ///< every path point, result by result
+};
+
+/**
+ * @brief empty a path_buffer, keeping its capacity
+ * @param buffer path_buffer to clear
+ */
+void path_buffer_clear(path_buffer &buffer);
+
+/**
+ * @brief copy one result onto the end of a path_buffer
+ * @param buffer path_buffer to append to
+ * @param result result to copy
+ */
+void path_buffer_append(path_buffer &buffer, const pathfind_result &result);
+
+/**
+ * @brief number of results in a path_buffer
+ * @param buffer path_buffer to count
+ * @return number of results
+ */
+inline size_t path_buffer_size(const path_buffer &buffer)
+{
+   return buffer.ids.size();
+}
+
+/**
+ * @brief path of one result, a view into the buffer
+ * @param buffer path_buffer holding the result
+ * @param i result index, must be < path_buffer_size()
+ * @return points of the path, valid until the buffer is next changed
+ */
+inline std::span<const Point> path_buffer_path(const path_buffer &buffer, size_t i)
+{
+   return std::span<const Point>(buffer.points).subspan(buffer.offsets[i], buffer.offsets[i + 1] - buffer.offsets[i]);
+}
+
+/**
+ * Wall-clock breakdown of a single Planner::plan() call, filled in when a caller asks for it
+ */
+struct plan_stats
+{
+   double validate_seconds = 0; ///< indexing obstacles and validating inputs
+   double bid_seconds = 0; ///< computing bids and assigning agents to targets
+   double uncross_seconds = 0; ///< resolving crossed paths
+   size_t num_bids = 0; ///< number of {target, agent} paths computed while bidding
+   size_t bids_pruned = 0; ///< bids skipped by pathfind_config::prune_bids
+   size_t curves_pruned = 0; ///< skipped bids whose straight path hit an obstacle, i.e. curve constructions saved
+   size_t num_swaps = 0; ///< number of agent swaps made while resolving crossed paths
+   size_t cache_hits = 0; ///< path lookups answered from the per-plan path cache
+   size_t cache_misses = 0; ///< path lookups that had to compute a new path
+   size_t scratch_peak_bytes = 0; ///< most scratch memory any one path used, see scratch_arena.hpp
+   size_t scratch_spills = 0; ///< paths whose scratch memory outgrew their thread's arena
+   size_t keepout_vertices = 0; ///< points of every keepout circle path_engine::HULL tessellated
+   size_t points_simplified = 0; ///< curved path points dropped by pathfind_config::simplify_tolerance
+   size_t targets_rebid = 0; ///< Replanner only, targets whose assignment was reopened and bid on again
+   size_t paths_invalidated = 0; ///< Replanner only, cached paths dropped because the change touched them
+};
+
+/**
+ * Output of Planner::plan() with a deadline
+ */
+struct anytime_plan
+{
+   std::vector<pathfind_result> results; ///< best plan found by the deadline, one result per served target
+   bool converged = false; ///< planning finished in time and results are exactly what plan() without a deadline returns
+   size_t unrouted_paths = 0; ///< results still holding the straight agent-to-target line, not yet routed around obstacles
+};
+
 /**
  * @brief Print the entire state to STDOUT, can be piped into a *.csv file and rendered by render_result.py
  * @param bounds Outer boundary Box
@@ -75,17 +211,38 @@ struct pathfind_result
  */
 void print_result(Boundary &bounds, std::vector<obstacle>& obstacles, std::vector<pathfind_result>& results);
 
+/**
+ * @brief Same CSV as print_result() above, written to any ostream
+ * @param out stream to write to
+ * @param bounds Outer boundary Box
+ * @param obstacles Vector of obstacles
+ * @param results Vector of pathfind_results
+ */
+void print_result(std::ostream &out, const Boundary &bounds, const std::vector<obstacle>& obstacles, const std::vector<pathfind_result>& results);
+
+/**
+ * @brief Same CSV as print_result() above, for the flat results of Planner::plan_into()
+ * @param out stream to write to
+ * @param bounds Outer boundary Box
+ * @param obstacles all obstacles
+ * @param results results as written by plan_into()
+ */
+void print_result(std::ostream &out, const Boundary &bounds, std::span<const obstacle> obstacles, const path_buffer &results);
+
 /**
  * @brief given boundaries, some agents, and some targets, select paths from agent to target
- * Throws std::runtime_error if a target is unreachable by any agent
+ * Wrapper over Planner(config).plan() that also erases assigned agents from agents
+ * Throws std::runtime_error if a target is unreachable by any agent, or crossed paths can't be resolved within config.max_uncross_swaps
  * Throws std::invalid_argument if there is a problem with the input parameters
  * @param bounds boundary Box struct
  * @param agents vector of all agents (represented by Point) to bid upon targets
  * @param targets vector of all targets (represented by Point) to be bid upon
  * @param obstacles vector of all circular obstacles
+ * @param config runtime options such as assignment mode and agent limit, see pathfind_config
  * @return vector of pathfind_results, algorithm is complete
  */
-std::vector<pathfind_result> pathfind(Boundary &bounds, std::vector<Point>& agents, std::vector<Point>& targets, std::vector<obstacle>& obstacles);
+std::vector<pathfind_result> pathfind(Boundary &bounds, std::vector<Point>& agents, std::vector<Point>& targets, std::vector<obstacle>& obstacles,
+                                      const pathfind_config &config = pathfind_config());
 
 /**
  * @brief ensure that the input params are valid- pathfind() will call this and should not proceed if it fails
@@ -93,8 +250,257 @@ std::vector<pathfind_result> pathfind(Boundary &bounds, std::vector<Point>& agen
  * @param agents provided vector of agents
  * @param targets provided vector of targets
  * @param obstacles provided vector of obstacles
+ * @param max_agents largest number of agents to accept
  * @return true if all inputs are acceptable, else false
  */
-bool is_valid_input_params(Boundary &bounds, std::vector<Point>& agents, std::vector<Point>& targets, std::vector<obstacle>& obstacles);
+bool is_valid_input_params(Boundary &bounds, std::vector<Point>& agents, std::vector<Point>& targets, std::vector<obstacle>& obstacles,
+                           size_t max_agents = NUM_MAX_AGENTS);
+
+struct obstacle_index;
+struct plan_scratch;
+
+/**
+ * Storage that Planner::plan_into() reuses from one plan to the next: the obstacle index, path cache,
+ * bids and uncrossing state of a plan. Keep one per planning thread, next to its path_buffer.
+ * Not thread-safe, one plan at a time
+ */
+class plan_workspace
+{
+public:
+   plan_workspace();
+   ~plan_workspace();
+   plan_workspace(const plan_workspace &) = delete;
+   plan_workspace &operator=(const plan_workspace &) = delete;
+
+private:
+   friend class Planner;
+   std::unique_ptr<plan_scratch> scratch; ///< the storage, see pathfinding.cpp
+};
+
+/**
+ * Reentrant planner that owns its tunables
+ * plan() keeps all per-plan scratch state (obstacle index, keepout steps) on its own stack,
+ * so one Planner can serve many concurrent plans and the same inputs always give the same result
+ */
+class Planner
+{
+public:
+   /**
+    * @brief create a planner
+    * @param config tunables and options used by every plan, see pathfind_config
+    */
+   explicit Planner(const pathfind_config &config = pathfind_config());
+
+   /**
+    * @brief given boundaries, some agents, and some targets, select paths from agent to target
+    * Deterministic and thread-safe, inputs are not modified
+    * Throws std::runtime_error if a target is unreachable by any agent, or crossed paths can't be resolved within max_uncross_swaps
+    * Throws std::invalid_argument if there is a problem with the input parameters
+    * @param bounds boundary Box struct
+    * @param agents all agents (represented by Point) to bid upon targets
+    * @param targets all targets (represented by Point) to be bid upon
+    * @param obstacles all circular obstacles
+    * @param stats optional output, per-phase timings and counters of this plan
+    * @return vector of pathfind_results
+    */
+   std::vector<pathfind_result> plan(const Boundary &bounds, const std::vector<Point> &agents, const std::vector<Point> &targets,
+                                     const std::vector<obstacle> &obstacles, plan_stats *stats = nullptr) const;
+
+   /**
+    * @brief anytime plan() that returns by a deadline with the best plan found so far
+    * A first assignment takes each target's nearest remaining agent by straight-line distance and routes those paths.
+    * Time left then goes to the full plan() bidding and uncrossing, reusing every path already routed.
+    * If the deadline passes while bidding, the first assignment is returned. Past that, the full assignment is
+    * returned with whatever crossings the deadline left unresolved. The deadline is checked between paths,
+    * so one path that is being routed when it passes still finishes
+    * Throws std::invalid_argument if there is a problem with the input parameters, and std::runtime_error like plan()
+    * if a routed path has no way around an obstacle
+    * @param bounds boundary Box struct
+    * @param agents all agents (represented by Point) to bid upon targets
+    * @param targets all targets (represented by Point) to be bid upon
+    * @param obstacles all circular obstacles
+    * @param deadline when to stop improving the plan and return
+    * @param stats optional output, per-phase timings and counters of this plan
+    * @return results, and whether planning converged before the deadline
+    */
+   anytime_plan plan(const Boundary &bounds, const std::vector<Point> &agents, const std::vector<Point> &targets,
+                     const std::vector<obstacle> &obstacles, std::chrono::steady_clock::time_point deadline, plan_stats *stats = nullptr) const;
+
+   /**
+    * @brief same plan as plan() above, written straight into a caller-owned buffer, with its scratch in a caller-owned workspace
+    * The obstacles are indexed into workspace, and indexed again only when a later plan passes different ones.
+    * The path cache, bids, results and uncrossing state of the plan live in workspace too, and every container keeps its
+    * capacity for the next plan. So a plan the workspace and results have already grown to fit, such as a repeat of an
+    * earlier plan, makes no heap allocations when its paths are all straight lines, as long as pathfind_config::pool
+    * is nullptr and nothing is logged. Building a curved path still allocates inside Boost.Geometry.
+    * Throws the same as plan(), results is left cleared if it does
+    * @param bounds boundary Box struct
+    * @param agents all agents (represented by Point) to bid upon targets
+    * @param targets all targets (represented by Point) to be bid upon
+    * @param obstacles all circular obstacles
+    * @param results output, cleared and then filled with one entry per pathfind_result plan() would return
+    * @param workspace scratch storage reused from plan to plan
+    * @param stats optional output, per-phase timings and counters of this plan
+    */
+   void plan_into(const Boundary &bounds, std::span<const Point> agents, std::span<const Point> targets, std::span<const obstacle> obstacles,
+                  path_buffer &results, plan_workspace &workspace, plan_stats *stats = nullptr) const;
+
+   /**
+    * @brief plan_into() against an obstacle map indexed once up front, see build_obstacle_index() in obstacle_index.hpp
+    * Skips indexing the obstacles on every plan when many plans share one map, with the same allocation behavior as above.
+    * The index keeps the coordinate_mode it was built with, pathfind_config::coordinates is not used
+    * @param bounds boundary Box struct
+    * @param agents all agents (represented by Point) to bid upon targets
+    * @param targets all targets (represented by Point) to be bid upon
+    * @param obstacles index of all circular obstacles, only read, so one index can serve concurrent plans
+    * @param results output, cleared and then filled with one entry per pathfind_result plan() would return
+    * @param workspace scratch storage reused from plan to plan, one per concurrent plan
+    * @param stats optional output, per-phase timings and counters of this plan
+    */
+   void plan_into(const Boundary &bounds, std::span<const Point> agents, std::span<const Point> targets, const obstacle_index &obstacles,
+                  path_buffer &results, plan_workspace &workspace, plan_stats *stats = nullptr) const;
+
+   /**
+    * @brief plan_into() above with a workspace of its own, which is allocated and freed on every call
+    * @param bounds boundary Box struct
+    * @param agents all agents (represented by Point) to bid upon targets
+    * @param targets all targets (represented by Point) to be bid upon
+    * @param obstacles all circular obstacles
+    * @param results output, cleared and then filled with one entry per pathfind_result plan() would return
+    * @param stats optional output, per-phase timings and counters of this plan
+    */
+   void plan_into(const Boundary &bounds, std::span<const Point> agents, std::span<const Point> targets, std::span<const obstacle> obstacles,
+                  path_buffer &results, plan_stats *stats = nullptr) const;
+
+   /**
+    * @brief plan_into() against a prebuilt obstacle index, with a workspace of its own allocated and freed on every call
+    * @param bounds boundary Box struct
+    * @param agents all agents (represented by Point) to bid upon targets
+    * @param targets all targets (represented by Point) to be bid upon
+    * @param obstacles index of all circular obstacles
+    * @param results output, cleared and then filled with one entry per pathfind_result plan() would return
+    * @param stats optional output, per-phase timings and counters of this plan
+    */
+   void plan_into(const Boundary &bounds, std::span<const Point> agents, std::span<const Point> targets, const obstacle_index &obstacles,
+                  path_buffer &results, plan_stats *stats = nullptr) const;
+
+   /**
+    * @brief the options this planner was created with
+    * @return pathfind_config of this planner
+    */
+   const pathfind_config &config() const { return settings; }
+
+private:
+   pathfind_config settings; ///< tunables, never modified by plan()
+};
+
+/**
+ * Changes between two ticks of a Replanner, applied in the order listed.
+ * Indices refer to the replanner's agents(), targets() and obstacles() before the change.
+ * Remaining targets and obstacles keep their order, added ones go on the end
+ */
+struct replan_delta
+{
+   std::vector<std::pair<size_t, Point>> moved_agents; ///< {agent index, new position}
+   std::vector<size_t> removed_targets; ///< indices of targets that are done or withdrawn
+   std::vector<Point> added_targets; ///< new targets, served after every existing one
+   std::vector<size_t> removed_obstacles; ///< indices of obstacles that went away
+   std::vector<obstacle> added_obstacles; ///< new obstacles
+};
+
+struct replan_state;
+
+/**
+ * Stateful planner for a world that changes a little between ticks
+ * reset() plans from scratch, exactly like Planner::plan(). Each replan() then applies a replan_delta and repairs the
+ * previous plan instead of starting over:
+ * - a cached path is dropped only if its agent moved, its target was removed, or an added or removed obstacle
+ *   touches the straight line from its agent to its target, the only obstacles a path is built around
+ * - a target keeps its agent and path unless that path was dropped. Targets left without an agent bid again among
+ *   the agents nobody holds, bidding first from the agent they had, every bid found in the cache costs nothing
+ * - only the paths that changed are checked for crossings, every other pair was already checked last tick
+ * so a tick costs about as much as the change, not the fleet. Targets that kept their agent are not reconsidered,
+ * even if an agent freed or moved by the delta would now bid lower, so the plan can drift from what plan() would
+ * return for the same inputs. Call reset() to start over.
+ * Obstacle changes rebuild the obstacle index, which costs as much as indexing the map for a plan.
+ * Keepout steps of dropped paths are handed out again, so keepouts don't keep widening from tick to tick.
+ * Not thread-safe, one Replanner per planning loop
+ */
+class Replanner
+{
+public:
+   /**
+    * @brief create a replanner with nothing planned yet
+    * @param config tunables and options used by every plan, see pathfind_config. use_path_cache is always on
+    */
+   explicit Replanner(const pathfind_config &config = pathfind_config());
+   ~Replanner();
+   Replanner(const Replanner &) = delete;
+   Replanner &operator=(const Replanner &) = delete;
+
+   /**
+    * @brief forget the previous plan and plan from scratch, same results as Planner::plan()
+    * Throws the same as Planner::plan(), the replanner then holds no plan
+    * @param bounds boundary Box struct
+    * @param agents all agents (represented by Point) to bid upon targets
+    * @param targets all targets (represented by Point) to be bid upon
+    * @param obstacles all circular obstacles
+    * @param stats optional output, per-phase timings and counters of this plan
+    * @return one pathfind_result per served target, valid until the next reset() or replan()
+    */
+   const std::vector<pathfind_result> &reset(const Boundary &bounds, const std::vector<Point> &agents, const std::vector<Point> &targets,
+                                             const std::vector<obstacle> &obstacles, plan_stats *stats = nullptr);
+
+   /**
+    * @brief apply a change to the world and repair the previous plan
+    * Throws std::invalid_argument, leaving the previous plan in place, if an index is out of range or the changed world
+    * fails the checks of Planner::plan(). Throws std::runtime_error if called before reset(), or like Planner::plan()
+    * if a path has no way around an obstacle or crossings can't be resolved, the replanner then holds no plan
+    * @param delta agents moved, targets and obstacles added or removed since the last tick
+    * @param stats optional output, per-phase timings and counters of this tick
+    * @return one pathfind_result per served target, valid until the next reset() or replan()
+    */
+   const std::vector<pathfind_result> &replan(const replan_delta &delta, plan_stats *stats = nullptr);
+
+   /**
+    * @brief whether reset() has planned and no replan() has thrown since
+    * @return true if results() holds a plan
+    */
+   bool has_plan() const { return state != nullptr; }
+
+   /**
+    * @brief results of the latest reset() or replan(), ids are indices into targets()
+    * @return one pathfind_result per served target, empty without a plan
+    */
+   const std::vector<pathfind_result> &results() const;
+
+   /**
+    * @brief agents as of the latest tick
+    * @return every agent, empty without a plan
+    */
+   const std::vector<Point> &agents() const;
+
+   /**
+    * @brief targets as of the latest tick, removed ones are gone and later ones moved down
+    * @return every target, empty without a plan
+    */
+   const std::vector<Point> &targets() const;
+
+   /**
+    * @brief obstacles as of the latest tick, removed ones are gone and later ones moved down
+    * @return every obstacle, empty without a plan
+    */
+   const std::vector<obstacle> &obstacles() const;
+
+   /**
+    * @brief the options this replanner was created with
+    * @return pathfind_config of this replanner
+    */
+   const pathfind_config &config() const { return settings; }
+
+private:
+   pathfind_config settings; ///< tunables, with use_path_cache forced on
+   std::unique_ptr<replan_state> state; ///< world and plan of the latest tick, nullptr without a plan
+};
 
 #endif  // __PATHFINDING_HPP
@@ -0,0 +1,13 @@
+/**
+ * @file pathfinding_core.cpp
+ * @brief The instantiations of pathfinding_core.hpp that libpathfinding.so ships
+ *
+ * pathfinding.cpp turns pathfind_config::points_per_circle into one of these counts, any other count is tessellated at runtime
+ */
+
+#include "pathfinding_core.hpp"
+
+template struct unit_circle<8>;
+template struct unit_circle<16>;
+template struct unit_circle<32>;
+template struct unit_circle<64>;
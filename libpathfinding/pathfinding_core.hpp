@@ -0,0 +1,170 @@
+/**
+ * @file pathfinding_core.hpp
+ * @brief Header-only geometry core of the planner, templated on coordinate scalar and circle tessellation count
+ *
+ * Everything here is inline and depends only on its template parameters. With a compile-time tessellation count
+ * the circle loop has a constant trip count and reads its angles from a table built once per count, and the
+ * bounds tests inline into their callers. libpathfinding.so is a thin instantiation of this core for double at
+ * the counts in pathfinding_core.cpp, and pathfinding.cpp dispatches pathfind_config::points_per_circle to those;
+ * any other program can include this header and instantiate it for its own scalar and count.
+ */
+#ifndef __PATHFINDING_CORE_HPP_
+#define __PATHFINDING_CORE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <boost/geometry.hpp>
+#include <boost/geometry/geometries/point_xy.hpp>
+
+namespace bg = boost::geometry;
+
+const int DYNAMIC_POINTS_PER_CIRCLE = 0; ///< tessellation count given at runtime instead of as a template argument
+const int MIN_ADAPTIVE_POINTS_PER_CIRCLE = 6; ///< fewest points chord_error_points() gives any circle
+const int MAX_ADAPTIVE_POINTS_PER_CIRCLE = 256; ///< most points chord_error_points() gives any circle
+
+/**
+ * boost.geometry types of the planner for one coordinate scalar
+ * geometry_types<double> gives exactly Point, Boundary, Line, Polygon and MultiPolygon of pathfinding.hpp
+ */
+template <typename Scalar>
+struct geometry_types
+{
+   using point = bg::model::d2::point_xy<Scalar>; ///< a position
+   using box = bg::model::box<point>; ///< axis-aligned boundary
+   using line = bg::model::linestring<point>; ///< a path
+   using polygon = bg::model::polygon<point>; ///< a tessellated circle
+   using multi_polygon = bg::model::multi_polygon<polygon>; ///< union of tessellated circles
+};
+
+/**
+ * cos and sin of every vertex angle of a circle tessellated into PointsPerCircle points
+ * Angles run clockwise from 0, accumulated exactly as bg::strategy::buffer::point_circle does,
+ * so circles built from the table are bit-for-bit the ones bg::buffer builds
+ */
+template <int PointsPerCircle>
+struct unit_circle
+{
+   static_assert(PointsPerCircle >= 3, "a circle needs at least three points");
+
+   std::array<double, PointsPerCircle> cos_a; ///< cos of each vertex angle
+   std::array<double, PointsPerCircle> sin_a; ///< sin of each vertex angle
+
+   unit_circle()
+   {
+      const double diff = bg::math::two_pi<double>() / PointsPerCircle;
+      double a = 0;
+      for (int i = 0; i < PointsPerCircle; i++, a -= diff)
+      {
+         cos_a[i] = std::cos(a);
+         sin_a[i] = std::sin(a);
+      }
+   }
+
+   /**
+    * @brief the table for this count, built on first use
+    * @return shared, immutable table
+    */
+   static const unit_circle &get()
+   {
+      static const unit_circle table;
+      return table;
+   }
+};
+
+/**
+ * @brief tessellate a circle into a closed clockwise polygon, the same polygon bg::buffer gives with a point_circle strategy
+ * PolygonType may be any clockwise closed polygon of geometry_types<Scalar>::point, such as one with another allocator
+ * @param center circle center
+ * @param radius circle radius
+ * @param points_per_circle tessellation count, only read when PointsPerCircle is DYNAMIC_POINTS_PER_CIRCLE (values below 3 mean 3)
+ * @return polygon with the tessellation count of points, plus the closing point
+ */
+template <typename Scalar, int PointsPerCircle, typename PolygonType = typename geometry_types<Scalar>::polygon>
+inline PolygonType circle_polygon(const typename geometry_types<Scalar>::point &center, double radius, int points_per_circle = PointsPerCircle)
+{
+   using point = typename geometry_types<Scalar>::point;
+   PolygonType circle;
+   auto &ring = circle.outer();
+   if constexpr (PointsPerCircle == DYNAMIC_POINTS_PER_CIRCLE)
+   {
+      const int count = std::max(points_per_circle, 3);
+      const double diff = bg::math::two_pi<double>() / count;
+      double a = 0;
+      ring.reserve(count + 1);
+      for (int i = 0; i < count; i++, a -= diff)
+      {
+         ring.push_back(point(center.x() + radius * std::cos(a), center.y() + radius * std::sin(a)));
+      }
+   }
+   else
+   {
+      const unit_circle<PointsPerCircle> &table = unit_circle<PointsPerCircle>::get();
+      ring.reserve(PointsPerCircle + 1);
+      for (int i = 0; i < PointsPerCircle; i++)
+      {
+         ring.push_back(point(center.x() + radius * table.cos_a[i], center.y() + radius * table.sin_a[i]));
+      }
+   }
+   ring.push_back(ring.front());
+   return circle;
+}
+
+/**
+ * @brief fewest points for a circumscribed polygon that stays within max_error of its circle
+ * Edges of a circumscribed polygon touch the circle and its vertices stick out by radius * (1 / cos(pi / n) - 1),
+ * so n >= pi / acos(radius / (radius + max_error)). Small circles get few points, large ones as many as they need
+ * @param radius circle radius
+ * @param max_error largest distance any point of the polygon may lie outside the circle, must be > 0
+ * @return tessellation count, clamped to [MIN_ADAPTIVE_POINTS_PER_CIRCLE, MAX_ADAPTIVE_POINTS_PER_CIRCLE]
+ */
+inline int chord_error_points(double radius, double max_error)
+{
+   double count = std::ceil(bg::math::pi<double>() / std::acos(radius / (radius + max_error)));
+   return static_cast<int>(std::clamp(count, static_cast<double>(MIN_ADAPTIVE_POINTS_PER_CIRCLE), static_cast<double>(MAX_ADAPTIVE_POINTS_PER_CIRCLE)));
+}
+
+/**
+ * @brief radius to tessellate a circle at so the polygon's edges, not its vertices, touch the circle
+ * The polygon then covers the whole circle, a path around it keeps at least radius from the center
+ * @param radius circle radius
+ * @param points_per_circle tessellation count (values below 3 mean 3)
+ * @return vertex radius of the circumscribed polygon
+ */
+inline double circumscribed_radius(double radius, int points_per_circle)
+{
+   return radius / std::cos(bg::math::pi<double>() / std::max(points_per_circle, 3));
+}
+
+/**
+ * @brief test whether a point is in bounds, the same as bg::covered_by
+ * @param p point under test
+ * @param bounds outer boundary box, edges included
+ * @return true if p is inside or on bounds
+ */
+template <typename Point, typename Box>
+inline bool is_point_in_bounds(const Point &p, const Box &bounds)
+{
+   return p.x() >= bounds.min_corner().x() && p.x() <= bounds.max_corner().x() &&
+          p.y() >= bounds.min_corner().y() && p.y() <= bounds.max_corner().y();
+}
+
+/**
+ * @brief test whether every point of a path is in bounds
+ * @param path path under test
+ * @param bounds outer boundary box, edges included
+ * @return true if the path never leaves bounds
+ */
+template <typename Line, typename Box>
+inline bool is_path_in_bounds(const Line &path, const Box &bounds)
+{
+   return std::all_of(path.begin(), path.end(), [&bounds](const auto &p) { return is_point_in_bounds(p, bounds); });
+}
+
+/* instantiated once in libpathfinding.so, see pathfinding_core.cpp */
+extern template struct unit_circle<8>;
+extern template struct unit_circle<16>;
+extern template struct unit_circle<32>;
+extern template struct unit_circle<64>;
+
+#endif  // __PATHFINDING_CORE_HPP_
@@ -0,0 +1,51 @@
+/**
+ * @file plan_context.hpp
+ * @brief Per-plan scratch state shared by the internal stages of Planner::plan()
+ */
+#ifndef __PLAN_CONTEXT_HPP_
+#define __PLAN_CONTEXT_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "obstacle_index.hpp"
+#include "path_cache.hpp"
+#include "scratch_arena.hpp"
+
+/**
+ * Keepout steps held by the selected paths of a plan, counted per obstacle, so a path only goes wider than the
+ * selected paths that wrap the same obstacle. A Replanner keeps its pool from tick to tick, and the steps of
+ * paths it drops are handed out again
+ */
+struct keepout_pool
+{
+   std::vector<std::vector<bool>> is_used; ///< is_used[obstacle][step] while a selected path holds the step around the obstacle, step 0 is never handed out
+};
+
+/**
+ * Everything a single plan needs beyond its agents and targets
+ * One of these lives on the stack of each Planner::plan() call, so concurrent plans share nothing. Its path cache
+ * lives in the plan_scratch of the call, which a plan_workspace keeps from one plan_into() to the next.
+ * A Replanner keeps one for its whole life, its cache and keepout steps carry over from plan to plan
+ * Stages that run on the thread pool only ever see it as const
+ */
+struct plan_context
+{
+   const pathfind_config &config; ///< tunables of the owning Planner
+   Boundary bounds; ///< outer boundary box
+   const obstacle_index &index; ///< obstacles of this plan, indexed once per plan or handed in prebuilt
+   path_cache &cache; ///< every path computed so far, see reserve_bids() and recalculate_path(). Outlives the plan, so its memory is reused
+   keepout_pool *steps = nullptr; ///< keepout steps of the selected paths, see reserve_keepout_steps()
+   size_t num_bids = 0; ///< bids evaluated, see evaluate_bids()
+   size_t bids_pruned = 0; ///< bids never built because their straight-line distance couldn't win
+   size_t curves_pruned = 0; ///< pruned bids that would have built a curved path
+   std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(); ///< anytime plans only, see is_past_deadline()
+   bool is_cut_short = false; ///< the deadline passed before planning finished
+   mutable scratch_usage scratch; ///< arena usage of every path of this plan, written by const stages too
+   mutable std::atomic<size_t> keepout_vertices{0}; ///< points of every keepout circle tessellated, see keepout_polygon()
+   mutable std::atomic<size_t> points_simplified{0}; ///< curved path points dropped, see simplify_path()
+};
+
+#endif  // __PLAN_CONTEXT_HPP_
@@ -0,0 +1,252 @@
+/**
+ * @file scenario_io.cpp
+ * @brief Read and write batches of scenarios, one at a time, in a binary or text file format
+ */
+
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "scenario_io.hpp"
+#include "byte_codec.hpp"
+
+using namespace std;
+
+const char SCENARIO_MAGIC[4] = {'L', 'P', 'S', 'B'}; ///< first bytes of a binary scenario file
+
+
+scenario_reader::scenario_reader(istream &in) : in(in), detected(scenario_format::TEXT)
+{
+   // a text file can never start with the magic's first byte, so one byte of lookahead decides the format
+   if (in.peek() != SCENARIO_MAGIC[0])
+   {
+      return;
+   }
+
+   char header[sizeof(SCENARIO_MAGIC) + 4];
+   in.read(header, sizeof(header));
+   if (in.gcount() != sizeof(header) || memcmp(header, SCENARIO_MAGIC, sizeof(SCENARIO_MAGIC)) != 0)
+   {
+      throw runtime_error("ERROR: scenario file header is malformed");
+   }
+   record_cursor cursor = {header + sizeof(SCENARIO_MAGIC), header + sizeof(header)};
+   uint32_t version = cursor.get_uint(4);
+   if (version != SCENARIO_FILE_VERSION)
+   {
+      throw runtime_error("ERROR: unsupported scenario file version " + to_string(version));
+   }
+   detected = scenario_format::BINARY;
+}
+
+bool scenario_reader::next(scenario &out)
+{
+   return (detected == scenario_format::BINARY) ? next_binary(out) : next_text(out);
+}
+
+bool scenario_reader::next_binary(scenario &out)
+{
+   char length_bytes[4];
+   in.read(length_bytes, sizeof(length_bytes));
+   if (in.gcount() == 0)
+   {
+      return false;
+   }
+   if (in.gcount() != sizeof(length_bytes))
+   {
+      throw runtime_error("ERROR: scenario record length is truncated");
+   }
+   record_cursor length_cursor = {length_bytes, length_bytes + sizeof(length_bytes)};
+   uint32_t length = length_cursor.get_uint(4);
+   if (length > MAX_SCENARIO_RECORD_SIZE)
+   {
+      throw runtime_error("ERROR: scenario record of " + to_string(length) + " bytes exceeds MAX_SCENARIO_RECORD_SIZE");
+   }
+
+   record.resize(length);
+   in.read(record.data(), length);
+   if (static_cast<uint32_t>(in.gcount()) != length)
+   {
+      throw runtime_error("ERROR: scenario record is truncated");
+   }
+
+   record_cursor cursor = {record.data(), record.data() + length};
+   size_t name_length = cursor.get_uint(2);
+   out.name.assign(cursor.take(name_length), name_length);
+   Point min_corner = cursor.get_point();
+   Point max_corner = cursor.get_point();
+   out.bounds = Boundary(min_corner, max_corner);
+
+   out.agents.resize(cursor.get_count(16));
+   for (auto &p : out.agents)
+   {
+      p = cursor.get_point();
+   }
+   out.targets.resize(cursor.get_count(16));
+   for (auto &p : out.targets)
+   {
+      p = cursor.get_point();
+   }
+   out.obstacles.resize(cursor.get_count(24));
+   for (auto &o : out.obstacles)
+   {
+      o.p = cursor.get_point();
+      o.radius = cursor.get_f64();
+   }
+   if (cursor.pos != cursor.end)
+   {
+      throw runtime_error("ERROR: scenario record has trailing bytes");
+   }
+   return true;
+}
+
+bool scenario_reader::next_text(scenario &out)
+{
+   string line;
+   bool in_scenario = false;
+   while (getline(in, line))
+   {
+      line_number++;
+      istringstream fields(line);
+      string keyword;
+      if (!(fields >> keyword) || keyword[0] == '#')
+      {
+         continue;
+      }
+
+      auto fail = [&](const string &why)
+      {
+         throw runtime_error("ERROR: scenario text line " + to_string(line_number) + ": " + why);
+      };
+      if (!in_scenario)
+      {
+         if (keyword != "scenario")
+         {
+            fail("expected 'scenario', got '" + keyword + "'");
+         }
+         getline(fields >> ws, out.name);
+         out.bounds = Boundary(Point(0, 0), Point(0, 0));
+         out.agents.clear();
+         out.targets.clear();
+         out.obstacles.clear();
+         in_scenario = true;
+         continue;
+      }
+
+      double x, y, z, w;
+      if (keyword == "end")
+      {
+         return true;
+      }
+      else if (keyword == "bounds")
+      {
+         if (!(fields >> x >> y >> z >> w))
+         {
+            fail("bounds needs min_x min_y max_x max_y");
+         }
+         out.bounds = Boundary(Point(x, y), Point(z, w));
+      }
+      else if (keyword == "agent" || keyword == "target")
+      {
+         if (!(fields >> x >> y))
+         {
+            fail(keyword + " needs x y");
+         }
+         (keyword == "agent" ? out.agents : out.targets).push_back(Point(x, y));
+      }
+      else if (keyword == "obstacle")
+      {
+         if (!(fields >> x >> y >> z))
+         {
+            fail("obstacle needs x y radius");
+         }
+         out.obstacles.push_back({Point(x, y), z});
+      }
+      else
+      {
+         fail("unknown keyword '" + keyword + "'");
+      }
+   }
+
+   if (in_scenario)
+   {
+      throw runtime_error("ERROR: scenario text ends inside scenario '" + out.name + "'");
+   }
+   return false;
+}
+
+scenario_writer::scenario_writer(ostream &out, scenario_format format) : out(out), format(format)
+{
+   if (format == scenario_format::BINARY)
+   {
+      out.write(SCENARIO_MAGIC, sizeof(SCENARIO_MAGIC));
+      record.clear();
+      put_u32(record, SCENARIO_FILE_VERSION);
+      out.write(record.data(), record.size());
+   }
+   else
+   {
+      out.precision(numeric_limits<double>::max_digits10);
+   }
+}
+
+void scenario_writer::write(const scenario &s)
+{
+   if (format == scenario_format::TEXT)
+   {
+      out << "scenario " << s.name << "\n";
+      out << "bounds " << s.bounds.min_corner().x() << " " << s.bounds.min_corner().y() << " "
+          << s.bounds.max_corner().x() << " " << s.bounds.max_corner().y() << "\n";
+      for (auto &p : s.agents)
+      {
+         out << "agent " << p.x() << " " << p.y() << "\n";
+      }
+      for (auto &p : s.targets)
+      {
+         out << "target " << p.x() << " " << p.y() << "\n";
+      }
+      for (auto &o : s.obstacles)
+      {
+         out << "obstacle " << o.p.x() << " " << o.p.y() << " " << o.radius << "\n";
+      }
+      out << "end\n";
+      return;
+   }
+
+   size_t name_length = min(s.name.size(), static_cast<size_t>(numeric_limits<uint16_t>::max()));
+   record.clear();
+   put_u32(record, 0); // patched below once the payload size is known
+   put_u16(record, static_cast<uint16_t>(name_length));
+   record.insert(record.end(), s.name.begin(), s.name.begin() + name_length);
+   put_point(record, s.bounds.min_corner());
+   put_point(record, s.bounds.max_corner());
+   put_u32(record, s.agents.size());
+   for (auto &p : s.agents)
+   {
+      put_point(record, p);
+   }
+   put_u32(record, s.targets.size());
+   for (auto &p : s.targets)
+   {
+      put_point(record, p);
+   }
+   put_u32(record, s.obstacles.size());
+   for (auto &o : s.obstacles)
+   {
+      put_point(record, o.p);
+      put_f64(record, o.radius);
+   }
+
+   patch_u32(record, 0, record.size() - 4);
+   out.write(record.data(), record.size());
+}
+
+void write_result_row(ostream &out, const string &prefix, const pathfind_result &result)
+{
+   streamsize precision = out.precision(numeric_limits<double>::max_digits10);
+   out << prefix << "ok," << result.id << ","
+       << result.agent.x() << "," << result.agent.y() << ","
+       << result.target.x() << "," << result.target.y() << ","
+       << "\"" << LP_PRINT_GEOM(result.path) << "\"\n";
+   out.precision(precision);
+}
@@ -0,0 +1,128 @@
+/**
+ * @file scenario_io.hpp
+ * @brief Read and write batches of scenarios, one at a time, in a binary or text file format, and write the CSV rows of their results
+ *
+ * Binary format, all integers and doubles little-endian:
+ *   header   "LPSB" then uint32 version (1)
+ *   record   uint32 payload length, then the payload:
+ *            uint16 name length, name bytes,
+ *            4 x double bounds (min_x, min_y, max_x, max_y),
+ *            uint32 agent count, 2 x double per agent,
+ *            uint32 target count, 2 x double per target,
+ *            uint32 obstacle count, 3 x double (x, y, radius) per obstacle
+ *
+ * Text format, one keyword line per item, blank lines and lines starting with '#' are skipped:
+ *   scenario <name>
+ *   bounds <min_x> <min_y> <max_x> <max_y>
+ *   agent <x> <y>
+ *   target <x> <y>
+ *   obstacle <x> <y> <radius>
+ *   end
+ */
+#ifndef __SCENARIO_IO_HPP_
+#define __SCENARIO_IO_HPP_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+const uint32_t SCENARIO_FILE_VERSION = 1; ///< version written into binary headers
+const uint32_t MAX_SCENARIO_RECORD_SIZE = 64u << 20; ///< refuse binary records claiming more bytes than this
+
+/**
+ * a complete set of inputs for one plan
+ */
+struct scenario
+{
+   std::string name; ///< label carried through to results
+   Boundary bounds; ///< outer boundary box
+   std::vector<Point> agents; ///< agent positions
+   std::vector<Point> targets; ///< target positions
+   std::vector<obstacle> obstacles; ///< circular obstacles
+};
+
+/**
+ * on-disk encodings understood by scenario_reader and scenario_writer
+ */
+enum class scenario_format
+{
+   BINARY, ///< length-prefixed records, compact and fast to parse
+   TEXT,   ///< keyword lines, easy to write by hand
+};
+
+/**
+ * Pulls scenarios off a stream one at a time, memory use is one record no matter how long the stream is
+ * The format is detected from the first bytes of the stream
+ */
+class scenario_reader
+{
+public:
+   /**
+    * @brief start reading, throws std::runtime_error if a binary header has an unknown version
+    * @param in stream positioned at the start of a scenario file, must outlive the reader
+    */
+   explicit scenario_reader(std::istream &in);
+
+   /**
+    * @brief read the next scenario
+    * Throws std::runtime_error on a truncated or malformed record
+    * @param out overwritten with the next scenario, its vectors keep their capacity
+    * @return false once the stream is exhausted
+    */
+   bool next(scenario &out);
+
+   /**
+    * @brief format detected at construction
+    * @return BINARY or TEXT
+    */
+   scenario_format format() const { return detected; }
+
+private:
+   bool next_binary(scenario &out);
+   bool next_text(scenario &out);
+
+   std::istream &in; ///< source stream
+   scenario_format detected; ///< format of the source stream
+   std::vector<char> record; ///< reused buffer for one binary record
+   size_t line_number = 0; ///< text lines consumed so far, for error messages
+};
+
+/**
+ * Appends scenarios to a stream in either format
+ */
+class scenario_writer
+{
+public:
+   /**
+    * @brief start writing, emits the binary header right away
+    * @param out stream to write to, must outlive the writer, open it in binary mode for BINARY
+    * @param format encoding to write
+    */
+   scenario_writer(std::ostream &out, scenario_format format);
+
+   /**
+    * @brief append one scenario
+    * @param s scenario to write, names longer than 65535 bytes are truncated in BINARY
+    */
+   void write(const scenario &s);
+
+private:
+   std::ostream &out; ///< destination stream
+   scenario_format format; ///< encoding to write
+   std::vector<char> record; ///< reused buffer for one binary record
+};
+
+/**
+ * @brief write one result of a plan as a pathfinding_batch CSV row: prefix, "ok", id, agent x and y, target x and y, quoted path
+ * Coordinates are written at max_digits10, so each one parses back to the double that was planned
+ * @param out stream to write to, its precision is left as it was
+ * @param prefix leading fields of the row, ending in a comma
+ * @param result result to write
+ */
+void write_result_row(std::ostream &out, const std::string &prefix, const pathfind_result &result);
+
+#endif  // __SCENARIO_IO_HPP_
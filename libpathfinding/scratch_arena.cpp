@@ -0,0 +1,150 @@
+/**
+ * @file scratch_arena.cpp
+ * @brief Per-thread bump arena for the geometry temporaries of one path
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+#include "scratch_arena.hpp"
+
+using namespace std;
+
+/**
+ * retained buffer bumped through by one thread, with anything that does not fit going to the heap
+ */
+class scratch_arena : public pmr::memory_resource
+{
+public:
+   ~scratch_arena() override
+   {
+      ::operator delete(buffer, align_val_t(alignof(max_align_t)));
+   }
+
+   /**
+    * @brief get ready for a new path, allocating the first buffer on first use
+    */
+   void open()
+   {
+      if (buffer == nullptr)
+      {
+         resize(SCRATCH_INITIAL_BYTES);
+      }
+      used = 0;
+      spilled = 0;
+      high = 0;
+      did_spill = false;
+   }
+
+   /**
+    * @brief rewind after a path, growing the buffer if the path did not fit in it
+    * @param usage optional, where to report the path's usage
+    */
+   void close(scratch_usage *usage)
+   {
+      if (usage != nullptr)
+      {
+         size_t seen = usage->peak_bytes.load(memory_order_relaxed);
+         while (high > seen && !usage->peak_bytes.compare_exchange_weak(seen, high, memory_order_relaxed))
+         {
+         }
+         if (did_spill)
+         {
+            usage->spills.fetch_add(1, memory_order_relaxed);
+         }
+      }
+      if (did_spill && capacity < SCRATCH_MAX_BYTES)
+      {
+         resize(min(bit_ceil(high), SCRATCH_MAX_BYTES));
+      }
+      used = 0;
+   }
+
+private:
+   void *do_allocate(size_t bytes, size_t alignment) override
+   {
+      size_t start = (used + alignment - 1) & ~(alignment - 1);
+      if (alignment <= alignof(max_align_t) && start + bytes <= capacity)
+      {
+         used = start + bytes;
+         high = max(high, used + spilled);
+         return buffer + start;
+      }
+      did_spill = true;
+      spilled += bytes;
+      high = max(high, used + spilled);
+      return ::operator new(bytes, align_val_t(alignment));
+   }
+
+   void do_deallocate(void *p, size_t bytes, size_t alignment) override
+   {
+      byte *block = static_cast<byte *>(p);
+      if (block >= buffer && block < buffer + capacity)
+      {
+         // only the newest block can be given back, which covers a vector regrowing in place of its last buffer
+         if (block + bytes == buffer + used)
+         {
+            used = block - buffer;
+         }
+         return;
+      }
+      spilled -= bytes;
+      ::operator delete(p, align_val_t(alignment));
+   }
+
+   bool do_is_equal(const pmr::memory_resource &other) const noexcept override
+   {
+      return this == &other;
+   }
+
+   /**
+    * @brief replace the buffer, only while nothing is allocated from it
+    * @param bytes new capacity
+    */
+   void resize(size_t bytes)
+   {
+      ::operator delete(buffer, align_val_t(alignof(max_align_t)));
+      buffer = static_cast<byte *>(::operator new(bytes, align_val_t(alignof(max_align_t))));
+      capacity = bytes;
+   }
+
+   byte *buffer = nullptr; ///< retained between paths
+   size_t capacity = 0; ///< size of buffer
+   size_t used = 0; ///< bytes of buffer handed out so far
+   size_t spilled = 0; ///< bytes live on the heap
+   size_t high = 0; ///< most of used + spilled at once this path
+   bool did_spill = false; ///< true if this path went to the heap
+};
+
+static thread_local scratch_arena thread_arena; ///< one arena per thread, so worker threads never share
+static thread_local int scope_depth = 0; ///< scratch_scopes open on this thread
+
+scratch_scope::scratch_scope(scratch_usage *usage) : outermost(scope_depth == 0), usage(usage)
+{
+   if (outermost)
+   {
+      thread_arena.open();
+   }
+   scope_depth++;
+}
+
+scratch_scope::~scratch_scope()
+{
+   scope_depth--;
+   if (outermost)
+   {
+      thread_arena.close(usage);
+   }
+}
+
+pmr::memory_resource *scratch_resource()
+{
+   if (scope_depth > 0)
+   {
+      return &thread_arena;
+   }
+   return pmr::new_delete_resource();
+}
@@ -0,0 +1,96 @@
+/**
+ * @file scratch_arena.hpp
+ * @brief Per-thread bump arena for the geometry temporaries of one path
+ *
+ * Building a path makes many short-lived containers- obstacle lists, stroked lines, tessellated circles, their union
+ * and its hull- that all die when the path is returned. While a scratch_scope is open, every scratch_allocator
+ * constructed on that thread takes its memory from the thread's arena, a single retained buffer that is bumped
+ * through and rewound when the outermost scope closes. A path that needs more than the buffer spills the rest to
+ * the heap, and the buffer is grown to fit for the next one, so in steady state the arena makes no heap calls.
+ * Outside any scope a scratch_allocator falls back to the heap, so scratch containers are safe anywhere.
+ *
+ * Containers built inside a scope must not outlive it. Copy anything that escapes into an ordinary container.
+ * Boost.Geometry's own internal temporaries keep using the heap.
+ */
+#ifndef __SCRATCH_ARENA_HPP_
+#define __SCRATCH_ARENA_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+const size_t SCRATCH_INITIAL_BYTES = 64 * 1024; ///< buffer every thread's arena starts with
+const size_t SCRATCH_MAX_BYTES = 16 * 1024 * 1024; ///< the buffer never grows past this, larger paths keep spilling
+
+/**
+ * arena usage summed over the paths of one plan, updated from any thread
+ */
+struct scratch_usage
+{
+   std::atomic<size_t> peak_bytes{0}; ///< most bytes any one path took from its arena, spills included
+   std::atomic<size_t> spills{0}; ///< paths that outgrew their thread's buffer and went to the heap
+};
+
+/**
+ * Open the calling thread's arena for the lifetime of this object
+ * Scopes nest, only the outermost one rewinds the arena when it closes
+ */
+class scratch_scope
+{
+public:
+   /**
+    * @brief open the arena of the calling thread
+    * @param usage optional, the outermost scope adds its usage here when it closes
+    */
+   explicit scratch_scope(scratch_usage *usage = nullptr);
+
+   /**
+    * @brief close the scope, rewinding the arena and freeing any spills if it is the outermost one
+    */
+   ~scratch_scope();
+
+   scratch_scope(const scratch_scope &) = delete;
+   scratch_scope &operator=(const scratch_scope &) = delete;
+
+private:
+   bool outermost; ///< true if this scope opened the arena
+   scratch_usage *usage; ///< where to report, may be nullptr
+};
+
+/**
+ * @brief memory resource for new scratch containers
+ * @return the calling thread's arena while a scratch_scope is open on it, else std::pmr::new_delete_resource()
+ */
+std::pmr::memory_resource *scratch_resource();
+
+/**
+ * polymorphic_allocator bound to scratch_resource() when it is constructed
+ * Default construction picks up the arena, so containers created anywhere inside a scope (including inside
+ * Boost.Geometry algorithms writing to scratch geometry types) use it. Copies of a container bind to the
+ * resource current where the copy is made
+ */
+template <typename T>
+class scratch_allocator : public std::pmr::polymorphic_allocator<T>
+{
+public:
+   using value_type = T;
+
+   scratch_allocator() : std::pmr::polymorphic_allocator<T>(scratch_resource()) {}
+   scratch_allocator(std::pmr::memory_resource *resource) : std::pmr::polymorphic_allocator<T>(resource) {}
+   template <typename U>
+   scratch_allocator(const scratch_allocator<U> &other) : std::pmr::polymorphic_allocator<T>(other.resource()) {}
+
+   scratch_allocator select_on_container_copy_construction() const { return scratch_allocator(); }
+};
+
+template <typename T>
+using scratch_vector = std::vector<T, scratch_allocator<T>>; ///< std::vector on the scratch arena
+
+using ScratchLine = bg::model::linestring<Point, std::vector, scratch_allocator>; ///< Line on the scratch arena
+using ScratchPolygon = bg::model::polygon<Point, true, true, std::vector, std::vector, scratch_allocator, scratch_allocator>; ///< Polygon on the scratch arena
+using ScratchMultiPolygon = bg::model::multi_polygon<ScratchPolygon, std::vector, scratch_allocator>; ///< MultiPolygon on the scratch arena
+
+#endif  // __SCRATCH_ARENA_HPP_
@@ -0,0 +1,216 @@
+/**
+ * @file tangent_path.cpp
+ * @brief Exact detours around circles from bitangent segments and sampled arcs
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "tangent_path.hpp"
+#include "scratch_arena.hpp"
+
+using namespace std;
+
+const double TWO_PI = 2.0 * M_PI;
+const double TANGENT_EPSILON = 1e-9; ///< slack for "every circle is on the inner side of this tangent"
+
+/**
+ * one edge of the hull, an outer tangent from circle "from" to circle "to" with the hull on its left
+ */
+struct hull_edge
+{
+   size_t from; ///< index of the circle the edge leaves
+   size_t to; ///< index of the circle the edge reaches
+   Point from_point; ///< tangent point on circle from
+   Point to_point; ///< tangent point on circle to
+   double normal_angle; ///< direction of the outward normal, increases as the hull is walked counterclockwise
+};
+
+/**
+ * @brief outer tangent from c1 to c2 that keeps both circles on its left
+ * @param c1 circle the tangent leaves
+ * @param c2 circle the tangent reaches
+ * @param edge output, tangent points and normal of the tangent
+ * @return false if one circle contains the other, so no such tangent exists
+ */
+static bool outer_tangent(const obstacle &c1, const obstacle &c2, hull_edge &edge)
+{
+   double dx = c2.p.x() - c1.p.x();
+   double dy = c2.p.y() - c1.p.y();
+   double length = hypot(dx, dy);
+   double cos_phi = (c1.radius - c2.radius) / length;
+   if (length == 0 || fabs(cos_phi) >= 1.0)
+   {
+      return false;
+   }
+   double sin_phi = sqrt(1.0 - cos_phi * cos_phi);
+   dx /= length;
+   dy /= length;
+
+   // rotate the center-to-center direction clockwise by (90 deg - phi), giving the outward normal
+   double nx = cos_phi * dx + sin_phi * dy;
+   double ny = cos_phi * dy - sin_phi * dx;
+   edge.from_point = Point(c1.p.x() + c1.radius * nx, c1.p.y() + c1.radius * ny);
+   edge.to_point = Point(c2.p.x() + c2.radius * nx, c2.p.y() + c2.radius * ny);
+   edge.normal_angle = atan2(ny, nx);
+   return true;
+}
+
+/**
+ * @brief test whether a tangent is an edge of the hull of all circles
+ * @param circles every circle of the hull
+ * @param edge candidate tangent
+ * @return true if no circle pokes out past the tangent
+ */
+static bool is_hull_edge(const scratch_vector<obstacle> &circles, const hull_edge &edge)
+{
+   double nx = cos(edge.normal_angle);
+   double ny = sin(edge.normal_angle);
+   double offset = nx * edge.from_point.x() + ny * edge.from_point.y();
+   double slack = TANGENT_EPSILON * (1.0 + fabs(offset));
+   for (auto &c : circles)
+   {
+      if (nx * c.p.x() + ny * c.p.y() + c.radius > offset + slack)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+void append_circle_arc(Line &path, const obstacle &c, const Point &start, const Point &end, bool is_clockwise, double arc_tolerance)
+{
+   double a_start = atan2(start.y() - c.p.y(), start.x() - c.p.x());
+   double a_end = atan2(end.y() - c.p.y(), end.x() - c.p.x());
+   double sweep = fmod((is_clockwise ? a_start - a_end : a_end - a_start) + TWO_PI, TWO_PI);
+   if (sweep < TANGENT_EPSILON || c.radius <= 0)
+   {
+      return;
+   }
+
+   double max_step = 2.0 * acos(c.radius / (c.radius + arc_tolerance));
+   size_t num_steps = static_cast<size_t>(ceil(sweep / max_step));
+   double step = (is_clockwise ? -sweep : sweep) / num_steps;
+   double vertex_radius = c.radius / cos(step / 2.0);
+   for (size_t k = 0; k < num_steps; k++)
+   {
+      double a = a_start + (k + 0.5) * step;
+      path.push_back(Point(c.p.x() + vertex_radius * cos(a), c.p.y() + vertex_radius * sin(a)));
+   }
+}
+
+/**
+ * @brief turn a run of consecutive counterclockwise hull edges into a path
+ * @param circles every circle of the hull
+ * @param edges every hull edge
+ * @param chain indices into edges, in walking order
+ * @param arc_tolerance see append_circle_arc()
+ * @return path from the first edge's start to the last edge's end
+ */
+static Line build_chain(const scratch_vector<obstacle> &circles, const scratch_vector<hull_edge> &edges, span<const size_t> chain, double arc_tolerance)
+{
+   Line path;
+   path.push_back(edges[chain[0]].from_point);
+   for (size_t i = 0; i < chain.size(); i++)
+   {
+      const hull_edge &edge = edges[chain[i]];
+      if (i > 0)
+      {
+         append_circle_arc(path, circles[edge.from], edges[chain[i - 1]].to_point, edge.from_point, false, arc_tolerance);
+         if (bg::distance(path.back(), edge.from_point) > TANGENT_EPSILON)
+         {
+            path.push_back(edge.from_point);
+         }
+      }
+      path.push_back(edge.to_point);
+   }
+   return path;
+}
+
+Line tangent_hull_path(const Point &agent, const Point &target, span<const obstacle> obstacles, bool is_clockwise, double arc_tolerance)
+{
+   /* circle 0 is the agent and circle 1 the target, both with radius 0 */
+   scratch_vector<obstacle> circles = {{agent, 0.0}, {target, 0.0}};
+   circles.insert(circles.end(), obstacles.begin(), obstacles.end());
+
+   /* every outer tangent that has all circles on its inner side is a hull edge */
+   scratch_vector<hull_edge> edges;
+   scratch_vector<scratch_vector<size_t>> outgoing(circles.size());
+   for (size_t i = 0; i < circles.size(); i++)
+   {
+      for (size_t j = 0; j < circles.size(); j++)
+      {
+         hull_edge edge = {i, j, Point(), Point(), 0.0};
+         if (i != j && outer_tangent(circles[i], circles[j], edge) && is_hull_edge(circles, edge))
+         {
+            outgoing[i].push_back(edges.size());
+            edges.push_back(edge);
+         }
+      }
+   }
+   if (outgoing[0].empty())
+   {
+      return Line();
+   }
+
+   /**
+    * walk counterclockwise from the agent, at each circle leave by the edge whose normal
+    * turns the least from the arriving one (a circle can sit on the hull more than once)
+    */
+   scratch_vector<size_t> cycle = {outgoing[0][0]};
+   while (edges[cycle.back()].to != 0)
+   {
+      if (cycle.size() > edges.size())
+      {
+         return Line();
+      }
+      const hull_edge &arriving = edges[cycle.back()];
+      size_t best = outgoing[arriving.to].empty() ? edges.size() : outgoing[arriving.to][0];
+      double best_turn = TWO_PI + 1;
+      for (size_t e : outgoing[arriving.to])
+      {
+         double turn = fmod(edges[e].normal_angle - arriving.normal_angle + 2 * TWO_PI, TWO_PI);
+         if (turn > TWO_PI - TANGENT_EPSILON)
+         {
+            turn = 0;
+         }
+         if (turn < best_turn)
+         {
+            best_turn = turn;
+            best = e;
+         }
+      }
+      if (best == edges.size())
+      {
+         return Line();
+      }
+      cycle.push_back(best);
+   }
+
+   /* split the cycle at the target */
+   size_t target_pos = cycle.size();
+   for (size_t i = 0; i < cycle.size(); i++)
+   {
+      if (edges[cycle[i]].to == 1)
+      {
+         target_pos = i;
+         break;
+      }
+   }
+   if (target_pos == cycle.size())
+   {
+      return Line();
+   }
+
+   if (!is_clockwise)
+   {
+      return build_chain(circles, edges, span(cycle).first(target_pos + 1), arc_tolerance);
+   }
+
+   /* the rest of the cycle runs counterclockwise from target to agent, walk it backwards */
+   Line path = build_chain(circles, edges, span(cycle).subspan(target_pos + 1), arc_tolerance);
+   bg::reverse(path);
+   return path;
+}
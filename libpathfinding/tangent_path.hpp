@@ -0,0 +1,44 @@
+/**
+ * @file tangent_path.hpp
+ * @brief Exact detours around circles from bitangent segments and sampled arcs
+ *
+ * Same idea as the buffer/union/convex hull detour in pathfinding.cpp, without tessellating anything:
+ * the convex hull of the agent, the target and a set of circles is a cycle of tangent segments and arcs,
+ * and either side of that cycle from agent to target is a detour around all of the circles.
+ */
+#ifndef __TANGENT_PATH_HPP_
+#define __TANGENT_PATH_HPP_
+
+#include <span>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+/**
+ * @brief walk one side of the convex hull of {agent, target, circles} from agent to target
+ * Hull edges are outer bitangents between circles (a point is a circle of radius 0).
+ * Arcs are sampled with vertices outside the circle, so no segment cuts into a circle
+ * and no vertex strays more than arc_tolerance from it
+ * @param agent first point of the path
+ * @param target last point of the path
+ * @param circles circles to route around, already grown by any keepout
+ * @param is_clockwise true for the clockwise side of the hull, false for the counterclockwise side
+ * @param arc_tolerance largest allowed gap between a sampled arc and the true arc, must be > 0
+ * @return path from agent to target, or an empty Line if agent or target lies inside the hull
+ */
+Line tangent_hull_path(const Point &agent, const Point &target, std::span<const obstacle> circles, bool is_clockwise, double arc_tolerance);
+
+/**
+ * @brief append the vertices of an arc, not including its end points
+ * vertices sit on the circle grown by 1/cos(step/2), so every chord is tangent to the true arc
+ * and the polyline never cuts inside the circle
+ * @param path Line to append to
+ * @param c circle the arc belongs to
+ * @param start first point of the arc, on the circle
+ * @param end last point of the arc, on the circle
+ * @param is_clockwise direction to go around c from start to end
+ * @param arc_tolerance largest allowed gap between the vertices and the circle, must be > 0
+ */
+void append_circle_arc(Line &path, const obstacle &c, const Point &start, const Point &end, bool is_clockwise, double arc_tolerance);
+
+#endif  // __TANGENT_PATH_HPP_
@@ -0,0 +1,114 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Persistent worker pool used to compute independent bids in parallel
+ */
+
+#include "thread_pool.hpp"
+
+using namespace std;
+
+
+thread_pool::thread_pool(size_t num_workers)
+{
+   workers.reserve(num_workers);
+   for (size_t i = 0; i < num_workers; i++)
+   {
+      workers.emplace_back(&thread_pool::worker_loop, this);
+   }
+}
+
+thread_pool::~thread_pool()
+{
+   {
+      lock_guard<mutex> lock(state_mutex);
+      stopping = true;
+   }
+   job_ready.notify_all();
+   for (auto &worker : workers)
+   {
+      worker.join();
+   }
+}
+
+void thread_pool::parallel_for(size_t count, const function<void(size_t)> &fn)
+{
+   if (count == 0)
+   {
+      return;
+   }
+
+   lock_guard<mutex> job_lock(job_mutex);
+   {
+      lock_guard<mutex> lock(state_mutex);
+      job = &fn;
+      job_count = count;
+      next_index = 0;
+      failure = nullptr;
+      busy_workers = workers.size();
+      generation++;
+   }
+   job_ready.notify_all();
+
+   // the caller works too, so a pool of size 0 is a plain serial loop
+   run_items();
+
+   unique_lock<mutex> lock(state_mutex);
+   job_done.wait(lock, [this] { return busy_workers == 0; });
+   job = nullptr;
+   if (failure)
+   {
+      exception_ptr to_throw = failure;
+      failure = nullptr;
+      rethrow_exception(to_throw);
+   }
+}
+
+/**
+ * @brief pull indices off the current job until none remain
+ * items are handed out one at a time, bids vary too much in cost for static chunking
+ */
+void thread_pool::run_items()
+{
+   size_t i;
+   while ((i = next_index.fetch_add(1)) < job_count)
+   {
+      try
+      {
+         (*job)(i);
+      }
+      catch (...)
+      {
+         lock_guard<mutex> lock(state_mutex);
+         if (!failure || i < failed_index)
+         {
+            failure = current_exception();
+            failed_index = i;
+         }
+      }
+   }
+}
+
+void thread_pool::worker_loop()
+{
+   size_t seen_generation = 0;
+   while (true)
+   {
+      {
+         unique_lock<mutex> lock(state_mutex);
+         job_ready.wait(lock, [&] { return stopping || generation != seen_generation; });
+         if (stopping)
+         {
+            return;
+         }
+         seen_generation = generation;
+      }
+
+      run_items();
+
+      {
+         lock_guard<mutex> lock(state_mutex);
+         busy_workers--;
+      }
+      job_done.notify_one();
+   }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Persistent worker pool used to compute independent bids in parallel
+ */
+#ifndef __THREAD_POOL_HPP_
+#define __THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads that stay alive between calls
+ * Create one per process (or per planning server) and hand it to pathfind() through pathfind_config::pool
+ * A pool with zero workers runs every job on the calling thread, which is the serial mode
+ */
+class thread_pool
+{
+public:
+   /**
+    * @brief start the worker threads
+    * @param num_workers number of background threads, 0 runs everything on the caller
+    */
+   explicit thread_pool(size_t num_workers = std::thread::hardware_concurrency());
+
+   /**
+    * @brief stop and join all worker threads
+    */
+   ~thread_pool();
+
+   thread_pool(const thread_pool &) = delete;
+   thread_pool &operator=(const thread_pool &) = delete;
+
+   /**
+    * @brief number of background worker threads
+    * @return worker count, the calling thread also helps during parallel_for()
+    */
+   size_t size() const { return workers.size(); }
+
+   /**
+    * @brief call fn(i) for every i in [0, count) across the pool, blocking until all are done
+    * fn must only write to state owned by index i. Concurrent callers are serialized.
+    * If any call throws, the exception from the lowest failing index is rethrown here,
+    * which matches what a plain serial loop would have thrown first
+    * @param count number of indices
+    * @param fn work item, called once per index
+    */
+   void parallel_for(size_t count, const std::function<void(size_t)> &fn);
+
+private:
+   void worker_loop();
+   void run_items();
+
+   std::vector<std::thread> workers; ///< background threads
+   std::mutex job_mutex; ///< serializes parallel_for() callers
+   std::mutex state_mutex; ///< guards the fields below
+   std::condition_variable job_ready; ///< signalled when a job is posted or on shutdown
+   std::condition_variable job_done; ///< signalled when the last worker leaves a job
+   bool stopping = false; ///< set by the destructor
+   size_t generation = 0; ///< bumped for each posted job so workers run it once
+   size_t busy_workers = 0; ///< workers still inside the current job
+
+   const std::function<void(size_t)> *job = nullptr; ///< current work item
+   size_t job_count = 0; ///< number of indices in the current job
+   std::atomic<size_t> next_index{0}; ///< next index to hand out
+   size_t failed_index = 0; ///< lowest index that threw
+   std::exception_ptr failure; ///< exception thrown by failed_index
+};
+
+#endif  // __THREAD_POOL_HPP_
@@ -0,0 +1,388 @@
+/**
+ * @file tiled_map.cpp
+ * @brief Tiled obstacle map for areas too large for one obstacle_map, routes are planned coarse to fine
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "tiled_map.hpp"
+#include "obstacle_index.hpp"
+#include "obstacle_map.hpp"
+#include "geometry_kernels.hpp"
+
+using namespace std;
+
+const size_t WAYPOINT_SAMPLES = 5; ///< candidate waypoints per tile along each axis, see find_waypoint()
+const size_t MAX_LEG_MARGIN = 2; ///< tiles around a leg's corridor, a leg with no path is retried one tile wider up to this
+
+/**
+ * a tile reached by the coarse A*
+ */
+struct coarse_visit
+{
+   double cost; ///< cost of the best route found to the tile
+   size_t parent; ///< tile the best route arrived from
+};
+
+tiled_map::tiled_map(const Boundary &bounds, const vector<obstacle> &obstacles, double tile_size, double clearance, double arc_tolerance, size_t leg_tiles)
+    : bounds(bounds), tile_size(tile_size), clearance(clearance), arc_tolerance(arc_tolerance), leg_tiles(leg_tiles), obstacles(obstacles)
+{
+   if (!(tile_size > 0) || !(arc_tolerance > 0) || leg_tiles == 0)
+   {
+      throw invalid_argument("ERROR: tiled_map tile_size, arc_tolerance and leg_tiles must be > 0");
+   }
+   double width = bounds.max_corner().x() - bounds.min_corner().x();
+   double height = bounds.max_corner().y() - bounds.min_corner().y();
+   tiles_x = max(static_cast<size_t>(1), static_cast<size_t>(ceil(width / tile_size)));
+   tiles_y = max(static_cast<size_t>(1), static_cast<size_t>(ceil(height / tile_size)));
+   coverage.assign(num_tiles(), 0.0);
+   is_blocked.assign(num_tiles(), 0);
+
+   /**
+    * every obstacle goes in each tile its grown circle touches, counted on the first pass and stored on the second.
+    * Coverage takes the share of the circle's area that its bounding box puts in the tile, close enough to weigh routes
+    */
+   vector<size_t> counts(num_tiles() + 1, 0);
+   for (int pass = 0; pass < 2; pass++)
+   {
+      for (size_t i = 0; i < obstacles.size(); i++)
+      {
+         obstacle grown = {obstacles[i].p, obstacles[i].radius + clearance};
+         Boundary box = obstacle_bounding_box(grown);
+         size_t first = tile_of(box.min_corner());
+         size_t last = tile_of(box.max_corner());
+         for (size_t ty = first / tiles_x; ty <= last / tiles_x; ty++)
+         {
+            for (size_t tx = first % tiles_x; tx <= last % tiles_x; tx++)
+            {
+               size_t t = ty * tiles_x + tx;
+               Boundary tile = tile_box(t);
+               if (!box_intersects_circle(tile, grown))
+               {
+                  continue;
+               }
+               if (pass == 0)
+               {
+                  counts[t + 1]++;
+                  double overlap_x = min(box.max_corner().x(), tile.max_corner().x()) - max(box.min_corner().x(), tile.min_corner().x());
+                  double overlap_y = min(box.max_corner().y(), tile.max_corner().y()) - max(box.min_corner().y(), tile.min_corner().y());
+                  double tile_area = (tile.max_corner().x() - tile.min_corner().x()) * (tile.max_corner().y() - tile.min_corner().y());
+                  coverage[t] += M_PI / 4 * overlap_x * overlap_y / tile_area;
+                  is_blocked[t] |= box_in_circle(tile, grown) ? 1 : 0;
+               }
+               else
+               {
+                  tile_obstacles[tile_start[t] + counts[t]++] = i;
+               }
+            }
+         }
+      }
+      if (pass == 0)
+      {
+         for (size_t t = 0; t < num_tiles(); t++)
+         {
+            counts[t + 1] += counts[t];
+            coverage[t] = min(coverage[t], 1.0);
+         }
+         tile_start = counts;
+         tile_obstacles.resize(counts.back());
+         fill(counts.begin(), counts.end(), 0);
+      }
+   }
+}
+
+Line tiled_map::find_path(const Point &agent, const Point &target, tiled_path_stats *stats) const
+{
+   tiled_path_stats local;
+   tiled_path_stats &counters = (stats != nullptr) ? *stats : local;
+   counters = tiled_path_stats();
+   for (auto &p : {agent, target})
+   {
+      if (!bg::covered_by(p, bounds))
+      {
+         throw invalid_argument("ERROR: tiled_map query point is out of bounds");
+      }
+      if (!is_free(p, tile_of(p)))
+      {
+         throw invalid_argument("ERROR: tiled_map query point is inside an obstacle");
+      }
+   }
+
+   vector<size_t> route = coarse_route(tile_of(agent), tile_of(target), counters);
+   if (route.empty())
+   {
+      return Line();
+   }
+
+   /**
+    * refine leg_tiles of the route at a time. Each leg ends at a free point of its last tile,
+    * picked to head toward the route two legs on so the joins stay nearly straight
+    */
+   Line path = {agent};
+   Point from = agent;
+   size_t first = 0;
+   do
+   {
+      size_t last = min(first + leg_tiles, route.size() - 1);
+      Point to = target;
+      Point toward = (last + 2 * leg_tiles < route.size() - 1) ? tile_center(route[last + 2 * leg_tiles]) : target;
+      while (last < route.size() - 1 && !find_waypoint(route[last], from, toward, to))
+      {
+         last++;
+      }
+      if (last == route.size() - 1)
+      {
+         to = target;
+      }
+
+      Line leg = refine_leg(from, to, span<const size_t>(route).subspan(first, last - first + 1), counters);
+      if (leg.empty())
+      {
+         return Line();
+      }
+      path.insert(path.end(), leg.begin() + 1, leg.end());
+      from = to;
+      first = last;
+   } while (first + 1 < route.size());
+   return path;
+}
+
+size_t tiled_map::num_tiles() const
+{
+   return tiles_x * tiles_y;
+}
+
+size_t tiled_map::num_obstacles() const
+{
+   return obstacles.size();
+}
+
+/**
+ * @brief tile holding a point, points past the edge of the map go to the nearest edge tile
+ * @param p point to place
+ * @return tile index, row by row
+ */
+size_t tiled_map::tile_of(const Point &p) const
+{
+   double fx = floor((p.x() - bounds.min_corner().x()) / tile_size);
+   double fy = floor((p.y() - bounds.min_corner().y()) / tile_size);
+   size_t tx = static_cast<size_t>(clamp(fx, 0.0, static_cast<double>(tiles_x - 1)));
+   size_t ty = static_cast<size_t>(clamp(fy, 0.0, static_cast<double>(tiles_y - 1)));
+   return ty * tiles_x + tx;
+}
+
+/**
+ * @brief area of a tile, tiles on the far edges are cut off by the map boundary
+ * @param tile tile index
+ * @return box of the tile
+ */
+Boundary tiled_map::tile_box(size_t tile) const
+{
+   double x = bounds.min_corner().x() + (tile % tiles_x) * tile_size;
+   double y = bounds.min_corner().y() + (tile / tiles_x) * tile_size;
+   return Boundary(Point(x, y), Point(min(x + tile_size, bounds.max_corner().x()), min(y + tile_size, bounds.max_corner().y())));
+}
+
+/**
+ * @brief center of a tile
+ * @param tile tile index
+ * @return center of tile_box()
+ */
+Point tiled_map::tile_center(size_t tile) const
+{
+   Boundary box = tile_box(tile);
+   return Point((box.min_corner().x() + box.max_corner().x()) / 2, (box.min_corner().y() + box.max_corner().y()) / 2);
+}
+
+/**
+ * @brief test whether a point keeps clearance from every obstacle
+ * @param p point under test
+ * @param tile tile holding p, only its obstacles can reach p
+ * @return true if p is outside every grown obstacle
+ */
+bool tiled_map::is_free(const Point &p, size_t tile) const
+{
+   for (size_t k = tile_start[tile]; k < tile_start[tile + 1]; k++)
+   {
+      const obstacle &o = obstacles[tile_obstacles[k]];
+      if (bg::distance(p, o.p) < o.radius + clearance)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief pick the point to end a leg at, from a grid of candidates inside a tile
+ * @param tile tile the leg ends in
+ * @param from start of the leg
+ * @param toward where the route goes next
+ * @param waypoint set to the free candidate with the shortest from -> candidate -> toward
+ * @return false if every candidate is inside an obstacle
+ */
+bool tiled_map::find_waypoint(size_t tile, const Point &from, const Point &toward, Point &waypoint) const
+{
+   Boundary box = tile_box(tile);
+   double step_x = (box.max_corner().x() - box.min_corner().x()) / WAYPOINT_SAMPLES;
+   double step_y = (box.max_corner().y() - box.min_corner().y()) / WAYPOINT_SAMPLES;
+   double best = HUGE_VAL;
+   for (size_t i = 0; i < WAYPOINT_SAMPLES; i++)
+   {
+      for (size_t j = 0; j < WAYPOINT_SAMPLES; j++)
+      {
+         Point p(box.min_corner().x() + (i + 0.5) * step_x, box.min_corner().y() + (j + 0.5) * step_y);
+         double detour = bg::distance(from, p) + bg::distance(p, toward);
+         if (detour < best && is_free(p, tile))
+         {
+            best = detour;
+            waypoint = p;
+         }
+      }
+   }
+   return best < HUGE_VAL;
+}
+
+/**
+ * @brief A* over the tile grid, each tile linked to its 8 neighbours
+ * A step costs its length, more through covered tiles (see TILE_COVERAGE_WEIGHT), and never enters a blocked tile.
+ * A diagonal step also needs both tiles it cuts past to be open. Straight-line distance never overestimates
+ * @param from tile of the agent
+ * @param to tile of the target
+ * @param stats counts the tiles expanded
+ * @return tiles from from to to, empty if to can't be reached
+ */
+vector<size_t> tiled_map::coarse_route(size_t from, size_t to, tiled_path_stats &stats) const
+{
+   // only the tiles the search reaches are stored, so a short route stays cheap on a huge map
+   unordered_map<size_t, coarse_visit> visited;
+   using frontier_entry = pair<double, size_t>;
+   priority_queue<frontier_entry, vector<frontier_entry>, greater<frontier_entry>> frontier;
+   const Point goal = tile_center(to);
+   visited[from] = {0.0, from};
+   frontier.push({bg::distance(tile_center(from), goal), from});
+   while (!frontier.empty())
+   {
+      auto [estimate, t] = frontier.top();
+      frontier.pop();
+      double cost = visited[t].cost;
+      if (t == to)
+      {
+         break;
+      }
+      if (estimate > cost + bg::distance(tile_center(t), goal) + 1e-9)
+      {
+         continue;
+      }
+      stats.coarse_expanded++;
+
+      long tx = t % tiles_x;
+      long ty = t / tiles_x;
+      for (long dy = -1; dy <= 1; dy++)
+      {
+         for (long dx = -1; dx <= 1; dx++)
+         {
+            long nx = tx + dx;
+            long ny = ty + dy;
+            if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= static_cast<long>(tiles_x) || ny >= static_cast<long>(tiles_y))
+            {
+               continue;
+            }
+            size_t n = ny * tiles_x + nx;
+            if (is_blocked[n] && n != to)
+            {
+               continue;
+            }
+            if (dx != 0 && dy != 0 && (is_blocked[ty * tiles_x + nx] || is_blocked[ny * tiles_x + tx]))
+            {
+               continue;
+            }
+            double step = bg::distance(tile_center(t), tile_center(n)) * (1.0 + TILE_COVERAGE_WEIGHT * (coverage[t] + coverage[n]) / 2);
+            auto found = visited.find(n);
+            if (found == visited.end() || cost + step < found->second.cost)
+            {
+               visited[n] = {cost + step, t};
+               frontier.push({cost + step + bg::distance(tile_center(n), goal), n});
+            }
+         }
+      }
+   }
+   if (visited.find(to) == visited.end())
+   {
+      return {};
+   }
+
+   vector<size_t> route = {to};
+   while (route.back() != from)
+   {
+      route.push_back(visited[route.back()].parent);
+   }
+   reverse(route.begin(), route.end());
+   stats.route_tiles = route.size();
+   return route;
+}
+
+/**
+ * @brief shortest path of one leg, on an obstacle_map of just the obstacles around its tiles
+ * The map covers the bounding box of the tiles plus a margin of one tile, then two if that finds no path
+ * @param from start of the leg, free and inside the first tile
+ * @param to end of the leg, free and inside the last tile
+ * @param tiles coarse route tiles of the leg
+ * @param stats counts the legs, tiles and obstacles loaded
+ * @return path from from to to, empty if neither margin has one
+ */
+Line tiled_map::refine_leg(const Point &from, const Point &to, span<const size_t> tiles, tiled_path_stats &stats) const
+{
+   Boundary corridor = tile_box(tiles[0]);
+   for (size_t t : tiles)
+   {
+      bg::expand(corridor, tile_box(t));
+   }
+   for (size_t margin = 1; margin <= MAX_LEG_MARGIN; margin++)
+   {
+      double grow = margin * tile_size;
+      Boundary box(Point(max(corridor.min_corner().x() - grow, bounds.min_corner().x()), max(corridor.min_corner().y() - grow, bounds.min_corner().y())),
+                   Point(min(corridor.max_corner().x() + grow, bounds.max_corner().x()), min(corridor.max_corner().y() + grow, bounds.max_corner().y())));
+
+      /* every obstacle reaching into the box, an obstacle touching several tiles is listed by each */
+      vector<size_t> ids;
+      size_t first = tile_of(box.min_corner());
+      size_t last = tile_of(box.max_corner());
+      for (size_t ty = first / tiles_x; ty <= last / tiles_x; ty++)
+      {
+         for (size_t tx = first % tiles_x; tx <= last % tiles_x; tx++)
+         {
+            size_t t = ty * tiles_x + tx;
+            ids.insert(ids.end(), tile_obstacles.begin() + tile_start[t], tile_obstacles.begin() + tile_start[t + 1]);
+            stats.tiles_loaded++;
+         }
+      }
+      sort(ids.begin(), ids.end());
+      ids.erase(unique(ids.begin(), ids.end()), ids.end());
+      vector<obstacle> nearby;
+      for (size_t id : ids)
+      {
+         if (box_intersects_circle(box, {obstacles[id].p, obstacles[id].radius + clearance}))
+         {
+            nearby.push_back(obstacles[id]);
+         }
+      }
+      stats.legs++;
+      stats.obstacles_loaded += nearby.size();
+
+      obstacle_map leg_map(box, nearby, clearance, arc_tolerance);
+      Line leg = leg_map.find_path(from, to);
+      if (!leg.empty())
+      {
+         return leg;
+      }
+   }
+   return Line();
+}
@@ -0,0 +1,103 @@
+/**
+ * @file tiled_map.hpp
+ * @brief Tiled obstacle map for areas too large for one obstacle_map, routes are planned coarse to fine
+ *
+ * An obstacle_map keeps every bitangent between its obstacles, quadratic in their number, so it can't hold a map
+ * kilometers across with tens of thousands of keepouts. A tiled_map only buckets its obstacles into square tiles
+ * and keeps, per tile, how much of it they cover. A query runs A* over the tile grid for a coarse route, then
+ * refines the route a few tiles at a time, each leg with a small obstacle_map built from the tiles around it.
+ * The graph built per query depends on the route's footprint and the obstacles near it, not on the size of the map.
+ * Routes are close to, but not always exactly, the shortest path, since each leg ends at a waypoint picked from the coarse route.
+ */
+#ifndef __TILED_MAP_HPP_
+#define __TILED_MAP_HPP_
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+const size_t DEFAULT_LEG_TILES = 4; ///< coarse route tiles refined per leg, see tiled_map
+const double TILE_COVERAGE_WEIGHT = 4.0; ///< coarse step cost is its length * (1 + weight * covered fraction of its tiles)
+
+/**
+ * counters of one tiled_map::find_path() call
+ */
+struct tiled_path_stats
+{
+   size_t route_tiles = 0; ///< tiles on the coarse route
+   size_t coarse_expanded = 0; ///< tiles A* expanded to find the coarse route
+   size_t legs = 0; ///< obstacle_maps built and queried, retries with a wider corridor included
+   size_t tiles_loaded = 0; ///< tiles whose obstacles went into a leg, summed over legs
+   size_t obstacles_loaded = 0; ///< obstacles in the leg obstacle_maps, summed over legs
+};
+
+/**
+ * A large map split into tiles, to plan long agent -> target paths against
+ * Build it once per map, then call find_path() as often as needed. find_path() is const and keeps
+ * its state on the stack, so any number of threads may query one map
+ */
+class tiled_map
+{
+public:
+   /**
+    * @brief bucket the obstacles of a map into tiles
+    * Throws std::invalid_argument if tile_size, arc_tolerance or leg_tiles is not > 0
+    * @param bounds outer boundary, no path leaves it
+    * @param obstacles circular obstacles of the map
+    * @param tile_size side of a square tile, a little over the largest obstacle diameter works well,
+    *                  bigger tiles give straighter routes but every leg builds a bigger obstacle_map
+    * @param clearance distance every path keeps from every obstacle, added to each radius
+    * @param arc_tolerance largest gap between a sampled arc of a path and its circle
+    * @param leg_tiles coarse route tiles refined per leg, more gives straighter routes and larger legs
+    */
+   tiled_map(const Boundary &bounds, const std::vector<obstacle> &obstacles, double tile_size, double clearance = 0.0,
+             double arc_tolerance = 0.01, size_t leg_tiles = DEFAULT_LEG_TILES);
+
+   /**
+    * @brief path from agent to target, refined along a coarse route through the tiles
+    * Throws std::invalid_argument if agent or target is out of bounds or inside an obstacle
+    * @param agent first point of the path
+    * @param target last point of the path
+    * @param stats optional output, what this query loaded
+    * @return path from agent to target, or an empty Line if no route was found through the coarse corridor
+    */
+   Line find_path(const Point &agent, const Point &target, tiled_path_stats *stats = nullptr) const;
+
+   /**
+    * @brief number of tiles
+    * @return tiles across times tiles down
+    */
+   size_t num_tiles() const;
+
+   /**
+    * @brief number of obstacles
+    * @return obstacles the map was built with
+    */
+   size_t num_obstacles() const;
+
+private:
+   size_t tile_of(const Point &p) const;
+   Boundary tile_box(size_t tile) const;
+   Point tile_center(size_t tile) const;
+   bool is_free(const Point &p, size_t tile) const;
+   bool find_waypoint(size_t tile, const Point &from, const Point &toward, Point &waypoint) const;
+   std::vector<size_t> coarse_route(size_t from, size_t to, tiled_path_stats &stats) const;
+   Line refine_leg(const Point &from, const Point &to, std::span<const size_t> tiles, tiled_path_stats &stats) const;
+
+   Boundary bounds; ///< outer boundary of the map
+   double tile_size; ///< side of a tile
+   double clearance; ///< added to every obstacle radius
+   double arc_tolerance; ///< handed to every leg's obstacle_map
+   size_t leg_tiles; ///< coarse route tiles per leg
+   size_t tiles_x; ///< tiles across
+   size_t tiles_y; ///< tiles down
+   std::vector<obstacle> obstacles; ///< obstacles in the order they were provided
+   std::vector<size_t> tile_start; ///< obstacles touching tile t are tile_obstacles[tile_start[t]] up to tile_obstacles[tile_start[t + 1]]
+   std::vector<size_t> tile_obstacles; ///< indices into obstacles, tile by tile
+   std::vector<double> coverage; ///< fraction of each tile covered by grown obstacles, at most 1
+   std::vector<char> is_blocked; ///< tile lies entirely inside one grown obstacle, the coarse route avoids it
+};
+
+#endif  // __TILED_MAP_HPP_
@@ -18,6 +18,10 @@
 //#define TEST_3
 #define TEST_4
 
+// Uncomment to solve the whole agent x target cost matrix for minimum total
+// path length instead of the default greedy per-target bidding
+//#define USE_OPTIMAL_ASSIGNMENT
+
 using namespace std;
 
 /**
@@ -92,7 +96,12 @@ int main(void)
     agents.push_back({Point(1.0, 4.0)});
 #endif // TEST_4
 
-    results = pathfind(bounds, agents, targets, obstacles);
+    pathfind_config config;
+#ifdef USE_OPTIMAL_ASSIGNMENT
+    config.assignment = assignment_mode::OPTIMAL;
+#endif // USE_OPTIMAL_ASSIGNMENT
+
+    results = pathfind(bounds, agents, targets, obstacles, config);
     print_result(bounds, obstacles, results);
     return 0;
 }
@@ -0,0 +1,413 @@
+/**
+ * @file loadgen.cpp
+ * @brief Load generator for pathfinding_server- reports throughput and tail latency as one JSON line
+ *
+ * Requests are built up front from the scenario file the server loaded, then every connection keeps a fixed number of
+ * requests in flight, sending the next one as each response arrives. Latency is measured per request from send to
+ * response, along with the size of the server batch each request was planned in. Run with --help for the list of options
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "scenario_io.hpp"
+#include "protocol.hpp"
+
+using namespace std;
+using steady = chrono::steady_clock;
+
+const double POINT_CLEARANCE = 0.1; ///< sampled points keep this far off obstacles and the boundary
+const size_t MAX_SAMPLE_TRIES = 100000; ///< give up placing a point after this many rejections
+
+/**
+ * command line options of the load generator
+ */
+struct loadgen_options
+{
+   string socket_path = DEFAULT_SOCKET_PATH; ///< where the server listens
+   string map_name; ///< name the server loaded the map under
+   string map_path; ///< the same scenario file, for its bounds, obstacles, agents and targets
+   size_t connections = 4; ///< client connections, one thread each
+   size_t in_flight = 8; ///< requests outstanding per connection
+   size_t requests = 10000; ///< timed requests across all connections
+   size_t warmup = 100; ///< untimed requests sent first, one at a time
+   size_t num_agents = 0; ///< agents per request, 0 reuses the agents and targets of the scenario
+   size_t num_targets = 0; ///< targets per request when num_agents is set, 0 means num_agents
+   uint64_t seed = 1; ///< seed for sampled agents and targets
+};
+
+/**
+ * @brief print usage to STDERR
+ * @param program argv[0]
+ */
+static void print_usage(const char *program)
+{
+   cerr << "usage: " << program << " --map NAME=FILE [options]\n"
+        << "  --map NAME=FILE                map name on the server, and the scenario file it was loaded from\n"
+        << "  --socket PATH                  server socket (" << DEFAULT_SOCKET_PATH << ")\n"
+        << "  --connections N                client connections (4)\n"
+        << "  --in-flight N                  requests outstanding per connection, at most " << MAX_IN_FLIGHT << " (8)\n"
+        << "  --requests N                   timed requests across all connections (10000)\n"
+        << "  --warmup N                     untimed requests sent first, one at a time (100)\n"
+        << "  --agents N                     sample N free agents per request, 0 reuses the scenario's own (0)\n"
+        << "  --targets N                    sampled targets per request (same as --agents)\n"
+        << "  --seed N                       seed for sampled agents and targets (1)\n";
+}
+
+/**
+ * @brief parse argv into loadgen_options
+ * Throws std::invalid_argument on an unknown option or a missing value
+ * @param argc from main()
+ * @param argv from main()
+ * @return parsed options
+ */
+static loadgen_options parse_options(int argc, char **argv)
+{
+   loadgen_options opts;
+   for (int i = 1; i < argc; i++)
+   {
+      string key = argv[i];
+      if (key == "--help")
+      {
+         print_usage(argv[0]);
+         exit(0);
+      }
+      if (i + 1 >= argc)
+      {
+         throw invalid_argument("ERROR: missing value for " + key);
+      }
+      string value = argv[++i];
+
+      if (key == "--map")
+      {
+         size_t split = value.find('=');
+         if (split == string::npos || split == 0)
+         {
+            throw invalid_argument("ERROR: --map wants NAME=FILE, got " + value);
+         }
+         opts.map_name = value.substr(0, split);
+         opts.map_path = value.substr(split + 1);
+      }
+      else if (key == "--socket")
+      {
+         opts.socket_path = value;
+      }
+      else if (key == "--connections")
+      {
+         opts.connections = max(stoul(value), 1ul);
+      }
+      else if (key == "--in-flight")
+      {
+         // the server stops reading past MAX_IN_FLIGHT, and this client only reads once its window is sent
+         opts.in_flight = clamp(stoul(value), 1ul, MAX_IN_FLIGHT);
+      }
+      else if (key == "--requests")
+      {
+         opts.requests = stoul(value);
+      }
+      else if (key == "--warmup")
+      {
+         opts.warmup = stoul(value);
+      }
+      else if (key == "--agents")
+      {
+         opts.num_agents = stoul(value);
+      }
+      else if (key == "--targets")
+      {
+         opts.num_targets = stoul(value);
+      }
+      else if (key == "--seed")
+      {
+         opts.seed = stoull(value);
+      }
+      else
+      {
+         throw invalid_argument("ERROR: unknown option " + key);
+      }
+   }
+   if (opts.map_name.empty())
+   {
+      throw invalid_argument("ERROR: --map is required");
+   }
+   return opts;
+}
+
+/**
+ * @brief sample a point inside the bounds that keeps clear of every obstacle
+ * Throws std::runtime_error if no such point turns up
+ * @param s scenario giving bounds and obstacles
+ * @param rng random source
+ * @return free point
+ */
+static Point sample_free_point(const scenario &s, mt19937_64 &rng)
+{
+   uniform_real_distribution<double> xs(s.bounds.min_corner().x() + POINT_CLEARANCE, s.bounds.max_corner().x() - POINT_CLEARANCE);
+   uniform_real_distribution<double> ys(s.bounds.min_corner().y() + POINT_CLEARANCE, s.bounds.max_corner().y() - POINT_CLEARANCE);
+   for (size_t tries = 0; tries < MAX_SAMPLE_TRIES; tries++)
+   {
+      Point p(xs(rng), ys(rng));
+      bool clear = none_of(s.obstacles.begin(), s.obstacles.end(), [&](const obstacle &o)
+                           { return bg::distance(p, o.p) < o.radius + POINT_CLEARANCE; });
+      if (clear)
+      {
+         return p;
+      }
+   }
+   throw runtime_error("ERROR: no free point found in " + s.name);
+}
+
+/**
+ * @brief connect to the server
+ * Throws std::runtime_error if it isn't listening
+ * @param path socket path
+ * @return connected socket
+ */
+static int connect_to(const string &path)
+{
+   sockaddr_un address = {};
+   address.sun_family = AF_UNIX;
+   if (path.size() >= sizeof(address.sun_path))
+   {
+      throw runtime_error("ERROR: socket path too long: " + path);
+   }
+   path.copy(address.sun_path, path.size());
+
+   int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+   {
+      string why = strerror(errno);
+      if (fd >= 0)
+      {
+         ::close(fd);
+      }
+      throw runtime_error("ERROR: cannot connect to " + path + ": " + why);
+   }
+   return fd;
+}
+
+/**
+ * timing and outcome of every request sent on one connection
+ */
+struct connection_result
+{
+   vector<double> latencies_us; ///< send to response, one per answered request
+   size_t errors = 0; ///< responses with !ok
+   size_t batch_total = 0; ///< sum of the batch sizes reported in responses
+   size_t batch_max = 0; ///< largest batch size reported in a response
+   string failure; ///< set if the connection itself failed
+};
+
+/**
+ * @brief send frames[first, first + count) on one connection, keeping in_flight outstanding
+ * Request ids index frames, so a response finds its send time directly
+ * @param opts socket path and in-flight depth
+ * @param frames every encoded request
+ * @param first first frame to send
+ * @param count frames to send
+ * @param out filled with latencies and errors
+ */
+static void drive_connection(const loadgen_options &opts, const vector<vector<char>> &frames, size_t first, size_t count,
+                             connection_result &out)
+{
+   vector<steady::time_point> sent_at(count);
+   vector<char> payload;
+   plan_response response;
+   out.latencies_us.reserve(count);
+   int fd = -1;
+   try
+   {
+      fd = connect_to(opts.socket_path);
+      size_t next = 0;
+      size_t received = 0;
+      while (received < count)
+      {
+         while (next < count && next - received < opts.in_flight)
+         {
+            sent_at[next] = steady::now();
+            write_frame(fd, frames[first + next]);
+            next++;
+         }
+         if (!read_frame(fd, payload))
+         {
+            throw runtime_error("ERROR: server closed the connection");
+         }
+         steady::time_point now = steady::now();
+         decode_response(payload, response);
+         if (response.id < first || response.id >= first + count)
+         {
+            throw runtime_error("ERROR: response for unknown request " + to_string(response.id) +
+                                (response.ok ? string() : ": " + response.error));
+         }
+         out.latencies_us.push_back(chrono::duration<double, micro>(now - sent_at[response.id - first]).count());
+         if (!response.ok)
+         {
+            out.errors++;
+         }
+         out.batch_total += response.batch;
+         out.batch_max = max(out.batch_max, static_cast<size_t>(response.batch));
+         received++;
+      }
+   }
+   catch (const exception &e)
+   {
+      out.failure = e.what();
+   }
+   if (fd >= 0)
+   {
+      ::close(fd);
+   }
+}
+
+/**
+ * @brief value at quantile q of sorted samples
+ * @param sorted ascending samples, not empty
+ * @param q quantile in [0, 1]
+ * @return nearest-rank percentile
+ */
+static double percentile(const vector<double> &sorted, double q)
+{
+   size_t rank = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+   return sorted[min(rank, sorted.size() - 1)];
+}
+
+int main(int argc, char **argv)
+{
+   loadgen_options opts;
+   scenario s;
+   try
+   {
+      opts = parse_options(argc, argv);
+      ifstream in(opts.map_path, ios::binary);
+      if (!in)
+      {
+         throw runtime_error("ERROR: cannot open " + opts.map_path);
+      }
+      scenario_reader reader(in);
+      if (!reader.next(s))
+      {
+         throw runtime_error("ERROR: no scenario in " + opts.map_path);
+      }
+   }
+   catch (const exception &e)
+   {
+      cerr << e.what() << "\n";
+      print_usage(argv[0]);
+      return 1;
+   }
+
+   /* encode every request before the clock starts, ids double as indices into frames */
+   size_t total = opts.warmup + opts.requests;
+   vector<vector<char>> frames(total);
+   mt19937_64 rng(opts.seed);
+   plan_request request;
+   request.map = opts.map_name;
+   try
+   {
+      for (size_t i = 0; i < total; i++)
+      {
+         request.id = static_cast<uint32_t>(i);
+         if (opts.num_agents == 0)
+         {
+            request.agents = s.agents;
+            request.targets = s.targets;
+         }
+         else
+         {
+            size_t num_targets = (opts.num_targets == 0) ? opts.num_agents : opts.num_targets;
+            request.agents.clear();
+            request.targets.clear();
+            for (size_t k = 0; k < opts.num_agents; k++)
+            {
+               request.agents.push_back(sample_free_point(s, rng));
+            }
+            for (size_t k = 0; k < num_targets; k++)
+            {
+               request.targets.push_back(sample_free_point(s, rng));
+            }
+         }
+         encode_request(request, frames[i]);
+      }
+   }
+   catch (const exception &e)
+   {
+      cerr << e.what() << "\n";
+      return 1;
+   }
+
+   connection_result warmup;
+   drive_connection(opts, frames, 0, opts.warmup, warmup);
+   if (!warmup.failure.empty())
+   {
+      cerr << warmup.failure << "\n";
+      return 1;
+   }
+
+   /* split the timed requests evenly, earlier connections take the remainder */
+   vector<connection_result> results(opts.connections);
+   vector<thread> clients;
+   size_t first = opts.warmup;
+   steady::time_point start = steady::now();
+   for (size_t c = 0; c < opts.connections; c++)
+   {
+      size_t count = opts.requests / opts.connections + ((c < opts.requests % opts.connections) ? 1 : 0);
+      clients.emplace_back(drive_connection, cref(opts), cref(frames), first, count, ref(results[c]));
+      first += count;
+   }
+   for (auto &t : clients)
+   {
+      t.join();
+   }
+   double elapsed_s = chrono::duration<double>(steady::now() - start).count();
+
+   vector<double> latencies;
+   size_t errors = 0;
+   size_t batch_total = 0;
+   size_t batch_max = 0;
+   for (auto &r : results)
+   {
+      if (!r.failure.empty())
+      {
+         cerr << r.failure << "\n";
+         return 1;
+      }
+      latencies.insert(latencies.end(), r.latencies_us.begin(), r.latencies_us.end());
+      errors += r.errors;
+      batch_total += r.batch_total;
+      batch_max = max(batch_max, r.batch_max);
+   }
+   sort(latencies.begin(), latencies.end());
+   double mean = 0;
+   for (double l : latencies)
+   {
+      mean += l;
+   }
+   mean = latencies.empty() ? 0 : mean / latencies.size();
+   auto at = [&](double q) { return latencies.empty() ? 0 : percentile(latencies, q); };
+
+   cout << fixed << setprecision(1)
+        << "{\"map\":\"" << opts.map_name << "\",\"connections\":" << opts.connections << ",\"in_flight\":" << opts.in_flight
+        << ",\"requests\":" << latencies.size() << ",\"errors\":" << errors
+        << ",\"elapsed_s\":" << setprecision(3) << elapsed_s << setprecision(1)
+        << ",\"requests_per_sec\":" << ((elapsed_s > 0) ? latencies.size() / elapsed_s : 0)
+        << ",\"latency_us\":{\"mean\":" << mean << ",\"p50\":" << at(0.5) << ",\"p99\":" << at(0.99)
+        << ",\"p999\":" << at(0.999) << ",\"max\":" << at(1.0) << "}"
+        << ",\"batch\":{\"mean\":" << setprecision(2) << (latencies.empty() ? 0 : static_cast<double>(batch_total) / latencies.size())
+        << ",\"max\":" << batch_max << "}}\n";
+   return 0;
+}
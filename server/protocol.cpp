@@ -0,0 +1,238 @@
+/**
+ * @file protocol.cpp
+ * @brief Wire format between pathfinding_server and its clients, over a Unix domain stream socket
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "protocol.hpp"
+#include "byte_codec.hpp"
+
+using namespace std;
+
+/**
+ * @brief start a frame, leaving room for the length prefix
+ * @param frame cleared, then holds the placeholder prefix
+ */
+static void begin_frame(vector<char> &frame)
+{
+   frame.clear();
+   put_u32(frame, 0); // patched by end_frame() once the payload size is known
+}
+
+/**
+ * @brief append the batch size of a response
+ * @param frame frame being encoded
+ * @param batch requests planned in the same batch, saturated to fit a uint16
+ */
+static void put_batch(vector<char> &frame, size_t batch)
+{
+   put_u16(frame, static_cast<uint16_t>(min(batch, static_cast<size_t>(UINT16_MAX))));
+}
+
+/**
+ * @brief fill in the length prefix of a finished frame
+ * @param frame frame from begin_frame() with its payload appended
+ */
+static void end_frame(vector<char> &frame)
+{
+   patch_u32(frame, 0, frame.size() - 4);
+}
+
+void encode_request(const plan_request &request, vector<char> &frame)
+{
+   size_t name_length = min(request.map.size(), static_cast<size_t>(UINT16_MAX));
+   begin_frame(frame);
+   put_u32(frame, request.id);
+   put_u16(frame, static_cast<uint16_t>(name_length));
+   frame.insert(frame.end(), request.map.begin(), request.map.begin() + name_length);
+   put_u32(frame, request.agents.size());
+   for (auto &p : request.agents)
+   {
+      put_point(frame, p);
+   }
+   put_u32(frame, request.targets.size());
+   for (auto &p : request.targets)
+   {
+      put_point(frame, p);
+   }
+   end_frame(frame);
+}
+
+void decode_request(const vector<char> &payload, plan_request &request)
+{
+   record_cursor cursor = {payload.data(), payload.data() + payload.size(), "request"};
+   request.id = cursor.get_uint(4);
+   size_t name_length = cursor.get_uint(2);
+   const char *name = cursor.take(name_length);
+   request.map.assign(name, name_length);
+   request.agents.resize(cursor.get_count(16));
+   for (auto &p : request.agents)
+   {
+      p = cursor.get_point();
+   }
+   request.targets.resize(cursor.get_count(16));
+   for (auto &p : request.targets)
+   {
+      p = cursor.get_point();
+   }
+}
+
+void encode_results(uint32_t id, size_t batch, const local_frame &coords, const path_buffer &results, vector<char> &frame)
+{
+   begin_frame(frame);
+   put_u32(frame, id);
+   frame.push_back(static_cast<char>(RESPONSE_OK));
+   put_batch(frame, batch);
+   put_point(frame, coords.origin);
+   put_u32(frame, path_buffer_size(results));
+   for (size_t i = 0; i < path_buffer_size(results); i++)
+   {
+      put_u32(frame, static_cast<uint32_t>(results.ids[i]));
+      put_point(frame, results.agents[i]);
+      put_point(frame, results.targets[i]);
+      span<const Point> path = path_buffer_path(results, i);
+      put_u32(frame, path.size());
+      for (auto &p : path)
+      {
+         compact_point c = to_compact_point(coords, p);
+         put_f32(frame, c.x);
+         put_f32(frame, c.y);
+      }
+   }
+   end_frame(frame);
+}
+
+void encode_error(uint32_t id, size_t batch, const string &message, vector<char> &frame)
+{
+   size_t message_length = min(message.size(), static_cast<size_t>(UINT16_MAX));
+   begin_frame(frame);
+   put_u32(frame, id);
+   frame.push_back(static_cast<char>(RESPONSE_ERROR));
+   put_batch(frame, batch);
+   put_u16(frame, static_cast<uint16_t>(message_length));
+   frame.insert(frame.end(), message.begin(), message.begin() + message_length);
+   end_frame(frame);
+}
+
+void decode_response(const vector<char> &payload, plan_response &response)
+{
+   record_cursor cursor = {payload.data(), payload.data() + payload.size(), "response"};
+   response.id = cursor.get_uint(4);
+   uint8_t status = cursor.get_uint(1);
+   response.batch = cursor.get_uint(2);
+   path_buffer_clear(response.results);
+   response.error.clear();
+   if (status == RESPONSE_ERROR)
+   {
+      size_t message_length = cursor.get_uint(2);
+      const char *message = cursor.take(message_length);
+      response.error.assign(message, message_length);
+      response.ok = false;
+      return;
+   }
+   if (status != RESPONSE_OK)
+   {
+      throw runtime_error("ERROR: response has unknown status " + to_string(status));
+   }
+
+   local_frame coords = {cursor.get_point()};
+   // smallest result is id, agent, target and a point count
+   size_t count = cursor.get_count(40);
+   for (size_t i = 0; i < count; i++)
+   {
+      response.results.ids.push_back(static_cast<int32_t>(cursor.get_uint(4)));
+      response.results.agents.push_back(cursor.get_point());
+      response.results.targets.push_back(cursor.get_point());
+      size_t num_points = cursor.get_count(8);
+      for (size_t k = 0; k < num_points; k++)
+      {
+         compact_point c;
+         c.x = cursor.get_f32();
+         c.y = cursor.get_f32();
+         response.results.points.push_back(from_compact_point(coords, c));
+      }
+      response.results.offsets.push_back(response.results.points.size());
+   }
+   response.ok = true;
+}
+
+/**
+ * @brief read exactly n bytes, retrying short reads and signals
+ * @param fd connected socket
+ * @param buf destination
+ * @param n bytes to read
+ * @return bytes read, less than n only if the peer closed the connection
+ */
+static size_t read_fully(int fd, char *buf, size_t n)
+{
+   size_t done = 0;
+   while (done < n)
+   {
+      ssize_t got = ::read(fd, buf + done, n - done);
+      if (got == 0)
+      {
+         break;
+      }
+      if (got < 0)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+         throw runtime_error(string("ERROR: socket read failed: ") + strerror(errno));
+      }
+      done += got;
+   }
+   return done;
+}
+
+bool read_frame(int fd, vector<char> &payload)
+{
+   char length_bytes[4];
+   size_t got = read_fully(fd, length_bytes, sizeof(length_bytes));
+   if (got == 0)
+   {
+      return false;
+   }
+   if (got != sizeof(length_bytes))
+   {
+      throw runtime_error("ERROR: connection closed inside a frame");
+   }
+   record_cursor length_cursor = {length_bytes, length_bytes + sizeof(length_bytes), "frame"};
+   uint32_t length = length_cursor.get_uint(4);
+   if (length > MAX_FRAME_SIZE)
+   {
+      throw runtime_error("ERROR: frame of " + to_string(length) + " bytes exceeds MAX_FRAME_SIZE");
+   }
+   payload.resize(length);
+   if (read_fully(fd, payload.data(), length) != length)
+   {
+      throw runtime_error("ERROR: connection closed inside a frame");
+   }
+   return true;
+}
+
+void write_frame(int fd, const vector<char> &frame)
+{
+   size_t done = 0;
+   while (done < frame.size())
+   {
+      // MSG_NOSIGNAL, a client that hung up is an error for this connection and not a SIGPIPE for the process
+      ssize_t sent = ::send(fd, frame.data() + done, frame.size() - done, MSG_NOSIGNAL);
+      if (sent < 0)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+         throw runtime_error(string("ERROR: socket write failed: ") + strerror(errno));
+      }
+      done += sent;
+   }
+}
@@ -0,0 +1,124 @@
+/**
+ * @file protocol.hpp
+ * @brief Wire format between pathfinding_server and its clients, over a Unix domain stream socket
+ *
+ * Every message is a frame, a uint32 payload length and then the payload. Integers and doubles are little-endian
+ * (see byte_codec.hpp). A client may send many requests without waiting, responses come back as each plan
+ * finishes, not in request order, and carry the id of their request. The server reads at most MAX_IN_FLIGHT requests
+ * of one connection ahead of the responses it has written, and stops reading the connection until one is sent, so a
+ * client that pipelines deeply must keep reading responses while it sends.
+ *
+ *   request   uint32 request id, uint16 map name length, map name bytes,
+ *             uint32 agent count, 2 x double per agent,
+ *             uint32 target count, 2 x double per target
+ *   response  uint32 request id, uint8 status, uint16 batch size, then
+ *             status 0 (ok)     2 x double frame origin, uint32 result count, then per result:
+ *                               int32 id, 2 x double agent, 2 x double target, uint32 point count, 2 x float per point
+ *             status 1 (error)  uint16 message length, message bytes
+ *
+ * The batch size is how many requests the server planned back to back in the batch that held this one, 0 for an error
+ * raised before planning, such as a malformed frame.
+ *
+ * Path points go out as compact_points, float32 offsets from a local_frame at the center of the map (see
+ * compact_coords.hpp), half the bytes of doubles. Decoded points are within compact_resolution() of the planned ones,
+ * agents and targets stay doubles and come back exact.
+ */
+#ifndef __PROTOCOL_HPP_
+#define __PROTOCOL_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "compact_coords.hpp"
+
+const char DEFAULT_SOCKET_PATH[] = "/tmp/pathfinding.sock"; ///< where the server listens unless told otherwise
+const uint32_t MAX_FRAME_SIZE = 64u << 20; ///< refuse frames claiming more bytes than this
+const size_t MAX_IN_FLIGHT = 256; ///< requests of one connection the server holds unanswered before it stops reading
+const uint8_t RESPONSE_OK = 0; ///< response status, results follow
+const uint8_t RESPONSE_ERROR = 1; ///< response status, a message follows
+
+/**
+ * one plan against a named map of the server
+ */
+struct plan_request
+{
+   uint32_t id = 0; ///< chosen by the client, echoed in the response
+   std::string map; ///< name the map was loaded under
+   std::vector<Point> agents; ///< agent positions
+   std::vector<Point> targets; ///< target positions
+};
+
+/**
+ * the answer to one plan_request
+ */
+struct plan_response
+{
+   uint32_t id = 0; ///< id of the request
+   bool ok = false; ///< false if the plan threw or the request was bad
+   uint16_t batch = 0; ///< requests planned in the same batch as this one, 0 if it never reached a worker
+   std::string error; ///< exception message when !ok
+   path_buffer results; ///< plan results when ok, path points restored from their compact_points
+};
+
+/**
+ * @brief encode a request as one frame
+ * @param request request to send
+ * @param frame overwritten with the frame, length prefix included
+ */
+void encode_request(const plan_request &request, std::vector<char> &frame);
+
+/**
+ * @brief decode a request payload
+ * Throws std::runtime_error if the payload is truncated or malformed
+ * @param payload frame payload from read_frame()
+ * @param request overwritten, its vectors keep their capacity
+ */
+void decode_request(const std::vector<char> &payload, plan_request &request);
+
+/**
+ * @brief encode the results of a plan as one frame
+ * @param id id of the request
+ * @param batch requests planned in the same batch, capped at 65535
+ * @param coords frame the path points are sent in, make_local_frame() of the map bounds
+ * @param results results from Planner::plan_into()
+ * @param frame overwritten with the frame, length prefix included
+ */
+void encode_results(uint32_t id, size_t batch, const local_frame &coords, const path_buffer &results, std::vector<char> &frame);
+
+/**
+ * @brief encode a failed plan as one frame
+ * @param id id of the request
+ * @param batch requests planned in the same batch, 0 if the request never reached a worker
+ * @param message what went wrong, truncated to 65535 bytes
+ * @param frame overwritten with the frame, length prefix included
+ */
+void encode_error(uint32_t id, size_t batch, const std::string &message, std::vector<char> &frame);
+
+/**
+ * @brief decode a response payload
+ * Throws std::runtime_error if the payload is truncated or malformed
+ * @param payload frame payload from read_frame()
+ * @param response overwritten, its buffers keep their capacity
+ */
+void decode_response(const std::vector<char> &payload, plan_response &response);
+
+/**
+ * @brief read one frame from a socket, blocking
+ * Throws std::runtime_error on a socket error, a frame cut off by the peer, or one larger than MAX_FRAME_SIZE
+ * @param fd connected socket
+ * @param payload overwritten with the payload, length prefix excluded
+ * @return false if the peer closed the connection cleanly before the next frame
+ */
+bool read_frame(int fd, std::vector<char> &payload);
+
+/**
+ * @brief write one whole frame to a socket, blocking
+ * Throws std::runtime_error on a socket error, such as the peer having gone away
+ * @param fd connected socket
+ * @param frame frame from one of the encode functions
+ */
+void write_frame(int fd, const std::vector<char> &frame);
+
+#endif  // __PROTOCOL_HPP_
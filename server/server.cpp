@@ -0,0 +1,684 @@
+/**
+ * @file server.cpp
+ * @brief Planning daemon- serves plans against preloaded obstacle maps over a Unix domain socket
+ *
+ * Maps are loaded and indexed once at startup, so a request only pays for its own plan. Each connection has a reader
+ * thread that decodes requests onto one shared queue. Every planning worker takes a batch as soon as it is free, the
+ * oldest queued request plus up to --batch - 1 more for the same map, and plans them back to back against one map
+ * lookup and one workspace. A slow plan only holds up its own worker. Each finished response goes to the outbox of its
+ * connection right away, and a writer thread per connection sends it, so a slow client never holds up planning. Clients can keep many
+ * requests in flight on one connection and responses arrive out of order. A reader stops reading once MAX_IN_FLIGHT
+ * requests of its connection are unanswered, so a client that pipelines faster than the workers plan can't grow the
+ * queue or its outbox without bound. On SIGINT or SIGTERM a client that stops reading its responses is cut off after
+ * SHUTDOWN_GRACE_MS, so a writer blocked on it can't hold up the shutdown.
+ * See protocol.hpp for the wire format, and run with --help for the list of options
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "pathfinding.hpp"
+#include "logging.hpp"
+#include "obstacle_index.hpp"
+#include "scenario_io.hpp"
+#include "protocol.hpp"
+
+using namespace std;
+
+const size_t DEFAULT_BATCH = 16; ///< most requests planned per batch when --batch isn't given
+const size_t MAX_SPARE_FRAMES = 16; ///< written frames a connection keeps for reuse
+const int ACCEPT_POLL_MS = 200; ///< how often the accept loop checks for a shutdown signal
+const int SHUTDOWN_GRACE_MS = 2000; ///< how long shutdown waits for clients to read their responses before cutting them off
+
+static volatile sig_atomic_t stop_requested = 0; ///< set by SIGINT or SIGTERM
+
+/**
+ * command line options of the server
+ */
+struct server_options
+{
+   string socket_path = DEFAULT_SOCKET_PATH; ///< where to listen
+   vector<pair<string, string>> maps; ///< {name, scenario file} of every map to preload
+   size_t threads = thread::hardware_concurrency(); ///< planning workers
+   size_t batch = DEFAULT_BATCH; ///< most requests one worker takes off the queue at once
+   pathfind_config config; ///< options for every plan
+   log_level level = log_level::WARNING; ///< runtime log threshold
+};
+
+/**
+ * an obstacle map, indexed once and shared read-only by every plan against it
+ */
+struct loaded_map
+{
+   Boundary bounds; ///< outer boundary box
+   obstacle_index index; ///< obstacles of the map
+   local_frame coords; ///< frame path points are sent in, centered on bounds
+};
+
+/**
+ * one client connection, shared by its reader thread, its writer thread and every queued request from it
+ * The socket is closed once the reader is done and the writer has sent the last response
+ */
+struct connection
+{
+   int fd; ///< connected socket
+   mutex state_mutex; ///< guards the fields below
+   condition_variable has_work; ///< signalled when a frame is queued and when the reader finishes
+   condition_variable has_room; ///< signalled when the writer sends a response
+   deque<vector<char>> outbox; ///< response frames waiting for the writer, oldest first
+   vector<vector<char>> spares; ///< frames already written, handed back out by send() so their memory is reused
+   size_t unanswered = 0; ///< requests read but not written yet
+   bool reader_done = false; ///< no more requests will be read
+   bool broken = false; ///< set after a failed write, later responses are dropped
+
+   explicit connection(int fd) : fd(fd) {}
+   ~connection() { ::close(fd); }
+
+   /**
+    * @brief count a request the writer must wait for, call before it is queued
+    * Blocks while MAX_IN_FLIGHT requests are unanswered, until the writer sends one
+    */
+   void expect_response()
+   {
+      unique_lock<mutex> lock(state_mutex);
+      has_room.wait(lock, [this] { return unanswered < MAX_IN_FLIGHT; });
+      unanswered++;
+   }
+
+   /**
+    * @brief queue the response to one expected request for the writer
+    * @param frame response frame, swapped with a spare frame so the caller can encode into it again
+    */
+   void send(vector<char> &frame)
+   {
+      {
+         lock_guard<mutex> lock(state_mutex);
+         outbox.emplace_back();
+         swap(outbox.back(), frame);
+         if (!spares.empty())
+         {
+            swap(frame, spares.back());
+            spares.pop_back();
+         }
+      }
+      has_work.notify_one();
+   }
+
+   /**
+    * @brief tell the writer no more requests are coming, it exits once every expected response is written
+    */
+   void finish_reading()
+   {
+      {
+         lock_guard<mutex> lock(state_mutex);
+         reader_done = true;
+      }
+      has_work.notify_one();
+   }
+};
+
+/**
+ * a decoded request waiting for a worker
+ */
+struct queued_request
+{
+   shared_ptr<connection> client; ///< where to send the response
+   plan_request request; ///< what to plan
+};
+
+/**
+ * Requests from every connection, taken a batch at a time by the planning workers
+ */
+class request_queue
+{
+public:
+   /**
+    * @param workers planning workers sharing the queue, a batch never takes more than its share of what is queued
+    * @param max_batch most requests taken by one pop()
+    */
+   request_queue(size_t workers, size_t max_batch) : workers(max(workers, static_cast<size_t>(1))), max_batch(max(max_batch, static_cast<size_t>(1))) {}
+
+   /**
+    * @brief add a request and wake a worker
+    * @param item request to add
+    */
+   void push(queued_request &&item)
+   {
+      {
+         lock_guard<mutex> lock(state_mutex);
+         items.push_back(move(item));
+      }
+      ready.notify_one();
+   }
+
+   /**
+    * @brief wait for a request, then take the oldest one and the next queued ones for the same map
+    * A batch takes at most max_batch requests and at most its share of the queue split across the workers, so a
+    * backlog is spread over every worker instead of landing on the first one awake
+    * @param batch overwritten with the requests taken, oldest first
+    * @return false once the queue is closed and empty
+    */
+   bool pop(vector<queued_request> &batch)
+   {
+      batch.clear();
+      unique_lock<mutex> lock(state_mutex);
+      ready.wait(lock, [this] { return closed || !items.empty(); });
+      if (items.empty())
+      {
+         return false;
+      }
+      size_t limit = min(max_batch, (items.size() + workers - 1) / workers);
+      batch.push_back(move(items.front()));
+      items.pop_front();
+      for (auto it = items.begin(); it != items.end() && batch.size() < limit;)
+      {
+         if (it->request.map == batch.front().request.map)
+         {
+            batch.push_back(move(*it));
+            it = items.erase(it);
+         }
+         else
+         {
+            ++it;
+         }
+      }
+      return true;
+   }
+
+   /**
+    * @brief let the workers finish what is queued and stop
+    */
+   void close()
+   {
+      {
+         lock_guard<mutex> lock(state_mutex);
+         closed = true;
+      }
+      ready.notify_all();
+   }
+
+private:
+   mutex state_mutex; ///< guards the fields below
+   condition_variable ready; ///< signalled on push and on close
+   deque<queued_request> items; ///< waiting requests, oldest first
+   bool closed = false; ///< set by close()
+   size_t workers; ///< planning workers popping batches
+   size_t max_batch; ///< most requests per batch
+};
+
+/**
+ * Connections that still have a writer thread, so shutdown can unblock their readers and wait for every response
+ */
+struct connection_registry
+{
+   mutex state_mutex; ///< guards the fields below
+   condition_variable all_done; ///< signalled when a writer exits
+   map<int, weak_ptr<connection>> live; ///< connections by socket, while their writer runs
+};
+
+/**
+ * counters reported on shutdown
+ */
+struct server_stats
+{
+   atomic<size_t> requests{0}; ///< requests answered
+   atomic<size_t> failures{0}; ///< requests answered with an error
+   atomic<size_t> batches{0}; ///< batches taken off the queue
+   atomic<size_t> largest_batch{0}; ///< most requests planned in one batch
+};
+
+/**
+ * @brief print usage to STDERR
+ * @param program argv[0]
+ */
+static void print_usage(const char *program)
+{
+   cerr << "usage: " << program << " --map NAME=FILE [options]\n"
+        << "  --map NAME=FILE                preload the bounds and obstacles of the first scenario in FILE as map NAME, repeatable\n"
+        << "  --socket PATH                  Unix domain socket to listen on (" << DEFAULT_SOCKET_PATH << ")\n"
+        << "  --threads N                    planning workers, at least 1 (all cores)\n"
+        << "  --batch N                      most queued requests for one map a worker plans back to back (" << DEFAULT_BATCH << ")\n"
+        << "  --mode greedy|optimal          assignment mode (greedy)\n"
+        << "  --engine hull|tangent          curved path engine (hull)\n"
+        << "  --coords double|float32        obstacle storage of every map (double)\n"
+        << "  --max-agents N                 reject requests with more agents than N (" << NUM_MAX_AGENTS << ")\n"
+        << "  --log-level debug|info|warning|error|none  diagnostics on STDERR (warning)\n";
+}
+
+/**
+ * @brief parse argv into server_options
+ * Throws std::invalid_argument on an unknown option or a missing value
+ * @param argc from main()
+ * @param argv from main()
+ * @return parsed options
+ */
+static server_options parse_options(int argc, char **argv)
+{
+   server_options opts;
+   for (int i = 1; i < argc; i++)
+   {
+      string key = argv[i];
+      if (key == "--help")
+      {
+         print_usage(argv[0]);
+         exit(0);
+      }
+      if (i + 1 >= argc)
+      {
+         throw invalid_argument("ERROR: missing value for " + key);
+      }
+      string value = argv[++i];
+
+      if (key == "--map")
+      {
+         size_t split = value.find('=');
+         if (split == string::npos || split == 0)
+         {
+            throw invalid_argument("ERROR: --map wants NAME=FILE, got " + value);
+         }
+         opts.maps.push_back({value.substr(0, split), value.substr(split + 1)});
+      }
+      else if (key == "--socket")
+      {
+         opts.socket_path = value;
+      }
+      else if (key == "--threads")
+      {
+         opts.threads = stoul(value);
+      }
+      else if (key == "--batch")
+      {
+         opts.batch = max(stoul(value), 1ul);
+      }
+      else if (key == "--mode")
+      {
+         if (value != "greedy" && value != "optimal")
+         {
+            throw invalid_argument("ERROR: unknown mode " + value);
+         }
+         opts.config.assignment = (value == "optimal") ? assignment_mode::OPTIMAL : assignment_mode::GREEDY;
+      }
+      else if (key == "--engine")
+      {
+         if (value != "hull" && value != "tangent")
+         {
+            throw invalid_argument("ERROR: unknown engine " + value);
+         }
+         opts.config.engine = (value == "tangent") ? path_engine::TANGENT : path_engine::HULL;
+      }
+      else if (key == "--coords")
+      {
+         if (value != "double" && value != "float32")
+         {
+            throw invalid_argument("ERROR: unknown coordinate mode " + value);
+         }
+         opts.config.coordinates = (value == "float32") ? coordinate_mode::FLOAT32 : coordinate_mode::DOUBLE;
+      }
+      else if (key == "--max-agents")
+      {
+         opts.config.max_agents = stoul(value);
+      }
+      else if (key == "--log-level")
+      {
+         const vector<pair<string, log_level>> levels = {
+             {"debug", log_level::DEBUG}, {"info", log_level::INFO}, {"warning", log_level::WARNING},
+             {"error", log_level::ERROR}, {"none", log_level::NONE}};
+         bool found = false;
+         for (auto &entry : levels)
+         {
+            if (entry.first == value)
+            {
+               opts.level = entry.second;
+               found = true;
+            }
+         }
+         if (!found)
+         {
+            throw invalid_argument("ERROR: unknown log level " + value);
+         }
+      }
+      else
+      {
+         throw invalid_argument("ERROR: unknown option " + key);
+      }
+   }
+   if (opts.maps.empty())
+   {
+      throw invalid_argument("ERROR: at least one --map is required");
+   }
+   return opts;
+}
+
+/**
+ * @brief load the first scenario of a file as a map
+ * Throws std::runtime_error if the file can't be read or holds no scenario
+ * @param path scenario file, binary or text
+ * @param mode storage mode of the obstacle index
+ * @return the map, indexed
+ */
+static loaded_map load_map(const string &path, coordinate_mode mode)
+{
+   ifstream in(path, ios::binary);
+   if (!in)
+   {
+      throw runtime_error("ERROR: cannot open " + path);
+   }
+   scenario_reader reader(in);
+   scenario s;
+   if (!reader.next(s))
+   {
+      throw runtime_error("ERROR: no scenario in " + path);
+   }
+   return loaded_map{s.bounds, build_obstacle_index(s.obstacles, mode), make_local_frame(s.bounds)};
+}
+
+/**
+ * @brief plan a batch of requests for one map back to back, handing each response to its connection as it is ready
+ * Runs on a planning worker, each worker keeps its own workspace and buffers across batches
+ * @param planner Planner shared by every worker
+ * @param maps every loaded map
+ * @param batch requests from request_queue::pop(), all for the same map
+ * @param stats counters to update
+ */
+static void answer_batch(const Planner &planner, const map<string, loaded_map> &maps, const vector<queued_request> &batch, server_stats &stats)
+{
+   thread_local path_buffer results;
+   thread_local plan_workspace workspace;
+   thread_local vector<char> frame;
+
+   auto found = maps.find(batch.front().request.map);
+   for (auto &item : batch)
+   {
+      const plan_request &request = item.request;
+      if (found == maps.end())
+      {
+         encode_error(request.id, batch.size(), "ERROR: unknown map " + request.map, frame);
+         stats.failures++;
+      }
+      else
+      {
+         try
+         {
+            planner.plan_into(found->second.bounds, request.agents, request.targets, found->second.index, results, workspace);
+            encode_results(request.id, batch.size(), found->second.coords, results, frame);
+         }
+         catch (const exception &e)
+         {
+            encode_error(request.id, batch.size(), e.what(), frame);
+            stats.failures++;
+         }
+      }
+      stats.requests++;
+      item.client->send(frame);
+   }
+   stats.batches++;
+   size_t largest = stats.largest_batch;
+   while (batch.size() > largest && !stats.largest_batch.compare_exchange_weak(largest, batch.size()))
+   {
+   }
+}
+
+/**
+ * @brief take the next batch off the queue and answer it, until the queue closes
+ * @param planner Planner shared by every worker
+ * @param maps every loaded map
+ * @param queue where requests come from
+ * @param stats counters to update
+ */
+static void plan_requests(const Planner &planner, const map<string, loaded_map> &maps, request_queue &queue, server_stats &stats)
+{
+   vector<queued_request> batch;
+   while (queue.pop(batch))
+   {
+      answer_batch(planner, maps, batch, stats);
+      // drop the connections now rather than when the next batch arrives
+      batch.clear();
+   }
+}
+
+/**
+ * @brief read requests off one connection until it closes, queueing each
+ * A malformed frame is answered with an error for request id 0, then the connection is dropped
+ * @param client connection to read
+ * @param queue where requests go
+ */
+static void read_requests(shared_ptr<connection> client, request_queue &queue)
+{
+   vector<char> payload;
+   try
+   {
+      while (read_frame(client->fd, payload))
+      {
+         queued_request item = {client, plan_request()};
+         decode_request(payload, item.request);
+         client->expect_response();
+         queue.push(move(item));
+      }
+   }
+   catch (const exception &e)
+   {
+      LP_LOG_WARNING("closing a client: " << e.what());
+      vector<char> frame;
+      encode_error(0, 0, e.what(), frame);
+      client->expect_response();
+      client->send(frame);
+   }
+   // no more requests, the writer sends what is still coming and the last one out closes the socket
+   ::shutdown(client->fd, SHUT_RD);
+   client->finish_reading();
+}
+
+/**
+ * @brief send the responses of one connection as they arrive in its outbox, until every expected one is sent
+ * After a failed write the rest are dropped, the reader sees the connection close
+ * @param client connection to write
+ * @param connections registry to leave on exit
+ */
+static void write_responses(shared_ptr<connection> client, connection_registry &connections)
+{
+   vector<char> frame;
+   unique_lock<mutex> lock(client->state_mutex);
+   while (true)
+   {
+      client->has_work.wait(lock, [&] { return !client->outbox.empty() || (client->reader_done && client->unanswered == 0); });
+      if (client->outbox.empty())
+      {
+         break;
+      }
+      frame = move(client->outbox.front());
+      client->outbox.pop_front();
+      bool is_broken = client->broken;
+      lock.unlock();
+      if (!is_broken)
+      {
+         try
+         {
+            write_frame(client->fd, frame);
+         }
+         catch (const exception &e)
+         {
+            LP_LOG_WARNING("dropping responses to a client: " << e.what());
+            is_broken = true;
+            ::shutdown(client->fd, SHUT_RDWR);
+         }
+      }
+      lock.lock();
+      client->broken = is_broken;
+      client->unanswered--;
+      client->has_room.notify_one();
+      if (client->spares.size() < MAX_SPARE_FRAMES)
+      {
+         client->spares.push_back(move(frame));
+      }
+      frame.clear();
+   }
+   lock.unlock();
+
+   // leave while the socket is still open, so a new connection can't be given the same fd first
+   lock_guard<mutex> registry_lock(connections.state_mutex);
+   connections.live.erase(client->fd);
+   connections.all_done.notify_all();
+}
+
+/**
+ * @brief open the listening socket, replacing a stale socket file
+ * Throws std::runtime_error if the socket can't be bound
+ * @param path socket path
+ * @return listening socket
+ */
+static int listen_on(const string &path)
+{
+   sockaddr_un address = {};
+   address.sun_family = AF_UNIX;
+   if (path.size() >= sizeof(address.sun_path))
+   {
+      throw runtime_error("ERROR: socket path too long: " + path);
+   }
+   path.copy(address.sun_path, path.size());
+
+   int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0)
+   {
+      throw runtime_error(string("ERROR: socket() failed: ") + strerror(errno));
+   }
+   ::unlink(path.c_str());
+   if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(fd, SOMAXCONN) < 0)
+   {
+      string why = strerror(errno);
+      ::close(fd);
+      throw runtime_error("ERROR: cannot listen on " + path + ": " + why);
+   }
+   return fd;
+}
+
+static void on_stop_signal(int)
+{
+   stop_requested = 1;
+}
+
+int main(int argc, char **argv)
+{
+   server_options opts;
+   try
+   {
+      opts = parse_options(argc, argv);
+   }
+   catch (const exception &e)
+   {
+      cerr << e.what() << "\n";
+      print_usage(argv[0]);
+      return 1;
+   }
+   set_log_level(opts.level);
+
+   map<string, loaded_map> maps;
+   int listen_fd = -1;
+   try
+   {
+      for (auto &[name, path] : opts.maps)
+      {
+         maps[name] = load_map(path, opts.config.coordinates);
+         cerr << "loaded map " << name << " from " << path << ", " << maps[name].index.obstacles.size() << " obstacles\n";
+      }
+      listen_fd = listen_on(opts.socket_path);
+   }
+   catch (const exception &e)
+   {
+      cerr << e.what() << "\n";
+      return 1;
+   }
+
+   struct sigaction action = {};
+   action.sa_handler = on_stop_signal;
+   sigaction(SIGINT, &action, nullptr);
+   sigaction(SIGTERM, &action, nullptr);
+
+   // parallelism is across requests, so each plan bids serially on its worker
+   opts.config.pool = nullptr;
+   Planner planner(opts.config);
+   request_queue queue(opts.threads, opts.batch);
+   connection_registry connections;
+   server_stats stats;
+
+   vector<thread> workers;
+   for (size_t i = 0; i < max(opts.threads, static_cast<size_t>(1)); i++)
+   {
+      workers.emplace_back(plan_requests, cref(planner), cref(maps), ref(queue), ref(stats));
+   }
+
+   cerr << "listening on " << opts.socket_path << " with " << workers.size() << " workers, batches of up to " << opts.batch << "\n";
+   while (!stop_requested)
+   {
+      pollfd waiting = {listen_fd, POLLIN, 0};
+      if (::poll(&waiting, 1, ACCEPT_POLL_MS) <= 0)
+      {
+         continue;
+      }
+      int fd = ::accept(listen_fd, nullptr, nullptr);
+      if (fd < 0)
+      {
+         continue;
+      }
+      auto client = make_shared<connection>(fd);
+      {
+         lock_guard<mutex> lock(connections.state_mutex);
+         connections.live[fd] = client;
+      }
+      thread(read_requests, client, ref(queue)).detach();
+      thread(write_responses, client, ref(connections)).detach();
+   }
+
+   /* stop reading from every client, answer and send whatever is already read, then stop */
+   ::close(listen_fd);
+   ::unlink(opts.socket_path.c_str());
+   {
+      unique_lock<mutex> lock(connections.state_mutex);
+      auto shutdown_all = [&](int how)
+      {
+         for (auto &[fd, weak] : connections.live)
+         {
+            if (auto client = weak.lock())
+            {
+               ::shutdown(client->fd, how);
+            }
+         }
+      };
+      shutdown_all(SHUT_RD);
+      if (!connections.all_done.wait_for(lock, chrono::milliseconds(SHUTDOWN_GRACE_MS), [&] { return connections.live.empty(); }))
+      {
+         // a client that stopped reading leaves its writer blocked in write_frame(), the failed write drops the rest
+         LP_LOG_WARNING("cutting off " << connections.live.size() << " clients that stopped reading");
+         shutdown_all(SHUT_RDWR);
+      }
+      connections.all_done.wait(lock, [&] { return connections.live.empty(); });
+   }
+   queue.close();
+   for (auto &worker : workers)
+   {
+      worker.join();
+   }
+
+   cerr << "served " << stats.requests << " requests, " << stats.failures << " failed, in " << stats.batches << " batches ("
+        << ((stats.batches > 0) ? static_cast<double>(stats.requests) / stats.batches : 0) << " per batch, largest "
+        << stats.largest_batch << ")\n";
+   return 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file test_compact_coords.cpp
+ * @brief FLOAT32 obstacle indexes find the same obstacles as DOUBLE ones, and compact encodings stay within their stated error
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "compact_coords.hpp"
+#include "obstacle_index.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+const double NEAR_OFFSETS[] = {0.0, 1e-12, -1e-12, 1e-7, -1e-7, 1e-3, -1e-3}; ///< distances off tangent for the near-tangent queries
+
+/**
+ * @brief run every query against both indexes and compare the hits
+ * @param exact DOUBLE index
+ * @param compact FLOAT32 index of the same obstacles
+ * @param a segment start, also the point under test
+ * @param b segment end
+ * @param box box under test
+ */
+static void check_queries(const obstacle_index &exact, const obstacle_index &compact, const Point &a, const Point &b, const Boundary &box)
+{
+   Point segment[] = {a, b};
+   auto path_exact = query_path_hits(exact, segment);
+   auto path_compact = query_path_hits(compact, segment);
+   CHECK(equal(path_exact.begin(), path_exact.end(), path_compact.begin(), path_compact.end()));
+   auto point_exact = query_point_hits(exact, a);
+   auto point_compact = query_point_hits(compact, a);
+   CHECK(equal(point_exact.begin(), point_exact.end(), point_compact.begin(), point_compact.end()));
+   auto outline_exact = query_outline_hits(exact, box);
+   auto outline_compact = query_outline_hits(compact, box);
+   CHECK(equal(outline_exact.begin(), outline_exact.end(), outline_compact.begin(), outline_compact.end()));
+   auto box_exact = query_box_hits(exact, box);
+   auto box_compact = query_box_hits(compact, box);
+   CHECK(equal(box_exact.begin(), box_exact.end(), box_compact.begin(), box_compact.end()));
+}
+
+/**
+ * @brief the two index modes agree on random and near-tangent queries, far enough from 0 that float32 rounds
+ * @param rng random source
+ */
+static void test_index_modes(mt19937 &rng)
+{
+   uniform_real_distribution<double> coord(-200.0, 200.0);
+   uniform_real_distribution<double> radius(0.5, 20.0);
+   uniform_real_distribution<double> angle(0.0, 2.0 * M_PI);
+   const Point center(40000.0, -25000.0);
+   auto random_point = [&]() { return Point(center.x() + coord(rng), center.y() + coord(rng)); };
+
+   vector<obstacle> obstacles;
+   for (int i = 0; i < 300; i++)
+   {
+      obstacles.push_back({random_point(), radius(rng)});
+   }
+   obstacle_index exact = build_obstacle_index(obstacles, coordinate_mode::DOUBLE);
+   obstacle_index compact = build_obstacle_index(obstacles, coordinate_mode::FLOAT32);
+
+   for (int q = 0; q < 500; q++)
+   {
+      Point a = random_point();
+      Point b = random_point();
+      Boundary box(Point(min(a.x(), b.x()), min(a.y(), b.y())), Point(max(a.x(), b.x()), max(a.y(), b.y())));
+      check_queries(exact, compact, a, b, box);
+   }
+
+   // segments tangent to each circle, points on it, and boxes whose edge touches it
+   for (auto &o : obstacles)
+   {
+      for (double offset : NEAR_OFFSETS)
+      {
+         double theta = angle(rng);
+         double ux = cos(theta);
+         double uy = sin(theta);
+         double r = o.radius + offset;
+         Point touch(o.p.x() + r * ux, o.p.y() + r * uy);
+         Point before(touch.x() + 10.0 * uy, touch.y() - 10.0 * ux);
+         Point after(touch.x() - 10.0 * uy, touch.y() + 10.0 * ux);
+         Point outward(touch.x() + 5.0 * ux, touch.y() + 5.0 * uy);
+         Boundary outside(Point(o.p.x() + r, o.p.y() - 1.0), Point(o.p.x() + r + 4.0, o.p.y() + 1.0));
+         Boundary around(Point(o.p.x() - r, o.p.y() - r), Point(o.p.x() + r, o.p.y() + r));
+         check_queries(exact, compact, before, after, outside);
+         check_queries(exact, compact, touch, outward, around);
+      }
+   }
+}
+
+/**
+ * @brief FLOAT32 halves the coordinate lanes, but the index keeps every obstacle in double, so it shrinks by much less
+ * @param rng random source
+ */
+static void test_index_memory(mt19937 &rng)
+{
+   uniform_real_distribution<double> coord(0.0, 1000.0);
+   uniform_real_distribution<double> radius(0.5, 5.0);
+   vector<obstacle> obstacles;
+   for (int i = 0; i < 4000; i++)
+   {
+      obstacles.push_back({Point(coord(rng), coord(rng)), radius(rng)});
+   }
+   obstacle_index exact = build_obstacle_index(obstacles, coordinate_mode::DOUBLE);
+   obstacle_index compact = build_obstacle_index(obstacles, coordinate_mode::FLOAT32);
+
+   // 3 floats and an id per lane against 3 doubles and an id
+   double lane_ratio = static_cast<double>(obstacle_soa_bytes(compact.soa)) / obstacle_soa_bytes(exact.soa);
+   CHECK(lane_ratio > 0.55 && lane_ratio < 0.6);
+   double index_ratio = static_cast<double>(obstacle_index_bytes(compact)) / obstacle_index_bytes(exact);
+   CHECK(index_ratio > 0.75 && index_ratio < 0.85);
+   CHECK(compact.obstacles.size() == obstacles.size());
+}
+
+/**
+ * @brief points of a map come back from a compact_line within compact_resolution()
+ * @param rng random source
+ */
+static void test_compact_line(mt19937 &rng)
+{
+   const Boundary maps[] = {Boundary(Point(0.0, 0.0), Point(1000.0, 1000.0)),
+                            Boundary(Point(-3e5, 2e5), Point(-1e5, 7e5)),
+                            Boundary(Point(1e6, 1e6), Point(1e6 + 5.0, 1e6 + 3.0))};
+   for (auto &bounds : maps)
+   {
+      local_frame frame = make_local_frame(bounds);
+      double resolution = compact_resolution(frame, bounds);
+      uniform_real_distribution<double> x(bounds.min_corner().x(), bounds.max_corner().x());
+      uniform_real_distribution<double> y(bounds.min_corner().y(), bounds.max_corner().y());
+      Line path = {bounds.min_corner(), bounds.max_corner(), Point(bounds.min_corner().x(), bounds.max_corner().y())};
+      for (int i = 0; i < 1000; i++)
+      {
+         path.push_back(Point(x(rng), y(rng)));
+      }
+      Line restored = from_compact_line(frame, to_compact_line(frame, path));
+      CHECK(restored.size() == path.size());
+      for (size_t i = 0; i < min(path.size(), restored.size()); i++)
+      {
+         CHECK(bg::distance(path[i], restored[i]) <= resolution);
+      }
+   }
+}
+
+/**
+ * @brief DroneStatus.msg angles and positions come back within one step
+ * @param rng random source
+ */
+static void test_quantized(mt19937 &rng)
+{
+   uniform_real_distribution<double> degrees(-180.0, 180.0);
+   for (int i = 0; i < 100000; i++)
+   {
+      double d = degrees(rng);
+      double error = fabs(dequantize_degrees(quantize_degrees(d)) - d);
+      // just under 180 rounds up to 2^32 and wraps to -180, the same angle
+      CHECK(fmin(error, 360.0 - error) <= WGS84_QUANTUM_DEGREES);
+   }
+   CHECK(quantize_degrees(-180.0) == 0);
+   CHECK(quantize_degrees(0.0) == INT32_MIN);
+   CHECK(quantize_degrees(180.0) == 0);
+   CHECK(dequantize_degrees(INT32_MIN) == 0.0);
+
+   // origins near the equator, at high latitude and on the antimeridian
+   uniform_real_distribution<double> meters(-20000.0, 20000.0);
+   for (auto [latitude, longitude] : {pair<double, double>{0.0, 0.0}, {39.7392, -104.9903}, {71.0, 25.8}, {-16.5, 180.0}})
+   {
+      wgs84_frame frame = make_wgs84_frame({quantize_degrees(latitude), quantize_degrees(longitude)});
+      for (int i = 0; i < 1000; i++)
+      {
+         Point p(meters(rng), meters(rng));
+         Point restored = from_quantized(frame, to_quantized(frame, p));
+         CHECK(fabs(restored.x() - p.x()) <= frame.meters_per_step_x);
+         CHECK(fabs(restored.y() - p.y()) <= frame.meters_per_step_y);
+      }
+   }
+}
+
+int main()
+{
+   mt19937 rng(14);
+   test_index_modes(rng);
+   test_index_memory(rng);
+   test_compact_line(rng);
+   test_quantized(rng);
+   return test_result("test_compact_coords");
+}
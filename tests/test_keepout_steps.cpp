@@ -0,0 +1,88 @@
+/**
+ * @file test_keepout_steps.cpp
+ * @brief A 100 x 100 fleet around one shared obstacle plans in bounds, keepouts grow per selected path, not per bid
+ */
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "logging.hpp"
+#include "pathfinding.hpp"
+#include "pathfinding_core.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+const size_t FLEET_SIZE = 100; ///< agents, and targets, of the fleet
+const double CENTER_Y = 50.0; ///< height of the obstacle center, the fleet straddles it
+const double LANE_WIDTH = 0.15; ///< gap between the straight lines on either side of the center
+
+/**
+ * @brief every agent and target of a fleet crossing one obstacle, each straight line through it
+ * Lanes are listed from the center line outwards, alternating above and below, so each selected path
+ * wraps outside the paths selected before it on its side
+ * @param agents output, one per lane on the left of the obstacle
+ * @param targets output, one per lane on the right of the obstacle
+ */
+static void fleet(vector<Point> &agents, vector<Point> &targets)
+{
+   for (size_t k = 0; k < FLEET_SIZE; k++)
+   {
+      double offset = (0.5 + static_cast<double>(k / 2)) * LANE_WIDTH;
+      double y = CENTER_Y + ((k % 2 == 0) ? offset : -offset);
+      agents.push_back(Point(10.0, y));
+      targets.push_back(Point(90.0, y));
+   }
+}
+
+/**
+ * @brief plan the fleet, every path wraps the obstacle, stays in bounds and within one keepout step per selected path
+ * Reserving steps per bid took 10,000 steps around the obstacle, which pushed paths off the map
+ * @param mode assignment mode under test
+ */
+static void test_fleet_in_bounds(assignment_mode mode)
+{
+   pathfind_config config;
+   config.assignment = mode;
+   config.engine = path_engine::TANGENT;
+   config.max_agents = FLEET_SIZE;
+   Planner planner(config);
+   Boundary bounds(Point(0.0, 0.0), Point(100.0, 100.0));
+   vector<Point> agents;
+   vector<Point> targets;
+   fleet(agents, targets);
+   obstacle shared = {Point(50.0, CENTER_Y), 8.0};
+
+   vector<pathfind_result> results;
+   try
+   {
+      results = planner.plan(bounds, agents, targets, {shared});
+   }
+   catch (const exception &)
+   {
+      CHECK(false);
+      return;
+   }
+   CHECK(results.size() == FLEET_SIZE);
+
+   // the nth path selected around the obstacle is at most n steps wider than it
+   const double widest = shared.radius + FLEET_SIZE * config.min_keepout_buffer;
+   for (auto &result : results)
+   {
+      CHECK(result.path.size() > 2);
+      CHECK(is_path_in_bounds(result.path, bounds));
+      for (const Point &p : result.path)
+      {
+         CHECK(fabs(p.y() - CENTER_Y) <= widest + 1e-9);
+      }
+   }
+}
+
+int main()
+{
+   set_log_level(log_level::NONE);
+   test_fleet_in_bounds(assignment_mode::GREEDY);
+   test_fleet_in_bounds(assignment_mode::OPTIMAL);
+   return test_result("test_keepout_steps");
+}
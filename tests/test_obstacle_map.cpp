@@ -0,0 +1,124 @@
+/**
+ * @file test_obstacle_map.cpp
+ * @brief An obstacle_map edited with insert() and remove() matches one built fresh from the same obstacles
+ */
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "obstacle_map.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+const double MAP_SIZE = 30.0;
+const double CLEARANCE = 0.25;
+
+/**
+ * @brief draw a random obstacle, some of them overlap each other or the bounds
+ * @param rng random generator
+ * @return obstacle inside the map
+ */
+static obstacle random_obstacle(mt19937 &rng)
+{
+   uniform_real_distribution<double> coord(0.0, MAP_SIZE);
+   uniform_real_distribution<double> radius(0.3, 1.5);
+   return {Point(coord(rng), coord(rng)), radius(rng)};
+}
+
+/**
+ * @brief draw a random point that keeps clearance from every obstacle
+ * @param rng random generator
+ * @param obstacles live obstacles
+ * @return free point inside the map
+ */
+static Point random_free_point(mt19937 &rng, const vector<pair<size_t, obstacle>> &obstacles)
+{
+   uniform_real_distribution<double> coord(0.0, MAP_SIZE);
+   while (true)
+   {
+      Point p(coord(rng), coord(rng));
+      bool is_free = true;
+      for (auto &live : obstacles)
+      {
+         is_free = is_free && bg::distance(p, live.second.p) > live.second.radius + CLEARANCE + 1e-6;
+      }
+      if (is_free)
+      {
+         return p;
+      }
+   }
+}
+
+/**
+ * @brief compare an edited map against a fresh build of its live obstacles
+ * @param edited map after inserts and removes
+ * @param obstacles its live obstacles with their ids
+ * @param rng random generator for the queries
+ */
+static void check_matches_fresh(const obstacle_map &edited, const vector<pair<size_t, obstacle>> &obstacles, mt19937 &rng)
+{
+   vector<obstacle> shapes;
+   for (auto &live : obstacles)
+   {
+      shapes.push_back(live.second);
+   }
+   obstacle_map fresh(Boundary(Point(0, 0), Point(MAP_SIZE, MAP_SIZE)), shapes, CLEARANCE);
+   CHECK(edited.num_obstacles() == fresh.num_obstacles());
+   CHECK(edited.num_edges() == fresh.num_edges());
+
+   for (int q = 0; q < 25; q++)
+   {
+      Point agent = random_free_point(rng, obstacles);
+      Point target = random_free_point(rng, obstacles);
+      Line a = edited.find_path(agent, target);
+      Line b = fresh.find_path(agent, target);
+      CHECK(a.empty() == b.empty());
+      if (!a.empty() && !b.empty())
+      {
+         double length = bg::length(b);
+         CHECK(fabs(bg::length(a) - length) <= 1e-6 * (1.0 + length));
+      }
+   }
+}
+
+int main()
+{
+   mt19937 rng(7);
+   Boundary bounds(Point(0, 0), Point(MAP_SIZE, MAP_SIZE));
+
+   vector<pair<size_t, obstacle>> live;
+   vector<obstacle> initial;
+   for (size_t i = 0; i < 40; i++)
+   {
+      initial.push_back(random_obstacle(rng));
+      live.push_back({i, initial.back()});
+   }
+   obstacle_map map(bounds, initial, CLEARANCE);
+   check_matches_fresh(map, live, rng);
+
+   /* churn well past the point where dead bitangents get compacted */
+   for (int round = 1; round <= 300; round++)
+   {
+      obstacle o = random_obstacle(rng);
+      live.push_back({map.insert(o), o});
+      size_t victim = uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+      map.remove(live[victim].first);
+      live.erase(live.begin() + victim);
+      if (round % 60 == 0)
+      {
+         check_matches_fresh(map, live, rng);
+      }
+   }
+
+   /* a removed id stays removed */
+   size_t id = map.insert(random_obstacle(rng));
+   map.remove(id);
+   CHECK_THROWS(map.remove(id), invalid_argument);
+   check_matches_fresh(map, live, rng);
+
+   return test_result("test_obstacle_map");
+}
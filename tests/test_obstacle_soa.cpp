@@ -0,0 +1,148 @@
+/**
+ * @file test_obstacle_soa.cpp
+ * @brief The AVX2 and scalar obstacle_soa kernels return the same masks, and those masks match the double predicates
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <random>
+#include <vector>
+
+#include "obstacle_soa.hpp"
+#include "geometry_kernels.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+const double NEAR_OFFSETS[] = {0.0, 1e-12, -1e-12, 1e-7, -1e-7, 1e-3, -1e-3}; ///< distances off tangent for the near-tangent queries
+
+/**
+ * @brief run one kernel with the SIMD kernels on and off and compare, then check the lanes against the double predicate
+ * @param soa obstacle store
+ * @param obstacles obstacles the store was built from
+ * @param block block to test
+ * @param kernel calls one of the *_hit_mask() kernels
+ * @param is_hit double predicate the kernel stands for
+ */
+static void check_block(const obstacle_soa &soa, const vector<obstacle> &obstacles, size_t block,
+                        const function<uint32_t(uint32_t &)> &kernel, const function<bool(const obstacle &)> &is_hit)
+{
+   uint32_t simd_uncertain = 0;
+   uint32_t scalar_uncertain = 0;
+   set_simd_kernels(true);
+   uint32_t simd_mask = kernel(simd_uncertain);
+   set_simd_kernels(false);
+   uint32_t scalar_mask = kernel(scalar_uncertain);
+   CHECK(simd_mask == scalar_mask);
+   CHECK(simd_uncertain == scalar_uncertain);
+   CHECK((scalar_mask & scalar_uncertain) == 0);
+
+   for (size_t k = 0; k < OBSTACLE_LANES; k++)
+   {
+      uint32_t id = soa.ids[block * OBSTACLE_LANES + k];
+      bool is_set = (scalar_mask >> k) & 1;
+      bool is_uncertain = (scalar_uncertain >> k) & 1;
+      if (id == NO_OBSTACLE)
+      {
+         // NaN padding never hits
+         CHECK(!is_set && !is_uncertain);
+      }
+      else if (!is_uncertain)
+      {
+         CHECK(is_set == is_hit(obstacles[id]));
+      }
+   }
+}
+
+/**
+ * @brief test every block of a store against a segment, a point and a box
+ * @param soa obstacle store
+ * @param obstacles obstacles the store was built from
+ * @param a segment start, also the point under test
+ * @param b segment end
+ * @param box box under test
+ */
+static void check_queries(const obstacle_soa &soa, const vector<obstacle> &obstacles, const Point &a, const Point &b, const Boundary &box)
+{
+   for (size_t block = 0; block < num_blocks(soa); block++)
+   {
+      check_block(soa, obstacles, block, [&](uint32_t &u) { return segment_hit_mask(soa, block, a, b, u); },
+                  [&](const obstacle &o) { return segment_intersects_circle(a, b, o); });
+      check_block(soa, obstacles, block, [&](uint32_t &u) { return point_hit_mask(soa, block, a, u); },
+                  [&](const obstacle &o) { return point_in_circle(a, o); });
+      check_block(soa, obstacles, block, [&](uint32_t &u) { return outline_hit_mask(soa, block, box, u); },
+                  [&](const obstacle &o) { return circle_reaches_outline(box, o); });
+   }
+}
+
+int main()
+{
+   mt19937 rng(13);
+   uniform_real_distribution<double> coord(-25.0, 25.0);
+   uniform_real_distribution<double> radius(0.1, 5.0);
+   uniform_real_distribution<double> angle(0.0, 2.0 * M_PI);
+   const Point center(1000.0, -500.0);
+   auto random_point = [&]() { return Point(center.x() + coord(rng), center.y() + coord(rng)); };
+
+   set_simd_kernels(true);
+   if (string(obstacle_kernel_name()) != "avx2")
+   {
+      cout << "test_obstacle_soa: no AVX2 kernels on this build or CPU, comparing scalar with itself" << endl;
+   }
+
+   // counts that leave 0, 3, 5 and 7 NaN padding lanes in the last block
+   for (size_t count : {8, 5, 13, 37, 1})
+   {
+      vector<obstacle> obstacles;
+      for (size_t i = 0; i < count; i++)
+      {
+         obstacles.push_back({random_point(), radius(rng)});
+      }
+      vector<size_t> order(count);
+      iota(order.begin(), order.end(), 0);
+      shuffle(order.begin(), order.end(), rng);
+
+      for (coordinate_mode mode : {coordinate_mode::DOUBLE, coordinate_mode::FLOAT32})
+      {
+         obstacle_soa soa = build_obstacle_soa(obstacles, order, mode);
+
+         /* random queries */
+         for (int q = 0; q < 200; q++)
+         {
+            Point a = random_point();
+            Point b = random_point();
+            Boundary box(Point(min(a.x(), b.x()), min(a.y(), b.y())), Point(max(a.x(), b.x()), max(a.y(), b.y())));
+            check_queries(soa, obstacles, a, b, box);
+            check_queries(soa, obstacles, a, a, box);
+         }
+
+         /* queries grazing each obstacle: tangent segments, segments ending on the circle, points on it, and box edges touching it */
+         for (auto &o : obstacles)
+         {
+            for (double offset : NEAR_OFFSETS)
+            {
+               double theta = angle(rng);
+               double ux = cos(theta);
+               double uy = sin(theta);
+               double r = o.radius + offset;
+               Point touch(o.p.x() + r * ux, o.p.y() + r * uy);
+               Point before(touch.x() + 3.0 * uy, touch.y() - 3.0 * ux);
+               Point after(touch.x() - 3.0 * uy, touch.y() + 3.0 * ux);
+               Point outward(touch.x() + 2.0 * ux, touch.y() + 2.0 * uy);
+               Boundary outside(Point(o.p.x() + r, o.p.y() - 1.0), Point(o.p.x() + r + 4.0, o.p.y() + 1.0));
+               Boundary around(Point(o.p.x() - r, o.p.y() - r), Point(o.p.x() + r, o.p.y() + r));
+               check_queries(soa, obstacles, before, after, outside);
+               check_queries(soa, obstacles, touch, outward, around);
+            }
+         }
+      }
+   }
+   set_simd_kernels(true);
+
+   return test_result("test_obstacle_soa");
+}
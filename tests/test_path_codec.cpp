@@ -0,0 +1,169 @@
+/**
+ * @file test_path_codec.cpp
+ * @brief encode_paths() and decode_paths() round trip within the frame's error, and damaged messages are rejected
+ */
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "path_codec.hpp"
+#include "compact_coords.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+/**
+ * @brief random paths inside a box, the box corners included
+ * @param rng random generator
+ * @param bounds box every point lies in
+ * @return path_buffer of a few paths
+ */
+static path_buffer random_paths(mt19937 &rng, const Boundary &bounds)
+{
+   uniform_real_distribution<double> x(bounds.min_corner().x(), bounds.max_corner().x());
+   uniform_real_distribution<double> y(bounds.min_corner().y(), bounds.max_corner().y());
+   path_buffer paths;
+   for (int id : {3, -7, 0, 1000})
+   {
+      pathfind_result result = {id, Point(x(rng), y(rng)), Point(x(rng), y(rng)), {}};
+      result.path.push_back(result.agent);
+      for (int k = 0; k < 6; k++)
+      {
+         result.path.push_back(Point(x(rng), y(rng)));
+      }
+      result.path.push_back(result.target);
+      path_buffer_append(paths, result);
+   }
+   path_buffer_append(paths, {9, bounds.min_corner(), bounds.max_corner(), {bounds.min_corner(), bounds.max_corner()}});
+   return paths;
+}
+
+/**
+ * @brief decode a message and compare it with the paths it was encoded from
+ * @param frame frame of the message
+ * @param paths encoded paths
+ * @param message message from encode_paths()
+ * @param max_error largest coordinate error allowed
+ * @return decoded paths
+ */
+static path_buffer check_round_trip(const path_frame &frame, const path_buffer &paths, const vector<char> &message, double max_error)
+{
+   path_buffer decoded;
+   decode_paths(frame, message, decoded);
+   CHECK(decoded.ids == paths.ids);
+   CHECK(decoded.offsets == paths.offsets);
+   for (size_t k = 0; k < paths.points.size() && k < decoded.points.size(); k++)
+   {
+      CHECK(fabs(decoded.points[k].x() - paths.points[k].x()) <= max_error);
+      CHECK(fabs(decoded.points[k].y() - paths.points[k].y()) <= max_error);
+   }
+   for (size_t i = 0; i < path_buffer_size(decoded); i++)
+   {
+      CHECK(bg::equals(decoded.agents[i], path_buffer_path(decoded, i).front()));
+      CHECK(bg::equals(decoded.targets[i], path_buffer_path(decoded, i).back()));
+   }
+   return decoded;
+}
+
+int main()
+{
+   mt19937 rng(5);
+   const Boundary bounds(Point(-3.0, 2.0), Point(7.0, 4.5));
+
+   /* round trips, a step is the box size / 2^bits, and only the max corner can be more than half a step off */
+   for (int bits : {1, 8, 16, 24, 32})
+   {
+      path_frame frame = {bounds, bits};
+      path_buffer paths = random_paths(rng, bounds);
+      vector<char> message;
+      encode_paths(frame, paths, message);
+      double step = 10.0 / ldexp(1.0, bits);
+      CHECK(fabs(path_frame_max_error(frame) - step) <= 1e-15);
+      path_buffer decoded = check_round_trip(frame, paths, message, step * (1.0 + 1e-9));
+
+      size_t corner = paths.offsets[path_buffer_size(paths) - 1];
+      for (size_t k = 0; k < corner; k++)
+      {
+         CHECK(fabs(decoded.points[k].x() - paths.points[k].x()) <= step / 2 * (1.0 + 1e-9) ||
+               paths.points[k].x() > bounds.max_corner().x() - step / 2);
+      }
+      CHECK(bg::equals(decoded.points[corner], bounds.min_corner()));
+
+      // decoded points sit on the lattice, so they encode to the same message
+      vector<char> again;
+      encode_paths(frame, decoded, again);
+      CHECK(again == message);
+   }
+
+   /* the 32-bit lattice is DroneStatus.msg's, lo + span * (u / 2^32) */
+   {
+      path_frame frame = {Boundary(Point(-180.0, -180.0), Point(180.0, 180.0)), 32};
+      path_buffer paths;
+      Point p(-122.3321, 47.6062);
+      path_buffer_append(paths, {0, p, p, {p}});
+      vector<char> message;
+      encode_paths(frame, paths, message);
+      path_buffer decoded;
+      decode_paths(frame, message, decoded);
+      CHECK(decoded.points[0].x() == dequantize_degrees(quantize_degrees(p.x())));
+      CHECK(decoded.points[0].y() == dequantize_degrees(quantize_degrees(p.y())));
+   }
+
+   /* a WGS84 frame quantizes to the same int32 latitude and longitude as to_quantized() */
+   {
+      wgs84_frame planning = make_wgs84_frame({quantize_degrees(47.6062), quantize_degrees(-122.3321)});
+      path_frame frame = wgs84_path_frame(planning);
+      path_buffer paths = random_paths(rng, Boundary(Point(-5000.0, -5000.0), Point(5000.0, 5000.0)));
+      vector<char> message;
+      encode_paths(frame, paths, message);
+      path_buffer decoded = check_round_trip(frame, paths, message, path_frame_max_error(frame));
+      for (size_t k = 0; k < paths.points.size(); k++)
+      {
+         quantized_position sent = to_quantized(planning, paths.points[k]);
+         quantized_position received = to_quantized(planning, decoded.points[k]);
+         CHECK(sent.latitude == received.latitude && sent.longitude == received.longitude);
+         CHECK(bg::distance(decoded.points[k], from_quantized(planning, sent)) < 1e-6);
+      }
+   }
+
+   /* damaged messages throw instead of decoding */
+   {
+      path_frame frame = {bounds, 16};
+      path_buffer paths = random_paths(rng, bounds);
+      vector<char> message;
+      encode_paths(frame, paths, message);
+      path_buffer decoded;
+      for (size_t at = 0; at < message.size(); at++)
+      {
+         for (int bit = 0; bit < 8; bit++)
+         {
+            vector<char> damaged = message;
+            damaged[at] = static_cast<char>(damaged[at] ^ (1 << bit));
+            CHECK_THROWS(decode_paths(frame, damaged, decoded), runtime_error);
+         }
+         vector<char> swapped = message;
+         swapped[at] = static_cast<char>(~swapped[at]);
+         CHECK_THROWS(decode_paths(frame, swapped, decoded), runtime_error);
+      }
+      for (size_t length = 0; length < message.size(); length++)
+      {
+         vector<char> truncated(message.begin(), message.begin() + length);
+         CHECK_THROWS(decode_paths(frame, truncated, decoded), runtime_error);
+      }
+      CHECK_THROWS(decode_paths({bounds, 15}, message, decoded), runtime_error);
+   }
+
+   /* bad frames and points outside the frame are the caller's error */
+   {
+      path_buffer paths = random_paths(rng, bounds);
+      vector<char> message;
+      CHECK_THROWS(encode_paths({bounds, 0}, paths, message), invalid_argument);
+      CHECK_THROWS(encode_paths({bounds, 33}, paths, message), invalid_argument);
+      CHECK_THROWS(encode_paths({Boundary(Point(0, 0), Point(0, 1)), 16}, paths, message), invalid_argument);
+      CHECK_THROWS(encode_paths({Boundary(Point(0, 0), Point(1, 1)), 16}, paths, message), invalid_argument);
+   }
+
+   return test_result("test_path_codec");
+}
@@ -0,0 +1,241 @@
+/**
+ * @file test_plan_into.cpp
+ * @brief Planner::plan_into() with a warm plan_workspace plans straight paths without touching the heap, and matches plan()
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "logging.hpp"
+#include "obstacle_index.hpp"
+#include "pathfinding.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+static atomic<size_t> heap_allocs{0}; ///< calls to operator new, the library's included
+
+/**
+ * @brief counting replacements of the global allocation functions, the array and nothrow forms forward to these
+ * The deletes stay out of line, or GCC pairs the inlined free() with operator new at the call site and warns about a mismatch
+ */
+void *operator new(size_t size)
+{
+   heap_allocs.fetch_add(1, memory_order_relaxed);
+   void *p = malloc(max(size, static_cast<size_t>(1)));
+   if (p == nullptr)
+   {
+      throw bad_alloc();
+   }
+   return p;
+}
+
+void *operator new(size_t size, align_val_t alignment)
+{
+   heap_allocs.fetch_add(1, memory_order_relaxed);
+   size_t align = static_cast<size_t>(alignment);
+   void *p = aligned_alloc(align, (max(size, static_cast<size_t>(1)) + align - 1) & ~(align - 1));
+   if (p == nullptr)
+   {
+      throw bad_alloc();
+   }
+   return p;
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept
+{
+   free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept
+{
+   free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, align_val_t) noexcept
+{
+   free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t, align_val_t) noexcept
+{
+   free(p);
+}
+
+/**
+ * a map and the agents and targets planned on it
+ */
+struct scenario
+{
+   Boundary bounds; ///< outer boundary box
+   vector<Point> agents; ///< every agent
+   vector<Point> targets; ///< every target
+   vector<obstacle> obstacles; ///< every obstacle
+};
+
+/**
+ * @brief agents and targets on the left of the map, obstacles only on the right, so every path is a straight line
+ * and greedy bidding leaves crossings to resolve
+ * @param rng random source
+ * @param num_agents number of agents, also the number of targets
+ * @return scenario on a 100 x 100 map
+ */
+static scenario straight_scenario(mt19937 &rng, size_t num_agents)
+{
+   uniform_real_distribution<double> left(5.0, 60.0);
+   uniform_real_distribution<double> right_x(75.0, 95.0);
+   uniform_real_distribution<double> right_y(10.0, 90.0);
+   scenario s = {Boundary(Point(0.0, 0.0), Point(100.0, 100.0)), {}, {}, {}};
+   for (size_t i = 0; i < num_agents; i++)
+   {
+      s.agents.push_back(Point(left(rng), left(rng)));
+      s.targets.push_back(Point(left(rng), left(rng)));
+   }
+   for (int i = 0; i < 6; i++)
+   {
+      s.obstacles.push_back({Point(right_x(rng), right_y(rng)), 3.0});
+   }
+   return s;
+}
+
+/**
+ * @brief a path_buffer holds exactly the given results
+ * @param buffer output of plan_into()
+ * @param results output of plan() for the same inputs
+ * @return true if every id, agent, target and path point matches
+ */
+static bool is_same_plan(const path_buffer &buffer, const vector<pathfind_result> &results)
+{
+   if (buffer.ids.size() != results.size())
+   {
+      return false;
+   }
+   for (size_t i = 0; i < results.size(); i++)
+   {
+      const pathfind_result &r = results[i];
+      if (buffer.ids[i] != r.id || !bg::equals(buffer.agents[i], r.agent) || !bg::equals(buffer.targets[i], r.target) ||
+          buffer.offsets[i + 1] - buffer.offsets[i] != r.path.size())
+      {
+         return false;
+      }
+      for (size_t k = 0; k < r.path.size(); k++)
+      {
+         const Point &p = buffer.points[buffer.offsets[i] + k];
+         if (p.x() != r.path[k].x() || p.y() != r.path[k].y())
+         {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief the second plan_into() of the same straight-line plan makes no heap allocations, with every bidding option
+ * @param rng random source
+ */
+static void test_no_allocations(mt19937 &rng)
+{
+   size_t total_swaps = 0;
+   for (auto mode : {assignment_mode::GREEDY, assignment_mode::OPTIMAL})
+   {
+      for (bool prune : {true, false})
+      {
+         for (bool use_cache : {true, false})
+         {
+            pathfind_config config;
+            config.assignment = mode;
+            config.prune_bids = prune;
+            config.use_path_cache = use_cache;
+            config.max_agents = 16;
+            Planner planner(config);
+            plan_workspace workspace;
+            path_buffer buffer;
+            for (size_t num_agents : {16, 3, 16, 9})
+            {
+               scenario s = straight_scenario(rng, num_agents);
+               obstacle_index index = build_obstacle_index(s.obstacles, config.coordinates);
+               plan_stats stats;
+
+               // obstacles given as a span, the workspace indexes them and keeps the index for the second call
+               planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, buffer, workspace);
+               size_t before = heap_allocs.load(memory_order_relaxed);
+               planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, buffer, workspace, &stats);
+               CHECK(heap_allocs.load(memory_order_relaxed) == before);
+               total_swaps += stats.num_swaps;
+
+               // the plan made in the same workspace is the plan plan() makes
+               CHECK(is_same_plan(buffer, planner.plan(s.bounds, s.agents, s.targets, s.obstacles)));
+
+               // obstacles indexed by the caller
+               planner.plan_into(s.bounds, s.agents, s.targets, index, buffer, workspace);
+               before = heap_allocs.load(memory_order_relaxed);
+               planner.plan_into(s.bounds, s.agents, s.targets, index, buffer, workspace);
+               CHECK(heap_allocs.load(memory_order_relaxed) == before);
+               CHECK(is_same_plan(buffer, planner.plan(s.bounds, s.agents, s.targets, s.obstacles)));
+            }
+         }
+      }
+   }
+   // crossings were resolved along the way, so uncrossing is covered too
+   CHECK(total_swaps > 0);
+}
+
+/**
+ * @brief curved plans still allocate, but a reused workspace gives the same plans as plan() and as a fresh workspace
+ * @param rng random source
+ */
+static void test_curved_plans(mt19937 &rng)
+{
+   uniform_real_distribution<double> coord(5.0, 95.0);
+   for (auto mode : {assignment_mode::GREEDY, assignment_mode::OPTIMAL})
+   {
+      pathfind_config config;
+      config.assignment = mode;
+      config.max_agents = 8;
+      Planner planner(config);
+      plan_workspace workspace;
+      path_buffer buffer;
+      path_buffer fresh;
+      for (int n = 0; n < 20; n++)
+      {
+         scenario s = {Boundary(Point(0.0, 0.0), Point(100.0, 100.0)), {}, {}, {{Point(50.0, 50.0), 8.0}, {Point(25.0, 70.0), 5.0}}};
+         // clear of both obstacles, half agents and half targets
+         while (s.targets.size() < 8)
+         {
+            Point p(coord(rng), coord(rng));
+            if (bg::distance(p, Point(50.0, 50.0)) > 12.0 && bg::distance(p, Point(25.0, 70.0)) > 9.0)
+            {
+               (s.agents.size() < 8 ? s.agents : s.targets).push_back(p);
+            }
+         }
+         vector<pathfind_result> expected;
+         try
+         {
+            expected = planner.plan(s.bounds, s.agents, s.targets, s.obstacles);
+         }
+         catch (const exception &)
+         {
+            CHECK_THROWS(planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, buffer, workspace), exception);
+            continue;
+         }
+         planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, buffer, workspace);
+         CHECK(is_same_plan(buffer, expected));
+         planner.plan_into(s.bounds, s.agents, s.targets, s.obstacles, fresh);
+         CHECK(is_same_plan(fresh, expected));
+      }
+   }
+}
+
+int main()
+{
+   // a logged message allocates its text, keep the planner quiet
+   set_log_level(log_level::NONE);
+   mt19937 rng(17);
+   test_no_allocations(rng);
+   test_curved_plans(rng);
+   return test_result("test_plan_into");
+}
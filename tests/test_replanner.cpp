@@ -0,0 +1,142 @@
+/**
+ * @file test_replanner.cpp
+ * @brief Replanner::replan() rebuilds a kept path when an added obstacle lands on it or on its straight line
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "geometry_kernels.hpp"
+#include "logging.hpp"
+#include "pathfinding.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+/**
+ * @brief distance from a point to the segment a-b
+ * @param p point
+ * @param a start of the segment
+ * @param b end of the segment
+ * @return shortest distance
+ */
+static double distance_to_segment(const Point &p, const Point &a, const Point &b)
+{
+   return bg::distance(p, bg::model::segment<Point>(a, b));
+}
+
+/**
+ * @brief a replanned plan matches a fresh plan of the changed world point by point
+ * @param config tunables of the replanner
+ * @param bounds boundary of the map
+ * @param agents every agent
+ * @param targets every target
+ * @param obstacles every obstacle after the change
+ * @param after results of the replan
+ */
+static void check_matches_fresh_plan(const pathfind_config &config, const Boundary &bounds, const vector<Point> &agents,
+                                     const vector<Point> &targets, const vector<obstacle> &obstacles, const vector<pathfind_result> &after)
+{
+   Planner planner(config);
+   vector<pathfind_result> fresh = planner.plan(bounds, agents, targets, obstacles);
+   CHECK(after.size() == 1 && fresh.size() == 1);
+   if (after.size() == 1 && fresh.size() == 1)
+   {
+      CHECK(after[0].path.size() == fresh[0].path.size());
+      for (size_t k = 0; k < min(after[0].path.size(), fresh[0].path.size()); k++)
+      {
+         CHECK(after[0].path[k].x() == fresh[0].path[k].x() && after[0].path[k].y() == fresh[0].path[k].y());
+      }
+   }
+}
+
+/**
+ * @brief an obstacle dropped onto a detour, clear of the straight agent to target line, drops the cached detour and
+ * the result holding it, so the next path is built against the changed obstacles
+ * @param engine curved path engine under test
+ */
+static void test_obstacle_on_detour(path_engine engine)
+{
+   pathfind_config config;
+   config.engine = engine;
+   Replanner replanner(config);
+   Boundary bounds(Point(0.0, 0.0), Point(20.0, 20.0));
+   vector<Point> agents = {Point(2.0, 10.0)};
+   vector<Point> targets = {Point(18.0, 10.0)};
+   vector<obstacle> obstacles = {{Point(10.0, 10.0), 3.0}};
+
+   vector<pathfind_result> before = replanner.reset(bounds, agents, targets, obstacles);
+   CHECK(before.size() == 1);
+   if (before.size() != 1)
+   {
+      return;
+   }
+   Line detour = before[0].path;
+   CHECK(detour.size() > 2);
+
+   // the point of the detour furthest from the straight line, an obstacle there misses that line by a wide margin
+   Point far = detour[0];
+   for (const Point &p : detour)
+   {
+      if (distance_to_segment(p, agents[0], targets[0]) > distance_to_segment(far, agents[0], targets[0]))
+      {
+         far = p;
+      }
+   }
+   obstacle added = {far, 0.5};
+   CHECK(distance_to_segment(far, agents[0], targets[0]) > 2.0 * added.radius);
+   CHECK(path_intersects_circle(detour, added));
+
+   replan_delta delta;
+   delta.added_obstacles.push_back(added);
+   plan_stats stats;
+   const vector<pathfind_result> &after = replanner.replan(delta, &stats);
+   CHECK(stats.paths_invalidated > 0);
+
+   // the path was rebuilt rather than kept, so the repaired plan is the plan of the changed world from scratch
+   obstacles.push_back(added);
+   check_matches_fresh_plan(config, bounds, agents, targets, obstacles, after);
+}
+
+/**
+ * @brief an obstacle dropped onto the straight agent to target line of a detour, clear of the detour itself, still
+ * drops it, the path calculate_path() builds now wraps that obstacle too
+ * @param engine curved path engine under test
+ */
+static void test_obstacle_on_straight_line(path_engine engine)
+{
+   pathfind_config config;
+   config.engine = engine;
+   Replanner replanner(config);
+   Boundary bounds(Point(0.0, 0.0), Point(20.0, 20.0));
+   vector<Point> agents = {Point(2.0, 10.0)};
+   vector<Point> targets = {Point(18.0, 10.0)};
+   vector<obstacle> obstacles = {{Point(10.0, 10.0), 3.0}};
+
+   vector<pathfind_result> before = replanner.reset(bounds, agents, targets, obstacles);
+   CHECK(before.size() == 1 && before[0].path.size() > 2);
+   if (before.size() != 1)
+   {
+      return;
+   }
+   obstacle added = {Point(5.5, 10.0), 0.3};
+   CHECK(!path_intersects_circle(before[0].path, added));
+
+   replan_delta delta;
+   delta.added_obstacles.push_back(added);
+   plan_stats stats;
+   const vector<pathfind_result> &after = replanner.replan(delta, &stats);
+   CHECK(stats.paths_invalidated > 0);
+   obstacles.push_back(added);
+   check_matches_fresh_plan(config, bounds, agents, targets, obstacles, after);
+}
+
+int main()
+{
+   set_log_level(log_level::NONE);
+   test_obstacle_on_detour(path_engine::HULL);
+   test_obstacle_on_detour(path_engine::TANGENT);
+   test_obstacle_on_straight_line(path_engine::HULL);
+   test_obstacle_on_straight_line(path_engine::TANGENT);
+   return test_result("test_replanner");
+}
@@ -0,0 +1,75 @@
+/**
+ * @file test_scenario_io.cpp
+ * @brief A result row written by write_result_row() parses back to the exact agent, target and path points
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "scenario_io.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+/**
+ * @brief parse the next comma separated number of a row
+ * @param row text of the row
+ * @param pos position of the number, moved past it and the character after it
+ * @return parsed value
+ */
+static double next_number(const string &row, size_t &pos)
+{
+   char *end = nullptr;
+   double v = strtod(row.c_str() + pos, &end);
+   pos = static_cast<size_t>(end - row.c_str()) + 1;
+   return v;
+}
+
+/**
+ * @brief coordinates that need all 17 significant digits round trip through a row bit for bit
+ * The default 6 digits would have turned 1/3 into 0.333333 and 0.1 + 0.2 into 0.3
+ */
+static void test_row_round_trip()
+{
+   pathfind_result result;
+   result.id = 7;
+   result.agent = Point(0.1 + 0.2, 1.0 / 3.0);
+   result.target = Point(123456.789012345678, -2.0 / 7.0);
+   result.path = {result.agent, Point(3.14159265358979312, 1e-17 + 2.0 / 3.0), result.target};
+
+   ostringstream out;
+   out << setprecision(3);
+   write_result_row(out, "4,\"name\",", result);
+   CHECK(out.precision() == 3);
+
+   string row = out.str();
+   string prefix = "4,\"name\",ok,7,";
+   CHECK(row.compare(0, prefix.size(), prefix) == 0);
+   size_t pos = prefix.size();
+   CHECK(next_number(row, pos) == result.agent.x());
+   CHECK(next_number(row, pos) == result.agent.y());
+   CHECK(next_number(row, pos) == result.target.x());
+   CHECK(next_number(row, pos) == result.target.y());
+
+   // path points follow as "[(x,y),(x,y),...]"
+   CHECK(row.compare(pos, 2, "\"[") == 0);
+   pos += 2;
+   for (const Point &p : result.path)
+   {
+      CHECK(row[pos] == '(');
+      pos++;
+      CHECK(next_number(row, pos) == p.x());
+      CHECK(next_number(row, pos) == p.y());
+      pos++; // the comma between points, or the closing bracket
+   }
+   CHECK(row.compare(pos - 1, 3, "]\"\n") == 0);
+}
+
+int main()
+{
+   test_row_round_trip();
+   return test_result("test_scenario_io");
+}
@@ -0,0 +1,148 @@
+/**
+ * @file test_thread_pool.cpp
+ * @brief Plans that bid on a thread_pool match the serial plans bit for bit, curved paths and every assignment mode
+ */
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "logging.hpp"
+#include "pathfinding.hpp"
+#include "thread_pool.hpp"
+#include "test_util.hpp"
+
+using namespace std;
+
+const size_t POOL_WORKERS = 4; ///< background threads of the pool under test
+
+/**
+ * a map and the agents and targets planned on it
+ */
+struct scenario
+{
+   Boundary bounds; ///< outer boundary box
+   vector<Point> agents; ///< every agent
+   vector<Point> targets; ///< every target
+   vector<obstacle> obstacles; ///< every obstacle
+};
+
+/**
+ * @brief obstacles scattered over the middle of the map, agents and targets anywhere clear of them, so most paths curve
+ * @param rng random source
+ * @param num_agents number of agents, also the number of targets
+ * @return scenario on a 100 x 100 map
+ */
+static scenario curved_scenario(mt19937 &rng, size_t num_agents)
+{
+   uniform_real_distribution<double> coord(5.0, 95.0);
+   uniform_real_distribution<double> middle(30.0, 70.0);
+   uniform_real_distribution<double> radius(4.0, 9.0);
+   scenario s = {Boundary(Point(0.0, 0.0), Point(100.0, 100.0)), {}, {}, {}};
+   for (int i = 0; i < 6; i++)
+   {
+      s.obstacles.push_back({Point(middle(rng), middle(rng)), radius(rng)});
+   }
+   while (s.targets.size() < num_agents)
+   {
+      Point p(coord(rng), coord(rng));
+      bool clear = true;
+      for (auto &o : s.obstacles)
+      {
+         clear = clear && bg::distance(p, o.p) > o.radius + 2.0;
+      }
+      if (clear)
+      {
+         (s.agents.size() < num_agents ? s.agents : s.targets).push_back(p);
+      }
+   }
+   return s;
+}
+
+/**
+ * @brief two plans hold the same results, compared with == down to every path point
+ * @param a first plan
+ * @param b second plan
+ * @return true if every id, agent, target and path point matches
+ */
+static bool is_same_plan(const vector<pathfind_result> &a, const vector<pathfind_result> &b)
+{
+   if (a.size() != b.size())
+   {
+      return false;
+   }
+   for (size_t i = 0; i < a.size(); i++)
+   {
+      if (a[i].id != b[i].id || a[i].agent.x() != b[i].agent.x() || a[i].agent.y() != b[i].agent.y() ||
+          a[i].target.x() != b[i].target.x() || a[i].target.y() != b[i].target.y() || a[i].path.size() != b[i].path.size())
+      {
+         return false;
+      }
+      for (size_t k = 0; k < a[i].path.size(); k++)
+      {
+         if (a[i].path[k].x() != b[i].path[k].x() || a[i].path[k].y() != b[i].path[k].y())
+         {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief plan the same scenarios serially and on a pool, for every assignment mode and engine
+ * @param rng random source
+ */
+static void test_pool_matches_serial(mt19937 &rng)
+{
+   thread_pool pool(POOL_WORKERS);
+   size_t num_curved = 0;
+   size_t num_planned = 0;
+   for (auto mode : {assignment_mode::GREEDY, assignment_mode::OPTIMAL})
+   {
+      for (auto engine : {path_engine::HULL, path_engine::TANGENT})
+      {
+         pathfind_config serial_config;
+         serial_config.assignment = mode;
+         serial_config.engine = engine;
+         serial_config.max_agents = 8;
+         serial_config.pool = nullptr;
+         pathfind_config pool_config = serial_config;
+         pool_config.pool = &pool;
+         Planner serial(serial_config);
+         Planner parallel(pool_config);
+
+         for (int n = 0; n < 10; n++)
+         {
+            scenario s = curved_scenario(rng, 8);
+            vector<pathfind_result> expected;
+            try
+            {
+               expected = serial.plan(s.bounds, s.agents, s.targets, s.obstacles);
+            }
+            catch (const exception &)
+            {
+               CHECK_THROWS(parallel.plan(s.bounds, s.agents, s.targets, s.obstacles), exception);
+               continue;
+            }
+            CHECK(is_same_plan(parallel.plan(s.bounds, s.agents, s.targets, s.obstacles), expected));
+            num_planned++;
+            for (auto &result : expected)
+            {
+               num_curved += (result.path.size() > 2) ? 1 : 0;
+            }
+         }
+      }
+   }
+   // most scenarios planned, with more curved paths than plans
+   CHECK(num_planned > 20);
+   CHECK(num_curved > num_planned);
+}
+
+int main()
+{
+   set_log_level(log_level::NONE);
+   mt19937 rng(4);
+   test_pool_matches_serial(rng);
+   return test_result("test_thread_pool");
+}
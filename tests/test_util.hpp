@@ -0,0 +1,58 @@
+/**
+ * @file test_util.hpp
+ * @brief Check macros shared by the test programs in tests/, run them all with make test
+ */
+#ifndef __TEST_UTIL_HPP_
+#define __TEST_UTIL_HPP_
+
+#include <iostream>
+
+inline int test_failures = 0; ///< checks that failed so far in this program
+
+/**
+ * report a failed check with its location and keep going, so one run lists every failure
+ */
+#define CHECK(cond)                                                                               \
+   do                                                                                             \
+   {                                                                                              \
+      if (!(cond))                                                                                \
+      {                                                                                           \
+         std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " << #cond << std::endl;  \
+         test_failures++;                                                                         \
+      }                                                                                           \
+   } while (0)
+
+/**
+ * report a check that expected expr to throw exception_type
+ */
+#define CHECK_THROWS(expr, exception_type)                                                        \
+   do                                                                                             \
+   {                                                                                              \
+      bool caught = false;                                                                        \
+      try                                                                                         \
+      {                                                                                           \
+         expr;                                                                                    \
+      }                                                                                           \
+      catch (const exception_type &)                                                              \
+      {                                                                                           \
+         caught = true;                                                                           \
+      }                                                                                           \
+      if (!caught)                                                                                \
+      {                                                                                           \
+         std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_THROWS failed: " << #expr << std::endl; \
+         test_failures++;                                                                         \
+      }                                                                                           \
+   } while (0)
+
+/**
+ * @brief print the outcome of a test program
+ * @param name name of the test program
+ * @return exit status for main(), 0 if every check passed
+ */
+inline int test_result(const char *name)
+{
+   std::cout << name << ": " << ((test_failures == 0) ? "passed" : "FAILED") << std::endl;
+   return (test_failures == 0) ? 0 : 1;
+}
+
+#endif  // __TEST_UTIL_HPP_